@@ -0,0 +1,60 @@
+/*
+  +--------------------------------------------------------------------------+
+  | libcat                                                                   |
+  +--------------------------------------------------------------------------+
+  | Licensed under the Apache License, Version 2.0 (the "License");          |
+  | you may not use this file except in compliance with the License.         |
+  | You may obtain a copy of the License at                                  |
+  | http://www.apache.org/licenses/LICENSE-2.0                               |
+  | Unless required by applicable law or agreed to in writing, software      |
+  | distributed under the License is distributed on an "AS IS" BASIS,        |
+  | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. |
+  | See the License for the specific language governing permissions and      |
+  | limitations under the License. See accompanying LICENSE file.            |
+  +--------------------------------------------------------------------------+
+  | Author: Twosee <twosee@php.net>                                          |
+  +--------------------------------------------------------------------------+
+ */
+
+#include "cat_api.h"
+
+#define BATCH_SIZE 128
+#define BATCHES    256
+
+static void empty_work(cat_data_t *data)
+{
+    (void) data;
+}
+
+int main(void)
+{
+    cat_data_t *data[BATCH_SIZE] = { NULL };
+    cat_nsec_t start, single, many;
+    size_t n;
+
+    cat_init_all();
+    cat_run(CAT_RUN_EASY);
+
+    start = cat_time_nsec();
+    for (n = 0; n < BATCH_SIZE * BATCHES / 32; n++) {
+        if (!cat_work(CAT_WORK_KIND_CPU, empty_work, NULL, NULL, CAT_TIMEOUT_FOREVER)) {
+            fprintf(stderr, "Error: %s\n", cat_get_last_error_message());
+            return EXIT_FAILURE;
+        }
+    }
+    single = (cat_time_nsec() - start) / (BATCH_SIZE * BATCHES / 32);
+
+    start = cat_time_nsec();
+    for (n = 0; n < BATCHES; n++) {
+        if (!cat_work_many(CAT_WORK_KIND_CPU, empty_work, NULL, data, BATCH_SIZE, CAT_TIMEOUT_FOREVER)) {
+            fprintf(stderr, "Error: %s\n", cat_get_last_error_message());
+            return EXIT_FAILURE;
+        }
+    }
+    many = (cat_time_nsec() - start) / (BATCH_SIZE * BATCHES);
+
+    printf("[cat_work     ] %.2fus per job\n", (double) single / 1000);
+    printf("[cat_work_many] %.2fus per job (batch size %d)\n", (double) many / 1000, BATCH_SIZE);
+
+    return EXIT_SUCCESS;
+}
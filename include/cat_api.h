@@ -36,6 +36,7 @@ extern "C" {
 #include "cat_fs.h"
 #include "cat_signal.h"
 #include "cat_os_wait.h"
+#include "cat_io_uring.h"
 #include "cat_async.h"
 #include "cat_watchdog.h"
 #include "cat_process.h"
@@ -98,6 +98,20 @@ typedef enum cat_coroutine_state_e {
 #undef CAT_COROUTINE_STATE_GEN
 } cat_coroutine_state_t;
 
+/* the lower value is the higher priority */
+#define CAT_COROUTINE_PRIORITY_MAP(XX) \
+    XX(HIGH,   0, "high") \
+    XX(NORMAL, 1, "normal") \
+    XX(LOW,    2, "low") \
+
+typedef enum cat_coroutine_priority_e {
+#define CAT_COROUTINE_PRIORITY_GEN(name, value, unused) CAT_ENUM_GEN(CAT_COROUTINE_PRIORITY_, name, value)
+    CAT_COROUTINE_PRIORITY_MAP(CAT_COROUTINE_PRIORITY_GEN)
+#undef CAT_COROUTINE_PRIORITY_GEN
+} cat_coroutine_priority_t;
+
+#define CAT_COROUTINE_PRIORITY_COUNT (CAT_COROUTINE_PRIORITY_LOW + 1)
+
 typedef uint64_t cat_coroutine_switches_t;
 #define CAT_COROUTINE_SWITCHES_FMT "%" PRIu64
 #define CAT_COROUTINE_SWITCHES_FMT_SPEC PRIu64
@@ -110,6 +124,47 @@ typedef cat_data_t *(*cat_coroutine_function_t)(cat_data_t *data);
 
 typedef struct cat_coroutine_s cat_coroutine_t;
 
+/* coroutine-local storage */
+#define CAT_COROUTINE_LOCAL_MAX_KEYS              128
+#define CAT_COROUTINE_LOCAL_DESTRUCTOR_ITERATIONS 4
+
+typedef uint32_t cat_coroutine_local_key_t;
+
+typedef void (*cat_coroutine_local_destructor_t)(cat_data_t *value);
+
+typedef struct cat_coroutine_local_key_info_s {
+    cat_bool_t used;
+    /* it is increased on deletion, so values of a deleted key are never seen by a new key of the same slot */
+    uint32_t generation;
+    cat_coroutine_local_destructor_t destructor;
+} cat_coroutine_local_key_info_t;
+
+typedef struct cat_coroutine_local_s {
+    cat_data_t *value;
+    /* value is treated as NULL if it does not match the generation of key */
+    uint32_t generation;
+} cat_coroutine_local_t;
+
+/* all times are in nanoseconds */
+typedef struct cat_coroutine_accounting_s {
+    cat_queue_node_t node;
+    /* total time spent running */
+    cat_nsec_t cpu_time;
+    /* total time spent being runnable before it was resumed by scheduler */
+    cat_nsec_t wait_time;
+    /* the longest time it ran without switching out */
+    cat_nsec_t max_slice;
+    /* the longest time it is expected to run without switching out (0 means unlimited),
+     * it is watched by watchdog and it works even if accounting is disabled */
+    cat_nsec_t budget;
+} cat_coroutine_accounting_t;
+
+typedef enum cat_coroutine_accounting_key_e {
+    CAT_COROUTINE_ACCOUNTING_KEY_CPU_TIME,
+    CAT_COROUTINE_ACCOUNTING_KEY_WAIT_TIME,
+    CAT_COROUTINE_ACCOUNTING_KEY_MAX_SLICE
+} cat_coroutine_accounting_key_t;
+
 struct cat_coroutine_s
 {
     union {
@@ -128,6 +183,18 @@ struct cat_coroutine_s
     cat_coroutine_t *from CAT_UNSAFE;
     cat_coroutine_t *previous;
     cat_coroutine_t *next;
+    /* accounting info (readonly) */
+    cat_coroutine_accounting_t accounting;
+    /* coroutine-local storage (it is allocated on first set) */
+    cat_coroutine_local_t *locals;
+    cat_coroutine_local_key_t locals_size;
+    /* absolute deadline of blocking calls (see cat_time_set_deadline()), it is inherited from creator */
+    cat_msec_t deadline;
+    /* priority in the ready queue, it is inherited from creator */
+    cat_coroutine_priority_t priority;
+    /* ready queue info (internal) */
+    cat_queue_node_t ready_node;
+    cat_nsec_t ready_time;
     /* internal properties (readonly) */
     cat_coroutine_function_t function;
     cat_coroutine_stack_size_t stack_size;
@@ -162,8 +229,28 @@ typedef uint32_t cat_coroutine_count_t;
 
 typedef void (*cat_coroutine_deadlock_callback_t)(void);
 
+#define CAT_COROUTINE_READY_DEFAULT_STARVATION_LIMIT 8
+
+/* all times are in nanoseconds */
+typedef struct cat_coroutine_ready_stats_s {
+    /* coroutines waiting in the queue now */
+    cat_coroutine_count_t length;
+    /* coroutines queued/resumed since the stats were reset */
+    uint64_t queued_count;
+    uint64_t resumed_count;
+    /* time between being queued and being resumed */
+    cat_nsec_t total_latency;
+    cat_nsec_t max_latency;
+} cat_coroutine_ready_stats_t;
+
+/* it is called when ready queue becomes non-empty, scheduler should run the ready queue soon */
+typedef void (*cat_coroutine_ready_wakeup_function_t)(void);
+
 typedef cat_msec_t (*cat_coroutine_msec_time_function_t)(void);
 
+/* return the time since which coroutines resumed by scheduler have been runnable (e.g. poll returned) */
+typedef cat_nsec_t (*cat_coroutine_ready_time_function_t)(void);
+
 CAT_GLOBALS_STRUCT_BEGIN(cat_coroutine) {
     /* options */
     cat_coroutine_stack_size_t default_stack_size;
@@ -187,6 +274,22 @@ CAT_GLOBALS_STRUCT_BEGIN(cat_coroutine) {
     cat_coroutine_count_t peak_count;
     /* global switches (for watchdog) */
     cat_coroutine_switches_t switches;
+    /* accounting */
+    cat_bool_t accounting;
+    cat_nsec_t accounting_time;
+    cat_queue_t accounted_coroutines;
+    cat_coroutine_ready_time_function_t ready_time_function;
+    /* coroutine-local storage */
+    cat_coroutine_local_key_info_t local_keys[CAT_COROUTINE_LOCAL_MAX_KEYS];
+    /* ready queue */
+    cat_bool_t ready_queue_enabled;
+    cat_queue_t ready_queues[CAT_COROUTINE_PRIORITY_COUNT];
+    cat_coroutine_count_t ready_count;
+    uint32_t ready_starvation_limit;
+    /* resumptions of higher priorities since the priority was served last time */
+    uint32_t ready_skips[CAT_COROUTINE_PRIORITY_COUNT];
+    cat_coroutine_ready_stats_t ready_stats[CAT_COROUTINE_PRIORITY_COUNT];
+    cat_coroutine_ready_wakeup_function_t ready_wakeup_function;
 } CAT_GLOBALS_STRUCT_END(cat_coroutine);
 
 extern CAT_API CAT_GLOBALS_DECLARE(cat_coroutine);
@@ -215,6 +318,8 @@ CAT_API cat_log_type_t cat_coroutine_set_deadlock_log_type(cat_log_type_t type);
 CAT_API cat_coroutine_deadlock_callback_t cat_coroutine_set_deadlock_callback(cat_coroutine_deadlock_callback_t callback);
 /* function will be used for coroutine_get_start_time()/coroutine_get_end_time() (non-thread-safe) */
 CAT_API cat_coroutine_msec_time_function_t cat_coroutine_set_msec_time_function(cat_coroutine_msec_time_function_t callback);
+/* function will be used for computing wait time of accounting (it is registered by event) */
+CAT_API cat_coroutine_ready_time_function_t cat_coroutine_set_ready_time_function(cat_coroutine_ready_time_function_t function);
 
 /* globals */
 CAT_API cat_coroutine_stack_size_t cat_coroutine_get_default_stack_size(void);
@@ -264,6 +369,59 @@ CAT_API cat_msec_t cat_coroutine_get_end_time(const cat_coroutine_t *coroutine);
 CAT_API cat_msec_t cat_coroutine_get_elapsed(const cat_coroutine_t *coroutine);
 CAT_API char *cat_coroutine_get_elapsed_str(const cat_coroutine_t *coroutine);
 
+/* accounting (opt-in, it costs a clock read per switch) */
+CAT_API void cat_coroutine_enable_accounting(void);
+CAT_API void cat_coroutine_disable_accounting(void);
+CAT_API cat_bool_t cat_coroutine_is_accounting_enabled(void);
+/* time of scheduler is not accounted, it is the time of event loop (including blocking) */
+CAT_API cat_nsec_t cat_coroutine_get_cpu_time(const cat_coroutine_t *coroutine);
+CAT_API cat_nsec_t cat_coroutine_get_wait_time(const cat_coroutine_t *coroutine);
+CAT_API cat_nsec_t cat_coroutine_get_max_slice(const cat_coroutine_t *coroutine);
+CAT_API void cat_coroutine_set_budget(cat_coroutine_t *coroutine, cat_nsec_t budget);
+CAT_API cat_nsec_t cat_coroutine_get_budget(const cat_coroutine_t *coroutine);
+CAT_API void cat_coroutine_set_deadline(cat_coroutine_t *coroutine, cat_msec_t deadline);
+CAT_API cat_msec_t cat_coroutine_get_deadline(const cat_coroutine_t *coroutine);
+/* fill at most n alive coroutines sorted by key in descending order, return the number filled */
+CAT_API size_t cat_coroutine_get_top(cat_coroutine_t **coroutines, size_t n, cat_coroutine_accounting_key_t key);
+/* log top n coroutines sorted by key as info */
+CAT_API void cat_coroutine_dump_top(size_t n, cat_coroutine_accounting_key_t key);
+
+/* coroutine-local storage (like pthread keys):
+ * values are slots indexed by key, destructor is called with the non-NULL value on coroutine exit,
+ * values of a deleted key are neither destructed nor visible to a new key which reuses the slot,
+ * they should be cleared before deletion */
+CAT_API cat_bool_t cat_coroutine_local_key_create(cat_coroutine_local_key_t *key, cat_coroutine_local_destructor_t destructor);
+CAT_API cat_bool_t cat_coroutine_local_key_delete(cat_coroutine_local_key_t key);
+/* get/set value of current coroutine */
+CAT_API cat_data_t *cat_coroutine_local_get(cat_coroutine_local_key_t key);
+CAT_API cat_bool_t cat_coroutine_local_set(cat_coroutine_local_key_t key, cat_data_t *value);
+CAT_API cat_data_t *cat_coroutine_get_local(const cat_coroutine_t *coroutine, cat_coroutine_local_key_t key);
+
+/* priority */
+CAT_API const char *cat_coroutine_priority_name(cat_coroutine_priority_t priority);
+CAT_API cat_coroutine_priority_t cat_coroutine_get_priority(const cat_coroutine_t *coroutine);
+CAT_API void cat_coroutine_set_priority(cat_coroutine_t *coroutine, cat_coroutine_priority_t priority);
+
+/* ready queue (opt-in):
+ * coroutines woken up by I/O callbacks are queued instead of being resumed inline,
+ * then scheduler resumes them after the poll phase in order of priority,
+ * a lower priority is still served once after every starvation_limit resumptions of the higher ones
+ * (0 means strict priority), coroutines resumed by others (e.g. canceled) are dequeued */
+CAT_API void cat_coroutine_enable_ready_queue(void);
+CAT_API void cat_coroutine_disable_ready_queue(void);
+CAT_API cat_bool_t cat_coroutine_is_ready_queue_enabled(void);
+/* return the original one */
+CAT_API uint32_t cat_coroutine_set_ready_starvation_limit(uint32_t limit);
+CAT_API cat_bool_t cat_coroutine_is_ready(const cat_coroutine_t *coroutine);
+CAT_API cat_coroutine_count_t cat_coroutine_get_ready_count(void);
+CAT_API cat_bool_t cat_coroutine_get_ready_stats(cat_coroutine_priority_t priority, cat_coroutine_ready_stats_t *stats);
+CAT_API void cat_coroutine_reset_ready_stats(void);
+/* return the original one */
+CAT_API cat_coroutine_ready_wakeup_function_t cat_coroutine_set_ready_wakeup_function(cat_coroutine_ready_wakeup_function_t function); CAT_INTERNAL
+CAT_API void cat_coroutine_ready(cat_coroutine_t *coroutine); CAT_INTERNAL
+/* return the number of resumed coroutines */
+CAT_API cat_coroutine_count_t cat_coroutine_run_ready_queue(void); CAT_INTERNAL
+
 /* scheduler */
 typedef void (*cat_coroutine_schedule_function_t)(void);
 typedef void (*cat_coroutine_deadlock_function_t)(void);
@@ -290,6 +448,24 @@ static cat_always_inline cat_bool_t cat_coroutine__schedule(cat_coroutine_t *cor
     } \
 } while (0)
 
+/* it is used by I/O callbacks which allow the coroutine to be resumed later (see ready queue),
+ * they must not touch anything the coroutine will read after scheduling it */
+static cat_always_inline cat_bool_t cat_coroutine__wakeup(cat_coroutine_t *coroutine)
+{
+    if (unlikely(CAT_COROUTINE_G(ready_queue_enabled)) &&
+        CAT_COROUTINE_G(current) == CAT_COROUTINE_G(scheduler)) {
+        cat_coroutine_ready(coroutine);
+        return cat_true;
+    }
+    return cat_coroutine__schedule(coroutine);
+}
+
+#define cat_coroutine_wakeup(coroutine, module_name, fmt, ...) do { \
+    if (unlikely(!cat_coroutine__wakeup(coroutine))) { \
+        CAT_CORE_ERROR_WITH_LAST(module_name, fmt " schedule failed", ##__VA_ARGS__); \
+    } \
+} while (0)
+
 /* sync */
 CAT_API cat_bool_t cat_coroutine_wait_all(void);
 CAT_API cat_bool_t cat_coroutine_wait_all_ex(cat_timeout_t timeout);
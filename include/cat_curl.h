@@ -34,6 +34,29 @@ CAT_API cat_bool_t cat_curl_module_shutdown(void);
 CAT_API cat_bool_t cat_curl_runtime_init(void);
 CAT_API cat_bool_t cat_curl_runtime_close(void);
 
+typedef struct cat_curl_stats_s {
+    /* transfers which were performed on the shared multi */
+    uint64_t transfer_count;
+    uint64_t new_connection_count;
+    /* transfers which were done without creating any new connection */
+    uint64_t reused_connection_count;
+    /* the shared multi is driven by curl_multi_socket_action() on readiness of sockets */
+    uint64_t socket_action_count;
+    uint64_t reactor_wakeup_count;
+} cat_curl_stats_t;
+
+/* cat_curl_easy_perform() runs transfers on a runtime-wide multi handle (with CURLPIPE_MULTIPLEX),
+ * so connections are reused across requests and HTTP/2 streams of concurrent coroutines
+ * are multiplexed over the same connection (enabled by default), returns the previous value.
+ * Note: CURLOPT_SHARE of easy handle would be overwritten by the runtime share during the transfer,
+ * and callbacks of easy handle (e.g. CURLOPT_WRITEFUNCTION) are called in the reactor coroutine which
+ * serves all of transfers, so they must not yield (e.g. do socket I/O or sleep), or all of transfers stall */
+CAT_API cat_bool_t cat_curl_enable_shared(cat_bool_t enable);
+CAT_API cat_bool_t cat_curl_is_shared_enabled(void);
+/* share handle of runtime (DNS cache and TLS sessions), it can also be used by easy handles of other multi handles */
+CAT_API CURLSH *cat_curl_get_share(void);
+CAT_API const cat_curl_stats_t *cat_curl_get_stats(void);
+
 CAT_API CURLcode cat_curl_easy_perform(CURL *ch);
 
 CAT_API CURLM *cat_curl_multi_init(void);
@@ -40,6 +40,93 @@ CAT_API void cat_dns_freeaddrinfo(struct addrinfo *response);
 CAT_API cat_bool_t cat_dns_get_ip(char *buffer, size_t buffer_size, const char *name, int af);
 CAT_API cat_bool_t cat_dns_get_ip_ex(char *buffer, size_t buffer_size, const char *name, int af, cat_timeout_t timeout);
 
+/* stub resolver:
+ * it talks to nameservers over UDP (and TCP if the answer was truncated) by socket,
+ * so lookups never occupy the threadpool which is shared with fs and work modules */
+
+#define CAT_DNS_PORT                    53
+#define CAT_DNS_MAX_NAMESERVERS         3
+#define CAT_DNS_MAX_SEARCH_DOMAINS      6
+#define CAT_DNS_MAX_ADDRESSES           16 /* per address family */
+#define CAT_DNS_NAME_BUFFER_SIZE        256
+#define CAT_DNS_UDP_PAYLOAD_SIZE        1232 /* EDNS0, recommended by DNS flag day 2020 */
+
+#define CAT_DNS_DEFAULT_TIMEOUT         5000
+#define CAT_DNS_DEFAULT_ATTEMPTS        2
+#define CAT_DNS_DEFAULT_NDOTS           1
+
+#ifndef CAT_OS_WIN
+#define CAT_DNS_RESOLV_CONF_PATH        "/etc/resolv.conf"
+#define CAT_DNS_HOSTS_PATH              "/etc/hosts"
+#else
+#define CAT_DNS_HOSTS_PATH              "C:\\Windows\\System32\\drivers\\etc\\hosts"
+#endif
+
+#define CAT_DNS_RECORD_TYPE_MAP(XX) \
+    XX(A,     1) \
+    XX(AAAA, 28) \
+    XX(SRV,  33) \
+
+typedef enum cat_dns_record_type_e {
+#define CAT_DNS_RECORD_TYPE_GEN(name, value) CAT_ENUM_GEN(CAT_DNS_RECORD_TYPE_, name, value)
+    CAT_DNS_RECORD_TYPE_MAP(CAT_DNS_RECORD_TYPE_GEN)
+#undef CAT_DNS_RECORD_TYPE_GEN
+} cat_dns_record_type_t;
+
+typedef struct cat_dns_srv_record_s {
+    uint16_t priority;
+    uint16_t weight;
+    uint16_t port;
+    char target[CAT_DNS_NAME_BUFFER_SIZE];
+} cat_dns_srv_record_t;
+
+typedef struct cat_dns_record_s {
+    cat_dns_record_type_t type;
+    uint32_t ttl;
+    union {
+        struct in_addr a;
+        struct in6_addr aaaa;
+        cat_dns_srv_record_t srv;
+    } data;
+} cat_dns_record_t;
+
+typedef struct cat_dns_resolver_options_s {
+    cat_sockaddr_inet_info_t nameservers[CAT_DNS_MAX_NAMESERVERS];
+    unsigned int nameserver_count;
+    char search[CAT_DNS_MAX_SEARCH_DOMAINS][CAT_DNS_NAME_BUFFER_SIZE];
+    unsigned int search_count;
+    unsigned int ndots;
+    /* timeout of each try (in milliseconds) */
+    cat_timeout_t timeout;
+    /* times of trying all nameservers */
+    unsigned int attempts;
+    cat_bool_t rotate;
+} cat_dns_resolver_options_t;
+
+CAT_API void cat_dns_resolver_options_init(cat_dns_resolver_options_t *options);
+/* parse content in resolv.conf format (nameserver, domain, search and options) */
+CAT_API void cat_dns_resolver_options_parse(cat_dns_resolver_options_t *options, const char *data, size_t length);
+CAT_API cat_bool_t cat_dns_resolver_options_load(cat_dns_resolver_options_t *options, const char *path);
+CAT_API cat_bool_t cat_dns_resolver_options_add_nameserver(cat_dns_resolver_options_t *options, const char *ip, size_t ip_length, int port);
+
+/* options will be loaded from resolv.conf if it is NULL */
+CAT_API cat_bool_t cat_dns_resolver_configure(const cat_dns_resolver_options_t *options);
+CAT_API const cat_dns_resolver_options_t *cat_dns_resolver_get_options(void);
+/* hosts will be loaded from the system hosts file if path is NULL */
+CAT_API cat_bool_t cat_dns_resolver_load_hosts(const char *path);
+
+/* getaddrinfo() will use stub resolver instead of threadpool if it was enabled,
+ * it can also be enabled by env CAT_DNS_STUB_RESOLVER=1,
+ * returns the previous value */
+CAT_API cat_bool_t cat_dns_enable_stub_resolver(cat_bool_t enable);
+CAT_API cat_bool_t cat_dns_is_stub_resolver_enabled(void);
+
+/* Notice: *count is capacity of records as input, and it would be the number of records as output,
+ * the search list will be applied on the name like res_search() does,
+ * A and AAAA are answered by hosts first if the name was found there */
+CAT_API cat_bool_t cat_dns_query(const char *name, cat_dns_record_type_t type, cat_dns_record_t *records, size_t *count);
+CAT_API cat_bool_t cat_dns_query_ex(const char *name, cat_dns_record_type_t type, cat_dns_record_t *records, size_t *count, cat_timeout_t timeout);
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,8 +42,16 @@ CAT_GLOBALS_STRUCT_BEGIN(cat_event) {
     uv_loop_t loop;
     uv_timer_t deadlock;
     cat_queue_t runtime_shutdown_tasks;
+    cat_queue_t loop_defer_tasks;
+    uv_idle_t loop_defer_idle;
     cat_queue_t io_defer_tasks;
-    uv_check_t io_defer_check;
+    uv_check_t defer_check;
+    /* for coroutine ready queue */
+    uv_idle_t ready_idle;
+    /* for coroutine accounting */
+    uv_prepare_t poll_prepare;
+    cat_nsec_t poll_time;
+    uint64_t poll_idle_time;
 } CAT_GLOBALS_STRUCT_END(cat_event);
 
 extern CAT_API CAT_GLOBALS_DECLARE(cat_event);
@@ -68,8 +76,9 @@ CAT_API cat_event_shutdown_task_t *cat_event_register_runtime_shutdown_task(cat_
 /* Note: it can only be called before shutdown. */
 CAT_API void cat_event_unregister_runtime_shutdown_task(cat_event_shutdown_task_t *task);
 
-/* defer task callbacks will be called in the current_round + 1 event loop,
- * it's useful to free memory later safely.  */
+/* defer task callbacks will be called in the current_round + 1 event loop
+ * (after io defer tasks of that round), it's useful to free memory later safely,
+ * tasks are queued without any per-task handle, so it is also cheap enough to yield.  */
 CAT_API cat_event_loop_defer_task_t *cat_event_loop_defer_task_create(
     cat_event_loop_defer_callback_t callback,
     cat_data_t *data
@@ -73,6 +73,34 @@ CAT_API ssize_t cat_fs_read(cat_file_t fd, void *buffer, size_t size);
 CAT_API ssize_t cat_fs_write(cat_file_t fd, const void *buffer, size_t length);
 CAT_API ssize_t cat_fs_pread(cat_file_t fd, void *buffer, size_t size, off_t offset);
 CAT_API ssize_t cat_fs_pwrite(cat_file_t fd, const void *buffer, size_t length, off_t offset);
+
+/* per-call flags of preadv2() and pwritev2(), only NOWAIT is accepted on platforms other than Linux */
+typedef enum cat_fs_rw_flag_e {
+    CAT_FS_RW_FLAG_NONE = 0,
+    /* high priority request, poll if possible */
+    CAT_FS_RW_FLAG_HIPRI = 1 << 0,
+    /* per-call O_DSYNC */
+    CAT_FS_RW_FLAG_DSYNC = 1 << 1,
+    /* per-call O_SYNC */
+    CAT_FS_RW_FLAG_SYNC = 1 << 2,
+    /* try it inline on the loop thread first, and fall back to the thread-pool
+     * only if it would block (e.g. data is not in the page cache),
+     * note that the result may be shorter if data is only partially cached */
+    CAT_FS_RW_FLAG_NOWAIT = 1 << 3,
+    /* per-call O_APPEND, data is always appended to the end of file */
+    CAT_FS_RW_FLAG_APPEND = 1 << 4,
+} cat_fs_rw_flag_t;
+
+typedef int cat_fs_rw_flags_t;
+
+CAT_API ssize_t cat_fs_readv(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count);
+CAT_API ssize_t cat_fs_writev(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count);
+/* offset -1 means the current file position */
+CAT_API ssize_t cat_fs_preadv(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset);
+CAT_API ssize_t cat_fs_pwritev(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset);
+CAT_API ssize_t cat_fs_preadv2(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset, cat_fs_rw_flags_t flags);
+CAT_API ssize_t cat_fs_pwritev2(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset, cat_fs_rw_flags_t flags);
+
 CAT_API off_t cat_fs_lseek(cat_file_t fd, off_t offset, int whence);
 CAT_API int cat_fs_fsync(cat_file_t fd);
 CAT_API int cat_fs_fdatasync(cat_file_t fd);
@@ -252,6 +280,148 @@ typedef int cat_fs_flock_flags_t;
 
 CAT_API int cat_fs_flock(cat_file_t fd, cat_fs_flock_flags_t operation);
 
+/* memory-mapped file */
+
+typedef enum cat_fs_mmap_flag_e {
+    CAT_FS_MMAP_FLAG_NONE = 0,
+    /* mapping is read-only and private by default, it makes it writable and shared with the file */
+    CAT_FS_MMAP_FLAG_WRITE = 1 << 0,
+    /* fault in all of pages on the thread-pool before it returns, so that access never blocks the loop */
+    CAT_FS_MMAP_FLAG_PREFAULT = 1 << 1,
+} cat_fs_mmap_flag_t;
+
+typedef int cat_fs_mmap_flags_t;
+
+typedef enum cat_fs_madvise_e {
+    CAT_FS_MADVISE_NORMAL,
+    CAT_FS_MADVISE_RANDOM,
+    CAT_FS_MADVISE_SEQUENTIAL,
+    CAT_FS_MADVISE_WILLNEED,
+    CAT_FS_MADVISE_DONTNEED,
+} cat_fs_madvise_t;
+
+/* offset must be a multiple of page size, returns NULL on error */
+CAT_API void *cat_fs_mmap(cat_file_t fd, int64_t offset, size_t length, cat_fs_mmap_flags_t flags);
+CAT_API int cat_fs_munmap(void *address, size_t length);
+/* advice is applied on the thread-pool, since WILLNEED may block on read-ahead */
+CAT_API int cat_fs_madvise(void *address, size_t length, cat_fs_madvise_t advice);
+/* fault in pages of the range on the thread-pool */
+CAT_API int cat_fs_prefault(const void *address, size_t length);
+CAT_API int cat_fs_prefault_ex(const void *address, size_t length, cat_timeout_t timeout);
+
+/* directory tree walker */
+
+typedef enum cat_fs_walk_action_e {
+    /* report the entry (and descend into it if it is a directory) */
+    CAT_FS_WALK_ACTION_INCLUDE,
+    /* do not report the entry, but still descend into it */
+    CAT_FS_WALK_ACTION_SKIP,
+    /* neither report nor descend into it */
+    CAT_FS_WALK_ACTION_PRUNE,
+} cat_fs_walk_action_t;
+
+typedef struct cat_fs_walk_entry_s {
+    /* relative to the root */
+    const char *path;
+    /* points to the basename in path */
+    const char *name;
+    cat_dirent_type_t type;
+    /* depth of children of the root is 1 */
+    size_t depth;
+    /* it is only filled if stat option is enabled */
+    cat_stat_t stat;
+} cat_fs_walk_entry_t;
+
+/* it is called on the worker thread, so it must be thread-safe */
+typedef cat_fs_walk_action_t (*cat_fs_walk_filter_t)(const cat_fs_walk_entry_t *entry, cat_data_t *data);
+
+typedef struct cat_fs_walk_options_s {
+    /* 0 means unlimited */
+    size_t max_depth;
+    cat_bool_t stat;
+    cat_fs_walk_filter_t filter;
+    cat_data_t *filter_data;
+    /* max number of entries in a batch */
+    size_t batch_size;
+    /* max number of batches which are waiting for consumer, worker would be blocked if it is full */
+    size_t max_batches;
+} cat_fs_walk_options_t;
+
+typedef struct cat_fs_walk_batch_s {
+    const cat_fs_walk_entry_t *entries;
+    size_t count;
+} cat_fs_walk_batch_t;
+
+typedef struct cat_fs_walk_stats_s {
+    /* entries which were reported */
+    uint64_t entry_count;
+    /* entries which were read from directories */
+    uint64_t scanned_count;
+    uint64_t directory_count;
+    /* entries or directories which could not be accessed (they were skipped) */
+    uint64_t error_count;
+    uint64_t batch_count;
+    cat_nsec_t duration;
+    double entries_per_second;
+} cat_fs_walk_stats_t;
+
+typedef struct cat_fs_walker_s cat_fs_walker_t;
+
+CAT_API void cat_fs_walk_options_init(cat_fs_walk_options_t *options);
+/* the tree is walked on a dedicated thread (readdir and stat in bulk), entries are streamed back in batches */
+CAT_API cat_fs_walker_t *cat_fs_walker_create(const char *path, const cat_fs_walk_options_t *options);
+/* returns an empty batch if walking is done, or NULL on error (e.g. root is not accessible),
+ * batch is valid until the next call or close */
+CAT_API const cat_fs_walk_batch_t *cat_fs_walker_next(cat_fs_walker_t *walker, cat_timeout_t timeout);
+CAT_API void cat_fs_walker_get_stats(cat_fs_walker_t *walker, cat_fs_walk_stats_t *stats);
+/* it stops the worker if walking is not done yet */
+CAT_API void cat_fs_walker_close(cat_fs_walker_t *walker);
+
+/* buffered writer (append-only) */
+
+#define CAT_FS_WRITER_DEFAULT_BUFFER_SIZE (256 * 1024)
+#define CAT_FS_WRITER_DEFAULT_MAX_BUFFER_SIZE (4 * CAT_FS_WRITER_DEFAULT_BUFFER_SIZE)
+#define CAT_FS_WRITER_DEFAULT_FLUSH_INTERVAL 10
+
+typedef struct cat_fs_writer_options_s {
+    /* pending data would be flushed once it reaches it */
+    size_t buffer_size;
+    /* writers would be blocked until data is flushed if pending data exceeds it */
+    size_t max_buffer_size;
+    /* pending data which does not fill the buffer would be flushed after it (in ms) */
+    cat_msec_t flush_interval;
+} cat_fs_writer_options_t;
+
+typedef struct cat_fs_writer_stats_s {
+    uint64_t write_count;
+    uint64_t write_bytes;
+    /* one flush is one pwritev() of all of pending buffers */
+    uint64_t flush_count;
+    uint64_t flush_bytes;
+    cat_nsec_t flush_time;
+    cat_nsec_t max_flush_time;
+    /* one sync is one fdatasync() for all of sync requests which are waiting */
+    uint64_t sync_count;
+    uint64_t sync_request_count;
+    cat_nsec_t sync_time;
+    cat_nsec_t max_sync_time;
+} cat_fs_writer_stats_t;
+
+typedef struct cat_fs_writer_s cat_fs_writer_t;
+
+CAT_API void cat_fs_writer_options_init(cat_fs_writer_options_t *options);
+/* data is appended to the end of fd, and fd is still owned by caller (it must be kept open until writer is closed) */
+CAT_API cat_fs_writer_t *cat_fs_writer_create(cat_file_t fd, const cat_fs_writer_options_t *options);
+/* data is copied into the buffer, it only blocks if too much data is pending */
+CAT_API cat_bool_t cat_fs_writer_write(cat_fs_writer_t *writer, const void *buffer, size_t length);
+/* wait for all of data written before to be written to file */
+CAT_API cat_bool_t cat_fs_writer_flush(cat_fs_writer_t *writer, cat_timeout_t timeout);
+/* wait for all of data written before to be durable, requests from many coroutines are served by one fdatasync() */
+CAT_API cat_bool_t cat_fs_writer_sync(cat_fs_writer_t *writer, cat_timeout_t timeout);
+CAT_API void cat_fs_writer_get_stats(const cat_fs_writer_t *writer, cat_fs_writer_stats_t *stats);
+/* pending data is flushed (but not synced), returns false if any flush has failed */
+CAT_API cat_bool_t cat_fs_writer_close(cat_fs_writer_t *writer);
+
 CAT_API char *cat_fs_get_contents(const char *filename, size_t *length);
 CAT_API ssize_t cat_fs_put_contents(const char *filename, const char *content, size_t length);
 
@@ -0,0 +1,96 @@
+/*
+  +--------------------------------------------------------------------------+
+  | libcat                                                                   |
+  +--------------------------------------------------------------------------+
+  | Licensed under the Apache License, Version 2.0 (the "License");          |
+  | you may not use this file except in compliance with the License.         |
+  | You may obtain a copy of the License at                                  |
+  | http://www.apache.org/licenses/LICENSE-2.0                               |
+  | Unless required by applicable law or agreed to in writing, software      |
+  | distributed under the License is distributed on an "AS IS" BASIS,        |
+  | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. |
+  | See the License for the specific language governing permissions and      |
+  | limitations under the License. See accompanying LICENSE file.            |
+  +--------------------------------------------------------------------------+
+  | Author: Twosee <twosee@php.net>                                          |
+  +--------------------------------------------------------------------------+
+ */
+
+#ifndef CAT_IO_URING_H
+#define CAT_IO_URING_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cat.h"
+
+#if defined(CAT_HAVE_IO_URING) && defined(CAT_OS_LINUX)
+#define CAT_IO_URING 1
+
+#include <linux/io_uring.h>
+
+#define CAT_IO_URING_DEFAULT_ENTRIES 256
+
+/* recv engine requires provided buffer ring (Linux 5.19+ headers) */
+#ifdef CAT_HAVE_IO_URING_PBUF_RING
+#define CAT_IO_URING_RECV 1
+
+/* provided buffers for recv, must be power of 2 */
+#ifndef CAT_IO_URING_RECV_BUFFER_COUNT
+#define CAT_IO_URING_RECV_BUFFER_COUNT 256
+#endif
+#ifndef CAT_IO_URING_RECV_BUFFER_SIZE
+#define CAT_IO_URING_RECV_BUFFER_SIZE (16 * 1024)
+#endif
+#endif
+
+typedef struct cat_io_uring_stats_s {
+    uint64_t submitted_count;
+    /* number of io_uring_enter() calls for submission */
+    uint64_t submit_call_count;
+    uint64_t completed_count;
+    uint64_t canceled_count;
+    size_t inflight_count;
+} cat_io_uring_stats_t;
+
+CAT_API cat_bool_t cat_io_uring_module_init(void);
+CAT_API cat_bool_t cat_io_uring_module_shutdown(void);
+CAT_API cat_bool_t cat_io_uring_runtime_init(void);
+CAT_API cat_bool_t cat_io_uring_runtime_shutdown(void);
+
+/* ring is set up lazily on first use, it returns false if io_uring is not supported by kernel or disabled */
+CAT_API cat_bool_t cat_io_uring_is_available(void);
+CAT_API cat_bool_t cat_io_uring_is_supported(uint8_t opcode);
+
+/* file-system operations would go through io_uring if it is available (disabled by default, or set CAT_FS_IO_URING=1),
+ * returns the previous value */
+CAT_API cat_bool_t cat_io_uring_enable_fs(cat_bool_t enable);
+CAT_API cat_bool_t cat_io_uring_is_fs_enabled(void);
+#ifdef CAT_IO_URING_RECV
+/* stream sockets wait for data by io_uring recv instead of the reactor (disabled by default) */
+CAT_API cat_bool_t cat_io_uring_enable_socket(cat_bool_t enable);
+CAT_API cat_bool_t cat_io_uring_is_socket_enabled(void);
+#endif
+
+/* SQEs are queued and submitted in batch once per loop iteration, completions are reaped on the event loop.
+ * returns NONE if opcode is not supported (caller should fallback),
+ * ERROR if waiting failed (e.g. canceled), or OK with the raw result (negative errno on failure) */
+CAT_API cat_ret_t cat_io_uring_execute(const struct io_uring_sqe *sqe, int32_t *result);
+/* data (allocated by cat_malloc) is the buffer referenced by SQE,
+ * its ownership is transferred to io_uring only if ERROR was returned, it would be released after kernel is done with it */
+CAT_API cat_ret_t cat_io_uring_execute_ex(const struct io_uring_sqe *sqe, int32_t *result, void *data, cat_timeout_t timeout);
+
+#ifdef CAT_IO_URING_RECV
+/* data is received into a provided buffer and then copied into the given buffer (at most CAT_IO_URING_RECV_BUFFER_SIZE),
+ * returns NONE if provided buffers are unavailable or exhausted (caller should fallback) */
+CAT_API cat_ret_t cat_io_uring_recv(int fd, char *buffer, size_t size, int32_t *result, cat_timeout_t timeout);
+#endif
+
+CAT_API const cat_io_uring_stats_t *cat_io_uring_get_stats(void);
+
+#endif /* CAT_HAVE_IO_URING */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CAT_IO_URING_H */
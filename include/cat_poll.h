@@ -59,6 +59,19 @@ typedef SHORT cat_pollfd_events_t;
     XX(HUP) \
     XX(NVAL) \
 
+typedef struct cat_poll_stats_s {
+    /* watchers in the registry */
+    size_t watcher_count;
+    uint64_t watcher_create_count;
+    /* interest mask changes (uv_poll_start() or uv_poll_stop()) */
+    uint64_t watcher_update_count;
+} cat_poll_stats_t;
+
+CAT_API cat_bool_t cat_poll_module_init(void);
+CAT_API cat_bool_t cat_poll_module_shutdown(void);
+CAT_API cat_bool_t cat_poll_runtime_init(void);
+CAT_API cat_bool_t cat_poll_runtime_shutdown(void);
+
 /** OK: events triggered, NONE: timedout, ERROR: error ocurred.
  * @note: it does not always return ERROR when it was cancelled,
  * because poll() operation may be partially done. */
@@ -75,6 +88,14 @@ CAT_API int cat_poll(cat_pollfd_t *fds, cat_nfds_t nfds, cat_timeout_t timeout);
  * @see: same with poll_one() note. */
 CAT_API int cat_select(cat_os_socket_t max_fd, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
 
+/* watch fd persistently (reference counted), its registration in event loop would be kept
+ * alive across poll calls, and it only be updated when the interest mask changes.
+ * @note: fd must be unwatched before it is closed. */
+CAT_API cat_bool_t cat_poll_watch(cat_os_socket_t fd);
+CAT_API void cat_poll_unwatch(cat_os_socket_t fd);
+
+CAT_API const cat_poll_stats_t *cat_poll_get_stats(void);
+
 /** poll emulation APIs */
 typedef cat_ret_t (*cat_poll_one_emulate_t)(cat_os_socket_t fd, cat_pollfd_events_t events, cat_pollfd_events_t *revents);
 typedef int (*cat_poll_emulate_t)(cat_pollfd_t *fds, cat_nfds_t nfds);
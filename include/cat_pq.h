@@ -23,6 +23,8 @@ extern "C" {
 #endif
 
 #include "cat.h"
+#include "cat_buffer.h"
+#include "cat_queue.h"
 
 #ifdef CAT_HAVE_PQ
 #define CAT_PQ 1
@@ -42,6 +44,153 @@ CAT_API PGresult *cat_pq_exec(PGconn *conn, const char *query);
 CAT_API PGresult *cat_pq_exec_params(PGconn *conn, const char *command, int n_params,
     const Oid *param_types, const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format);
 
+/* copy:
+ * start COPY by cat_pq_exec() as usual (PGRES_COPY_IN or PGRES_COPY_OUT is returned),
+ * then put data and end it, or get data until it is done, the final result is returned at last */
+
+/* returns false if the row should be the last one we are interested in */
+typedef cat_bool_t (*cat_pq_copy_row_callback_t)(const char *row, size_t length, cat_data_t *data);
+
+/* wait for buffer space if connection is busy (backpressure) */
+CAT_API cat_bool_t cat_pq_copy_put_data(PGconn *conn, const char *buffer, size_t length);
+CAT_API cat_bool_t cat_pq_copy_put_vector(PGconn *conn, const cat_io_vector_t *vector, unsigned int vector_count);
+CAT_API cat_bool_t cat_pq_copy_put_buffer(PGconn *conn, const cat_buffer_t *buffer);
+/* error_message can be NULL, otherwise COPY is forced to fail with it */
+CAT_API PGresult *cat_pq_copy_end(PGconn *conn, const char *error_message);
+/* same as PQgetCopyData() in sync mode, but it does not block the loop */
+CAT_API int cat_pq_copy_get_data(PGconn *conn, char **buffer);
+/* stream all rows into callback */
+CAT_API PGresult *cat_pq_copy_to(PGconn *conn, cat_pq_copy_row_callback_t callback, cat_data_t *data);
+
+/* pool */
+
+#define CAT_PQ_POOL_DEFAULT_MIN_SIZE                0
+#define CAT_PQ_POOL_DEFAULT_MAX_SIZE                16
+#define CAT_PQ_POOL_DEFAULT_IDLE_TIMEOUT            (60 * 1000)
+#define CAT_PQ_POOL_DEFAULT_HEALTH_CHECK_INTERVAL   (5 * 1000)
+#define CAT_PQ_POOL_DEFAULT_STATEMENT_CACHE_SIZE    64
+
+typedef struct cat_pq_pool_options_s {
+    size_t min_size;
+    size_t max_size;
+    /* idle connections (above min_size) which have not been used for this long will be closed */
+    cat_msec_t idle_timeout;
+    /* idle connections which were used recently (within this interval) will not be checked */
+    cat_msec_t health_check_interval;
+    /* timeout for waiting for an available connection */
+    cat_timeout_t wait_timeout;
+    /* max number of auto-prepared statements per connection, 0 means disabled */
+    size_t statement_cache_size;
+} cat_pq_pool_options_t;
+
+typedef struct cat_pq_pool_stats_s {
+    /* gauges */
+    size_t size;
+    size_t idle_count;
+    size_t in_use_count;
+    size_t waiter_count;
+    /* counters */
+    uint64_t acquire_count;
+    uint64_t wait_count;
+    uint64_t timeout_count;
+    uint64_t create_count;
+    uint64_t close_count;
+    uint64_t health_check_count;
+    uint64_t health_check_failure_count;
+    uint64_t statement_prepare_count;
+    /* wait time is the time spent on waiting for other coroutines to release connections,
+     * checkout time is the whole latency of acquire (including waiting, connecting and checking) */
+    cat_msec_t wait_time_total;
+    cat_msec_t wait_time_max;
+    cat_msec_t checkout_time_total;
+    cat_msec_t checkout_time_max;
+} cat_pq_pool_stats_t;
+
+typedef struct cat_pq_pool_s cat_pq_pool_t;
+
+typedef struct cat_pq_pool_statement_s {
+    char *query;
+    char name[32];
+} cat_pq_pool_statement_t;
+
+typedef struct cat_pq_pool_connection_s {
+    cat_queue_node_t node;
+    cat_pq_pool_t *pool;
+    PGconn *conn;
+    cat_msec_t last_used_time;
+    uint64_t statement_id;
+    size_t statement_count;
+    cat_pq_pool_statement_t *statements;
+} cat_pq_pool_connection_t;
+
+enum cat_pq_pool_flag_e {
+    CAT_PQ_POOL_FLAG_NONE      = 0,
+    CAT_PQ_POOL_FLAG_ALLOCATED = 1 << 0,
+    CAT_PQ_POOL_FLAG_CLOSED    = 1 << 1,
+};
+
+typedef uint8_t cat_pq_pool_flags_t;
+
+struct cat_pq_pool_s {
+    cat_pq_pool_flags_t flags;
+    char *conninfo;
+    cat_pq_pool_options_t options;
+    /* most recently used connection is at the front */
+    cat_queue_t idle_connections;
+    cat_queue_t waiters;
+    cat_pq_pool_stats_t stats;
+};
+
+CAT_API void cat_pq_pool_options_init(cat_pq_pool_options_t *options);
+
+/* min_size connections are established at creation */
+CAT_API cat_pq_pool_t *cat_pq_pool_create(cat_pq_pool_t *pool, const char *conninfo, const cat_pq_pool_options_t *options);
+/* idle connections are closed immediately, in-use connections are closed when they are released,
+ * and pool is released after all connections have been released if it was allocated by create() */
+CAT_API void cat_pq_pool_close(cat_pq_pool_t *pool);
+
+CAT_API cat_pq_pool_connection_t *cat_pq_pool_acquire(cat_pq_pool_t *pool);
+CAT_API cat_pq_pool_connection_t *cat_pq_pool_acquire_ex(cat_pq_pool_t *pool, cat_timeout_t timeout);
+/* connection which is broken or in transaction will be closed instead of being reused */
+CAT_API void cat_pq_pool_release(cat_pq_pool_connection_t *connection);
+
+CAT_API PGconn *cat_pq_pool_connection_get_conn(const cat_pq_pool_connection_t *connection);
+/* statement will be prepared automatically on first use and cached on this connection */
+CAT_API PGresult *cat_pq_pool_connection_exec_cached(cat_pq_pool_connection_t *connection, const char *query, int n_params,
+    const Oid *param_types, const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format);
+
+CAT_API const cat_pq_pool_stats_t *cat_pq_pool_get_stats(const cat_pq_pool_t *pool);
+
+#ifdef LIBPQ_HAS_PIPELINING
+#define CAT_PQ_HAVE_PIPELINE 1
+
+/* pipeline:
+ * queue queries by cat_pq_pipeline_*() without waiting for results,
+ * send them all by cat_pq_pipeline_sync(), then fetch results in order
+ * by cat_pq_pipeline_get_result() until PGRES_PIPELINE_SYNC is returned */
+
+typedef void (*cat_pq_pipeline_result_callback_t)(PGconn *conn, PGresult *result, cat_data_t *data);
+
+CAT_API cat_bool_t cat_pq_enter_pipeline_mode(PGconn *conn);
+/* all results must be consumed before exit */
+CAT_API cat_bool_t cat_pq_exit_pipeline_mode(PGconn *conn);
+CAT_API cat_bool_t cat_pq_pipeline_prepare(PGconn *conn, const char *stmt_name, const char *query, int n_params, const Oid *param_types);
+CAT_API cat_bool_t cat_pq_pipeline_exec_prepared(PGconn *conn, const char *stmt_name, int n_params,
+    const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format);
+CAT_API cat_bool_t cat_pq_pipeline_exec_params(PGconn *conn, const char *command, int n_params,
+    const Oid *param_types, const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format);
+CAT_API cat_bool_t cat_pq_pipeline_sync(PGconn *conn);
+/* returns the (last) result of the next queued query, or the PGRES_PIPELINE_SYNC result */
+CAT_API PGresult *cat_pq_pipeline_get_result(PGconn *conn);
+/* execute the same command with n_batches sets of params in one round trip,
+ * results are passed to callback in order (or cleared if callback is NULL),
+ * returns the number of succeeded queries or -1 on error,
+ * if results can not be drained on error, connection is left in pipeline mode and must be closed */
+CAT_API int cat_pq_pipeline_exec_params_batch(PGconn *conn, const char *command, int n_params, int n_batches,
+    const Oid *param_types, const char *const *const *param_values, const int *const *param_lengths, const int *param_formats,
+    int result_format, cat_pq_pipeline_result_callback_t callback, cat_data_t *data);
+#endif /* LIBPQ_HAS_PIPELINING */
+
 #endif /* CAT_HAVE_PQ */
 
 #ifdef __cplusplus
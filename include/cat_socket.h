@@ -25,7 +25,6 @@ extern "C" {
 #include "cat.h"
 #include "cat_ref.h"
 #include "cat_coroutine.h"
-#include "cat_dns.h"
 #include "cat_ssl.h"
 
 #ifdef CAT_OS_UNIX_LIKE
@@ -42,6 +41,8 @@ extern "C" {
 /* sockaddr */
 
 #define CAT_SOCKET_DEFAULT_BACKLOG  511
+/* delay between connection attempts of connect_to() (Happy Eyeballs, RFC 8305 recommends 250ms) */
+#define CAT_SOCKET_DEFAULT_CONNECT_ATTEMPT_DELAY 250
 
 #ifdef INET_ADDRSTRLEN
 # define CAT_SOCKET_IPV4_BUFFER_SIZE INET_ADDRSTRLEN
@@ -310,6 +311,8 @@ typedef uint32_t cat_socket_flags_t;
     /* socket may be a pipe file, which is created by pipe2()
      * and can only work with read()/write() */ \
     XX(NOT_SOCK,          1 << 3) \
+    /* writes are rejected, someone is writing a series of data (e.g. send_mapped()) */ \
+    XX(WRITE_LOCKED,      1 << 4) \
     /* 20 ~ 23 (stream (tcp|pipe|tty)) */ \
     XX(SERVER,            1 << 20) \
     XX(SERVER_CONNECTION, 1 << 21) \
@@ -504,6 +507,25 @@ struct cat_socket_s
 
 RB_HEAD(cat_socket_internal_tree_s, cat_socket_internal_s);
 
+/* connect stats (of connect_to() with domain names) */
+
+typedef struct cat_socket_connect_family_stats_s {
+    /* connections won by this family */
+    uint64_t count;
+    cat_msec_t latency_total;
+    cat_msec_t latency_max;
+} cat_socket_connect_family_stats_t;
+
+typedef struct cat_socket_connect_stats_s {
+    cat_socket_connect_family_stats_t ipv4;
+    cat_socket_connect_family_stats_t ipv6;
+    /* connection attempts have been started */
+    uint64_t attempts;
+    /* connects that raced more than one attempt */
+    uint64_t races;
+    uint64_t failures;
+} cat_socket_connect_stats_t;
+
 /* globals */
 
 CAT_GLOBALS_STRUCT_BEGIN(cat_socket) {
@@ -512,13 +534,18 @@ CAT_GLOBALS_STRUCT_BEGIN(cat_socket) {
     struct {
         cat_socket_timeout_options_t timeout;
         unsigned int tcp_keepalive_delay;
+        cat_msec_t connect_attempt_delay;
     } options;
+    cat_socket_connect_stats_t connect_stats;
     /* In theory, all internal socket objects should be maintained in the tree,
      * but currently only the internal sockets that need to be used are stored
      * e.g., server sockets for poll module. */
     struct cat_socket_internal_tree_s internal_tree;
     /* dns */
     // TODO: dns_cache (we should implement lru_cache)
+    cat_bool_t dns_use_stub_resolver;
+    struct cat_dns_resolver_s *dns_resolver;
+    cat_queue_t dns_stub_addrinfos;
 } CAT_GLOBALS_STRUCT_END(cat_socket);
 
 extern CAT_API CAT_GLOBALS_DECLARE(cat_socket);
@@ -584,6 +611,15 @@ CAT_API cat_bool_t cat_socket_set_handshake_timeout(cat_socket_t *socket, cat_ti
 CAT_API cat_bool_t cat_socket_set_read_timeout(cat_socket_t *socket, cat_timeout_t timeout);
 CAT_API cat_bool_t cat_socket_set_write_timeout(cat_socket_t *socket, cat_timeout_t timeout);
 
+/* connect_to() races the resolved addresses with the staggered delay (Happy Eyeballs, RFC 8305),
+ * and the family of the winner can be known by cat_socket_get_af(),
+ * attempts would be made one by one if delay is 0 */
+CAT_API cat_msec_t cat_socket_get_global_connect_attempt_delay(void);
+CAT_API void cat_socket_set_global_connect_attempt_delay(cat_msec_t delay);
+
+CAT_API const cat_socket_connect_stats_t *cat_socket_get_connect_stats(void);
+CAT_API void cat_socket_reset_connect_stats(void);
+
 CAT_API cat_bool_t cat_socket_bind(cat_socket_t *socket, const cat_sockaddr_t *address, cat_socklen_t address_length);
 CAT_API cat_bool_t cat_socket_bind_ex(cat_socket_t *socket, const cat_sockaddr_t *address, cat_socklen_t address_length, cat_socket_bind_flags_t flags);
 CAT_API cat_bool_t cat_socket_bind_to(cat_socket_t *socket, const char *name, size_t name_length, int port);
@@ -692,6 +728,16 @@ CAT_API cat_bool_t cat_socket_send_handle_ex(cat_socket_t *socket, cat_socket_t
 CAT_API ssize_t cat_socket_send_file(cat_socket_t *socket, const char *filename, int64_t offset, size_t length);
 CAT_API ssize_t cat_socket_send_file_ex(cat_socket_t *socket, const char *filename, int64_t offset, size_t length, cat_timeout_t timeout);
 
+#ifndef CAT_SOCKET_SEND_MAPPED_CHUNK_SIZE
+#define CAT_SOCKET_SEND_MAPPED_CHUNK_SIZE (1024 * 1024)
+#endif
+
+/* send memory-mapped region (see cat_fs_mmap()) without copying,
+ * pages are faulted in on the thread-pool chunk by chunk, so that page faults never stall the loop,
+ * other writes on the socket fail with CAT_ELOCKED until it is done */
+CAT_API cat_bool_t cat_socket_send_mapped(cat_socket_t *socket, const void *address, size_t length);
+CAT_API cat_bool_t cat_socket_send_mapped_ex(cat_socket_t *socket, const void *address, size_t length, cat_timeout_t timeout);
+
 /* @note last_error will not be updated when close failed,  */
 CAT_API cat_bool_t cat_socket_close(cat_socket_t *socket);
 
@@ -763,6 +809,9 @@ typedef int cat_pipe_flags;
 
 CAT_API cat_bool_t cat_pipe(cat_os_fd_t fds[2], cat_pipe_flags read_flags, cat_pipe_flags write_flags);
 
+/* dns module depends on the socket types, so we include it at last */
+#include "cat_dns.h"
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,39 @@ CAT_API cat_bool_t cat_sync_wait_group_add(cat_sync_wait_group_t *wg, ssize_t de
 CAT_API cat_bool_t cat_sync_wait_group_wait(cat_sync_wait_group_t *wg, cat_timeout_t timeout);
 CAT_API cat_bool_t cat_sync_wait_group_done(cat_sync_wait_group_t *wg);
 
+/* coroutine group (structured concurrency):
+ * children are spawned into the group and they never outlive join(),
+ * the first failure cancels the others and it will be propagated by join() */
+
+/* return false and update last error on failure */
+typedef cat_bool_t (*cat_sync_coroutine_group_function_t)(cat_data_t *data);
+
+typedef struct cat_sync_coroutine_group_s {
+    cat_queue_t children;
+    size_t count;
+    cat_coroutine_t *coroutine;
+    cat_bool_t canceled;
+    cat_bool_t failed;
+    /* the first error of children */
+    cat_error_t error;
+} cat_sync_coroutine_group_t;
+
+CAT_API cat_sync_coroutine_group_t *cat_sync_coroutine_group_create(cat_sync_coroutine_group_t *group);
+/* child runs immediately until it yields */
+CAT_API cat_bool_t cat_sync_coroutine_group_spawn(cat_sync_coroutine_group_t *group, cat_sync_coroutine_group_function_t function, cat_data_t *data);
+/* wait for all children, if timedout (or canceled), children will be canceled and waited again,
+ * so that children should give up as soon as possible once they see the group canceled.
+ * return false with the first error of children, or ETIMEDOUT/ECANCELED */
+CAT_API cat_bool_t cat_sync_coroutine_group_join(cat_sync_coroutine_group_t *group, cat_timeout_t timeout);
+/* resume all waiting children, so that blocking operations they are waiting for
+ * (socket, channel and so on) fail with ECANCELED (time_wait() returns true as it has been resumed),
+ * and no more children can be spawned */
+CAT_API void cat_sync_coroutine_group_cancel(cat_sync_coroutine_group_t *group);
+CAT_API cat_bool_t cat_sync_coroutine_group_is_canceled(const cat_sync_coroutine_group_t *group);
+CAT_API size_t cat_sync_coroutine_group_get_count(const cat_sync_coroutine_group_t *group);
+/* cancel and join the remaining children, then release the error */
+CAT_API void cat_sync_coroutine_group_close(cat_sync_coroutine_group_t *group);
+
 #ifdef __cplusplus
 }
 #endif
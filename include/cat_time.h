@@ -53,6 +53,18 @@ CAT_API cat_bool_t cat_time_wait(cat_timeout_t timeout);
     } \
 } while (0)
 
+/* deadline is an absolute time of cat_time_msec() (0 means none) for current coroutine,
+ * timeouts of blocking calls based on cat_time_wait() or cat_poll() are clamped against it
+ * (they fail with ETIMEDOUT once it is exceeded), and new coroutines inherit it from creator.
+ * return the original one, so that it can be restored */
+CAT_API cat_msec_t cat_time_set_deadline(cat_msec_t deadline);
+CAT_API cat_msec_t cat_time_get_deadline(void);
+/* set deadline to now + timeout unless there is an earlier one, return the original one */
+CAT_API cat_msec_t cat_time_narrow_deadline(cat_timeout_t timeout);
+/* return the smaller one of timeout and the remaining time of deadline,
+ * it is counted from the loop time (see cat_time_msec_cached()) like all timers */
+CAT_API cat_timeout_t cat_time_clamp_timeout(cat_timeout_t timeout);
+
 /* OK: timeout, NONE: cancelled, ERROR: error occured */
 CAT_API cat_ret_t cat_time_delay(cat_timeout_t timeout);
 
@@ -26,6 +26,7 @@ extern "C" {
 
 #include "cat_coroutine.h"
 #include "cat_atomic.h"
+#include "cat_buffer.h"
 
 #define CAT_WATCH_DOG_DEFAULT_QUANTUM    (5 * 1000 * 1000)
 #define CAT_WATCH_DOG_DEFAULT_THRESHOLD  (10 * 1000 * 1000)
@@ -37,6 +38,9 @@ extern "C" {
 #define CAT_WATCH_DOG_ROLE_NAME "thread"
 #endif
 
+#define CAT_WATCH_DOG_BACKTRACE_MAX_DEPTH        32
+#define CAT_WATCH_DOG_PROFILER_DEFAULT_CAPACITY  1024
+
 #define CAT_ALERT_COUNT_FMT "%" PRIu64
 #define CAT_ALERT_COUNT_FMT_SPEC PRIu64
 typedef uint64_t cat_alert_count_t;
@@ -45,6 +49,34 @@ typedef struct cat_watchdog_s cat_watchdog_t;
 
 typedef void (*cat_watchdog_alerter_t)(cat_watchdog_t *watchdog);
 
+/* return false to keep running instead of yielding */
+typedef cat_bool_t (*cat_watchdog_budget_handler_t)(cat_coroutine_t *coroutine, cat_nsec_t elapsed);
+
+/* what the watched thread was doing at the moment of alert */
+typedef struct cat_watchdog_snapshot_s {
+    /* how long the loop has been blocked (nano secondes) */
+    cat_nsec_t blocked_time;
+    /* "main", "scheduler" or "coroutine" */
+    const char *role;
+    /* it is 0 if role is coroutine but it is unknown (no backtrace support) */
+    cat_coroutine_id_t coroutine_id;
+    /* backtrace of the watched thread, depth is 0 if it is unavailable */
+    uint32_t depth;
+    void *frames[CAT_WATCH_DOG_BACKTRACE_MAX_DEPTH];
+} cat_watchdog_snapshot_t;
+
+typedef struct cat_watchdog_profiler_s cat_watchdog_profiler_t;
+
+typedef struct cat_watchdog_profiler_stats_s {
+    /* samples taken since the profiler started */
+    uint64_t sample_count;
+    /* samples dropped because the buffer was being read */
+    uint64_t dropped_count;
+    /* samples kept in the ring buffer (the latest ones) */
+    size_t stored_count;
+    size_t capacity;
+} cat_watchdog_profiler_stats_t;
+
 CAT_GLOBALS_STRUCT_BEGIN(cat_watchdog) {
     cat_watchdog_t *watchdog;
 } CAT_GLOBALS_STRUCT_END(cat_watchdog);
@@ -61,6 +93,8 @@ struct cat_watchdog_s
     /* do something if blocking time is greater than threshold (nano secondes) */
     cat_timeout_t threshold;
     cat_watchdog_alerter_t alerter;
+    /* alert info (readonly, it is valid in alerter) */
+    cat_watchdog_snapshot_t snapshot;
     /* private */
     cat_alert_count_t alert_count;
     cat_bool_t allocated;
@@ -68,10 +102,22 @@ struct cat_watchdog_s
     uv_pid_t pid; /* TODO: cat_pid_t */
     CAT_GLOBALS_TYPE(cat_coroutine) *globals;
     cat_coroutine_switches_t last_switches;
+    cat_nsec_t last_switch_time;
+    /* the watched thread is blocked since blocked_since if its switches + 1 equals to blocked_switches */
+    cat_atomic_uint64_t blocked_switches;
+    cat_atomic_uint64_t blocked_since;
+    cat_watchdog_budget_handler_t budget_handler;
+    /* snapshot is taken by signal handler on the watched thread if it is enabled */
+    cat_atomic_bool_t snapshot_backtrace;
+    cat_atomic_bool_t snapshot_requested;
+    cat_atomic_bool_t snapshot_taken;
     uv_thread_t thread;
     uv_sem_t *sem;
     uv_cond_t cond;
     uv_mutex_t mutex;
+    /* sampling profiler (protected by mutex) */
+    cat_watchdog_profiler_t *profiler;
+    uv_thread_t target;
 };
 
 CAT_API cat_bool_t cat_watchdog_module_init(void);
@@ -88,6 +134,35 @@ CAT_API cat_bool_t cat_watchdog_is_running(void);
 CAT_API cat_timeout_t cat_watchdog_get_quantum(void);
 CAT_API cat_timeout_t cat_watchdog_get_threshold(void);
 
+/* CPU budget (see cat_coroutine_set_budget()):
+ * a coroutine can not be preempted, so CPU-bound code should call cat_watchdog_check_budget()
+ * as a yield point, it is cheap (an atomic load) until the current coroutine has been blocking
+ * the loop for more than its budget (the precision is the quantum of watchdog),
+ * then budget handler is called and the coroutine yields unless the handler returns false.
+ * return true if the budget was exceeded */
+CAT_API cat_bool_t cat_watchdog_check_budget(void);
+/* return the original one */
+CAT_API cat_watchdog_budget_handler_t cat_watchdog_set_budget_handler(cat_watchdog_budget_handler_t handler);
+
+/* backtrace and coroutine id of the snapshot (disabled by default, unix only):
+ * watchdog thread interrupts the watched thread with SIGPROF on every alert,
+ * and the signal handler records what it is doing.
+ * Note: SIGPROF handler is installed at the first enable and it will never be restored */
+CAT_API cat_bool_t cat_watchdog_enable_snapshot_backtrace(cat_bool_t enable);
+
+/* sampling profiler (unix only):
+ * watchdog thread interrupts the watched thread with SIGPROF every quantum,
+ * and the signal handler records the backtrace of the running coroutine into a ring buffer,
+ * so that memory is bounded and only the latest samples are kept.
+ * Note: SIGPROF handler is installed at the first start and it will never be restored */
+CAT_API cat_bool_t cat_watchdog_start_profiler(size_t capacity);
+CAT_API cat_bool_t cat_watchdog_stop_profiler(void);
+CAT_API cat_bool_t cat_watchdog_is_profiling(void);
+CAT_API cat_bool_t cat_watchdog_get_profiler_stats(cat_watchdog_profiler_stats_t *stats);
+/* samples are aggregated by coroutine role and stack,
+ * one "role;outermost;...;innermost count" per line (folded stacks for flamegraph tools) */
+CAT_API CAT_BUFFER_STR_FREE char *cat_watchdog_get_folded_stacks(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,7 +33,112 @@ typedef enum cat_work_kind_e {
   CAT_WORK_KIND_SLOW_IO = UV_WORK_SLOW_IO,
 } cat_work_kind_t;
 
+#define CAT_WORK_KIND_COUNT 3
+
+/* max number of cached work contexts */
+#ifndef CAT_WORK_CONTEXT_CACHE_SIZE
+#define CAT_WORK_CONTEXT_CACHE_SIZE 1024
+#endif
+
+/* expected number of chunks per thread for parallel works, more chunks make load balancing better */
+#ifndef CAT_WORK_PARALLEL_CHUNKS_PER_THREAD
+#define CAT_WORK_PARALLEL_CHUNKS_PER_THREAD 4
+#endif
+
+/* bucket[0]: < 2us, bucket[i]: [2^i, 2^(i+1)) us, the last bucket holds all the rest */
+#define CAT_WORK_LATENCY_HISTOGRAM_SIZE 24
+
+typedef struct cat_work_kind_stats_s {
+    /* number of works which are queued or running */
+    size_t queue_depth;
+    size_t max_queue_depth;
+    uint64_t completed_count;
+    uint64_t canceled_count;
+    /* latency from submission to completion */
+    uint64_t latency_histogram[CAT_WORK_LATENCY_HISTOGRAM_SIZE];
+} cat_work_kind_stats_t;
+
+/* process items in [begin, end) */
+typedef void (*cat_work_parallel_function_t)(size_t begin, size_t end, cat_data_t *data);
+/* accumulate items in [begin, end) into partial (which is initialized as a copy of the result) */
+typedef void (*cat_work_map_function_t)(size_t begin, size_t end, void *partial, cat_data_t *data);
+/* merge partial into result, it is called on the calling coroutine in order of chunks */
+typedef void (*cat_work_reduce_function_t)(void *result, const void *partial, cat_data_t *data);
+
+typedef struct cat_work_stats_s {
+    cat_work_kind_stats_t kinds[CAT_WORK_KIND_COUNT];
+    size_t cached_context_count;
+} cat_work_stats_t;
+
+/* dedicated worker pool, works can be routed to it instead of the libuv thread-pool */
+typedef struct cat_work_pool_s cat_work_pool_t;
+
+typedef struct cat_work_pool_options_s {
+    const char *name;
+    size_t thread_count;
+    /* max number of waiting works, 0 means unlimited, works would be rejected with EAGAIN if it is full */
+    size_t max_queue_size;
+    /* CPUs which threads are pinned to, NULL means no affinity */
+    const int *cpus;
+    size_t cpu_count;
+} cat_work_pool_options_t;
+
+typedef struct cat_work_pool_stats_s {
+    size_t thread_count;
+    /* number of works which are waiting for a thread */
+    size_t queue_depth;
+    size_t max_queue_depth;
+    size_t running_count;
+    uint64_t completed_count;
+    uint64_t canceled_count;
+    uint64_t rejected_count;
+    /* time threads spent on running works or waiting for works (ns) */
+    uint64_t busy_time;
+    uint64_t idle_time;
+    /* busy_time / (busy_time + idle_time) */
+    double utilization;
+} cat_work_pool_stats_t;
+
+CAT_API cat_bool_t cat_work_module_init(void);
+CAT_API cat_bool_t cat_work_module_shutdown(void);
+CAT_API cat_bool_t cat_work_runtime_init(void);
+CAT_API cat_bool_t cat_work_runtime_shutdown(void);
+
 CAT_API cat_bool_t cat_work(cat_work_kind_t kind, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data, cat_timeout_t timeout);
+/* submit works for each data in batch, and wait for all of them with a single wakeup,
+ * pending works would be canceled on timeout or cancellation (or if pool rejects one of them),
+ * cleanup is called for each data after its work is done (as same as cat_work()) */
+CAT_API cat_bool_t cat_work_many(cat_work_kind_t kind, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *const *data, size_t count, cat_timeout_t timeout);
+
+/* split [begin, end) into chunks (at least grain items per chunk, 0 means auto) over threads of the kind,
+ * and wait for all of them with a single wakeup. function is called with slices of at most grain items,
+ * once it timed out or was canceled, slices which have not started yet are skipped in every chunk,
+ * but a running slice can not be interrupted, so data must be kept alive until it is done */
+CAT_API cat_bool_t cat_work_parallel_for(cat_work_kind_t kind, size_t begin, size_t end, size_t grain, cat_work_parallel_function_t function, cat_data_t *data, cat_timeout_t timeout);
+/* result should be initialized with the identity value by caller (e.g. 0 for sum),
+ * it is only updated if all chunks are done */
+CAT_API cat_bool_t cat_work_map_reduce(cat_work_kind_t kind, size_t begin, size_t end, size_t grain, cat_work_map_function_t map, cat_work_reduce_function_t reduce, void *result, size_t result_size, cat_data_t *data, cat_timeout_t timeout);
+
+CAT_API const cat_work_stats_t *cat_work_get_stats(void);
+CAT_API void cat_work_reset_stats(void);
+
+CAT_API void cat_work_pool_options_init(cat_work_pool_options_t *options);
+/* threads are created immediately, pool is bound to the event loop of current thread */
+CAT_API cat_work_pool_t *cat_work_pool_create(const cat_work_pool_options_t *options);
+/* waiting works are canceled, then it blocks until running works are done */
+CAT_API void cat_work_pool_close(cat_work_pool_t *pool);
+CAT_API const char *cat_work_pool_get_name(const cat_work_pool_t *pool);
+/* threads would be spawned or retired on the fly (a busy thread exits after its current work is done) */
+CAT_API cat_bool_t cat_work_pool_set_thread_count(cat_work_pool_t *pool, size_t thread_count);
+CAT_API void cat_work_pool_get_stats(cat_work_pool_t *pool, cat_work_pool_stats_t *stats);
+
+/* route works of the kind to the pool (NULL means libuv thread-pool), it affects:
+ * cat_work() and cat_work_many(), file-system operations which are based on cat_work (FAST_IO),
+ * and DNS getaddrinfo() via system resolver (SLOW_IO) */
+CAT_API void cat_work_set_pool(cat_work_kind_t kind, cat_work_pool_t *pool);
+CAT_API cat_work_pool_t *cat_work_get_pool(cat_work_kind_t kind);
+/* run the work on the given pool, or the routed one of its kind if pool is NULL */
+CAT_API cat_bool_t cat_work_ex(cat_work_kind_t kind, cat_work_pool_t *pool, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data, cat_timeout_t timeout);
 
 #ifdef __cplusplus
 }
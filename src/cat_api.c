@@ -40,13 +40,18 @@ CAT_API cat_bool_t cat_module_init_all(void)
     return cat_module_init() &&
            cat_coroutine_module_init() &&
            cat_event_module_init() &&
+           cat_work_module_init() &&
            cat_buffer_module_init() &&
+           cat_poll_module_init() &&
 #ifdef CAT_SSL
            cat_ssl_module_init() &&
 #endif
            cat_socket_module_init() &&
 #ifdef CAT_OS_WAIT
            cat_os_wait_module_init() &&
+#endif
+#ifdef CAT_IO_URING
+           cat_io_uring_module_init() &&
 #endif
            cat_watchdog_module_init() &&
            cat_true;
@@ -57,10 +62,15 @@ CAT_API cat_bool_t cat_module_shutdown_all(void)
     cat_bool_t ret = cat_true;
 
     ret = cat_watchdog_module_shutdown() && ret;
+#ifdef CAT_IO_URING
+    ret = cat_io_uring_module_shutdown() && ret;
+#endif
 #ifdef CAT_OS_WAIT
     ret = cat_os_wait_module_shutdown() && ret;
 #endif
     ret = cat_socket_module_shutdown() && ret;
+    ret = cat_poll_module_shutdown() && ret;
+    ret = cat_work_module_shutdown() && ret;
     ret = cat_event_module_shutdown() && ret;
     ret = cat_coroutine_module_shutdown() && ret;
     ret = cat_module_shutdown() && ret;
@@ -73,9 +83,14 @@ CAT_API cat_bool_t cat_runtime_init_all(void)
     return cat_runtime_init() &&
            cat_coroutine_runtime_init() &&
            cat_event_runtime_init() &&
+           cat_work_runtime_init() &&
+           cat_poll_runtime_init() &&
            cat_socket_runtime_init() &&
 #ifdef CAT_OS_WAIT
            cat_os_wait_runtime_init() &&
+#endif
+#ifdef CAT_IO_URING
+           cat_io_uring_runtime_init() &&
 #endif
            cat_watchdog_runtime_init() &&
            cat_true;
@@ -86,10 +101,16 @@ CAT_API cat_bool_t cat_runtime_shutdown_all(void)
     cat_bool_t ret = cat_true;
 
     ret = cat_watchdog_runtime_shutdown() && ret;
+#ifdef CAT_IO_URING
+    ret = cat_io_uring_runtime_shutdown() && ret;
+#endif
 #ifdef CAT_OS_WAIT
     ret = cat_os_wait_runtime_shutdown() && ret;
 #endif
+    ret = cat_poll_runtime_shutdown() && ret;
     ret = cat_event_runtime_shutdown() && ret;
+    /* after event shutdown, works may be done during it */
+    ret = cat_work_runtime_shutdown() && ret;
     ret = cat_coroutine_runtime_shutdown() && ret;
     ret = cat_runtime_shutdown() && ret;
 
@@ -56,7 +56,7 @@ static void cat_async_callback(uv_async_t *handle)
 
     async->done = cat_true;
     if (coroutine != NULL) {
-        cat_coroutine_schedule(coroutine, THREAD, "Async");
+        cat_coroutine_wakeup(coroutine, THREAD, "Async");
     } else if (async->closing) {
         /* wait failed/cancelled and reach here */
         uv_close(&async->u.handle, cat_async_close_callback);
@@ -184,6 +184,29 @@ CAT_API cat_bool_t cat_coroutine_runtime_init(void)
     CAT_COROUTINE_G(peak_count) = 0;
     CAT_COROUTINE_G(switches) = 0;
 
+    /* init accounting */
+    CAT_COROUTINE_G(accounting) = cat_false;
+    CAT_COROUTINE_G(accounting_time) = 0;
+    cat_queue_init(&CAT_COROUTINE_G(accounted_coroutines));
+    CAT_COROUTINE_G(ready_time_function) = NULL;
+
+    /* init coroutine-local storage */
+    memset(CAT_COROUTINE_G(local_keys), 0, sizeof(CAT_COROUTINE_G(local_keys)));
+
+    /* init ready queue */
+    CAT_COROUTINE_G(ready_queue_enabled) = cat_false;
+    do {
+        int priority;
+        for (priority = 0; priority < CAT_COROUTINE_PRIORITY_COUNT; priority++) {
+            cat_queue_init(&CAT_COROUTINE_G(ready_queues)[priority]);
+        }
+    } while (0);
+    CAT_COROUTINE_G(ready_count) = 0;
+    CAT_COROUTINE_G(ready_starvation_limit) = CAT_COROUTINE_READY_DEFAULT_STARVATION_LIMIT;
+    memset(CAT_COROUTINE_G(ready_skips), 0, sizeof(CAT_COROUTINE_G(ready_skips)));
+    memset(CAT_COROUTINE_G(ready_stats), 0, sizeof(CAT_COROUTINE_G(ready_stats)));
+    CAT_COROUTINE_G(ready_wakeup_function) = NULL;
+
     /* init main coroutine properties */
     do {
         cat_coroutine_t *main_coroutine = &CAT_COROUTINE_G(_main);
@@ -196,6 +219,14 @@ CAT_API cat_bool_t cat_coroutine_runtime_init(void)
         main_coroutine->from = NULL;
         main_coroutine->previous = NULL;
         main_coroutine->next = NULL;
+        memset(&main_coroutine->accounting, 0, sizeof(main_coroutine->accounting));
+        cat_queue_init(&main_coroutine->accounting.node);
+        main_coroutine->locals = NULL;
+        main_coroutine->locals_size = 0;
+        main_coroutine->deadline = 0;
+        main_coroutine->priority = CAT_COROUTINE_PRIORITY_NORMAL;
+        cat_queue_init(&main_coroutine->ready_node);
+        main_coroutine->ready_time = 0;
         main_coroutine->stack_size = 0;
         main_coroutine->function = NULL;
 #ifdef CAT_COROUTINE_USE_USER_STACK
@@ -235,6 +266,37 @@ CAT_API cat_bool_t cat_coroutine_runtime_init(void)
     return cat_true;
 }
 
+static void cat_coroutine_local_destruct(cat_coroutine_t *coroutine)
+{
+    cat_coroutine_local_key_t key;
+    cat_bool_t called;
+    int n;
+
+    /* destructor may set values again, so we do it for several rounds like pthread */
+    for (n = 0; n < CAT_COROUTINE_LOCAL_DESTRUCTOR_ITERATIONS; n++) {
+        called = cat_false;
+        for (key = 0; key < coroutine->locals_size; key++) {
+            const cat_coroutine_local_key_info_t *info = &CAT_COROUTINE_G(local_keys)[key];
+            cat_coroutine_local_t *local = &coroutine->locals[key];
+            cat_data_t *value = local->value;
+            if (value == NULL) {
+                continue;
+            }
+            local->value = NULL;
+            if (info->used && info->generation == local->generation && info->destructor != NULL) {
+                info->destructor(value);
+                called = cat_true;
+            }
+        }
+        if (!called) {
+            break;
+        }
+    }
+    cat_free(coroutine->locals);
+    coroutine->locals = NULL;
+    coroutine->locals_size = 0;
+}
+
 CAT_API cat_bool_t cat_coroutine_runtime_shutdown(void)
 {
     /* For the non-scheduler mode */
@@ -244,6 +306,18 @@ CAT_API cat_bool_t cat_coroutine_runtime_shutdown(void)
         "Coroutine waiter should be empty");
     CAT_ASSERT(cat_coroutine_get_scheduler() == NULL && "Coroutine scheduler should have been stopped");
     CAT_ASSERT(CAT_COROUTINE_G(count) == 1 && "Coroutine count should be 1");
+    CAT_ASSERT(CAT_COROUTINE_G(ready_count) == 0 && "Coroutine ready queue should be empty");
+
+    if (CAT_COROUTINE_G(main)->locals != NULL) {
+        cat_coroutine_local_destruct(CAT_COROUTINE_G(main));
+    }
+
+    /* only main coroutine may be still there */
+    while (!cat_queue_empty(&CAT_COROUTINE_G(accounted_coroutines))) {
+        cat_queue_node_t *node = cat_queue_next(&CAT_COROUTINE_G(accounted_coroutines));
+        cat_queue_remove(node);
+        cat_queue_init(node);
+    }
 
     return cat_true;
 }
@@ -276,6 +350,13 @@ CAT_API cat_coroutine_msec_time_function_t cat_coroutine_set_msec_time_function(
     return original_function;
 }
 
+CAT_API cat_coroutine_ready_time_function_t cat_coroutine_set_ready_time_function(cat_coroutine_ready_time_function_t function)
+{
+    cat_coroutine_ready_time_function_t original_function = CAT_COROUTINE_G(ready_time_function);
+    CAT_COROUTINE_G(ready_time_function) = function;
+    return original_function;
+}
+
 CAT_API cat_coroutine_jump_t cat_coroutine_register_jump(cat_coroutine_jump_t jump)
 {
     cat_coroutine_jump_t original_jump = cat_coroutine_jump;
@@ -305,6 +386,22 @@ CAT_API cat_coroutine_t *cat_coroutine_register_main(cat_coroutine_t *coroutine)
     if (original_main != coroutine) {
         if (original_main != NULL) {
             memcpy(coroutine, original_main, sizeof(*coroutine));
+            /* the copied node still points to the original one */
+            cat_queue_init(&coroutine->accounting.node);
+            if (!cat_queue_empty(&original_main->accounting.node)) {
+                cat_queue_remove(&original_main->accounting.node);
+                cat_queue_init(&original_main->accounting.node);
+                cat_queue_push_back(&CAT_COROUTINE_G(accounted_coroutines), &coroutine->accounting.node);
+            }
+            /* locals are moved to the new one */
+            original_main->locals = NULL;
+            original_main->locals_size = 0;
+            cat_queue_init(&coroutine->ready_node);
+            if (!cat_queue_empty(&original_main->ready_node)) {
+                cat_queue_remove(&original_main->ready_node);
+                cat_queue_init(&original_main->ready_node);
+                cat_queue_push_back(&CAT_COROUTINE_G(ready_queues)[coroutine->priority], &coroutine->ready_node);
+            }
         }
         CAT_COROUTINE_G(main) = coroutine;
         if (original_main == CAT_COROUTINE_G(current)) {
@@ -419,6 +516,10 @@ static void cat_coroutine_context_function(cat_coroutine_transfer_t transfer)
     coroutine->start_time = cat_coroutine_msec_time();
     /* execute function */
     data = coroutine->function(data);
+    /* destruct locals */
+    if (coroutine->locals != NULL) {
+        cat_coroutine_local_destruct(coroutine);
+    }
     /* end time */
     coroutine->end_time = cat_coroutine_msec_time();
     /* finished */
@@ -564,6 +665,14 @@ CAT_API cat_coroutine_t *cat_coroutine_create_ex(cat_coroutine_t *coroutine, cat
     coroutine->from = NULL;
     coroutine->previous = NULL;
     coroutine->next = NULL;
+    memset(&coroutine->accounting, 0, sizeof(coroutine->accounting));
+    cat_queue_init(&coroutine->accounting.node);
+    coroutine->locals = NULL;
+    coroutine->locals_size = 0;
+    coroutine->deadline = CAT_COROUTINE_G(current) != NULL ? CAT_COROUTINE_G(current)->deadline : 0;
+    coroutine->priority = CAT_COROUTINE_G(current) != NULL ? CAT_COROUTINE_G(current)->priority : CAT_COROUTINE_PRIORITY_NORMAL;
+    cat_queue_init(&coroutine->ready_node);
+    coroutine->ready_time = 0;
     coroutine->start_time = 0;
     coroutine->end_time = 0;
     coroutine->stack_size = (cat_coroutine_stack_size_t) stack_size;
@@ -603,6 +712,13 @@ CAT_API void cat_coroutine_free(cat_coroutine_t *coroutine)
 {
     CAT_LOG_DEBUG(COROUTINE, "coroutine_close(id: " CAT_COROUTINE_ID_FMT ")", coroutine->id);
     CAT_ASSERT(!cat_coroutine_is_alive(coroutine) && "Coroutine can not be forced to close when it is running or waiting");
+    if (!cat_queue_empty(&coroutine->accounting.node)) {
+        cat_queue_remove(&coroutine->accounting.node);
+    }
+    if (coroutine->locals != NULL) {
+        /* it was never finished, destructors can not be called here */
+        cat_free(coroutine->locals);
+    }
 #ifdef CAT_COROUTINE_USE_THREAD_CONTEXT
     if (coroutine->start_time == 0) {
         coroutine->state = CAT_COROUTINE_STATE_DEAD;
@@ -657,12 +773,68 @@ CAT_API cat_bool_t cat_coroutine_close(cat_coroutine_t *coroutine)
     return cat_true;
 }
 
+static void cat_coroutine_account(cat_coroutine_t *current_coroutine, cat_coroutine_t *coroutine)
+{
+    cat_coroutine_t *scheduler = CAT_COROUTINE_G(scheduler);
+    cat_nsec_t now = cat_time_nsec();
+
+    if (current_coroutine != scheduler) {
+        cat_coroutine_accounting_t *accounting = &current_coroutine->accounting;
+        cat_nsec_t slice = now - CAT_COROUTINE_G(accounting_time);
+        accounting->cpu_time += slice;
+        if (slice > accounting->max_slice) {
+            accounting->max_slice = slice;
+        }
+        if (cat_queue_empty(&accounting->node)) {
+            cat_queue_push_back(&CAT_COROUTINE_G(accounted_coroutines), &accounting->node);
+        }
+    }
+    if (coroutine != scheduler) {
+        cat_coroutine_accounting_t *accounting = &coroutine->accounting;
+        /* it was woken up by some events which were ready since ready time,
+         * but scheduler has been busy with other things until now */
+        if (current_coroutine == scheduler && CAT_COROUTINE_G(ready_time_function) != NULL) {
+            cat_nsec_t ready_time = CAT_COROUTINE_G(ready_time_function)();
+            if (ready_time != 0 && now > ready_time) {
+                accounting->wait_time += now - ready_time;
+            }
+        }
+        if (cat_queue_empty(&accounting->node)) {
+            cat_queue_push_back(&CAT_COROUTINE_G(accounted_coroutines), &accounting->node);
+        }
+    }
+    CAT_COROUTINE_G(accounting_time) = now;
+}
+
+static void cat_coroutine_ready_remove(cat_coroutine_t *coroutine)
+{
+    cat_coroutine_priority_t priority = coroutine->priority;
+    cat_coroutine_ready_stats_t *stats = &CAT_COROUTINE_G(ready_stats)[priority];
+    cat_nsec_t latency = cat_time_nsec() - coroutine->ready_time;
+
+    cat_queue_remove(&coroutine->ready_node);
+    cat_queue_init(&coroutine->ready_node);
+    CAT_COROUTINE_G(ready_count)--;
+    if (cat_queue_empty(&CAT_COROUTINE_G(ready_queues)[priority])) {
+        CAT_COROUTINE_G(ready_skips)[priority] = 0;
+    }
+    stats->length--;
+    stats->resumed_count++;
+    stats->total_latency += latency;
+    if (latency > stats->max_latency) {
+        stats->max_latency = latency;
+    }
+}
+
 CAT_API void cat_coroutine_jump_standard(cat_coroutine_t *coroutine, cat_data_t *data, cat_data_t **retval)
 {
     cat_coroutine_t *current_coroutine = CAT_COROUTINE_G(current);
 
     CAT_ASSERT((data == NULL || (coroutine->flags & CAT_COROUTINE_FLAG_ACCEPT_DATA)) && "Coroutine does not accept data");
 
+    if (unlikely(CAT_COROUTINE_G(accounting))) {
+        cat_coroutine_account(current_coroutine, coroutine);
+    }
     /* global switches++ */
     CAT_COROUTINE_G(switches)++;
     /* current switches++ */
@@ -776,6 +948,10 @@ CAT_API cat_bool_t cat_coroutine_resume(cat_coroutine_t *coroutine, cat_data_t *
     if (unlikely(!cat_coroutine_check_resumability(coroutine))) {
         return cat_false;
     }
+    if (unlikely(!cat_queue_empty(&coroutine->ready_node))) {
+        /* it is resumed by others before scheduler runs the ready queue */
+        cat_coroutine_ready_remove(coroutine);
+    }
 
     CAT_COROUTINE_SWITCH_LOG(resume, coroutine);
 
@@ -973,6 +1149,403 @@ CAT_API char *cat_coroutine_get_elapsed_str(const cat_coroutine_t *coroutine)
     return cat_time_format_msec(cat_coroutine_get_elapsed(coroutine));
 }
 
+/* accounting */
+
+CAT_API void cat_coroutine_enable_accounting(void)
+{
+    if (CAT_COROUTINE_G(accounting)) {
+        return;
+    }
+    CAT_COROUTINE_G(accounting) = cat_true;
+    CAT_COROUTINE_G(accounting_time) = cat_time_nsec();
+}
+
+CAT_API void cat_coroutine_disable_accounting(void)
+{
+    CAT_COROUTINE_G(accounting) = cat_false;
+}
+
+CAT_API cat_bool_t cat_coroutine_is_accounting_enabled(void)
+{
+    return CAT_COROUTINE_G(accounting);
+}
+
+CAT_API cat_nsec_t cat_coroutine_get_cpu_time(const cat_coroutine_t *coroutine)
+{
+    cat_nsec_t cpu_time = coroutine->accounting.cpu_time;
+
+    /* add the running slice */
+    if (CAT_COROUTINE_G(accounting) &&
+        coroutine == CAT_COROUTINE_G(current) &&
+        coroutine != CAT_COROUTINE_G(scheduler)) {
+        cpu_time += cat_time_nsec() - CAT_COROUTINE_G(accounting_time);
+    }
+
+    return cpu_time;
+}
+
+CAT_API cat_nsec_t cat_coroutine_get_wait_time(const cat_coroutine_t *coroutine)
+{
+    return coroutine->accounting.wait_time;
+}
+
+CAT_API cat_nsec_t cat_coroutine_get_max_slice(const cat_coroutine_t *coroutine)
+{
+    return coroutine->accounting.max_slice;
+}
+
+CAT_API void cat_coroutine_set_budget(cat_coroutine_t *coroutine, cat_nsec_t budget)
+{
+    coroutine->accounting.budget = budget;
+}
+
+CAT_API cat_nsec_t cat_coroutine_get_budget(const cat_coroutine_t *coroutine)
+{
+    return coroutine->accounting.budget;
+}
+
+CAT_API void cat_coroutine_set_deadline(cat_coroutine_t *coroutine, cat_msec_t deadline)
+{
+    coroutine->deadline = deadline;
+}
+
+CAT_API cat_msec_t cat_coroutine_get_deadline(const cat_coroutine_t *coroutine)
+{
+    return coroutine->deadline;
+}
+
+/* priority */
+
+CAT_API const char *cat_coroutine_priority_name(cat_coroutine_priority_t priority)
+{
+    switch (priority) {
+#define CAT_COROUTINE_PRIORITY_NAME_GEN(name, unused, value) case CAT_COROUTINE_PRIORITY_##name: return value;
+    CAT_COROUTINE_PRIORITY_MAP(CAT_COROUTINE_PRIORITY_NAME_GEN)
+#undef CAT_COROUTINE_PRIORITY_NAME_GEN
+    }
+    CAT_NEVER_HERE("Unknown priority");
+}
+
+CAT_API cat_coroutine_priority_t cat_coroutine_get_priority(const cat_coroutine_t *coroutine)
+{
+    return coroutine->priority;
+}
+
+CAT_API void cat_coroutine_set_priority(cat_coroutine_t *coroutine, cat_coroutine_priority_t priority)
+{
+    CAT_ASSERT((unsigned int) priority < CAT_COROUTINE_PRIORITY_COUNT);
+    if (priority == coroutine->priority) {
+        return;
+    }
+    if (!cat_queue_empty(&coroutine->ready_node)) {
+        /* move it to the tail of the new queue, queued time is kept */
+        cat_coroutine_priority_t original_priority = coroutine->priority;
+        cat_queue_remove(&coroutine->ready_node);
+        if (cat_queue_empty(&CAT_COROUTINE_G(ready_queues)[original_priority])) {
+            CAT_COROUTINE_G(ready_skips)[original_priority] = 0;
+        }
+        CAT_COROUTINE_G(ready_stats)[original_priority].length--;
+        cat_queue_push_back(&CAT_COROUTINE_G(ready_queues)[priority], &coroutine->ready_node);
+        CAT_COROUTINE_G(ready_stats)[priority].length++;
+    }
+    coroutine->priority = priority;
+}
+
+/* ready queue */
+
+CAT_API void cat_coroutine_enable_ready_queue(void)
+{
+    CAT_COROUTINE_G(ready_queue_enabled) = cat_true;
+}
+
+CAT_API void cat_coroutine_disable_ready_queue(void)
+{
+    /* queued coroutines will still be resumed by scheduler */
+    CAT_COROUTINE_G(ready_queue_enabled) = cat_false;
+}
+
+CAT_API cat_bool_t cat_coroutine_is_ready_queue_enabled(void)
+{
+    return CAT_COROUTINE_G(ready_queue_enabled);
+}
+
+CAT_API uint32_t cat_coroutine_set_ready_starvation_limit(uint32_t limit)
+{
+    uint32_t original_limit = CAT_COROUTINE_G(ready_starvation_limit);
+
+    CAT_COROUTINE_G(ready_starvation_limit) = limit;
+
+    return original_limit;
+}
+
+CAT_API cat_bool_t cat_coroutine_is_ready(const cat_coroutine_t *coroutine)
+{
+    return !cat_queue_empty(&coroutine->ready_node);
+}
+
+CAT_API cat_coroutine_count_t cat_coroutine_get_ready_count(void)
+{
+    return CAT_COROUTINE_G(ready_count);
+}
+
+CAT_API cat_bool_t cat_coroutine_get_ready_stats(cat_coroutine_priority_t priority, cat_coroutine_ready_stats_t *stats)
+{
+    if (unlikely((unsigned int) priority >= CAT_COROUTINE_PRIORITY_COUNT)) {
+        cat_update_last_error(CAT_EINVAL, "Coroutine priority %d is invalid", (int) priority);
+        return cat_false;
+    }
+    *stats = CAT_COROUTINE_G(ready_stats)[priority];
+
+    return cat_true;
+}
+
+CAT_API void cat_coroutine_reset_ready_stats(void)
+{
+    int priority;
+
+    for (priority = 0; priority < CAT_COROUTINE_PRIORITY_COUNT; priority++) {
+        cat_coroutine_ready_stats_t *stats = &CAT_COROUTINE_G(ready_stats)[priority];
+        cat_coroutine_count_t length = stats->length;
+        memset(stats, 0, sizeof(*stats));
+        stats->length = length;
+    }
+}
+
+CAT_API cat_coroutine_ready_wakeup_function_t cat_coroutine_set_ready_wakeup_function(cat_coroutine_ready_wakeup_function_t function)
+{
+    cat_coroutine_ready_wakeup_function_t original_function = CAT_COROUTINE_G(ready_wakeup_function);
+
+    CAT_COROUTINE_G(ready_wakeup_function) = function;
+
+    return original_function;
+}
+
+CAT_API void cat_coroutine_ready(cat_coroutine_t *coroutine)
+{
+    cat_coroutine_priority_t priority = coroutine->priority;
+
+    if (!cat_queue_empty(&coroutine->ready_node)) {
+        /* it has been woken up by others in this round */
+        return;
+    }
+    coroutine->ready_time = cat_time_nsec();
+    cat_queue_push_back(&CAT_COROUTINE_G(ready_queues)[priority], &coroutine->ready_node);
+    CAT_COROUTINE_G(ready_stats)[priority].length++;
+    CAT_COROUTINE_G(ready_stats)[priority].queued_count++;
+    if (CAT_COROUTINE_G(ready_count)++ == 0 && CAT_COROUTINE_G(ready_wakeup_function) != NULL) {
+        CAT_COROUTINE_G(ready_wakeup_function)();
+    }
+}
+
+static cat_coroutine_priority_t cat_coroutine_ready_pick(void)
+{
+    cat_queue_t *queues = CAT_COROUTINE_G(ready_queues);
+    uint32_t limit = CAT_COROUTINE_G(ready_starvation_limit);
+    int priority;
+
+    /* the lowest starving one goes first */
+    if (limit != 0) {
+        for (priority = CAT_COROUTINE_PRIORITY_COUNT - 1; priority > 0; priority--) {
+            if (CAT_COROUTINE_G(ready_skips)[priority] >= limit && !cat_queue_empty(&queues[priority])) {
+                return (cat_coroutine_priority_t) priority;
+            }
+        }
+    }
+    for (priority = 0; priority < CAT_COROUTINE_PRIORITY_COUNT; priority++) {
+        if (!cat_queue_empty(&queues[priority])) {
+            break;
+        }
+    }
+    CAT_ASSERT(priority < CAT_COROUTINE_PRIORITY_COUNT);
+
+    return (cat_coroutine_priority_t) priority;
+}
+
+CAT_API cat_coroutine_count_t cat_coroutine_run_ready_queue(void)
+{
+    cat_queue_t *queues = CAT_COROUTINE_G(ready_queues);
+    cat_coroutine_count_t count = 0;
+
+    /* queued coroutines may be dequeued by others at any time, so we pick them one by one */
+    while (CAT_COROUTINE_G(ready_count) > 0) {
+        cat_coroutine_priority_t priority = cat_coroutine_ready_pick();
+        cat_coroutine_t *coroutine = cat_queue_front_data(&queues[priority], cat_coroutine_t, ready_node);
+        int lower_priority;
+        for (lower_priority = priority + 1; lower_priority < CAT_COROUTINE_PRIORITY_COUNT; lower_priority++) {
+            if (!cat_queue_empty(&queues[lower_priority])) {
+                CAT_COROUTINE_G(ready_skips)[lower_priority]++;
+            }
+        }
+        CAT_COROUTINE_G(ready_skips)[priority] = 0;
+        cat_coroutine_ready_remove(coroutine);
+        cat_coroutine_schedule(coroutine, COROUTINE, "Ready queue");
+        count++;
+    }
+
+    return count;
+}
+
+static cat_nsec_t cat_coroutine_get_accounting_value(const cat_coroutine_t *coroutine, cat_coroutine_accounting_key_t key)
+{
+    switch (key) {
+        case CAT_COROUTINE_ACCOUNTING_KEY_CPU_TIME:
+            return cat_coroutine_get_cpu_time(coroutine);
+        case CAT_COROUTINE_ACCOUNTING_KEY_WAIT_TIME:
+            return coroutine->accounting.wait_time;
+        case CAT_COROUTINE_ACCOUNTING_KEY_MAX_SLICE:
+            return coroutine->accounting.max_slice;
+    }
+    CAT_NEVER_HERE("Unknown key");
+}
+
+CAT_API size_t cat_coroutine_get_top(cat_coroutine_t **coroutines, size_t n, cat_coroutine_accounting_key_t key)
+{
+    size_t count = 0;
+
+    if (n == 0) {
+        return 0;
+    }
+    /* insertion into a sorted array of n, n is expected to be small */
+    CAT_QUEUE_FOREACH_DATA_START(&CAT_COROUTINE_G(accounted_coroutines), cat_coroutine_t, accounting.node, coroutine) {
+        cat_nsec_t value = cat_coroutine_get_accounting_value(coroutine, key);
+        size_t i = count;
+        if (count == n) {
+            if (value <= cat_coroutine_get_accounting_value(coroutines[n - 1], key)) {
+                continue;
+            }
+            i--;
+        } else {
+            count++;
+        }
+        for (; i > 0 && cat_coroutine_get_accounting_value(coroutines[i - 1], key) < value; i--) {
+            coroutines[i] = coroutines[i - 1];
+        }
+        coroutines[i] = coroutine;
+    } CAT_QUEUE_FOREACH_DATA_END();
+
+    return count;
+}
+
+CAT_API void cat_coroutine_dump_top(size_t n, cat_coroutine_accounting_key_t key)
+{
+    cat_coroutine_t **coroutines;
+    size_t count, i;
+
+    if (n == 0) {
+        return;
+    }
+    coroutines = (cat_coroutine_t **) cat_malloc(sizeof(*coroutines) * n);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(coroutines == NULL)) {
+        CAT_SYSCALL_FAILURE(NOTICE, COROUTINE, "Malloc for top coroutines failed");
+        return;
+    }
+#endif
+    count = cat_coroutine_get_top(coroutines, n, key);
+    for (i = 0; i < count; i++) {
+        cat_coroutine_t *coroutine = coroutines[i];
+        const char *name = cat_coroutine_get_role_name(coroutine);
+        CAT_LOG_INFO(COROUTINE, "#%-3zu R" CAT_COROUTINE_ID_FMT "%s%s%s state: %-7s switches: " CAT_COROUTINE_SWITCHES_FMT " "
+            "cpu_time: %" PRIu64 "ns, wait_time: %" PRIu64 "ns, max_slice: %" PRIu64 "ns",
+            i + 1, coroutine->id, name != NULL ? " (" : "", name != NULL ? name : "", name != NULL ? ")" : "",
+            cat_coroutine_get_state_name(coroutine), coroutine->switches,
+            cat_coroutine_get_cpu_time(coroutine), coroutine->accounting.wait_time, coroutine->accounting.max_slice);
+    }
+    cat_free(coroutines);
+}
+
+/* coroutine-local storage */
+
+CAT_API cat_bool_t cat_coroutine_local_key_create(cat_coroutine_local_key_t *key, cat_coroutine_local_destructor_t destructor)
+{
+    cat_coroutine_local_key_info_t *keys = CAT_COROUTINE_G(local_keys);
+    cat_coroutine_local_key_t n;
+
+    for (n = 0; n < CAT_COROUTINE_LOCAL_MAX_KEYS; n++) {
+        if (!keys[n].used) {
+            keys[n].used = cat_true;
+            keys[n].destructor = destructor;
+            *key = n;
+            return cat_true;
+        }
+    }
+    cat_update_last_error(CAT_EAGAIN, "Coroutine local keys have been exhausted (max: %d)", CAT_COROUTINE_LOCAL_MAX_KEYS);
+
+    return cat_false;
+}
+
+static cat_always_inline cat_bool_t cat_coroutine_local_key_is_valid(cat_coroutine_local_key_t key)
+{
+    return key < CAT_COROUTINE_LOCAL_MAX_KEYS && CAT_COROUTINE_G(local_keys)[key].used;
+}
+
+CAT_API cat_bool_t cat_coroutine_local_key_delete(cat_coroutine_local_key_t key)
+{
+    if (unlikely(!cat_coroutine_local_key_is_valid(key))) {
+        cat_update_last_error(CAT_EINVAL, "Coroutine local key is invalid");
+        return cat_false;
+    }
+    CAT_COROUTINE_G(local_keys)[key].used = cat_false;
+    CAT_COROUTINE_G(local_keys)[key].generation++;
+    CAT_COROUTINE_G(local_keys)[key].destructor = NULL;
+
+    return cat_true;
+}
+
+CAT_API cat_data_t *cat_coroutine_local_get(cat_coroutine_local_key_t key)
+{
+    return cat_coroutine_get_local(CAT_COROUTINE_G(current), key);
+}
+
+CAT_API cat_bool_t cat_coroutine_local_set(cat_coroutine_local_key_t key, cat_data_t *value)
+{
+    cat_coroutine_t *coroutine = CAT_COROUTINE_G(current);
+
+    if (unlikely(!cat_coroutine_local_key_is_valid(key))) {
+        cat_update_last_error(CAT_EINVAL, "Coroutine local key is invalid");
+        return cat_false;
+    }
+    if (unlikely(key >= coroutine->locals_size)) {
+        cat_coroutine_local_key_t size;
+        cat_coroutine_local_t *locals;
+        if (value == NULL) {
+            return cat_true;
+        }
+        size = CAT_MAX(key + 1, coroutine->locals_size * 2);
+        size = CAT_MIN(size, CAT_COROUTINE_LOCAL_MAX_KEYS);
+        locals = (cat_coroutine_local_t *) cat_realloc(coroutine->locals, sizeof(*locals) * size);
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(locals == NULL)) {
+            cat_update_last_error_of_syscall("Realloc for coroutine locals failed");
+            return cat_false;
+        }
+#endif
+        memset(locals + coroutine->locals_size, 0, sizeof(*locals) * (size - coroutine->locals_size));
+        coroutine->locals = locals;
+        coroutine->locals_size = size;
+    }
+    coroutine->locals[key].value = value;
+    coroutine->locals[key].generation = CAT_COROUTINE_G(local_keys)[key].generation;
+
+    return cat_true;
+}
+
+CAT_API cat_data_t *cat_coroutine_get_local(const cat_coroutine_t *coroutine, cat_coroutine_local_key_t key)
+{
+    const cat_coroutine_local_t *local;
+
+    if (key >= coroutine->locals_size) {
+        return NULL;
+    }
+    local = &coroutine->locals[key];
+    if (unlikely(local->generation != CAT_COROUTINE_G(local_keys)[key].generation)) {
+        /* it was set by a deleted key */
+        return NULL;
+    }
+
+    return local->value;
+}
+
 /* scheduler */
 
 static void cat_coroutine_deadlock(cat_coroutine_deadlock_function_t deadlock)
@@ -1051,6 +1624,8 @@ CAT_API cat_coroutine_t *cat_coroutine_scheduler_run(cat_coroutine_t *coroutine,
         cat_update_last_error_with_previous("Create event scheduler failed");
         return NULL;
     }
+    /* scheduler serves everyone */
+    coroutine->deadline = 0;
 
     /* run scheduler */
     (void) cat_coroutine_resume(coroutine, (cat_data_t *) scheduler, NULL);
@@ -34,6 +34,8 @@ typedef struct cat_curl_pollfd_s {
     cat_queue_node_t node;
     curl_socket_t sockfd;
     int action;
+    /* registration of fd is kept alive until CURL_POLL_REMOVE */
+    cat_bool_t watched;
 } cat_curl_pollfd_t;
 
 typedef struct cat_curl_multi_context_s {
@@ -48,6 +50,32 @@ typedef struct cat_curl_multi_context_s {
 
 RB_HEAD(cat_curl_multi_context_tree_s, cat_curl_multi_context_s);
 
+/* transfer which is performed on the shared multi */
+typedef struct cat_curl_transfer_s {
+    cat_queue_node_t node;
+    CURL *ch;
+    cat_coroutine_t *coroutine;
+    CURLcode code;
+    cat_bool_t done;
+} cat_curl_transfer_t;
+
+/* socket of the shared multi */
+typedef struct cat_curl_socket_s {
+    cat_queue_node_t node;
+    cat_queue_node_t ready_node;
+    curl_socket_t sockfd;
+    /* CURL_POLL_XXX */
+    int action;
+    /* uv events of the started watcher */
+    int events;
+    /* CURL_CSELECT_XXX which has not been handled yet */
+    int ready;
+    union {
+        uv_handle_t handle;
+        uv_poll_t poll;
+    } u;
+} cat_curl_socket_t;
+
 static int cat_curl__multi_context_compare(cat_curl_multi_context_t* c1, cat_curl_multi_context_t* c2)
 {
     uintptr_t m1 = (uintptr_t) c1->multi;
@@ -69,6 +97,27 @@ RB_GENERATE_STATIC(cat_curl_multi_context_tree_s,
 
 CAT_GLOBALS_STRUCT_BEGIN(cat_curl) {
     struct cat_curl_multi_context_tree_s multi_tree;
+    cat_bool_t shared_enabled;
+    CURLM *shared_multi;
+    CURLSH *share;
+    /* transfers which are running on the shared multi */
+    cat_queue_t transfers;
+    /* reactor of the shared multi */
+    uv_timer_t shared_timer;
+    cat_bool_t shared_timedout;
+    cat_queue_t shared_sockets;
+    cat_queue_t ready_sockets;
+    /* some watchers were stopped by libuv due to error */
+    cat_bool_t shared_sockets_stopped;
+    cat_event_shutdown_task_t *shared_shutdown_task;
+    cat_coroutine_t *reactor;
+    cat_bool_t reactor_waiting;
+    cat_event_io_defer_task_t *reactor_task;
+    /* reactor is in curl_multi_socket_action() (callbacks may yield by mistake) */
+    cat_bool_t reactor_in_curl;
+    /* coroutines which are waiting for reactor to leave curl */
+    cat_queue_t reactor_leave_waiters;
+    cat_curl_stats_t stats;
 } CAT_GLOBALS_STRUCT_END(cat_curl);
 
 CAT_GLOBALS_DECLARE(cat_curl);
@@ -151,6 +200,494 @@ static const char *cat_curl_action_name(int action)
 /* easy */
 
 static CURLMcode cat_curl_multi_wait_impl(CURLM *multi, int timeout_ms, int *numfds, int *running_handles);
+static CURLMcode cat_curl_multi_socket_action(CURLM *multi, curl_socket_t sockfd, int action, int *running_handles);
+
+CAT_API cat_bool_t cat_curl_enable_shared(cat_bool_t enable)
+{
+    cat_bool_t previous = CAT_CURL_G(shared_enabled);
+
+    CAT_CURL_G(shared_enabled) = enable;
+
+    return previous;
+}
+
+CAT_API cat_bool_t cat_curl_is_shared_enabled(void)
+{
+    return CAT_CURL_G(shared_enabled);
+}
+
+CAT_API CURLSH *cat_curl_get_share(void)
+{
+    CURLSH *share = CAT_CURL_G(share);
+
+    if (share == NULL) {
+        share = curl_share_init();
+        if (unlikely(share == NULL)) {
+            return NULL;
+        }
+        /* connection cache is shared by the shared multi itself */
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        CAT_LOG_DEBUG(CURL, "curl_share_init(share: %p)", share);
+        CAT_CURL_G(share) = share;
+    }
+
+    return share;
+}
+
+CAT_API const cat_curl_stats_t *cat_curl_get_stats(void)
+{
+    return &CAT_CURL_G(stats);
+}
+
+/* the shared multi is driven by the loop directly (reactor):
+ * every socket of it has a long-lived poll watcher, readiness of sockets and
+ * timeout of the multi are collected in loop callbacks, then the reactor coroutine
+ * calls curl_multi_socket_action() only for those sockets which are ready,
+ * and transfers which are done resume their owners.
+ * curl callbacks (e.g. CURLOPT_WRITEFUNCTION) are called in the reactor coroutine. */
+
+static void cat_curl_shared_notify(void);
+
+static cat_always_inline int cat_curl_translate_poll_flags_to_uv(int action)
+{
+    int events = 0;
+
+    if (action == CURL_POLL_IN || action == CURL_POLL_INOUT) {
+        events |= UV_READABLE;
+    }
+    if (action == CURL_POLL_OUT || action == CURL_POLL_INOUT) {
+        events |= UV_WRITABLE;
+    }
+
+    return events;
+}
+
+static void cat_curl_shared_socket_close_callback(uv_handle_t *handle)
+{
+    cat_curl_socket_t *socket = cat_container_of(handle, cat_curl_socket_t, u.handle);
+    cat_free(socket);
+}
+
+static void cat_curl_shared_socket_close(cat_curl_socket_t *socket)
+{
+    cat_queue_remove(&socket->node);
+    if (socket->ready != CURL_CSELECT_NONE) {
+        cat_queue_remove(&socket->ready_node);
+    }
+    uv_close(&socket->u.handle, cat_curl_shared_socket_close_callback);
+}
+
+static void cat_curl_shared_poll_callback(uv_poll_t *handle, int status, int events)
+{
+    cat_curl_socket_t *socket = cat_container_of(handle, cat_curl_socket_t, u.poll);
+    int ready = CURL_CSELECT_NONE;
+
+    CAT_LOG_DEBUG_V3(CURL, "shared_poll_callback(fd: %d, status: %d, events: %d)", (int) socket->sockfd, status, events);
+
+    if (unlikely(status < 0)) {
+        /* libuv has stopped the watcher, it would be restarted after cURL handled the error */
+        ready = CURL_CSELECT_ERR;
+        socket->events = 0;
+        CAT_CURL_G(shared_sockets_stopped) = cat_true;
+    } else {
+        if (events & (UV_READABLE | UV_DISCONNECT)) {
+            ready |= CURL_CSELECT_IN;
+        }
+        if (events & UV_WRITABLE) {
+            ready |= CURL_CSELECT_OUT;
+        }
+    }
+    if (ready == CURL_CSELECT_NONE) {
+        return;
+    }
+    if (socket->ready == CURL_CSELECT_NONE) {
+        cat_queue_push_back(&CAT_CURL_G(ready_sockets), &socket->ready_node);
+    }
+    socket->ready |= ready;
+    cat_curl_shared_notify();
+}
+
+static int cat_curl_shared_socket_update(cat_curl_socket_t *socket)
+{
+    int events = cat_curl_translate_poll_flags_to_uv(socket->action);
+    int error;
+
+    if (events == socket->events) {
+        return 0;
+    }
+    if (events == 0) {
+        error = uv_poll_stop(&socket->u.poll);
+    } else {
+        error = uv_poll_start(&socket->u.poll, events, cat_curl_shared_poll_callback);
+    }
+    if (unlikely(error != 0)) {
+        socket->events = 0;
+        return error;
+    }
+    socket->events = events;
+
+    return 0;
+}
+
+static int cat_curl_shared_socket_function(
+    CURL *ch, curl_socket_t sockfd, int action,
+    void *userp, cat_curl_socket_t *socket)
+{
+    CURLM *multi = CAT_CURL_G(shared_multi);
+    int error;
+    (void) ch;
+    (void) userp;
+
+    CAT_LOG_DEBUG_V2(CURL, "libcurl::curl_multi_socket_function(multi: %p, sockfd: %d, action=%s) on shared",
+        multi, sockfd, cat_curl_action_name(action));
+
+    if (action == CURL_POLL_REMOVE) {
+        if (socket != NULL) {
+            cat_curl_shared_socket_close(socket);
+            curl_multi_assign(multi, sockfd, NULL);
+        }
+        return 0;
+    }
+    if (socket == NULL) {
+        socket = (cat_curl_socket_t *) cat_malloc(sizeof(*socket));
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(socket == NULL)) {
+            return -1;
+        }
+#endif
+        error = uv_poll_init_socket(&CAT_EVENT_G(loop), &socket->u.poll, sockfd);
+        if (unlikely(error != 0)) {
+            CAT_WARN_WITH_REASON(CURL, error, "Curl shared multi init poll for socket %d failed", (int) sockfd);
+            cat_free(socket);
+            return -1;
+        }
+        socket->sockfd = sockfd;
+        socket->events = 0;
+        socket->ready = CURL_CSELECT_NONE;
+        cat_queue_push_back(&CAT_CURL_G(shared_sockets), &socket->node);
+        curl_multi_assign(multi, sockfd, socket);
+    }
+    socket->action = action;
+    error = cat_curl_shared_socket_update(socket);
+    if (unlikely(error != 0)) {
+        CAT_WARN_WITH_REASON(CURL, error, "Curl shared multi start poll for socket %d failed", (int) sockfd);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void cat_curl_shared_timer_callback(uv_timer_t *timer)
+{
+    (void) timer;
+    CAT_CURL_G(shared_timedout) = cat_true;
+    /* io defer tasks would not be run until the next poll phase is done */
+    if (CAT_CURL_G(reactor_waiting)) {
+        cat_coroutine_schedule(CAT_CURL_G(reactor), CURL, "Shared multi reactor");
+    }
+}
+
+static int cat_curl_shared_timer_function(CURLM *multi, long timeout, void *userp)
+{
+    uv_timer_t *timer = &CAT_CURL_G(shared_timer);
+    (void) multi;
+    (void) userp;
+
+    CAT_LOG_DEBUG_V2(CURL, "libcurl::curl_multi_timeout_function(multi: %p, timeout=%ld) on shared", multi, timeout);
+
+    if (timeout < 0) {
+        (void) uv_timer_stop(timer);
+    } else {
+        (void) uv_timer_start(timer, cat_curl_shared_timer_callback, timeout, 0);
+    }
+
+    return 0;
+}
+
+static void cat_curl_shared_multi_close(void)
+{
+    CURLM *multi = CAT_CURL_G(shared_multi);
+    cat_curl_socket_t *socket;
+
+    CAT_ASSERT(CAT_CURL_G(reactor) == NULL);
+    CAT_ASSERT(cat_queue_empty(&CAT_CURL_G(transfers)));
+    (void) cat_curl_multi_cleanup(multi);
+    CAT_CURL_G(shared_multi) = NULL;
+    /* sockets of cached connections may not be removed by cURL */
+    while ((socket = cat_queue_front_data(&CAT_CURL_G(shared_sockets), cat_curl_socket_t, node))) {
+        cat_curl_shared_socket_close(socket);
+    }
+    uv_close((uv_handle_t *) &CAT_CURL_G(shared_timer), NULL);
+}
+
+static void cat_curl_shared_multi_shutdown(cat_data_t *data)
+{
+    (void) data;
+    /* task is released by event */
+    CAT_CURL_G(shared_shutdown_task) = NULL;
+    cat_curl_shared_multi_close();
+}
+
+static CURLM *cat_curl_get_shared_multi(void)
+{
+    CURLM *multi = CAT_CURL_G(shared_multi);
+
+    if (multi == NULL) {
+        cat_event_shutdown_task_t *shutdown_task;
+        /* handles of the reactor must be closed before the loop is closed */
+        shutdown_task = cat_event_register_runtime_shutdown_task(cat_curl_shared_multi_shutdown, NULL);
+        if (unlikely(shutdown_task == NULL)) {
+            return NULL;
+        }
+        multi = cat_curl_multi_init();
+        if (unlikely(multi == NULL)) {
+            cat_event_unregister_runtime_shutdown_task(shutdown_task);
+            return NULL;
+        }
+        cat_curl_multi_configure(
+            multi,
+            (void *) cat_curl_shared_socket_function,
+            (void *) cat_curl_shared_timer_function,
+            NULL
+        );
+#ifdef CURLPIPE_MULTIPLEX
+        /* it is the default since 7.62.0, but we rely on it */
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+        (void) uv_timer_init(&CAT_EVENT_G(loop), &CAT_CURL_G(shared_timer));
+        CAT_CURL_G(shared_timedout) = cat_false;
+        CAT_CURL_G(shared_sockets_stopped) = cat_false;
+        CAT_CURL_G(shared_shutdown_task) = shutdown_task;
+        CAT_CURL_G(shared_multi) = multi;
+    }
+
+    return multi;
+}
+
+static void cat_curl_shared_transfer_done(cat_curl_transfer_t *transfer, CURLcode code)
+{
+    cat_curl_stats_t *stats = &CAT_CURL_G(stats);
+    long connects = 0;
+
+    transfer->done = cat_true;
+    transfer->code = code;
+    stats->transfer_count++;
+    if (curl_easy_getinfo(transfer->ch, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK) {
+        stats->new_connection_count += connects;
+        if (connects == 0 && code == CURLE_OK) {
+            stats->reused_connection_count++;
+        }
+    }
+}
+
+/* returns number of transfers which are done */
+static size_t cat_curl_shared_dispatch(CURLM *multi)
+{
+    cat_curl_transfer_t *transfer;
+    cat_queue_t done;
+    CURLMsg *message;
+    int n;
+    size_t count = 0;
+
+    /* messages would be invalidated once handle is removed,
+     * so we mark all of them as done before waking up anyone */
+    cat_queue_init(&done);
+    while ((message = curl_multi_info_read(multi, &n)) != NULL) {
+        CAT_LOG_DEBUG_V2(CURL, "libcurl::curl_multi_info_read(multi: %p) = %p (ch: %p)", multi, message, message->easy_handle);
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        /* private data is not used, because it belongs to user */
+        CAT_QUEUE_FOREACH_DATA_START(&CAT_CURL_G(transfers), cat_curl_transfer_t, node, transfer) {
+            if (transfer->ch == message->easy_handle) {
+                cat_curl_shared_transfer_done(transfer, message->data.result);
+                cat_queue_remove(&transfer->node);
+                cat_queue_push_back(&done, &transfer->node);
+                count++;
+                break;
+            }
+        } CAT_QUEUE_FOREACH_DATA_END();
+    }
+    while ((transfer = cat_queue_front_data(&done, cat_curl_transfer_t, node)) != NULL) {
+        cat_queue_remove(&transfer->node);
+        cat_coroutine_wakeup(transfer->coroutine, CURL, "Shared multi transfer");
+    }
+
+    return count;
+}
+
+static void cat_curl_shared_socket_action(CURLM *multi, curl_socket_t sockfd, int ev_bitmask)
+{
+    cat_coroutine_t *waiter;
+    int running_handles;
+
+    CAT_CURL_G(reactor_in_curl) = cat_true;
+    (void) cat_curl_multi_socket_action(multi, sockfd, ev_bitmask, &running_handles);
+    CAT_CURL_G(reactor_in_curl) = cat_false;
+    CAT_CURL_G(stats).socket_action_count++;
+    /* waiters remove themselves from the queue once they are resumed */
+    while ((waiter = cat_queue_front_data(&CAT_CURL_G(reactor_leave_waiters), cat_coroutine_t, waiter.node))) {
+        cat_coroutine_schedule(waiter, CURL, "Shared multi reactor leave waiter");
+    }
+}
+
+/* curl_multi_remove_handle() fails with CURLM_RECURSIVE_API_CALL if reactor is in curl callback,
+ * so the caller must wait for it even if it has been cancelled, or easy handle would be left in multi */
+static void cat_curl_shared_wait_for_reactor_leave(void)
+{
+    cat_coroutine_t *coroutine = CAT_COROUTINE_G(current);
+    cat_msec_t deadline;
+
+    if (likely(!CAT_CURL_G(reactor_in_curl))) {
+        return;
+    }
+    deadline = cat_time_set_deadline(0);
+    cat_queue_push_back(&CAT_CURL_G(reactor_leave_waiters), &coroutine->waiter.node);
+    do {
+        (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+    } while (CAT_CURL_G(reactor_in_curl));
+    cat_queue_remove(&coroutine->waiter.node);
+    (void) cat_time_set_deadline(deadline);
+}
+
+static void cat_curl_shared_react(CURLM *multi)
+{
+    cat_curl_socket_t *socket;
+
+    if (CAT_CURL_G(shared_timedout)) {
+        CAT_CURL_G(shared_timedout) = cat_false;
+        cat_curl_shared_socket_action(multi, CURL_SOCKET_TIMEOUT, 0);
+    }
+    /* sockets may be removed during socket action, so we pop them one by one */
+    while ((socket = cat_queue_front_data(&CAT_CURL_G(ready_sockets), cat_curl_socket_t, ready_node))) {
+        int ready = socket->ready;
+        cat_queue_remove(&socket->ready_node);
+        socket->ready = CURL_CSELECT_NONE;
+        cat_curl_shared_socket_action(multi, socket->sockfd, ready);
+    }
+    if (unlikely(CAT_CURL_G(shared_sockets_stopped))) {
+        CAT_CURL_G(shared_sockets_stopped) = cat_false;
+        CAT_QUEUE_FOREACH_DATA_START(&CAT_CURL_G(shared_sockets), cat_curl_socket_t, node, socket) {
+            (void) cat_curl_shared_socket_update(socket);
+        } CAT_QUEUE_FOREACH_DATA_END();
+    }
+}
+
+static void cat_curl_shared_reactor_task_callback(cat_event_io_defer_task_t *task, cat_data_t *data)
+{
+    (void) task;
+    (void) data;
+    cat_coroutine_schedule(CAT_CURL_G(reactor), CURL, "Shared multi reactor");
+}
+
+static void cat_curl_shared_notify(void)
+{
+    /* collect all of events in this poll phase, then react at once */
+    if (CAT_CURL_G(reactor_waiting) && CAT_CURL_G(reactor_task) == NULL) {
+        CAT_CURL_G(reactor_task) = cat_event_io_defer_task_create(cat_curl_shared_reactor_task_callback, NULL);
+    }
+}
+
+static cat_data_t *cat_curl_shared_reactor_function(cat_data_t *data)
+{
+    CURLM *multi = CAT_CURL_G(shared_multi);
+    (void) data;
+
+    /* it serves all transfers, so it must not inherit the deadline of the first one */
+    (void) cat_time_set_deadline(0);
+    CAT_CURL_G(reactor) = CAT_COROUTINE_G(current);
+    /* it exits when there are no transfers, so that it never holds the runtime */
+    while (!cat_queue_empty(&CAT_CURL_G(transfers))) {
+        if (!CAT_CURL_G(shared_timedout) && cat_queue_empty(&CAT_CURL_G(ready_sockets))) {
+            CAT_CURL_G(reactor_waiting) = cat_true;
+            (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+            CAT_CURL_G(reactor_waiting) = cat_false;
+            if (CAT_CURL_G(reactor_task) != NULL) {
+                cat_event_io_defer_task_close(CAT_CURL_G(reactor_task));
+                CAT_CURL_G(reactor_task) = NULL;
+            }
+            continue;
+        }
+        CAT_CURL_G(stats).reactor_wakeup_count++;
+        cat_curl_shared_react(multi);
+        (void) cat_curl_shared_dispatch(multi);
+    }
+    CAT_CURL_G(reactor) = NULL;
+
+    return NULL;
+}
+
+static CURLcode cat_curl_easy_perform_shared(CURL *ch)
+{
+    cat_curl_transfer_t transfer;
+    CURLM *multi;
+    CURLSH *share;
+    CURLcode code = CURLE_RECV_ERROR;
+    CURLMcode mcode;
+    cat_bool_t wait_ret;
+
+    multi = cat_curl_get_shared_multi();
+    if (unlikely(multi == NULL)) {
+        return CURLE_OUT_OF_MEMORY;
+    }
+    share = cat_curl_get_share();
+    if (share != NULL) {
+        curl_easy_setopt(ch, CURLOPT_SHARE, share);
+    }
+    /* wait for the existing connection to multiplex on instead of creating a new one */
+    curl_easy_setopt(ch, CURLOPT_PIPEWAIT, 1L);
+    mcode = curl_multi_add_handle(multi, ch);
+    if (unlikely(mcode != CURLM_OK)) {
+#if LIBCURL_VERSION_NUM >= 0x072001 /* Available since 7.32.1 */
+        if (mcode == CURLM_ADDED_ALREADY) {
+            code = CURLE_AGAIN;
+        }
+#endif
+        goto _add_failed;
+    }
+
+    transfer.ch = ch;
+    transfer.coroutine = CAT_COROUTINE_G(current);
+    transfer.code = CURLE_RECV_ERROR;
+    transfer.done = cat_false;
+    cat_queue_push_back(&CAT_CURL_G(transfers), &transfer.node);
+
+    /* cURL has set a timer to kick off the transfer, reactor would be woken up by it */
+    if (CAT_CURL_G(reactor) == NULL) {
+        if (unlikely(cat_coroutine_run(NULL, cat_curl_shared_reactor_function, NULL) == NULL)) {
+            cat_queue_remove(&transfer.node);
+            goto _error;
+        }
+    }
+    wait_ret = cat_time_wait(CAT_TIMEOUT_FOREVER);
+
+    if (transfer.done) {
+        code = transfer.code;
+    } else {
+        /* cancelled or deadline exceeded */
+        if (!wait_ret && cat_get_last_error_code() == CAT_ETIMEDOUT) {
+            code = CURLE_OPERATION_TIMEDOUT;
+        }
+        cat_queue_remove(&transfer.node);
+        if (cat_queue_empty(&CAT_CURL_G(transfers)) && CAT_CURL_G(reactor_waiting)) {
+            /* let reactor exit */
+            cat_coroutine_schedule(CAT_CURL_G(reactor), CURL, "Shared multi reactor");
+        }
+    }
+    _error:
+    cat_curl_shared_wait_for_reactor_leave();
+    mcode = curl_multi_remove_handle(multi, ch);
+    if (unlikely(mcode != CURLM_OK)) {
+        CAT_WARN(CURL, "Curl shared multi remove handle %p failed: %s", ch, curl_multi_strerror(mcode));
+    }
+    _add_failed:
+    if (share != NULL) {
+        curl_easy_setopt(ch, CURLOPT_SHARE, NULL);
+    }
+
+    return code;
+}
 
 static CURLcode cat_curl_easy_perform_impl(CURL *ch)
 {
@@ -216,7 +753,9 @@ CAT_API CURLcode cat_curl_easy_perform(CURL *ch)
 {
     CAT_LOG_DEBUG(CURL, "curl_easy_perform(ch: %p) = " CAT_LOG_UNFINISHED_STR, ch);
 
-    CURLcode code = cat_curl_easy_perform_impl(ch);
+    CURLcode code = CAT_CURL_G(shared_enabled) ?
+        cat_curl_easy_perform_shared(ch) :
+        cat_curl_easy_perform_impl(ch);
 
     CAT_LOG_DEBUG(CURL, "curl_easy_perform(ch: %p) = %d (%s)", ch, code, curl_easy_strerror(code));
 
@@ -246,10 +785,15 @@ static int cat_curl_multi_socket_function(
             cat_queue_push_back(&context->fds, &fd->node);
             context->nfds++;
             fd->sockfd = sockfd;
+            fd->watched = cat_poll_watch(sockfd);
             curl_multi_assign(multi, sockfd, fd);
         }
-        fd->action |= action;
+        /* action is always the full interest of fd */
+        fd->action = action;
     } else {
+        if (fd->watched) {
+            cat_poll_unwatch(sockfd);
+        }
         cat_queue_remove(&fd->node);
         cat_free(fd);
         context->nfds--;
@@ -322,6 +866,9 @@ static void cat_curl_multi_context_close(cat_curl_multi_context_t *context)
         CAT_LOG_DEBUG_V2(CURL, "curl_multi_context_close(multi: %p) with %zu fds", context->multi, (size_t) context->nfds);
         cat_curl_pollfd_t *fd;
         while ((fd = cat_queue_front_data(&context->fds, cat_curl_pollfd_t, node))) {
+            if (fd->watched) {
+                cat_poll_unwatch(fd->sockfd);
+            }
             cat_queue_remove(&fd->node);
             cat_free(fd);
             context->nfds--;
@@ -393,7 +940,7 @@ static cat_always_inline cat_timeout_t cat_curl_multi_timeout_solve(cat_timeout_
     return operation_timeout;
 }
 
-static cat_always_inline CURLMcode cat_curl_multi_socket_action(CURLM *multi, curl_socket_t sockfd, int action, int *running_handles)
+static CURLMcode cat_curl_multi_socket_action(CURLM *multi, curl_socket_t sockfd, int action, int *running_handles)
 {
     CURLMcode mcode = curl_multi_socket_action(multi, sockfd, action, running_handles);
     CAT_LOG_DEBUG_V2(CURL, "libcurl::curl_multi_socket_action(multi: %p, fd: %d, %s) = %d (%s)",
@@ -681,12 +1228,36 @@ CAT_API cat_bool_t cat_curl_module_shutdown(void)
 
 CAT_API cat_bool_t cat_curl_runtime_init(void)
 {
+    CAT_CURL_G(shared_enabled) = cat_true;
+    CAT_CURL_G(shared_multi) = NULL;
+    CAT_CURL_G(share) = NULL;
+    cat_queue_init(&CAT_CURL_G(transfers));
+    cat_queue_init(&CAT_CURL_G(shared_sockets));
+    cat_queue_init(&CAT_CURL_G(ready_sockets));
+    cat_queue_init(&CAT_CURL_G(reactor_leave_waiters));
+    CAT_CURL_G(shared_shutdown_task) = NULL;
+    CAT_CURL_G(reactor) = NULL;
+    CAT_CURL_G(reactor_waiting) = cat_false;
+    CAT_CURL_G(reactor_task) = NULL;
+    CAT_CURL_G(reactor_in_curl) = cat_false;
+    memset(&CAT_CURL_G(stats), 0, sizeof(CAT_CURL_G(stats)));
 
     return cat_true;
 }
 
 CAT_API cat_bool_t cat_curl_runtime_close(void)
 {
+    CAT_ASSERT(cat_queue_empty(&CAT_CURL_G(transfers)));
+    /* it is usually closed during runtime shutdown */
+    if (CAT_CURL_G(shared_shutdown_task) != NULL) {
+        cat_event_unregister_runtime_shutdown_task(CAT_CURL_G(shared_shutdown_task));
+        CAT_CURL_G(shared_shutdown_task) = NULL;
+        cat_curl_shared_multi_close();
+    }
+    if (CAT_CURL_G(share) != NULL) {
+        (void) curl_share_cleanup(CAT_CURL_G(share));
+        CAT_CURL_G(share) = NULL;
+    }
     CAT_ASSERT(RB_MIN(cat_curl_multi_context_tree_s, &CAT_CURL_G(multi_tree)) == NULL);
 
     return cat_true;
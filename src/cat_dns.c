@@ -20,6 +20,14 @@
 #include "cat_coroutine.h"
 #include "cat_event.h"
 #include "cat_time.h"
+#include "cat_work.h"
+
+/* for uv__getaddrinfo_translate_error */
+#ifdef CAT_IDE_HELPER
+#include "uv-common.h"
+#else
+#include "../deps/libuv/src/uv-common.h"
+#endif
 
 typedef struct cat_getaddrinfo_context_s {
     union {
@@ -46,17 +54,152 @@ static void cat_dns_getaddrinfo_callback(uv_getaddrinfo_t* request, int status,
     cat_free(context);
 }
 
+/* getaddrinfo() on dedicated work pool (SLOW_IO) */
+
+typedef struct cat_getaddrinfo_work_data_s {
+    char *hostname;
+    char *service;
+    struct addrinfo hints;
+    cat_bool_t has_hints;
+    int error;
+    struct addrinfo *response;
+} cat_getaddrinfo_work_data_t;
+
+static void cat_dns_getaddrinfo_work_function(cat_data_t *data)
+{
+    cat_getaddrinfo_work_data_t *work_data = (cat_getaddrinfo_work_data_t *) data;
+
+    work_data->error = getaddrinfo(
+        work_data->hostname, work_data->service,
+        work_data->has_hints ? &work_data->hints : NULL,
+        &work_data->response
+    );
+}
+
+static void cat_dns_getaddrinfo_work_cleanup(cat_data_t *data)
+{
+    cat_getaddrinfo_work_data_t *work_data = (cat_getaddrinfo_work_data_t *) data;
+
+    /* response has not been taken away (e.g. timedout) */
+    if (work_data->response != NULL) {
+        uv_freeaddrinfo(work_data->response);
+    }
+    if (work_data->hostname != NULL) {
+        cat_free(work_data->hostname);
+    }
+    if (work_data->service != NULL) {
+        cat_free(work_data->service);
+    }
+    cat_free(work_data);
+}
+
+static struct addrinfo *cat_dns_getaddrinfo_on_pool(cat_work_pool_t *pool, const char *hostname, const char *service, const struct addrinfo *hints, cat_timeout_t timeout)
+{
+    cat_getaddrinfo_work_data_t *work_data;
+    struct addrinfo *response;
+
+    work_data = (cat_getaddrinfo_work_data_t *) cat_malloc(sizeof(*work_data));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(work_data == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for DNS getaddrinfo work data failed");
+        return NULL;
+    }
+#endif
+    /* caller may return before the work is done, so we must copy them */
+    work_data->hostname = hostname != NULL ? cat_strdup(hostname) : NULL;
+    work_data->service = service != NULL ? cat_strdup(service) : NULL;
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely((hostname != NULL && work_data->hostname == NULL) || (service != NULL && work_data->service == NULL))) {
+        cat_update_last_error_of_syscall("Strdup for DNS getaddrinfo work data failed");
+        work_data->response = NULL;
+        cat_dns_getaddrinfo_work_cleanup(work_data);
+        return NULL;
+    }
+#endif
+    work_data->has_hints = hints != NULL;
+    if (hints != NULL) {
+        memset(&work_data->hints, 0, sizeof(work_data->hints));
+        work_data->hints.ai_flags = hints->ai_flags;
+        work_data->hints.ai_family = hints->ai_family;
+        work_data->hints.ai_socktype = hints->ai_socktype;
+        work_data->hints.ai_protocol = hints->ai_protocol;
+    }
+    work_data->error = 0;
+    work_data->response = NULL;
+    /* data will be released by cleanup even if it fails */
+    if (unlikely(!cat_work_ex(CAT_WORK_KIND_SLOW_IO, pool, cat_dns_getaddrinfo_work_function, cat_dns_getaddrinfo_work_cleanup, work_data, timeout))) {
+        cat_update_last_error_with_previous("DNS getaddrinfo failed");
+        return NULL;
+    }
+    /* work is done and cleanup will be called later, it is safe to access data here */
+    if (unlikely(work_data->error != 0)) {
+        cat_update_last_error_with_reason(uv__getaddrinfo_translate_error(work_data->error), "DNS getaddrinfo failed");
+        return NULL;
+    }
+    response = work_data->response;
+    work_data->response = NULL;
+
+    return response;
+}
+
 CAT_API struct addrinfo *cat_dns_getaddrinfo(const char *hostname, const char *service, const struct addrinfo *hints)
 {
     return cat_dns_getaddrinfo_ex(hostname, service, hints, cat_socket_get_global_dns_timeout());
 }
 
+static struct addrinfo *cat_dns_stub_getaddrinfo(const char *hostname, int port, const struct addrinfo *hints, cat_timeout_t timeout);
+
+static cat_bool_t cat_dns_stub_getaddrinfo_is_available(const char *hostname, const char *service, const struct addrinfo *hints, int *port)
+{
+    if (!CAT_SOCKET_G(dns_use_stub_resolver) || hostname == NULL) {
+        return cat_false;
+    }
+    if (hints != NULL) {
+        if (hints->ai_family != AF_UNSPEC && hints->ai_family != AF_INET && hints->ai_family != AF_INET6) {
+            return cat_false;
+        }
+        if (hints->ai_flags & (AI_PASSIVE | AI_CANONNAME | AI_NUMERICHOST)) {
+            return cat_false;
+        }
+    }
+    *port = 0;
+    if (service != NULL) {
+        /* service names (e.g. "http") require services database, leave them to the system */
+        const char *p = service;
+        if (*p == '\0') {
+            return cat_false;
+        }
+        for (; *p != '\0'; p++) {
+            if (!(*p >= '0' && *p <= '9')) {
+                return cat_false;
+            }
+            *port = *port * 10 + (*p - '0');
+            if (*port > UINT16_MAX) {
+                return cat_false;
+            }
+        }
+    }
+
+    return cat_true;
+}
+
 CAT_API struct addrinfo *cat_dns_getaddrinfo_ex(const char *hostname, const char *service, const struct addrinfo *hints, cat_timeout_t timeout)
 {
-    cat_getaddrinfo_context_t *context = (cat_getaddrinfo_context_t *) cat_malloc(sizeof(*context));
+    cat_getaddrinfo_context_t *context;
     cat_bool_t ret;
-    int error;
+    int error, port;
+
+    if (cat_dns_stub_getaddrinfo_is_available(hostname, service, hints, &port)) {
+        return cat_dns_stub_getaddrinfo(hostname, port, hints, timeout);
+    }
+    do {
+        cat_work_pool_t *pool = cat_work_get_pool(CAT_WORK_KIND_SLOW_IO);
+        if (pool != NULL) {
+            return cat_dns_getaddrinfo_on_pool(pool, hostname, service, hints, timeout);
+        }
+    } while (0);
 
+    context = (cat_getaddrinfo_context_t *) cat_malloc(sizeof(*context));
 #if CAT_ALLOC_HANDLE_ERRORS
     if (unlikely(context == NULL)) {
         cat_update_last_error_of_syscall("Malloc for DNS getaddrinfo context failed");
@@ -91,8 +234,30 @@ CAT_API struct addrinfo *cat_dns_getaddrinfo_ex(const char *hostname, const char
     return context->response;
 }
 
+/* addrinfo created by stub resolver, heads of lists are tracked in the global queue,
+ * so that we can tell them from the ones created by system getaddrinfo() */
+typedef struct cat_dns_stub_addrinfo_s {
+    cat_queue_node_t node;
+    struct addrinfo ai;
+} cat_dns_stub_addrinfo_t;
+
 CAT_API void cat_dns_freeaddrinfo(struct addrinfo *response)
 {
+    if (response == NULL) {
+        return;
+    }
+    CAT_QUEUE_FOREACH_DATA_START(&CAT_SOCKET_G(dns_stub_addrinfos), cat_dns_stub_addrinfo_t, node, stub) {
+        if (&stub->ai == response) {
+            struct addrinfo *next;
+            cat_queue_remove(&stub->node);
+            do {
+                next = response->ai_next;
+                cat_free(cat_container_of(response, cat_dns_stub_addrinfo_t, ai));
+                response = next;
+            } while (response != NULL);
+            return;
+        }
+    } CAT_QUEUE_FOREACH_DATA_END();
     uv_freeaddrinfo(response);
 }
 
@@ -132,3 +297,1248 @@ CAT_API cat_bool_t cat_dns_get_ip_ex(char *buffer, size_t buffer_size, const cha
 
     return cat_true;
 }
+
+/* stub resolver */
+
+#define CAT_DNS_HEADER_SIZE         12
+#define CAT_DNS_QUERY_BUFFER_SIZE   512
+#define CAT_DNS_UDP_BUFFER_SIZE     4096
+#define CAT_DNS_MAX_LABEL_LENGTH    63
+#define CAT_DNS_MAX_POINTER_JUMPS   64
+#define CAT_DNS_MAX_LINE_TOKENS     (1 + CAT_DNS_MAX_SEARCH_DOMAINS)
+
+#define CAT_DNS_CLASS_IN            1
+#define CAT_DNS_TYPE_OPT            41
+
+#define CAT_DNS_FLAG_QR             0x8000
+#define CAT_DNS_FLAG_TC             0x0200
+#define CAT_DNS_FLAG_RD             0x0100
+#define CAT_DNS_RCODE_MASK          0x000f
+
+#define CAT_DNS_RCODE_NOERROR       0
+#define CAT_DNS_RCODE_SERVFAIL      2
+#define CAT_DNS_RCODE_NXDOMAIN      3
+#define CAT_DNS_RCODE_REFUSED       5
+
+typedef struct cat_dns_hosts_entry_s {
+    char *name;
+    cat_dns_record_t record;
+} cat_dns_hosts_entry_t;
+
+typedef struct cat_dns_resolver_s {
+    cat_dns_resolver_options_t options;
+    cat_dns_hosts_entry_t *hosts;
+    size_t hosts_count;
+    unsigned int next_nameserver;
+} cat_dns_resolver_t;
+
+typedef struct cat_dns_question_s {
+    const char *name;
+    cat_dns_record_type_t type;
+    uint16_t id;
+    cat_errno_t error;
+    cat_dns_record_t *records;
+    size_t capacity;
+    size_t count;
+} cat_dns_question_t;
+
+static cat_always_inline uint16_t cat_dns_read_uint16(const unsigned char *p)
+{
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static cat_always_inline uint32_t cat_dns_read_uint32(const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | ((uint32_t) p[3]);
+}
+
+static cat_always_inline unsigned char *cat_dns_write_uint16(unsigned char *p, uint16_t value)
+{
+    p[0] = (unsigned char) (value >> 8);
+    p[1] = (unsigned char) value;
+    return p + 2;
+}
+
+static cat_always_inline cat_bool_t cat_dns_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static cat_always_inline cat_bool_t cat_dns_question_is_done(const cat_dns_question_t *question)
+{
+    /* retrying on other nameservers makes no sense */
+    return question->error == 0 ||
+           question->error == CAT_EAI_NONAME ||
+           question->error == CAT_EAI_NODATA ||
+           question->error == CAT_EINVAL;
+}
+
+/* wire format */
+
+static size_t cat_dns_build_query(unsigned char *buffer, size_t size, uint16_t id, const char *name, cat_dns_record_type_t type)
+{
+    unsigned char *p = buffer;
+    const char *label = name;
+    size_t name_length = strlen(name);
+
+    if (name_length > 0 && name[name_length - 1] == '.') {
+        name_length--;
+    }
+    if (unlikely(name_length == 0 || name_length > CAT_DNS_NAME_BUFFER_SIZE - 3)) {
+        return 0;
+    }
+    /* header + qname + qtype + qclass + OPT RR */
+    if (unlikely(size < CAT_DNS_HEADER_SIZE + (name_length + 2) + 4 + 11)) {
+        return 0;
+    }
+    p = cat_dns_write_uint16(p, id);
+    p = cat_dns_write_uint16(p, CAT_DNS_FLAG_RD);
+    p = cat_dns_write_uint16(p, 1); /* qdcount */
+    p = cat_dns_write_uint16(p, 0); /* ancount */
+    p = cat_dns_write_uint16(p, 0); /* nscount */
+    p = cat_dns_write_uint16(p, 1); /* arcount */
+    while (1) {
+        const char *dot = (const char *) memchr(label, '.', name_length);
+        size_t label_length = dot != NULL ? (size_t) (dot - label) : name_length;
+        if (unlikely(label_length == 0 || label_length > CAT_DNS_MAX_LABEL_LENGTH)) {
+            return 0;
+        }
+        *p++ = (unsigned char) label_length;
+        p = (unsigned char *) cat_strnappend((char *) p, label, label_length);
+        if (dot == NULL) {
+            break;
+        }
+        name_length -= label_length + 1;
+        label = dot + 1;
+    }
+    *p++ = 0;
+    p = cat_dns_write_uint16(p, (uint16_t) type);
+    p = cat_dns_write_uint16(p, CAT_DNS_CLASS_IN);
+    /* EDNS0 OPT pseudo-RR: root name, type, UDP payload size, extended rcode and flags, rdlength */
+    *p++ = 0;
+    p = cat_dns_write_uint16(p, CAT_DNS_TYPE_OPT);
+    p = cat_dns_write_uint16(p, CAT_DNS_UDP_PAYLOAD_SIZE);
+    p = cat_dns_write_uint16(p, 0);
+    p = cat_dns_write_uint16(p, 0);
+    p = cat_dns_write_uint16(p, 0);
+
+    return (size_t) (p - buffer);
+}
+
+/* it only skips the name if buffer is NULL */
+static cat_bool_t cat_dns_expand_name(const unsigned char *message, size_t length, size_t *offset, char *buffer, size_t size)
+{
+    size_t position = *offset, n = 0;
+    unsigned int jumps = 0;
+    cat_bool_t jumped = cat_false;
+
+    while (1) {
+        size_t label_length;
+        if (unlikely(position >= length)) {
+            return cat_false;
+        }
+        label_length = message[position];
+        if ((label_length & 0xc0) == 0xc0) {
+            if (unlikely(position + 1 >= length || ++jumps > CAT_DNS_MAX_POINTER_JUMPS)) {
+                return cat_false;
+            }
+            if (!jumped) {
+                *offset = position + 2;
+                jumped = cat_true;
+            }
+            position = ((label_length & 0x3f) << 8) | message[position + 1];
+            continue;
+        }
+        if (unlikely(label_length & 0xc0)) {
+            return cat_false;
+        }
+        position++;
+        if (label_length == 0) {
+            break;
+        }
+        if (unlikely(position + label_length > length)) {
+            return cat_false;
+        }
+        if (buffer != NULL) {
+            if (unlikely(n + label_length + 1 >= size)) {
+                return cat_false;
+            }
+            if (n > 0) {
+                buffer[n++] = '.';
+            }
+            memcpy(buffer + n, message + position, label_length);
+            n += label_length;
+        }
+        position += label_length;
+    }
+    if (!jumped) {
+        *offset = position;
+    }
+    if (buffer != NULL) {
+        buffer[n] = '\0';
+    }
+
+    return cat_true;
+}
+
+/* answer must echo our question, otherwise it is a stale or forged one */
+static cat_bool_t cat_dns_match_question(const unsigned char *message, size_t length, const cat_dns_question_t *question)
+{
+    char name[CAT_DNS_NAME_BUFFER_SIZE];
+    size_t offset = CAT_DNS_HEADER_SIZE, name_length = strlen(question->name);
+
+    if (cat_dns_read_uint16(message) != question->id || cat_dns_read_uint16(message + 4) != 1) {
+        return cat_false;
+    }
+    if (!cat_dns_expand_name(message, length, &offset, CAT_STRS(name)) || offset + 4 > length) {
+        return cat_false;
+    }
+    if (name_length > 0 && question->name[name_length - 1] == '.') {
+        name_length--;
+    }
+
+    return strlen(name) == name_length &&
+           cat_strncasecmp(name, question->name, name_length) == 0 &&
+           cat_dns_read_uint16(message + offset) == (uint16_t) question->type &&
+           cat_dns_read_uint16(message + offset + 2) == CAT_DNS_CLASS_IN;
+}
+
+static uint16_t cat_dns_generate_id(void)
+{
+    uint16_t id;
+
+    /* it is not predictable, so that spoofing is harder */
+    if (unlikely(uv_random(NULL, NULL, &id, sizeof(id), 0, NULL) != 0)) {
+        /* RAND_MAX may be only 32767 */
+        id = (uint16_t) (rand() ^ (rand() << 8));
+    }
+
+    return id;
+}
+
+/* truncated can be NULL if truncation is unexpected (e.g. TCP) */
+static cat_errno_t cat_dns_parse_response(const unsigned char *message, size_t length, cat_dns_question_t *question, cat_bool_t *truncated)
+{
+    size_t offset = CAT_DNS_HEADER_SIZE;
+    unsigned int flags, qdcount, ancount, n;
+
+    flags = cat_dns_read_uint16(message + 2);
+    if (truncated != NULL) {
+        *truncated = (flags & CAT_DNS_FLAG_TC) != 0;
+        if (*truncated) {
+            return 0;
+        }
+    }
+    switch (flags & CAT_DNS_RCODE_MASK) {
+        case CAT_DNS_RCODE_NOERROR:
+            break;
+        case CAT_DNS_RCODE_NXDOMAIN:
+            return CAT_EAI_NONAME;
+        case CAT_DNS_RCODE_SERVFAIL:
+        case CAT_DNS_RCODE_REFUSED:
+            return CAT_EAI_AGAIN;
+        default:
+            return CAT_EAI_FAIL;
+    }
+    qdcount = cat_dns_read_uint16(message + 4);
+    ancount = cat_dns_read_uint16(message + 6);
+    for (n = 0; n < qdcount; n++) {
+        if (unlikely(!cat_dns_expand_name(message, length, &offset, NULL, 0) || offset + 4 > length)) {
+            return CAT_EAI_FAIL;
+        }
+        if (unlikely(cat_dns_read_uint16(message + offset) != (uint16_t) question->type)) {
+            return CAT_EAI_FAIL;
+        }
+        offset += 4;
+    }
+    question->count = 0;
+    /* records of CNAME chain are skipped, we only care about the final answers */
+    for (n = 0; n < ancount; n++) {
+        unsigned int type, rclass, rdlength;
+        uint32_t ttl;
+        if (unlikely(!cat_dns_expand_name(message, length, &offset, NULL, 0) || offset + 10 > length)) {
+            return CAT_EAI_FAIL;
+        }
+        type = cat_dns_read_uint16(message + offset);
+        rclass = cat_dns_read_uint16(message + offset + 2);
+        ttl = cat_dns_read_uint32(message + offset + 4);
+        rdlength = cat_dns_read_uint16(message + offset + 8);
+        offset += 10;
+        if (unlikely(offset + rdlength > length)) {
+            return CAT_EAI_FAIL;
+        }
+        if (type == (unsigned int) question->type && rclass == CAT_DNS_CLASS_IN && question->count < question->capacity) {
+            cat_dns_record_t *record = &question->records[question->count];
+            record->type = question->type;
+            record->ttl = ttl;
+            switch (question->type) {
+                case CAT_DNS_RECORD_TYPE_A:
+                    if (unlikely(rdlength != sizeof(record->data.a))) {
+                        return CAT_EAI_FAIL;
+                    }
+                    memcpy(&record->data.a, message + offset, sizeof(record->data.a));
+                    break;
+                case CAT_DNS_RECORD_TYPE_AAAA:
+                    if (unlikely(rdlength != sizeof(record->data.aaaa))) {
+                        return CAT_EAI_FAIL;
+                    }
+                    memcpy(&record->data.aaaa, message + offset, sizeof(record->data.aaaa));
+                    break;
+                case CAT_DNS_RECORD_TYPE_SRV: {
+                    size_t target_offset = offset + 6;
+                    if (unlikely(rdlength < 7)) {
+                        return CAT_EAI_FAIL;
+                    }
+                    record->data.srv.priority = cat_dns_read_uint16(message + offset);
+                    record->data.srv.weight = cat_dns_read_uint16(message + offset + 2);
+                    record->data.srv.port = cat_dns_read_uint16(message + offset + 4);
+                    if (unlikely(!cat_dns_expand_name(message, length, &target_offset, CAT_STRS(record->data.srv.target)))) {
+                        return CAT_EAI_FAIL;
+                    }
+                    break;
+                }
+            }
+            question->count++;
+        }
+        offset += rdlength;
+    }
+
+    return question->count > 0 ? 0 : CAT_EAI_NODATA;
+}
+
+/* exchange */
+
+static void cat_dns_resolver_exchange_tcp(const cat_sockaddr_inet_info_t *nameserver, cat_dns_question_t *question, cat_timeout_t timeout)
+{
+    cat_socket_t socket;
+    unsigned char query[CAT_DNS_QUERY_BUFFER_SIZE], header[2];
+    unsigned char *response = NULL;
+    cat_socket_write_vector_t vector[2];
+    size_t query_length, response_length;
+    ssize_t n = -1;
+    cat_bool_t ret;
+
+    CAT_LOG_DEBUG(DNS, "Answer of \"%s\" was truncated, retry it over TCP", question->name);
+
+    query_length = cat_dns_build_query(query, sizeof(query), question->id, question->name, question->type);
+    if (unlikely(query_length == 0)) {
+        question->error = CAT_EINVAL;
+        return;
+    }
+    if (unlikely(cat_socket_create(&socket, CAT_SOCKET_TYPE_TCP) == NULL)) {
+        question->error = cat_get_last_error_code();
+        return;
+    }
+    CAT_TIME_WAIT_START() {
+        ret = cat_socket_connect_ex(&socket, &nameserver->address.common, nameserver->length, timeout);
+    } CAT_TIME_WAIT_END(timeout);
+    if (unlikely(!ret)) {
+        goto _error;
+    }
+    cat_dns_write_uint16(header, (uint16_t) query_length);
+    vector[0] = cat_socket_write_vector_init((const char *) header, sizeof(header));
+    vector[1] = cat_socket_write_vector_init((const char *) query, (cat_socket_vector_length_t) query_length);
+    CAT_TIME_WAIT_START() {
+        ret = cat_socket_write_ex(&socket, vector, CAT_ARRAY_SIZE(vector), timeout);
+    } CAT_TIME_WAIT_END(timeout);
+    if (unlikely(!ret)) {
+        goto _error;
+    }
+    CAT_TIME_WAIT_START() {
+        n = cat_socket_read_ex(&socket, (char *) header, sizeof(header), timeout);
+    } CAT_TIME_WAIT_END(timeout);
+    if (unlikely(n != (ssize_t) sizeof(header))) {
+        goto _error;
+    }
+    response_length = cat_dns_read_uint16(header);
+    if (unlikely(response_length < CAT_DNS_HEADER_SIZE)) {
+        question->error = CAT_EAI_FAIL;
+        goto _close;
+    }
+    response = (unsigned char *) cat_malloc(response_length);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(response == NULL)) {
+        question->error = CAT_ENOMEM;
+        goto _close;
+    }
+#endif
+    CAT_TIME_WAIT_START() {
+        n = cat_socket_read_ex(&socket, (char *) response, response_length, timeout);
+    } CAT_TIME_WAIT_END(timeout);
+    if (unlikely(n != (ssize_t) response_length)) {
+        goto _error;
+    }
+    if (unlikely(!cat_dns_match_question(response, response_length, question))) {
+        question->error = CAT_EAI_FAIL;
+        goto _close;
+    }
+    question->error = cat_dns_parse_response(response, response_length, question, NULL);
+    goto _close;
+
+    _error:
+    question->error = n >= 0 ? CAT_EAI_FAIL : cat_get_last_error_code();
+    _close:
+    if (response != NULL) {
+        cat_free(response);
+    }
+    cat_socket_close(&socket);
+}
+
+/* send all unfinished questions to the nameserver at once and wait for their answers,
+ * so that A and AAAA queries are in flight in parallel */
+static void cat_dns_resolver_exchange(const cat_sockaddr_inet_info_t *nameserver, cat_dns_question_t *questions, size_t question_count, cat_timeout_t timeout)
+{
+    cat_socket_t socket;
+    unsigned char buffer[CAT_DNS_UDP_BUFFER_SIZE];
+    cat_dns_question_t *question;
+    size_t query_length, pending = 0, i;
+    ssize_t n;
+    cat_errno_t error;
+    cat_bool_t ret, truncated;
+
+    if (unlikely(cat_socket_create(&socket, CAT_SOCKET_TYPE_UDP) == NULL)) {
+        error = cat_get_last_error_code();
+        goto _failed;
+    }
+    /* connected UDP socket filters out datagrams from others,
+     * and we can also know it ASAP if nameserver is unreachable (ECONNREFUSED) */
+    if (unlikely(!cat_socket_connect(&socket, &nameserver->address.common, nameserver->length))) {
+        goto _error;
+    }
+    for (i = 0; i < question_count; i++) {
+        question = &questions[i];
+        if (cat_dns_question_is_done(question)) {
+            continue;
+        }
+        question->id = cat_dns_generate_id();
+        query_length = cat_dns_build_query(buffer, CAT_DNS_QUERY_BUFFER_SIZE, question->id, question->name, question->type);
+        if (unlikely(query_length == 0)) {
+            question->error = CAT_EINVAL;
+            continue;
+        }
+        question->error = CAT_ETIMEDOUT;
+        CAT_TIME_WAIT_START() {
+            ret = cat_socket_send_ex(&socket, (const char *) buffer, query_length, timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        if (unlikely(!ret)) {
+            goto _error;
+        }
+        pending++;
+    }
+    while (pending > 0) {
+        uint16_t id;
+        CAT_TIME_WAIT_START() {
+            n = cat_socket_recv_ex(&socket, (char *) buffer, sizeof(buffer), timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        if (unlikely(n < 0)) {
+            goto _error;
+        }
+        if (unlikely(n < CAT_DNS_HEADER_SIZE || !(cat_dns_read_uint16(buffer + 2) & CAT_DNS_FLAG_QR))) {
+            continue;
+        }
+        id = cat_dns_read_uint16(buffer);
+        question = NULL;
+        for (i = 0; i < question_count; i++) {
+            if (questions[i].error == CAT_ETIMEDOUT && questions[i].id == id) {
+                question = &questions[i];
+                break;
+            }
+        }
+        if (unlikely(question == NULL || !cat_dns_match_question(buffer, (size_t) n, question))) {
+            /* stale or forged answer */
+            continue;
+        }
+        question->error = cat_dns_parse_response(buffer, (size_t) n, question, &truncated);
+        if (truncated) {
+            cat_dns_resolver_exchange_tcp(nameserver, question, timeout);
+        }
+        CAT_LOG_DEBUG(DNS, "Query \"%s\" (type=%d) got %zu records" CAT_LOG_STRERRNO_FMT,
+            question->name, question->type, question->count, CAT_LOG_STRERRNO_C(question->error == 0, question->error));
+        pending--;
+    }
+    cat_socket_close(&socket);
+    return;
+
+    _error:
+    error = cat_get_last_error_code();
+    cat_socket_close(&socket);
+    _failed:
+    for (i = 0; i < question_count; i++) {
+        if (!cat_dns_question_is_done(&questions[i])) {
+            questions[i].error = error;
+        }
+    }
+}
+
+/* try the questions on all nameservers until they are done or run out of attempts */
+static void cat_dns_resolver_resolve(cat_dns_resolver_t *resolver, cat_dns_question_t *questions, size_t question_count, cat_timeout_t timeout)
+{
+    const cat_dns_resolver_options_t *options = &resolver->options;
+    cat_sockaddr_inet_info_t nameservers[CAT_DNS_MAX_NAMESERVERS];
+    unsigned int nameserver_count, attempts, attempt, start, n;
+    cat_timeout_t exchange_timeout;
+    size_t i;
+
+    /* copy them because options may be changed while we are waiting */
+    nameserver_count = options->nameserver_count;
+    if (nameserver_count > 0) {
+        memcpy(nameservers, options->nameservers, sizeof(nameservers[0]) * nameserver_count);
+    } else {
+        /* use the local nameserver as libc does */
+        nameservers[0].length = sizeof(nameservers[0].address.in);
+        (void) uv_ip4_addr("127.0.0.1", CAT_DNS_PORT, &nameservers[0].address.in);
+        nameserver_count = 1;
+    }
+    attempts = options->attempts > 0 ? options->attempts : 1;
+    start = options->rotate ? (resolver->next_nameserver++ % nameserver_count) : 0;
+
+    for (i = 0; i < question_count; i++) {
+        questions[i].error = CAT_ETIMEDOUT;
+        questions[i].count = 0;
+    }
+    for (attempt = 0; attempt < attempts; attempt++) {
+        for (n = 0; n < nameserver_count; n++) {
+            cat_bool_t done = cat_true;
+            exchange_timeout = options->timeout;
+            if (timeout != CAT_TIMEOUT_FOREVER && (exchange_timeout < 0 || exchange_timeout > timeout)) {
+                exchange_timeout = timeout;
+            }
+            CAT_TIME_WAIT_START() {
+                cat_dns_resolver_exchange(&nameservers[(start + n) % nameserver_count], questions, question_count, exchange_timeout);
+            } CAT_TIME_WAIT_END(timeout);
+            for (i = 0; i < question_count; i++) {
+                if (questions[i].error == CAT_ECANCELED) {
+                    return;
+                }
+                if (!cat_dns_question_is_done(&questions[i])) {
+                    done = cat_false;
+                }
+            }
+            if (done || timeout == 0) {
+                return;
+            }
+        }
+    }
+}
+
+/* returns cat_false if there are no more candidates, buffer will be empty if candidate is unavailable */
+static cat_bool_t cat_dns_resolver_get_candidate(const cat_dns_resolver_options_t *options, const char *name, unsigned int index, char *buffer, size_t size)
+{
+    size_t name_length = strlen(name);
+    unsigned int search_count = options->search_count, dots = 0;
+    const char *domain = NULL, *p;
+
+    if (name_length > 0 && name[name_length - 1] == '.') {
+        search_count = 0; /* it is a FQDN */
+    }
+    if (index > search_count) {
+        return cat_false;
+    }
+    for (p = name; *p != '\0'; p++) {
+        dots += *p == '.';
+    }
+    if (dots >= options->ndots) {
+        /* try as-is first */
+        if (index > 0) {
+            domain = options->search[index - 1];
+        }
+    } else {
+        /* try as-is at last */
+        if (index < search_count) {
+            domain = options->search[index];
+        }
+    }
+    if (domain == NULL) {
+        if (name_length >= size) {
+            buffer[0] = '\0';
+        } else {
+            memcpy(buffer, name, name_length + 1);
+        }
+    } else {
+        int length = snprintf(buffer, size, "%s.%s", name, domain);
+        if (length < 0 || (size_t) length >= size) {
+            buffer[0] = '\0';
+        }
+    }
+
+    return cat_true;
+}
+
+/* hosts */
+
+static void cat_dns_resolver_free_hosts(cat_dns_resolver_t *resolver)
+{
+    size_t i;
+
+    for (i = 0; i < resolver->hosts_count; i++) {
+        cat_free(resolver->hosts[i].name);
+    }
+    if (resolver->hosts != NULL) {
+        cat_free(resolver->hosts);
+    }
+    resolver->hosts = NULL;
+    resolver->hosts_count = 0;
+}
+
+/* returns the number of matched records of the type */
+static size_t cat_dns_resolver_lookup_hosts(const cat_dns_resolver_t *resolver, const char *name, cat_dns_record_type_t type, cat_dns_record_t *records, size_t capacity)
+{
+    size_t name_length = strlen(name), count = 0, i;
+
+    if (name_length > 0 && name[name_length - 1] == '.') {
+        name_length--;
+    }
+    for (i = 0; i < resolver->hosts_count && count < capacity; i++) {
+        const cat_dns_hosts_entry_t *entry = &resolver->hosts[i];
+        if (entry->record.type != type) {
+            continue;
+        }
+        if (strlen(entry->name) != name_length || cat_strncasecmp(entry->name, name, name_length) != 0) {
+            continue;
+        }
+        records[count++] = entry->record;
+    }
+
+    return count;
+}
+
+/* config files */
+
+static size_t cat_dns_tokenize_line(const char **data, const char *end, cat_const_string_t *tokens, size_t max)
+{
+    const char *p = *data, *eol;
+    size_t count = 0;
+
+    eol = (const char *) memchr(p, '\n', end - p);
+    if (eol == NULL) {
+        eol = end;
+    }
+    *data = eol == end ? end : eol + 1;
+    while (p < eol && count < max) {
+        const char *start;
+        while (p < eol && cat_dns_is_space(*p)) {
+            p++;
+        }
+        if (p == eol || *p == '#' || *p == ';') {
+            break;
+        }
+        start = p;
+        while (p < eol && !cat_dns_is_space(*p)) {
+            p++;
+        }
+        cat_const_string_create(&tokens[count++], start, p - start);
+    }
+
+    return count;
+}
+
+static cat_always_inline cat_bool_t cat_dns_token_equals(const cat_const_string_t *token, const char *string, size_t length)
+{
+    return token->length == length && memcmp(token->data, string, length) == 0;
+}
+
+/* parse the number after prefix (e.g. "ndots:"), returns -1 if it is not a valid one */
+static int cat_dns_token_get_option(const cat_const_string_t *token, const char *prefix, size_t prefix_length, int max)
+{
+    size_t i;
+    int value = 0;
+
+    if (token->length <= prefix_length || memcmp(token->data, prefix, prefix_length) != 0) {
+        return -1;
+    }
+    for (i = prefix_length; i < token->length; i++) {
+        char c = token->data[i];
+        if (!(c >= '0' && c <= '9')) {
+            return -1;
+        }
+        value = value * 10 + (c - '0');
+        if (value > max) {
+            value = max;
+        }
+    }
+
+    return value;
+}
+
+static void cat_dns_resolver_options_add_search_domain(cat_dns_resolver_options_t *options, const cat_const_string_t *domain)
+{
+    size_t length = domain->length;
+
+    if (options->search_count >= CAT_DNS_MAX_SEARCH_DOMAINS) {
+        return;
+    }
+    if (length > 0 && domain->data[length - 1] == '.') {
+        length--;
+    }
+    if (length == 0 || length >= CAT_DNS_NAME_BUFFER_SIZE) {
+        return;
+    }
+    memcpy(options->search[options->search_count], domain->data, length);
+    options->search[options->search_count][length] = '\0';
+    options->search_count++;
+}
+
+/* Notice: resolv.conf and hosts are tiny local files, so we just read them synchronously */
+static char *cat_dns_read_file(const char *path, size_t *length)
+{
+    FILE *file;
+    char *data = NULL, *new_data;
+    size_t size = 0, n;
+
+    file = fopen(path, "rb");
+    if (unlikely(file == NULL)) {
+        cat_update_last_error_of_syscall("Open file \"%s\" failed", path);
+        return NULL;
+    }
+    *length = 0;
+    while (1) {
+        if (*length == size) {
+            size = size == 0 ? 4096 : size * 2;
+            new_data = (char *) cat_realloc(data, size);
+#if CAT_ALLOC_HANDLE_ERRORS
+            if (unlikely(new_data == NULL)) {
+                cat_update_last_error_of_syscall("Realloc for file content failed");
+                goto _error;
+            }
+#endif
+            data = new_data;
+        }
+        n = fread(data + *length, 1, size - *length, file);
+        if (n == 0) {
+            break;
+        }
+        *length += n;
+    }
+    if (unlikely(ferror(file))) {
+        cat_update_last_error_of_syscall("Read file \"%s\" failed", path);
+        goto _error;
+    }
+    fclose(file);
+
+    return data;
+
+    _error:
+    if (data != NULL) {
+        cat_free(data);
+    }
+    fclose(file);
+    return NULL;
+}
+
+CAT_API void cat_dns_resolver_options_init(cat_dns_resolver_options_t *options)
+{
+    options->nameserver_count = 0;
+    options->search_count = 0;
+    options->ndots = CAT_DNS_DEFAULT_NDOTS;
+    options->timeout = CAT_DNS_DEFAULT_TIMEOUT;
+    options->attempts = CAT_DNS_DEFAULT_ATTEMPTS;
+    options->rotate = cat_false;
+}
+
+CAT_API void cat_dns_resolver_options_parse(cat_dns_resolver_options_t *options, const char *data, size_t length)
+{
+    const char *end = data + length;
+    cat_const_string_t tokens[CAT_DNS_MAX_LINE_TOKENS];
+    size_t token_count, i;
+
+    while (data < end) {
+        token_count = cat_dns_tokenize_line(&data, end, tokens, CAT_ARRAY_SIZE(tokens));
+        if (token_count < 2) {
+            continue;
+        }
+        if (cat_dns_token_equals(&tokens[0], CAT_STRL("nameserver"))) {
+            if (options->nameserver_count < CAT_DNS_MAX_NAMESERVERS) {
+                CAT_PROTECT_LAST_ERROR_START() {
+                    if (!cat_dns_resolver_options_add_nameserver(options, tokens[1].data, tokens[1].length, CAT_DNS_PORT)) {
+                        CAT_LOG_DEBUG(DNS, "Ignore invalid nameserver \"%.*s\"", (int) tokens[1].length, tokens[1].data);
+                    }
+                } CAT_PROTECT_LAST_ERROR_END();
+            }
+        } else if (cat_dns_token_equals(&tokens[0], CAT_STRL("domain")) ||
+                   cat_dns_token_equals(&tokens[0], CAT_STRL("search"))) {
+            /* the last one wins */
+            options->search_count = 0;
+            for (i = 1; i < token_count; i++) {
+                cat_dns_resolver_options_add_search_domain(options, &tokens[i]);
+            }
+        } else if (cat_dns_token_equals(&tokens[0], CAT_STRL("options"))) {
+            for (i = 1; i < token_count; i++) {
+                int value;
+                /* limits are the same as glibc */
+                if ((value = cat_dns_token_get_option(&tokens[i], CAT_STRL("ndots:"), 15)) >= 0) {
+                    options->ndots = (unsigned int) value;
+                } else if ((value = cat_dns_token_get_option(&tokens[i], CAT_STRL("timeout:"), 30)) >= 0) {
+                    options->timeout = ((cat_timeout_t) value) * 1000;
+                } else if ((value = cat_dns_token_get_option(&tokens[i], CAT_STRL("attempts:"), 5)) >= 0) {
+                    options->attempts = (unsigned int) value;
+                } else if (cat_dns_token_equals(&tokens[i], CAT_STRL("rotate"))) {
+                    options->rotate = cat_true;
+                }
+            }
+        }
+    }
+}
+
+CAT_API cat_bool_t cat_dns_resolver_options_load(cat_dns_resolver_options_t *options, const char *path)
+{
+    size_t length;
+    char *data;
+
+    data = cat_dns_read_file(path, &length);
+    if (unlikely(data == NULL)) {
+        cat_update_last_error_with_previous("DNS resolver load options failed");
+        return cat_false;
+    }
+    cat_dns_resolver_options_parse(options, data, length);
+    cat_free(data);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_dns_resolver_options_add_nameserver(cat_dns_resolver_options_t *options, const char *ip, size_t ip_length, int port)
+{
+    cat_sockaddr_inet_info_t *nameserver;
+    char buffer[CAT_SOCKET_IPV6_BUFFER_SIZE + 16]; /* with zone index */
+
+    if (unlikely(options->nameserver_count >= CAT_DNS_MAX_NAMESERVERS)) {
+        cat_update_last_error(CAT_ENOSPC, "DNS nameservers are too many (max %d)", CAT_DNS_MAX_NAMESERVERS);
+        return cat_false;
+    }
+    if (unlikely(ip_length >= sizeof(buffer))) {
+        cat_update_last_error(CAT_EINVAL, "DNS nameserver address is too long");
+        return cat_false;
+    }
+    memcpy(buffer, ip, ip_length);
+    buffer[ip_length] = '\0';
+    nameserver = &options->nameservers[options->nameserver_count];
+    nameserver->address.common.sa_family = AF_UNSPEC;
+    nameserver->length = sizeof(nameserver->address);
+    if (unlikely(!cat_sockaddr_getbyname(&nameserver->address.common, &nameserver->length, buffer, ip_length, port))) {
+        cat_update_last_error_with_previous("DNS nameserver address is invalid");
+        return cat_false;
+    }
+    options->nameserver_count++;
+
+    return cat_true;
+}
+
+/* resolver */
+
+static void cat_dns_resolver_shutdown(cat_data_t *data)
+{
+    cat_dns_resolver_t *resolver = (cat_dns_resolver_t *) data;
+
+    cat_dns_resolver_free_hosts(resolver);
+    cat_free(resolver);
+    CAT_SOCKET_G(dns_resolver) = NULL;
+}
+
+static cat_bool_t cat_dns_resolver_load_hosts_file(cat_dns_resolver_t *resolver, const char *path)
+{
+    cat_const_string_t tokens[CAT_DNS_MAX_LINE_TOKENS];
+    cat_dns_hosts_entry_t *hosts = NULL, *new_hosts;
+    size_t hosts_count = 0, hosts_size = 0, length, token_count, i;
+    const char *data, *p, *end;
+    char ip[CAT_SOCKET_IPV6_BUFFER_SIZE];
+    cat_dns_record_t record;
+
+    data = cat_dns_read_file(path, &length);
+    if (unlikely(data == NULL)) {
+        cat_update_last_error_with_previous("DNS resolver load hosts failed");
+        return cat_false;
+    }
+    for (p = data, end = data + length; p < end;) {
+        token_count = cat_dns_tokenize_line(&p, end, tokens, CAT_ARRAY_SIZE(tokens));
+        if (token_count < 2 || tokens[0].length >= sizeof(ip)) {
+            continue;
+        }
+        memcpy(ip, tokens[0].data, tokens[0].length);
+        ip[tokens[0].length] = '\0';
+        memset(&record, 0, sizeof(record));
+        if (uv_inet_pton(AF_INET, ip, &record.data.a) == 0) {
+            record.type = CAT_DNS_RECORD_TYPE_A;
+        } else if (uv_inet_pton(AF_INET6, ip, &record.data.aaaa) == 0) {
+            record.type = CAT_DNS_RECORD_TYPE_AAAA;
+        } else {
+            continue;
+        }
+        for (i = 1; i < token_count; i++) {
+            char *name;
+            if (hosts_count == hosts_size) {
+                hosts_size = hosts_size == 0 ? 16 : hosts_size * 2;
+                new_hosts = (cat_dns_hosts_entry_t *) cat_realloc(hosts, sizeof(*hosts) * hosts_size);
+#if CAT_ALLOC_HANDLE_ERRORS
+                if (unlikely(new_hosts == NULL)) {
+                    cat_update_last_error_of_syscall("Realloc for DNS hosts failed");
+                    goto _error;
+                }
+#endif
+                hosts = new_hosts;
+            }
+            name = cat_strndup(tokens[i].data, tokens[i].length);
+#if CAT_ALLOC_HANDLE_ERRORS
+            if (unlikely(name == NULL)) {
+                cat_update_last_error_of_syscall("Dup for DNS hosts name failed");
+                goto _error;
+            }
+#endif
+            hosts[hosts_count].name = name;
+            hosts[hosts_count].record = record;
+            hosts_count++;
+        }
+    }
+    cat_free((void *) data);
+    cat_dns_resolver_free_hosts(resolver);
+    resolver->hosts = hosts;
+    resolver->hosts_count = hosts_count;
+
+    return cat_true;
+
+#if CAT_ALLOC_HANDLE_ERRORS
+    _error:
+    for (i = 0; i < hosts_count; i++) {
+        cat_free(hosts[i].name);
+    }
+    if (hosts != NULL) {
+        cat_free(hosts);
+    }
+    cat_free((void *) data);
+    return cat_false;
+#endif
+}
+
+static cat_dns_resolver_t *cat_dns_resolver_get(void)
+{
+    cat_dns_resolver_t *resolver = CAT_SOCKET_G(dns_resolver);
+
+    if (likely(resolver != NULL)) {
+        return resolver;
+    }
+    resolver = (cat_dns_resolver_t *) cat_malloc(sizeof(*resolver));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(resolver == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for DNS resolver failed");
+        return NULL;
+    }
+#endif
+    if (unlikely(cat_event_register_runtime_shutdown_task(cat_dns_resolver_shutdown, resolver) == NULL)) {
+        cat_update_last_error_with_previous("DNS resolver register shutdown task failed");
+        cat_free(resolver);
+        return NULL;
+    }
+    cat_dns_resolver_options_init(&resolver->options);
+    resolver->hosts = NULL;
+    resolver->hosts_count = 0;
+    resolver->next_nameserver = 0;
+    /* it is fine that system files do not exist */
+    CAT_PROTECT_LAST_ERROR_START() {
+#ifdef CAT_DNS_RESOLV_CONF_PATH
+        (void) cat_dns_resolver_options_load(&resolver->options, CAT_DNS_RESOLV_CONF_PATH);
+#endif
+        (void) cat_dns_resolver_load_hosts_file(resolver, CAT_DNS_HOSTS_PATH);
+    } CAT_PROTECT_LAST_ERROR_END();
+    CAT_SOCKET_G(dns_resolver) = resolver;
+
+    return resolver;
+}
+
+CAT_API cat_bool_t cat_dns_resolver_configure(const cat_dns_resolver_options_t *options)
+{
+    cat_dns_resolver_t *resolver;
+    cat_dns_resolver_options_t new_options;
+
+    if (options != NULL) {
+        if (unlikely(options->nameserver_count > CAT_DNS_MAX_NAMESERVERS || options->search_count > CAT_DNS_MAX_SEARCH_DOMAINS)) {
+            cat_update_last_error(CAT_EINVAL, "DNS resolver options are invalid");
+            return cat_false;
+        }
+        new_options = *options;
+    } else {
+        cat_dns_resolver_options_init(&new_options);
+#ifdef CAT_DNS_RESOLV_CONF_PATH
+        if (unlikely(!cat_dns_resolver_options_load(&new_options, CAT_DNS_RESOLV_CONF_PATH))) {
+            cat_update_last_error_with_previous("DNS resolver configure failed");
+            return cat_false;
+        }
+#endif
+    }
+    resolver = cat_dns_resolver_get();
+    if (unlikely(resolver == NULL)) {
+        cat_update_last_error_with_previous("DNS resolver configure failed");
+        return cat_false;
+    }
+    resolver->options = new_options;
+    resolver->next_nameserver = 0;
+
+    return cat_true;
+}
+
+CAT_API const cat_dns_resolver_options_t *cat_dns_resolver_get_options(void)
+{
+    cat_dns_resolver_t *resolver = cat_dns_resolver_get();
+
+    if (unlikely(resolver == NULL)) {
+        return NULL;
+    }
+
+    return &resolver->options;
+}
+
+CAT_API cat_bool_t cat_dns_resolver_load_hosts(const char *path)
+{
+    cat_dns_resolver_t *resolver = cat_dns_resolver_get();
+
+    if (unlikely(resolver == NULL)) {
+        cat_update_last_error_with_previous("DNS resolver load hosts failed");
+        return cat_false;
+    }
+
+    return cat_dns_resolver_load_hosts_file(resolver, path != NULL ? path : CAT_DNS_HOSTS_PATH);
+}
+
+CAT_API cat_bool_t cat_dns_enable_stub_resolver(cat_bool_t enable)
+{
+    cat_bool_t previous = CAT_SOCKET_G(dns_use_stub_resolver);
+
+    CAT_SOCKET_G(dns_use_stub_resolver) = enable;
+
+    return previous;
+}
+
+CAT_API cat_bool_t cat_dns_is_stub_resolver_enabled(void)
+{
+    return CAT_SOCKET_G(dns_use_stub_resolver);
+}
+
+CAT_API cat_bool_t cat_dns_query(const char *name, cat_dns_record_type_t type, cat_dns_record_t *records, size_t *count)
+{
+    return cat_dns_query_ex(name, type, records, count, cat_socket_get_global_dns_timeout());
+}
+
+CAT_API cat_bool_t cat_dns_query_ex(const char *name, cat_dns_record_type_t type, cat_dns_record_t *records, size_t *count, cat_timeout_t timeout)
+{
+    cat_dns_resolver_t *resolver;
+    cat_dns_question_t question;
+    char candidate[CAT_DNS_NAME_BUFFER_SIZE];
+    cat_errno_t error = CAT_EAI_NONAME;
+    unsigned int index;
+
+    if (unlikely(name == NULL || records == NULL || count == NULL || *count == 0)) {
+        cat_update_last_error(CAT_EINVAL, "DNS query arguments are invalid");
+        return cat_false;
+    }
+    switch (type) {
+#define CAT_DNS_RECORD_TYPE_CASE(name, unused) case CAT_DNS_RECORD_TYPE_##name:
+        CAT_DNS_RECORD_TYPE_MAP(CAT_DNS_RECORD_TYPE_CASE)
+#undef CAT_DNS_RECORD_TYPE_CASE
+            break;
+        default:
+            cat_update_last_error(CAT_EINVAL, "DNS record type %d is unsupported", (int) type);
+            return cat_false;
+    }
+    resolver = cat_dns_resolver_get();
+    if (unlikely(resolver == NULL)) {
+        cat_update_last_error_with_previous("DNS query failed");
+        return cat_false;
+    }
+    if (type == CAT_DNS_RECORD_TYPE_A || type == CAT_DNS_RECORD_TYPE_AAAA) {
+        /* hosts takes precedence over nameservers as getaddrinfo() does */
+        size_t n = cat_dns_resolver_lookup_hosts(resolver, name, type, records, *count);
+        if (n > 0) {
+            *count = n;
+            return cat_true;
+        }
+    }
+    for (index = 0; cat_dns_resolver_get_candidate(&resolver->options, name, index, CAT_STRS(candidate)); index++) {
+        if (candidate[0] == '\0') {
+            continue;
+        }
+        question.name = candidate;
+        question.type = type;
+        question.records = records;
+        question.capacity = *count;
+        CAT_TIME_WAIT_START() {
+            cat_dns_resolver_resolve(resolver, &question, 1, timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        error = question.error;
+        if (error == 0) {
+            *count = question.count;
+            return cat_true;
+        }
+        if (error != CAT_EAI_NONAME && error != CAT_EAI_NODATA) {
+            break;
+        }
+    }
+    *count = 0;
+    cat_update_last_error_with_reason(error, "DNS query \"%s\" failed", name);
+
+    return cat_false;
+}
+
+/* getaddrinfo */
+
+static struct addrinfo *cat_dns_addrinfo_create(int af, const void *address, int port, const struct addrinfo *hints)
+{
+    cat_dns_stub_addrinfo_t *stub;
+    struct addrinfo *ai;
+    cat_sockaddr_inet_union_t *sa;
+
+    stub = (cat_dns_stub_addrinfo_t *) cat_malloc(sizeof(*stub) + sizeof(*sa));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(stub == NULL)) {
+        return NULL;
+    }
+#endif
+    memset(stub, 0, sizeof(*stub) + sizeof(*sa));
+    ai = &stub->ai;
+    sa = (cat_sockaddr_inet_union_t *) (stub + 1);
+    if (af == AF_INET) {
+        sa->in.sin_family = AF_INET;
+        sa->in.sin_port = htons((uint16_t) port);
+        memcpy(&sa->in.sin_addr, address, sizeof(sa->in.sin_addr));
+        ai->ai_addrlen = sizeof(sa->in);
+    } else {
+        sa->in6.sin6_family = AF_INET6;
+        sa->in6.sin6_port = htons((uint16_t) port);
+        memcpy(&sa->in6.sin6_addr, address, sizeof(sa->in6.sin6_addr));
+        ai->ai_addrlen = sizeof(sa->in6);
+    }
+    ai->ai_flags = hints != NULL ? hints->ai_flags : 0;
+    ai->ai_family = af;
+    ai->ai_socktype = hints != NULL ? hints->ai_socktype : 0;
+    ai->ai_protocol = hints != NULL ? hints->ai_protocol : 0;
+    ai->ai_addr = &sa->common;
+
+    return ai;
+}
+
+/* interleave address families and make IPv6 first (Happy Eyeballs, RFC 8305 section 4) */
+static struct addrinfo *cat_dns_addrinfo_build(
+    const cat_dns_record_t *records_v6, size_t count_v6,
+    const cat_dns_record_t *records_v4, size_t count_v4,
+    int port, const struct addrinfo *hints
+)
+{
+    struct addrinfo *head = NULL, **next = &head, *ai;
+    size_t i_v6 = 0, i_v4 = 0;
+
+    while (i_v6 < count_v6 || i_v4 < count_v4) {
+        if (i_v6 < count_v6 && (i_v4 >= count_v4 || i_v6 <= i_v4)) {
+            ai = cat_dns_addrinfo_create(AF_INET6, &records_v6[i_v6++].data.aaaa, port, hints);
+        } else {
+            ai = cat_dns_addrinfo_create(AF_INET, &records_v4[i_v4++].data.a, port, hints);
+        }
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(ai == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for DNS addrinfo failed");
+            cat_dns_freeaddrinfo(head);
+            return NULL;
+        }
+#endif
+        if (head == NULL) {
+            cat_queue_push_back(&CAT_SOCKET_G(dns_stub_addrinfos), &cat_container_of(ai, cat_dns_stub_addrinfo_t, ai)->node);
+        }
+        *next = ai;
+        next = &ai->ai_next;
+    }
+
+    return head;
+}
+
+static struct addrinfo *cat_dns_stub_getaddrinfo(const char *hostname, int port, const struct addrinfo *hints, cat_timeout_t timeout)
+{
+    cat_dns_resolver_t *resolver;
+    cat_dns_question_t questions[2];
+    cat_dns_record_t *records, *records_v6, *records_v4;
+    size_t question_count, count_v6 = 0, count_v4 = 0, i;
+    char candidate[CAT_DNS_NAME_BUFFER_SIZE];
+    int af = hints != NULL ? hints->ai_family : AF_UNSPEC;
+    cat_errno_t error = CAT_EAI_NONAME;
+    struct addrinfo *response;
+    unsigned int index;
+
+    records = (cat_dns_record_t *) cat_malloc(sizeof(*records) * CAT_DNS_MAX_ADDRESSES * 2);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(records == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for DNS records failed");
+        return NULL;
+    }
+#endif
+    records_v6 = records;
+    records_v4 = records + CAT_DNS_MAX_ADDRESSES;
+
+    /* numeric host */
+    if (af != AF_INET6 && uv_inet_pton(AF_INET, hostname, &records_v4[0].data.a) == 0) {
+        count_v4 = 1;
+        goto _build;
+    }
+    if (af != AF_INET && uv_inet_pton(AF_INET6, hostname, &records_v6[0].data.aaaa) == 0) {
+        count_v6 = 1;
+        goto _build;
+    }
+
+    resolver = cat_dns_resolver_get();
+    if (unlikely(resolver == NULL)) {
+        cat_update_last_error_with_previous("DNS getaddrinfo failed");
+        goto _error;
+    }
+
+    if (af != AF_INET) {
+        count_v6 = cat_dns_resolver_lookup_hosts(resolver, hostname, CAT_DNS_RECORD_TYPE_AAAA, records_v6, CAT_DNS_MAX_ADDRESSES);
+    }
+    if (af != AF_INET6) {
+        count_v4 = cat_dns_resolver_lookup_hosts(resolver, hostname, CAT_DNS_RECORD_TYPE_A, records_v4, CAT_DNS_MAX_ADDRESSES);
+    }
+    if (count_v6 + count_v4 > 0) {
+        goto _build;
+    }
+
+    for (index = 0; cat_dns_resolver_get_candidate(&resolver->options, hostname, index, CAT_STRS(candidate)); index++) {
+        if (candidate[0] == '\0') {
+            continue;
+        }
+        question_count = 0;
+        if (af != AF_INET) {
+            questions[question_count].name = candidate;
+            questions[question_count].type = CAT_DNS_RECORD_TYPE_AAAA;
+            questions[question_count].records = records_v6;
+            questions[question_count].capacity = CAT_DNS_MAX_ADDRESSES;
+            question_count++;
+        }
+        if (af != AF_INET6) {
+            questions[question_count].name = candidate;
+            questions[question_count].type = CAT_DNS_RECORD_TYPE_A;
+            questions[question_count].records = records_v4;
+            questions[question_count].capacity = CAT_DNS_MAX_ADDRESSES;
+            question_count++;
+        }
+        CAT_TIME_WAIT_START() {
+            cat_dns_resolver_resolve(resolver, questions, question_count, timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        error = CAT_EAI_NONAME;
+        for (i = 0; i < question_count; i++) {
+            if (questions[i].error == 0) {
+                *(questions[i].type == CAT_DNS_RECORD_TYPE_AAAA ? &count_v6 : &count_v4) = questions[i].count;
+            } else if (questions[i].error != CAT_EAI_NONAME && questions[i].error != CAT_EAI_NODATA) {
+                error = questions[i].error;
+            }
+        }
+        if (count_v6 + count_v4 > 0) {
+            goto _build;
+        }
+        if (error != CAT_EAI_NONAME) {
+            break;
+        }
+    }
+    cat_update_last_error_with_reason(error, "DNS getaddrinfo failed");
+    goto _error;
+
+    _build:
+    response = cat_dns_addrinfo_build(records_v6, count_v6, records_v4, count_v4, port, hints);
+    cat_free(records);
+    return response;
+
+    _error:
+    cat_free(records);
+    return NULL;
+}
@@ -17,6 +17,7 @@
  */
 
 #include "cat_event.h"
+#include "cat_time.h"
 
 #ifdef CAT_IDE_HELPER
 #include "uv-common.h"
@@ -31,12 +32,10 @@ struct cat_event_shutdown_task_s {
 };
 
 struct cat_event_loop_defer_task_s {
-    union {
-        cat_data_t *data;
-        uv_timer_t timer;
-        uv_handle_t handle;
-    } u;
+    cat_queue_node_t node;
+    cat_event_round_t round;
     cat_event_loop_defer_callback_t callback;
+    cat_data_t *data;
 };
 
 struct cat_event_io_defer_task_s {
@@ -47,7 +46,10 @@ struct cat_event_io_defer_task_s {
 
 CAT_API CAT_GLOBALS_DECLARE(cat_event);
 
-static void cat_event_do_io_defer_tasks(uv_check_t *check);
+static void cat_event_loop_defer_idle_callback(uv_idle_t *idle);
+static void cat_event_do_defer_tasks(uv_check_t *check);
+static void cat_event_ready_wakeup(void);
+static cat_nsec_t cat_event_get_ready_time(void);
 
 CAT_API cat_bool_t cat_event_module_init(void)
 {
@@ -75,14 +77,37 @@ CAT_API cat_bool_t cat_event_runtime_init(void)
     }
 
     cat_queue_init(&CAT_EVENT_G(runtime_shutdown_tasks));
+    cat_queue_init(&CAT_EVENT_G(loop_defer_tasks));
+    do {
+        uv_idle_t *idle = &CAT_EVENT_G(loop_defer_idle);
+        (void) uv_idle_init(&CAT_EVENT_G(loop), idle);
+        /* it is only started when there are pending tasks */
+        idle->flags |= UV_HANDLE_INTERNAL;
+    } while (0);
     cat_queue_init(&CAT_EVENT_G(io_defer_tasks));
     do {
-        uv_check_t *check = &CAT_EVENT_G(io_defer_check);
+        uv_check_t *check = &CAT_EVENT_G(defer_check);
         (void) uv_check_init(&CAT_EVENT_G(loop), check);
-        (void) uv_check_start(check, cat_event_do_io_defer_tasks);
+        (void) uv_check_start(check, cat_event_do_defer_tasks);
         uv_unref((uv_handle_t *) check);
         check->flags |= UV_HANDLE_INTERNAL;
     } while (0);
+    do {
+        uv_idle_t *idle = &CAT_EVENT_G(ready_idle);
+        (void) uv_idle_init(&CAT_EVENT_G(loop), idle);
+        /* it is only started when there are queued coroutines */
+        idle->flags |= UV_HANDLE_INTERNAL;
+    } while (0);
+    (void) cat_coroutine_set_ready_wakeup_function(cat_event_ready_wakeup);
+    do {
+        uv_prepare_t *prepare = &CAT_EVENT_G(poll_prepare);
+        (void) uv_prepare_init(&CAT_EVENT_G(loop), prepare);
+        uv_unref((uv_handle_t *) prepare);
+        prepare->flags |= UV_HANDLE_INTERNAL;
+        CAT_EVENT_G(poll_time) = 0;
+        CAT_EVENT_G(poll_idle_time) = 0;
+    } while (0);
+    (void) cat_coroutine_set_ready_time_function(cat_event_get_ready_time);
 
     return cat_true;
 }
@@ -103,9 +128,15 @@ CAT_API cat_bool_t cat_event_runtime_shutdown(void)
     /* we must call run to close all handles and clear defer tasks */
     cat_event_schedule();
 
-    uv_close((uv_handle_t *) &CAT_EVENT_G(io_defer_check), NULL);
+    uv_close((uv_handle_t *) &CAT_EVENT_G(loop_defer_idle), NULL);
+    uv_close((uv_handle_t *) &CAT_EVENT_G(defer_check), NULL);
+    uv_close((uv_handle_t *) &CAT_EVENT_G(ready_idle), NULL);
+    (void) cat_coroutine_set_ready_wakeup_function(NULL);
+    uv_close((uv_handle_t *) &CAT_EVENT_G(poll_prepare), NULL);
+    (void) cat_coroutine_set_ready_time_function(NULL);
 
     CAT_ASSERT(cat_queue_empty(&CAT_EVENT_G(runtime_shutdown_tasks)));
+    CAT_ASSERT(cat_queue_empty(&CAT_EVENT_G(loop_defer_tasks)));
     CAT_ASSERT(cat_queue_empty(&CAT_EVENT_G(io_defer_tasks)));
 
     return cat_true;
@@ -176,46 +207,94 @@ CAT_API void cat_event_unregister_runtime_shutdown_task(cat_event_shutdown_task_
     cat_free(task);
 }
 
-static void cat_event_loop_defer_task_callback(uv_timer_t *timer)
+/* loop defer tasks are executed by the defer check handle after io defer tasks,
+ * pending tasks keep the idle handle active, which keeps the loop alive and
+ * makes the poll phase non-blocking, it is marked as internal only when there
+ * is nothing to do, so that closing the loop fails with EBUSY while tasks are pending */
+
+static void cat_event_loop_defer_idle_callback(uv_idle_t *idle)
+{
+    (void) idle;
+}
+
+static void cat_event_loop_defer_idle_start(void)
 {
-    cat_event_loop_defer_task_t *task = cat_container_of(timer, cat_event_loop_defer_task_t, u.timer);
-    cat_data_t *data = task->u.data;
-    task->u.data = NULL; // make others know it's running
-    task->callback(task, data);
+    uv_idle_t *idle = &CAT_EVENT_G(loop_defer_idle);
+
+    idle->flags &= ~UV_HANDLE_INTERNAL;
+    (void) uv_idle_start(idle, cat_event_loop_defer_idle_callback);
 }
 
-static void cat_event_loop_defer_task_free_callback(uv_handle_t *handle)
+static void cat_event_loop_defer_idle_stop(void)
 {
-    cat_event_loop_defer_task_t *task = cat_container_of(handle, cat_event_loop_defer_task_t, u.handle);
-    cat_free(task);
+    uv_idle_t *idle = &CAT_EVENT_G(loop_defer_idle);
+
+    (void) uv_idle_stop(idle);
+    idle->flags |= UV_HANDLE_INTERNAL;
+}
+
+static void cat_event_do_loop_defer_tasks(void)
+{
+    cat_queue_t *tasks = &CAT_EVENT_G(loop_defer_tasks);
+    cat_event_round_t round = CAT_EVENT_G(loop).round;
+    cat_event_loop_defer_task_t *task;
+
+    /* execute tasks of previous rounds,
+     * tasks created in callbacks will be executed in the next round */
+    while ((task = cat_queue_front_data(tasks, cat_event_loop_defer_task_t, node)) != NULL) {
+        if (task->round == round) {
+            break;
+        }
+        cat_queue_remove(&task->node);
+        cat_queue_init(&task->node); // make others know it's running
+        task->callback(task, task->data);
+        /* note: do not access the task anymore,
+         * it may be free'd in callback. */
+    }
+    if (cat_queue_empty(tasks)) {
+        cat_event_loop_defer_idle_stop();
+    }
 }
 
 CAT_API cat_event_loop_defer_task_t *cat_event_loop_defer_task_create(
     cat_event_loop_defer_callback_t callback,
     cat_data_t *data
 ) {
+    cat_queue_t *tasks = &CAT_EVENT_G(loop_defer_tasks);
     cat_event_loop_defer_task_t *task;
+
     task = (cat_event_loop_defer_task_t *) cat_malloc_unrecoverable(sizeof(*task));
+    task->round = CAT_EVENT_G(loop).round;
     task->callback = callback;
-    task->u.data = data;
-    (void) uv_timer_init(&CAT_EVENT_G(loop), &task->u.timer);
-    (void) uv_timer_start(&task->u.timer, cat_event_loop_defer_task_callback, 0, 0);
+    task->data = data;
+    if (cat_queue_empty(tasks)) {
+        cat_event_loop_defer_idle_start();
+    }
+    cat_queue_push_back(tasks, &task->node);
+
     return task;
 }
 
 CAT_API cat_bool_t cat_event_loop_defer_task_close(cat_event_loop_defer_task_t *task)
 {
-    cat_bool_t called = task->u.data == NULL;
-    uv_close(&task->u.handle, cat_event_loop_defer_task_free_callback);
+    cat_bool_t called = cat_queue_empty(&task->node);
+
+    if (!called) {
+        cat_queue_remove(&task->node);
+        if (cat_queue_empty(&CAT_EVENT_G(loop_defer_tasks))) {
+            cat_event_loop_defer_idle_stop();
+        }
+    }
+    cat_free(task);
+
     return called;
 }
 
-static void cat_event_do_io_defer_tasks(uv_check_t *check)
+static void cat_event_do_io_defer_tasks(void)
 {
     cat_queue_t *tasks = &CAT_EVENT_G(io_defer_tasks);
     cat_event_io_defer_task_t *task;
 
-    (void) check;
     /* execute tasks of current round */
     while ((task = cat_queue_front_data(tasks, cat_event_io_defer_task_t, node)) != NULL) {
         cat_queue_remove(&task->node);
@@ -225,6 +304,44 @@ static void cat_event_do_io_defer_tasks(uv_check_t *check)
     }
 }
 
+/* coroutines in the ready queue are resumed after all io events (and io defer tasks) in the current round,
+ * the idle handle keeps the loop alive and makes the poll phase non-blocking until they are resumed */
+
+static void cat_event_ready_idle_callback(uv_idle_t *idle)
+{
+    (void) idle;
+}
+
+static void cat_event_ready_wakeup(void)
+{
+    uv_idle_t *idle = &CAT_EVENT_G(ready_idle);
+
+    idle->flags &= ~UV_HANDLE_INTERNAL;
+    (void) uv_idle_start(idle, cat_event_ready_idle_callback);
+}
+
+static void cat_event_run_ready_queue(void)
+{
+    uv_idle_t *idle = &CAT_EVENT_G(ready_idle);
+
+    if (!uv_is_active((uv_handle_t *) idle)) {
+        return;
+    }
+    (void) cat_coroutine_run_ready_queue();
+    if (cat_coroutine_get_ready_count() == 0) {
+        (void) uv_idle_stop(idle);
+        idle->flags |= UV_HANDLE_INTERNAL;
+    }
+}
+
+static void cat_event_do_defer_tasks(uv_check_t *check)
+{
+    (void) check;
+    cat_event_do_io_defer_tasks();
+    cat_event_run_ready_queue();
+    cat_event_do_loop_defer_tasks();
+}
+
 CAT_API cat_event_io_defer_task_t *cat_event_io_defer_task_create(
     cat_event_io_defer_callback_t callback,
     cat_data_t *data
@@ -247,6 +364,33 @@ CAT_API cat_bool_t cat_event_io_defer_task_close(cat_event_io_defer_task_t *task
     return called;
 }
 
+/* the poll phase is the only place where the loop blocks,
+ * coroutines woken up in this round have been runnable since the poll returned,
+ * we compute it by the time before polling plus the idle time in polling */
+
+static void cat_event_poll_prepare_callback(uv_prepare_t *prepare)
+{
+    CAT_EVENT_G(poll_time) = cat_time_nsec();
+    CAT_EVENT_G(poll_idle_time) = uv_metrics_idle_time(prepare->loop);
+}
+
+static cat_nsec_t cat_event_get_ready_time(void)
+{
+    uv_prepare_t *prepare = &CAT_EVENT_G(poll_prepare);
+
+    /* start tracking lazily, it is only called if coroutine accounting is enabled */
+    if (unlikely(!uv_is_active((uv_handle_t *) prepare))) {
+        (void) uv_loop_configure(&CAT_EVENT_G(loop), UV_METRICS_IDLE_TIME);
+        (void) uv_prepare_start(prepare, cat_event_poll_prepare_callback);
+        return 0;
+    }
+    if (unlikely(CAT_EVENT_G(poll_time) == 0)) {
+        return 0;
+    }
+
+    return CAT_EVENT_G(poll_time) + (uv_metrics_idle_time(&CAT_EVENT_G(loop)) - CAT_EVENT_G(poll_idle_time));
+}
+
 CAT_API void cat_event_fork(void)
 {
 #ifndef CAT_COROUTINE_USE_THREAD_CONTEXT
@@ -23,6 +23,8 @@
 #include "cat_time.h"
 #include "cat_work.h"
 #include "cat_async.h"
+#include "cat_io_uring.h"
+#include "cat_atomic.h"
 
 #ifdef CAT_ENABLE_DEBUG_LOG
 #include "cat_buffer.h" // for buffer_export_str()
@@ -156,6 +158,124 @@ static void cat_fs_callback(uv_fs_t *fs)
     cat_free(context);
 }
 
+#ifdef CAT_IO_URING
+#include <sys/sysmacros.h>
+
+/* returns NONE if caller should fallback to the thread-pool */
+static cat_ret_t cat_fs_io_uring_do_result(const struct io_uring_sqe *sqe, int32_t *result, void *data, const char *operation)
+{
+    cat_ret_t ret;
+
+    ret = cat_io_uring_execute_ex(sqe, result, data, CAT_TIMEOUT_FOREVER);
+    if (unlikely(ret == CAT_RET_ERROR)) {
+        cat_update_last_error_with_previous("File-System %s failed", operation);
+        errno = cat_orig_errno(cat_get_last_error_code());
+    } else if (ret == CAT_RET_OK && unlikely(*result < 0)) {
+        cat_update_last_error_with_reason(cat_translate_sys_error(-*result), "File-System %s failed", operation);
+        errno = -*result;
+        ret = CAT_RET_ERROR;
+    }
+
+    return ret;
+}
+
+/* prepare SQE in the trailing arguments, then {on_fail} or {on_done} would be executed,
+ * or go on with the thread-pool way if io_uring is unavailable */
+#define CAT_FS_IO_URING_DO_RESULT_EX(on_fail, on_done, operation, data, ...) do { \
+    if (cat_io_uring_is_fs_enabled()) { \
+        struct io_uring_sqe sqe; \
+        /* it stays 0 if waiting failed */ \
+        int32_t result = 0; \
+        cat_ret_t ret; \
+        memset(&sqe, 0, sizeof(sqe)); \
+        {__VA_ARGS__} \
+        ret = cat_fs_io_uring_do_result(&sqe, &result, data, #operation); \
+        if (ret == CAT_RET_ERROR) { \
+            {on_fail} \
+        } else if (ret == CAT_RET_OK) { \
+            {on_done} \
+        } \
+    } \
+} while (0)
+
+#define CAT_FS_IO_URING_DO_RESULT(return_type, operation, ...) \
+        CAT_FS_IO_URING_DO_RESULT_EX({return -1;}, {return (return_type) result;}, operation, NULL, __VA_ARGS__)
+
+static cat_always_inline void cat_fs_io_uring_prep_rw(struct io_uring_sqe *sqe, uint8_t opcode, cat_file_t fd, const void *buffer, size_t length, int64_t offset)
+{
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buffer;
+    sqe->len = (uint32_t) length;
+    sqe->off = (uint64_t) offset;
+}
+
+static void cat_fs_io_uring_statx_to_stat(const struct statx *statxbuf, cat_stat_t *statbuf)
+{
+    statbuf->st_dev = makedev(statxbuf->stx_dev_major, statxbuf->stx_dev_minor);
+    statbuf->st_mode = statxbuf->stx_mode;
+    statbuf->st_nlink = statxbuf->stx_nlink;
+    statbuf->st_uid = statxbuf->stx_uid;
+    statbuf->st_gid = statxbuf->stx_gid;
+    statbuf->st_rdev = makedev(statxbuf->stx_rdev_major, statxbuf->stx_rdev_minor);
+    statbuf->st_ino = statxbuf->stx_ino;
+    statbuf->st_size = statxbuf->stx_size;
+    statbuf->st_blksize = statxbuf->stx_blksize;
+    statbuf->st_blocks = statxbuf->stx_blocks;
+    statbuf->st_atim.tv_sec = statxbuf->stx_atime.tv_sec;
+    statbuf->st_atim.tv_nsec = statxbuf->stx_atime.tv_nsec;
+    statbuf->st_mtim.tv_sec = statxbuf->stx_mtime.tv_sec;
+    statbuf->st_mtim.tv_nsec = statxbuf->stx_mtime.tv_nsec;
+    statbuf->st_ctim.tv_sec = statxbuf->stx_ctime.tv_sec;
+    statbuf->st_ctim.tv_nsec = statxbuf->stx_ctime.tv_nsec;
+    statbuf->st_birthtim.tv_sec = statxbuf->stx_btime.tv_sec;
+    statbuf->st_birthtim.tv_nsec = statxbuf->stx_btime.tv_nsec;
+    statbuf->st_flags = 0;
+    statbuf->st_gen = 0;
+}
+
+#if CAT_ALLOC_HANDLE_ERRORS
+#define _CAT_FS_IO_URING_STATX_ALLOC_CHECK(statxbuf) do { \
+    if (unlikely(statxbuf == NULL)) { \
+        cat_update_last_error_of_syscall("Malloc for file-system statx failed"); \
+        return -1; \
+    } \
+} while (0)
+#else
+#define _CAT_FS_IO_URING_STATX_ALLOC_CHECK(statxbuf)
+#endif
+
+/* statx buffer is allocated on heap because kernel may still write it after we were canceled */
+#define CAT_FS_IO_URING_DO_STAT(name, dirfd, _path, flags) do { \
+    if (cat_io_uring_is_fs_enabled() && cat_io_uring_is_supported(IORING_OP_STATX)) { \
+        struct statx *statxbuf = (struct statx *) cat_malloc(sizeof(*statxbuf)); \
+        _CAT_FS_IO_URING_STATX_ALLOC_CHECK(statxbuf); \
+        CAT_FS_IO_URING_DO_RESULT_EX({ \
+            /* kernel has done with it, otherwise it is owned by io_uring now */ \
+            if (result < 0) { \
+                cat_free(statxbuf); \
+            } \
+            return -1; \
+        }, { \
+            cat_fs_io_uring_statx_to_stat(statxbuf, statbuf); \
+            cat_free(statxbuf); \
+            return 0; \
+        }, name, statxbuf, { \
+            sqe.opcode = IORING_OP_STATX; \
+            sqe.fd = dirfd; \
+            sqe.addr = (uint64_t) (uintptr_t) (_path); \
+            sqe.len = STATX_BASIC_STATS | STATX_BTIME; \
+            sqe.off = (uint64_t) (uintptr_t) statxbuf; \
+            sqe.statx_flags = flags; \
+        }); \
+        cat_free(statxbuf); \
+    } \
+} while (0)
+#else
+#define CAT_FS_IO_URING_DO_RESULT(return_type, operation, ...)
+#define CAT_FS_IO_URING_DO_STAT(name, dirfd, _path, flags)
+#endif /* CAT_IO_URING */
+
 #ifdef CAT_OS_WIN
 # define wrappath(_path, path) \
 char path##buf[(32767/*hard limit*/ + 4/* \\?\ */ + 1/* \0 */)*sizeof(wchar_t)] = {'\\', '\\', '?', '\\'}; \
@@ -415,6 +535,13 @@ static cat_always_inline cat_file_t cat_fs_open_impl(const char *_path, cat_fs_o
 {
     wrappath(_path, path);
 
+    CAT_FS_IO_URING_DO_RESULT(cat_file_t, open, {
+        sqe.opcode = IORING_OP_OPENAT;
+        sqe.fd = AT_FDCWD;
+        sqe.addr = (uint64_t) (uintptr_t) path;
+        sqe.len = (uint32_t) mode;
+        sqe.open_flags = (uint32_t) (flags | O_CLOEXEC);
+    });
     CAT_FS_DO_RESULT(cat_file_t, open, path, flags, mode);
 }
 
@@ -450,14 +577,22 @@ CAT_API cat_file_t cat_fs_open(const char *path, cat_fs_open_flags_t flags, ...)
 
 static cat_always_inline int cat_fs_close_impl(cat_file_t fd)
 {
+    CAT_FS_IO_URING_DO_RESULT(int, close, {
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = fd;
+    });
     CAT_FS_DO_RESULT(int, close, fd);
 }
 
 CAT_API int cat_fs_close(cat_file_t fd)
 {
+    cat_msec_t deadline;
     int error;
     CAT_LOG_DEBUG(FS, "close(" CAT_FS_FILE_FMT ") = " CAT_LOG_UNFINISHED_STR, fd);
+    /* fd is released even if we gave up waiting, so the result must be waited for whatever the deadline is */
+    deadline = cat_time_set_deadline(0);
     error = cat_fs_close_impl(fd);
+    (void) cat_time_set_deadline(deadline);
     CAT_LOG_DEBUG(FS, "close(" CAT_FS_FILE_FMT ") = " CAT_LOG_INT_RET_FMT, fd, CAT_LOG_INT_RET_C(error));
     return error;
 }
@@ -490,7 +625,12 @@ static void cat_fs_read_cb(cat_data_t *ptr)
 
 static cat_always_inline ssize_t cat_fs_read_impl(cat_file_t fd, void *buf, size_t size)
 {
-    cat_fs_read_data_t *data = (cat_fs_read_data_t *) cat_malloc(sizeof(*data));
+    cat_fs_read_data_t *data;
+
+    CAT_FS_IO_URING_DO_RESULT(ssize_t, read, {
+        cat_fs_io_uring_prep_rw(&sqe, IORING_OP_READ, fd, buf, size, -1);
+    });
+    data = (cat_fs_read_data_t *) cat_malloc(sizeof(*data));
 #if CAT_ALLOC_HANDLE_ERRORS
     if (data == NULL) {
         cat_update_last_error_of_syscall("Malloc for fs read failed");
@@ -546,7 +686,12 @@ static void cat_fs_write_cb(cat_data_t *ptr)
 
 static cat_always_inline ssize_t cat_fs_write_impl(cat_file_t fd, const void *buf, size_t length)
 {
-    cat_fs_write_data_t *data = (cat_fs_write_data_t *) cat_malloc(sizeof(*data));
+    cat_fs_write_data_t *data;
+
+    CAT_FS_IO_URING_DO_RESULT(ssize_t, write, {
+        cat_fs_io_uring_prep_rw(&sqe, IORING_OP_WRITE, fd, buf, length, -1);
+    });
+    data = (cat_fs_write_data_t *) cat_malloc(sizeof(*data));
 #if CAT_ALLOC_HANDLE_ERRORS
     if (data == NULL) {
         cat_update_last_error_of_syscall("Malloc for fs write failed");
@@ -589,6 +734,9 @@ static cat_always_inline ssize_t cat_fs_pread_impl(cat_file_t fd, void *buffer,
 {
     uv_buf_t buf = uv_buf_init((char *) buffer, (unsigned int) size);
 
+    CAT_FS_IO_URING_DO_RESULT(ssize_t, pread, {
+        cat_fs_io_uring_prep_rw(&sqe, IORING_OP_READ, fd, buffer, size, offset);
+    });
     CAT_FS_DO_RESULT(ssize_t, read, fd, &buf, 1, offset);
 }
 
@@ -615,6 +763,9 @@ static cat_always_inline ssize_t cat_fs_pwrite_impl(cat_file_t fd, const void *b
 {
     uv_buf_t buf = uv_buf_init((char *) buffer, (unsigned int) length);
 
+    CAT_FS_IO_URING_DO_RESULT(ssize_t, pwrite, {
+        cat_fs_io_uring_prep_rw(&sqe, IORING_OP_WRITE, fd, buffer, length, offset);
+    });
     CAT_FS_DO_RESULT(ssize_t, write, fd, &buf, 1, offset);
 }
 
@@ -639,6 +790,180 @@ CAT_API ssize_t cat_fs_pwrite(cat_file_t fd, const void *buffer, size_t length,
     return n;
 }
 
+// vectored I/O
+
+#ifdef CAT_OS_LINUX
+#include <sys/uio.h>
+#endif
+
+#if defined(CAT_OS_LINUX) && defined(RWF_NOWAIT)
+#define CAT_FS_HAVE_RWV2 1
+#endif
+
+#ifdef CAT_FS_HAVE_RWV2
+typedef struct cat_fs_rwv_data_s {
+    cat_fs_work_ret_t ret;
+    int fd;
+    const struct iovec *iov;
+    int iovcnt;
+    off_t offset;
+    int flags;
+    cat_bool_t write;
+} cat_fs_rwv_data_t;
+
+static cat_always_inline ssize_t cat_fs_rwv2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags, cat_bool_t write)
+{
+    return write ? pwritev2(fd, iov, iovcnt, offset, flags) : preadv2(fd, iov, iovcnt, offset, flags);
+}
+
+static void cat_fs_rwv_cb(cat_data_t *ptr)
+{
+    cat_fs_rwv_data_t *data = (cat_fs_rwv_data_t *) ptr;
+    data->ret.ret.num = cat_fs_rwv2(data->fd, data->iov, data->iovcnt, data->offset, data->flags, data->write);
+    if (0 > data->ret.ret.num) {
+        data->ret.error.type = CAT_FS_ERROR_ERRNO;
+        data->ret.error.val.error = errno;
+    }
+}
+
+static int cat_fs_rwf(cat_fs_rw_flags_t flags)
+{
+    int rwf = 0;
+
+    if (flags & CAT_FS_RW_FLAG_HIPRI) {
+        rwf |= RWF_HIPRI;
+    }
+    if (flags & CAT_FS_RW_FLAG_DSYNC) {
+        rwf |= RWF_DSYNC;
+    }
+    if (flags & CAT_FS_RW_FLAG_SYNC) {
+        rwf |= RWF_SYNC;
+    }
+    if (flags & CAT_FS_RW_FLAG_NOWAIT) {
+        rwf |= RWF_NOWAIT;
+    }
+    if (flags & CAT_FS_RW_FLAG_APPEND) {
+        rwf |= RWF_APPEND;
+    }
+
+    return rwf;
+}
+#endif
+
+static ssize_t cat_fs_rwv_impl(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset, cat_fs_rw_flags_t flags, cat_bool_t write)
+{
+    const char *operation = write ? "pwritev2" : "preadv2";
+    int rwf = 0;
+
+#ifdef CAT_FS_HAVE_RWV2
+    rwf = cat_fs_rwf(flags);
+    if (rwf & RWF_NOWAIT) {
+        /* data may be served from the page cache without blocking, so it does not deserve a round trip */
+        ssize_t n = cat_fs_rwv2(fd, (const struct iovec *) vector, (int) vector_count, offset, rwf, write);
+        if (n >= 0) {
+            return n;
+        }
+        /* EOPNOTSUPP/EINVAL/ENOSYS: NOWAIT is not supported by kernel or file-system */
+        if (errno != EAGAIN && errno != EOPNOTSUPP && errno != EINVAL && errno != ENOSYS) {
+            cat_update_last_error_of_syscall("File-System %s failed", operation);
+            return -1;
+        }
+        rwf &= ~RWF_NOWAIT;
+    }
+#else
+    if (unlikely((flags & ~CAT_FS_RW_FLAG_NOWAIT) != 0)) {
+        cat_update_last_error(CAT_ENOTSUP, "File-System %s flags are not supported on this platform", operation);
+        errno = cat_orig_errno(CAT_ENOTSUP);
+        return -1;
+    }
+#endif
+    CAT_FS_IO_URING_DO_RESULT_EX({return -1;}, {return (ssize_t) result;}, rwv, NULL, {
+        cat_fs_io_uring_prep_rw(&sqe, write ? IORING_OP_WRITEV : IORING_OP_READV, fd, vector, vector_count, offset);
+        sqe.rw_flags = rwf;
+    });
+#ifdef CAT_FS_HAVE_RWV2
+    if (rwf != 0) {
+        cat_fs_rwv_data_t *data = (cat_fs_rwv_data_t *) cat_malloc(sizeof(*data));
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (data == NULL) {
+            cat_update_last_error_of_syscall("Malloc for fs %s failed", operation);
+            return -1;
+        }
+#endif
+        memset(&data->ret, 0, sizeof(data->ret));
+        data->fd = fd;
+        data->iov = (const struct iovec *) vector;
+        data->iovcnt = (int) vector_count;
+        data->offset = offset;
+        data->flags = rwf;
+        data->write = write;
+        if (!cat_work(CAT_WORK_KIND_FAST_IO, cat_fs_rwv_cb, cat_free_function, data, CAT_TIMEOUT_FOREVER)) {
+            return -1;
+        }
+        if (data->ret.error.type != CAT_FS_ERROR_NONE) {
+            cat_fs_work_error(&data->ret.error, write ? "File-System pwritev2 failed: %s" : "File-System preadv2 failed: %s");
+        }
+        return (ssize_t) data->ret.ret.num;
+    }
+#endif
+    (void) rwf;
+    if (write) {
+        CAT_FS_DO_RESULT(ssize_t, write, fd, (const uv_buf_t *) vector, vector_count, offset);
+    } else {
+        CAT_FS_DO_RESULT(ssize_t, read, fd, (const uv_buf_t *) vector, vector_count, offset);
+    }
+}
+
+CAT_API ssize_t cat_fs_readv(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count)
+{
+    return cat_fs_preadv2(fd, vector, vector_count, -1, CAT_FS_RW_FLAG_NONE);
+}
+
+CAT_API ssize_t cat_fs_writev(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count)
+{
+    return cat_fs_pwritev2(fd, vector, vector_count, -1, CAT_FS_RW_FLAG_NONE);
+}
+
+CAT_API ssize_t cat_fs_preadv(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset)
+{
+    return cat_fs_preadv2(fd, vector, vector_count, offset, CAT_FS_RW_FLAG_NONE);
+}
+
+CAT_API ssize_t cat_fs_pwritev(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset)
+{
+    return cat_fs_pwritev2(fd, vector, vector_count, offset, CAT_FS_RW_FLAG_NONE);
+}
+
+CAT_API ssize_t cat_fs_preadv2(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset, cat_fs_rw_flags_t flags)
+{
+    ssize_t n;
+
+    CAT_LOG_DEBUG(FS, "preadv2(" CAT_FS_FILE_FMT ", %p, %u, %jd, %d) = " CAT_LOG_UNFINISHED_STR,
+        fd, vector, vector_count, (intmax_t) offset, flags);
+
+    n = cat_fs_rwv_impl(fd, vector, vector_count, offset, flags, cat_false);
+
+    CAT_LOG_DEBUG(FS, "preadv2(" CAT_FS_FILE_FMT ", %p, %u, %jd, %d) = " CAT_LOG_SSIZE_RET_FMT,
+        fd, vector, vector_count, (intmax_t) offset, flags, CAT_LOG_SSIZE_RET_C(n));
+
+    return n;
+}
+
+CAT_API ssize_t cat_fs_pwritev2(cat_file_t fd, const cat_io_vector_t *vector, unsigned int vector_count, off_t offset, cat_fs_rw_flags_t flags)
+{
+    ssize_t n;
+
+    CAT_LOG_DEBUG(FS, "pwritev2(" CAT_FS_FILE_FMT ", %p, %u, %jd, %d) = " CAT_LOG_UNFINISHED_STR,
+        fd, vector, vector_count, (intmax_t) offset, flags);
+
+    n = cat_fs_rwv_impl(fd, vector, vector_count, offset, flags, cat_true);
+
+    CAT_LOG_DEBUG(FS, "pwritev2(" CAT_FS_FILE_FMT ", %p, %u, %jd, %d) = " CAT_LOG_SSIZE_RET_FMT,
+        fd, vector, vector_count, (intmax_t) offset, flags, CAT_LOG_SSIZE_RET_C(n));
+
+    return n;
+}
+
 typedef struct cat_fs_lseek_data_s {
     cat_fs_work_ret_t ret;
     int fd;
@@ -687,6 +1012,10 @@ CAT_API off_t cat_fs_lseek(cat_file_t fd, off_t offset, int whence)
 
 static cat_always_inline int cat_fs_fsync_impl(cat_file_t fd)
 {
+    CAT_FS_IO_URING_DO_RESULT(int, fsync, {
+        sqe.opcode = IORING_OP_FSYNC;
+        sqe.fd = fd;
+    });
     CAT_FS_DO_RESULT(int, fsync, fd);
 }
 
@@ -701,6 +1030,11 @@ CAT_API int cat_fs_fsync(cat_file_t fd)
 
 static cat_always_inline int cat_fs_fdatasync_impl(cat_file_t fd)
 {
+    CAT_FS_IO_URING_DO_RESULT(int, fdatasync, {
+        sqe.opcode = IORING_OP_FSYNC;
+        sqe.fd = fd;
+        sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+    });
     CAT_FS_DO_RESULT(int, fdatasync, fd);
 }
 
@@ -911,6 +1245,7 @@ CAT_API int cat_fs_access(const char *path, int mode)
 static cat_always_inline int cat_fs_stat_impl(const char *_path, cat_stat_t *statbuf)
 {
     wrappath(_path, path);
+    CAT_FS_IO_URING_DO_STAT(stat, AT_FDCWD, path, 0);
     CAT_FS_DO_STAT(stat, path);
 }
 
@@ -927,6 +1262,7 @@ CAT_API int cat_fs_stat(const char *path, cat_stat_t *statbuf)
 static cat_always_inline int cat_fs_lstat_impl(const char *_path, cat_stat_t *statbuf)
 {
     wrappath(_path, path);
+    CAT_FS_IO_URING_DO_STAT(lstat, AT_FDCWD, path, AT_SYMLINK_NOFOLLOW);
     CAT_FS_DO_STAT(lstat, path);
 }
 
@@ -942,6 +1278,7 @@ CAT_API int cat_fs_lstat(const char *path, cat_stat_t *statbuf)
 
 static cat_always_inline int cat_fs_fstat_impl(cat_file_t fd, cat_stat_t *statbuf)
 {
+    CAT_FS_IO_URING_DO_STAT(fstat, fd, "", AT_EMPTY_PATH);
     CAT_FS_DO_STAT(fstat, fd);
 }
 
@@ -2415,9 +2752,13 @@ CAT_API void cat_fs_rewinddir(cat_dir_t *dir)
 
 CAT_API int cat_fs_closedir(cat_dir_t *dir)
 {
+    cat_msec_t deadline;
     int error;
     CAT_LOG_DEBUG(FS, "closedir(%p) = " CAT_LOG_UNFINISHED_STR, dir);
+    /* dir handle has been released before waiting, see cat_fs_close() */
+    deadline = cat_time_set_deadline(0);
     error = cat_fs_closedir_impl(dir);
+    (void) cat_time_set_deadline(deadline);
     CAT_LOG_DEBUG(FS, "closedir(%p) = " CAT_LOG_INT_RET_FMT, dir, CAT_LOG_INT_RET_C(error));
     return error;
 }
@@ -2781,6 +3122,1376 @@ CAT_API int cat_fs_flock(cat_file_t fd, cat_fs_flock_flags_t operation)
 
 #undef _CAT_FS_FLOCK_FLAG_NONBLOCK
 
+/* memory-mapped file */
+
+#ifndef CAT_OS_WIN
+#include <sys/mman.h>
+
+typedef struct cat_fs_madvise_data_s {
+    cat_fs_work_ret_t ret;
+    void *address;
+    size_t length;
+    int advice;
+    cat_bool_t prefault;
+    /* the caller must not return (and unmap pages) until the worker is done */
+    cat_bool_t done;
+    /* set by the caller on timeout, the worker stops touching pages */
+    cat_atomic_bool_t canceled;
+    cat_coroutine_t *waiter;
+} cat_fs_madvise_data_t;
+
+static void cat_fs_madvise_cb(cat_data_t *ptr)
+{
+    cat_fs_madvise_data_t *data = (cat_fs_madvise_data_t *) ptr;
+
+    if (data->advice != -1) {
+        data->ret.ret.num = madvise(data->address, data->length, data->advice);
+        if (0 != data->ret.ret.num) {
+            if (!data->prefault) {
+                data->ret.error.type = CAT_FS_ERROR_ERRNO;
+                data->ret.error.val.error = errno;
+                return;
+            }
+            /* it is just a hint for prefault */
+            data->ret.ret.num = 0;
+        }
+    }
+    if (data->prefault) {
+        const volatile char *p = (const volatile char *) cat_getpageof(data->address);
+        const char *end = ((const char *) data->address) + data->length;
+        size_t pagesize = cat_getpagesize();
+        for (; (const char *) p < end; p += pagesize) {
+            if (unlikely(cat_atomic_bool_load(&data->canceled))) {
+                break;
+            }
+            (void) *p;
+        }
+    }
+}
+
+static void cat_fs_madvise_cleanup(cat_data_t *ptr)
+{
+    cat_fs_madvise_data_t *data = (cat_fs_madvise_data_t *) ptr;
+
+    data->done = cat_true;
+    if (data->waiter != NULL) {
+        cat_coroutine_schedule(data->waiter, FS, "File-System madvise");
+    }
+}
+
+static int cat_fs_madvise_impl(void *address, size_t length, int advice, cat_bool_t prefault, cat_timeout_t timeout)
+{
+    cat_fs_madvise_data_t *data;
+    cat_msec_t deadline;
+    int ret = -1;
+
+    if (length == 0) {
+        return 0;
+    }
+    data = (cat_fs_madvise_data_t *) cat_malloc(sizeof(*data));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (data == NULL) {
+        cat_update_last_error_of_syscall("Malloc for fs madvise failed");
+        return -1;
+    }
+#endif
+    memset(&data->ret, 0, sizeof(data->ret));
+    data->address = address;
+    data->length = length;
+    data->advice = advice;
+    data->prefault = prefault;
+    data->done = cat_false;
+    cat_atomic_bool_init(&data->canceled, cat_false);
+    data->waiter = NULL;
+    if (cat_work(CAT_WORK_KIND_FAST_IO, cat_fs_madvise_cb, cat_fs_madvise_cleanup, data, timeout)) {
+        /* only madvise() may fail */
+        cat_fs_work_check_error(&data->ret.error, "madvise");
+        ret = (int) data->ret.ret.num;
+    }
+    /* even if it was canceled or timed out, the worker may still be touching the pages,
+     * wait for it without deadline and cancellation, it stops at the next page */
+    if (!data->done) {
+        cat_atomic_bool_store(&data->canceled, cat_true);
+        deadline = cat_time_set_deadline(0);
+        do {
+            data->waiter = CAT_COROUTINE_G(current);
+            (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+            data->waiter = NULL;
+        } while (!data->done);
+        (void) cat_time_set_deadline(deadline);
+    }
+    cat_free(data);
+
+    return ret;
+}
+
+static int cat_fs_madvise_advice(cat_fs_madvise_t advice)
+{
+    switch (advice) {
+        case CAT_FS_MADVISE_NORMAL:
+            return MADV_NORMAL;
+        case CAT_FS_MADVISE_RANDOM:
+            return MADV_RANDOM;
+        case CAT_FS_MADVISE_SEQUENTIAL:
+            return MADV_SEQUENTIAL;
+        case CAT_FS_MADVISE_WILLNEED:
+            return MADV_WILLNEED;
+        case CAT_FS_MADVISE_DONTNEED:
+            return MADV_DONTNEED;
+        default:
+            return -1;
+    }
+}
+#endif /* CAT_OS_WIN */
+
+CAT_API void *cat_fs_mmap(cat_file_t fd, int64_t offset, size_t length, cat_fs_mmap_flags_t flags)
+{
+#ifndef CAT_OS_WIN
+    void *address;
+    int prot = PROT_READ, mmap_flags = MAP_PRIVATE;
+
+    CAT_LOG_DEBUG(FS, "mmap(" CAT_FS_FILE_FMT ", %" PRId64 ", %zu, %d) = " CAT_LOG_UNFINISHED_STR, fd, offset, length, flags);
+
+    if (flags & CAT_FS_MMAP_FLAG_WRITE) {
+        prot |= PROT_WRITE;
+        mmap_flags = MAP_SHARED;
+    }
+    /* it only sets up page tables, no I/O is involved */
+    address = mmap(NULL, length, prot, mmap_flags, fd, (off_t) offset);
+    if (unlikely(address == MAP_FAILED)) {
+        cat_update_last_error_of_syscall("File-System mmap failed");
+        address = NULL;
+    } else if ((flags & CAT_FS_MMAP_FLAG_PREFAULT) &&
+        unlikely(cat_fs_madvise_impl(address, length, MADV_WILLNEED, cat_true, CAT_TIMEOUT_FOREVER) != 0)) {
+        (void) munmap(address, length);
+        address = NULL;
+    }
+
+    CAT_LOG_DEBUG(FS, "mmap(" CAT_FS_FILE_FMT ", %" PRId64 ", %zu, %d) = %p", fd, offset, length, flags, address);
+
+    return address;
+#else
+    (void) fd;
+    (void) offset;
+    (void) length;
+    (void) flags;
+    cat_update_last_error(CAT_ENOTSUP, "File-System mmap is not supported on this platform");
+    return NULL;
+#endif
+}
+
+CAT_API int cat_fs_munmap(void *address, size_t length)
+{
+#ifndef CAT_OS_WIN
+    int ret = munmap(address, length);
+
+    CAT_LOG_DEBUG(FS, "munmap(%p, %zu) = " CAT_LOG_INT_RET_FMT, address, length, CAT_LOG_INT_RET_C(ret));
+
+    if (unlikely(ret != 0)) {
+        cat_update_last_error_of_syscall("File-System munmap failed");
+    }
+    return ret;
+#else
+    (void) address;
+    (void) length;
+    cat_update_last_error(CAT_ENOTSUP, "File-System munmap is not supported on this platform");
+    return -1;
+#endif
+}
+
+CAT_API int cat_fs_madvise(void *address, size_t length, cat_fs_madvise_t advice)
+{
+#ifndef CAT_OS_WIN
+    int madvise_advice = cat_fs_madvise_advice(advice);
+    int ret;
+
+    if (unlikely(madvise_advice == -1)) {
+        cat_update_last_error(CAT_EINVAL, "File-System madvise failed: unknown advice %d", advice);
+        return -1;
+    }
+    ret = cat_fs_madvise_impl(address, length, madvise_advice, cat_false, CAT_TIMEOUT_FOREVER);
+
+    CAT_LOG_DEBUG(FS, "madvise(%p, %zu, %d) = " CAT_LOG_INT_RET_FMT, address, length, advice, CAT_LOG_INT_RET_C(ret));
+
+    return ret;
+#else
+    (void) address;
+    (void) length;
+    (void) advice;
+    cat_update_last_error(CAT_ENOTSUP, "File-System madvise is not supported on this platform");
+    return -1;
+#endif
+}
+
+CAT_API int cat_fs_prefault(const void *address, size_t length)
+{
+    return cat_fs_prefault_ex(address, length, CAT_TIMEOUT_FOREVER);
+}
+
+CAT_API int cat_fs_prefault_ex(const void *address, size_t length, cat_timeout_t timeout)
+{
+#ifndef CAT_OS_WIN
+    int ret = cat_fs_madvise_impl((void *) cat_getpageof(address), length + (((uintptr_t) address) & (cat_getpagesize() - 1)), MADV_WILLNEED, cat_true, timeout);
+
+    CAT_LOG_DEBUG(FS, "prefault(%p, %zu, " CAT_TIMEOUT_FMT ") = " CAT_LOG_INT_RET_FMT, address, length, timeout, CAT_LOG_INT_RET_C(ret));
+
+    return ret;
+#else
+    (void) address;
+    (void) length;
+    (void) timeout;
+    cat_update_last_error(CAT_ENOTSUP, "File-System prefault is not supported on this platform");
+    return -1;
+#endif
+}
+
+/* directory tree walker */
+
+#ifndef CAT_OS_WIN
+#include <dirent.h>
+#include <fcntl.h>
+#ifdef CAT_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+/* memory of batches is allocated on the worker thread, so we always use system allocator */
+typedef struct cat_fs_walk_batch_internal_s {
+    cat_queue_node_t node;
+    cat_fs_walk_batch_t batch;
+    cat_fs_walk_entry_t *entries;
+    /* paths of entries */
+    char *strings;
+    size_t strings_length;
+    size_t strings_size;
+} cat_fs_walk_batch_internal_t;
+
+/* directory fd is kept open until all of its children have been opened relative to it */
+typedef struct cat_fs_walk_dirfd_s {
+    int fd;
+    size_t refcount;
+} cat_fs_walk_dirfd_t;
+
+typedef struct cat_fs_walk_directory_s {
+    /* relative to the root */
+    char *path;
+    /* the last component of path */
+    const char *name;
+    /* NULL for the root */
+    cat_fs_walk_dirfd_t *parent;
+    size_t depth;
+} cat_fs_walk_directory_t;
+
+struct cat_fs_walker_s {
+    char *root;
+    cat_fs_walk_options_t options;
+    uv_thread_t tid;
+    uv_mutex_t mutex;
+    uv_cond_t cond;
+    uv_async_t notifier;
+    cat_coroutine_t *coroutine;
+    cat_atomic_bool_t closing;
+    /* protected by mutex */
+    cat_queue_t batches;
+    size_t batch_count;
+    cat_bool_t done;
+    int error;
+    cat_fs_walk_stats_t stats;
+    cat_nsec_t start_time;
+    cat_nsec_t end_time;
+    /* owned by consumer */
+    cat_fs_walk_batch_internal_t *current;
+    cat_fs_walk_batch_t empty_batch;
+    /* owned by worker */
+    cat_fs_walk_batch_internal_t *building;
+    cat_fs_walk_directory_t *directories;
+    size_t directory_count;
+    size_t directory_size;
+    char *path_buffer;
+    size_t path_buffer_size;
+    cat_fs_walk_stats_t local_stats;
+    /* fatal error (e.g. ENOMEM) which stops walking */
+    int local_error;
+};
+
+static void cat_fs_walk_stat_from_native(const struct stat *native, cat_stat_t *statbuf)
+{
+    memset(statbuf, 0, sizeof(*statbuf));
+    statbuf->st_dev = native->st_dev;
+    statbuf->st_mode = native->st_mode;
+    statbuf->st_nlink = native->st_nlink;
+    statbuf->st_uid = native->st_uid;
+    statbuf->st_gid = native->st_gid;
+    statbuf->st_rdev = native->st_rdev;
+    statbuf->st_ino = native->st_ino;
+    statbuf->st_size = native->st_size;
+    statbuf->st_blksize = native->st_blksize;
+    statbuf->st_blocks = native->st_blocks;
+#if defined(CAT_OS_DARWIN)
+    statbuf->st_atim.tv_sec = native->st_atimespec.tv_sec;
+    statbuf->st_atim.tv_nsec = native->st_atimespec.tv_nsec;
+    statbuf->st_mtim.tv_sec = native->st_mtimespec.tv_sec;
+    statbuf->st_mtim.tv_nsec = native->st_mtimespec.tv_nsec;
+    statbuf->st_ctim.tv_sec = native->st_ctimespec.tv_sec;
+    statbuf->st_ctim.tv_nsec = native->st_ctimespec.tv_nsec;
+#else
+    statbuf->st_atim.tv_sec = native->st_atim.tv_sec;
+    statbuf->st_atim.tv_nsec = native->st_atim.tv_nsec;
+    statbuf->st_mtim.tv_sec = native->st_mtim.tv_sec;
+    statbuf->st_mtim.tv_nsec = native->st_mtim.tv_nsec;
+    statbuf->st_ctim.tv_sec = native->st_ctim.tv_sec;
+    statbuf->st_ctim.tv_nsec = native->st_ctim.tv_nsec;
+#endif
+}
+
+static cat_dirent_type_t cat_fs_walk_type_from_mode(mode_t mode)
+{
+    switch (mode & S_IFMT) {
+        case S_IFREG:
+            return CAT_DIRENT_TYPE_FILE;
+        case S_IFDIR:
+            return CAT_DIRENT_TYPE_DIR;
+        case S_IFLNK:
+            return CAT_DIRENT_TYPE_LINK;
+        case S_IFIFO:
+            return CAT_DIRENT_TYPE_FIFO;
+        case S_IFSOCK:
+            return CAT_DIRENT_TYPE_SOCKET;
+        case S_IFCHR:
+            return CAT_DIRENT_TYPE_CHAR;
+        case S_IFBLK:
+            return CAT_DIRENT_TYPE_BLOCK;
+        default:
+            return CAT_DIRENT_TYPE_UNKNOWN;
+    }
+}
+
+static cat_dirent_type_t cat_fs_walk_type_from_dtype(unsigned char d_type)
+{
+    switch (d_type) {
+#ifdef DT_REG
+        case DT_REG:
+            return CAT_DIRENT_TYPE_FILE;
+        case DT_DIR:
+            return CAT_DIRENT_TYPE_DIR;
+        case DT_LNK:
+            return CAT_DIRENT_TYPE_LINK;
+        case DT_FIFO:
+            return CAT_DIRENT_TYPE_FIFO;
+        case DT_SOCK:
+            return CAT_DIRENT_TYPE_SOCKET;
+        case DT_CHR:
+            return CAT_DIRENT_TYPE_CHAR;
+        case DT_BLK:
+            return CAT_DIRENT_TYPE_BLOCK;
+#endif
+        default:
+            return CAT_DIRENT_TYPE_UNKNOWN;
+    }
+}
+
+static void cat_fs_walk_batch_free(cat_fs_walk_batch_internal_t *batch)
+{
+    cat_sys_free(batch->strings);
+    cat_sys_free(batch);
+}
+
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+static cat_bool_t cat_fs_walker_out_of_memory(cat_fs_walker_t *walker)
+{
+    walker->local_error = ENOMEM;
+    return cat_false;
+}
+#endif
+
+/* publish the building batch, returns false if walker is closing */
+static cat_bool_t cat_fs_walker_publish(cat_fs_walker_t *walker)
+{
+    cat_fs_walk_batch_internal_t *batch = walker->building;
+    size_t n;
+
+    walker->building = NULL;
+    /* strings would never be moved from now on */
+    for (n = 0; n < batch->batch.count; n++) {
+        cat_fs_walk_entry_t *entry = &batch->entries[n];
+        entry->path = batch->strings + (uintptr_t) entry->path;
+        entry->name = batch->strings + (uintptr_t) entry->name;
+    }
+    walker->local_stats.batch_count++;
+
+    uv_mutex_lock(&walker->mutex);
+    while (walker->batch_count >= walker->options.max_batches && !cat_atomic_bool_load(&walker->closing)) {
+        uv_cond_wait(&walker->cond, &walker->mutex);
+    }
+    if (cat_atomic_bool_load(&walker->closing)) {
+        uv_mutex_unlock(&walker->mutex);
+        cat_fs_walk_batch_free(batch);
+        return cat_false;
+    }
+    cat_queue_push_back(&walker->batches, &batch->node);
+    walker->batch_count++;
+    walker->stats = walker->local_stats;
+    uv_mutex_unlock(&walker->mutex);
+    (void) uv_async_send(&walker->notifier);
+
+    return cat_true;
+}
+
+static void cat_fs_walk_dirfd_release(cat_fs_walk_dirfd_t *dirfd)
+{
+    if (dirfd != NULL && --dirfd->refcount == 0) {
+        (void) close(dirfd->fd);
+        cat_sys_free(dirfd);
+    }
+}
+
+static cat_bool_t cat_fs_walker_add_entry(cat_fs_walker_t *walker, cat_fs_walk_dirfd_t *dirfd, const cat_fs_walk_directory_t *directory, const char *name, unsigned char d_type)
+{
+    size_t directory_path_length = strlen(directory->path);
+    size_t name_length = strlen(name);
+    size_t path_length;
+    cat_fs_walk_entry_t entry;
+    cat_fs_walk_action_t action;
+
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        return cat_true;
+    }
+    walker->local_stats.scanned_count++;
+
+    /* build relative path */
+    path_length = directory_path_length + (directory_path_length != 0) + name_length;
+    if (path_length + 1 > walker->path_buffer_size) {
+        char *path_buffer = (char *) cat_sys_realloc(walker->path_buffer, path_length + 1 + 256);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+        if (unlikely(path_buffer == NULL)) {
+            return cat_fs_walker_out_of_memory(walker);
+        }
+#endif
+        walker->path_buffer = path_buffer;
+        walker->path_buffer_size = path_length + 1 + 256;
+    }
+    memcpy(walker->path_buffer, directory->path, directory_path_length);
+    if (directory_path_length != 0) {
+        walker->path_buffer[directory_path_length] = '/';
+    }
+    memcpy(walker->path_buffer + path_length - name_length, name, name_length + 1);
+
+    entry.path = walker->path_buffer;
+    entry.name = walker->path_buffer + path_length - name_length;
+    entry.type = cat_fs_walk_type_from_dtype(d_type);
+    entry.depth = directory->depth + 1;
+    if (walker->options.stat || entry.type == CAT_DIRENT_TYPE_UNKNOWN) {
+        struct stat native;
+        /* relative to the directory fd, so that kernel does not need to resolve the whole path again */
+        if (unlikely(fstatat(dirfd->fd, name, &native, AT_SYMLINK_NOFOLLOW) != 0)) {
+            /* e.g. it has been removed */
+            walker->local_stats.error_count++;
+            return cat_true;
+        }
+        entry.type = cat_fs_walk_type_from_mode(native.st_mode);
+        if (walker->options.stat) {
+            cat_fs_walk_stat_from_native(&native, &entry.stat);
+        }
+    }
+    if (!walker->options.stat) {
+        memset(&entry.stat, 0, sizeof(entry.stat));
+    }
+
+    action = walker->options.filter != NULL ?
+        walker->options.filter(&entry, walker->options.filter_data) :
+        CAT_FS_WALK_ACTION_INCLUDE;
+
+    if (action == CAT_FS_WALK_ACTION_INCLUDE) {
+        cat_fs_walk_batch_internal_t *batch = walker->building;
+        cat_fs_walk_entry_t *batch_entry;
+        if (batch == NULL) {
+            batch = (cat_fs_walk_batch_internal_t *) cat_sys_malloc(sizeof(*batch) + sizeof(*batch->entries) * walker->options.batch_size);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+            if (unlikely(batch == NULL)) {
+                return cat_fs_walker_out_of_memory(walker);
+            }
+#endif
+            batch->entries = (cat_fs_walk_entry_t *) (batch + 1);
+            batch->batch.entries = batch->entries;
+            batch->batch.count = 0;
+            batch->strings_size = walker->options.batch_size * 32;
+            batch->strings = (char *) cat_sys_malloc(batch->strings_size);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+            if (unlikely(batch->strings == NULL)) {
+                cat_sys_free(batch);
+                return cat_fs_walker_out_of_memory(walker);
+            }
+#endif
+            batch->strings_length = 0;
+            walker->building = batch;
+        }
+        if (batch->strings_length + path_length + 1 > batch->strings_size) {
+            char *strings = (char *) cat_sys_realloc(batch->strings, (batch->strings_length + path_length + 1) * 2);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+            if (unlikely(strings == NULL)) {
+                return cat_fs_walker_out_of_memory(walker);
+            }
+#endif
+            batch->strings = strings;
+            batch->strings_size = (batch->strings_length + path_length + 1) * 2;
+        }
+        batch_entry = &batch->entries[batch->batch.count++];
+        *batch_entry = entry;
+        /* they are offsets until it is published, because strings may be reallocated */
+        batch_entry->path = (const char *) (uintptr_t) batch->strings_length;
+        batch_entry->name = (const char *) (uintptr_t) (batch->strings_length + path_length - name_length);
+        memcpy(batch->strings + batch->strings_length, walker->path_buffer, path_length + 1);
+        batch->strings_length += path_length + 1;
+        walker->local_stats.entry_count++;
+        if (batch->batch.count == walker->options.batch_size) {
+            if (!cat_fs_walker_publish(walker)) {
+                return cat_false;
+            }
+        }
+    }
+
+    if (entry.type == CAT_DIRENT_TYPE_DIR &&
+        action != CAT_FS_WALK_ACTION_PRUNE &&
+        (walker->options.max_depth == 0 || entry.depth < walker->options.max_depth)) {
+        cat_fs_walk_directory_t *child;
+        char *child_path;
+        if (walker->directory_count == walker->directory_size) {
+            size_t directory_size = walker->directory_size != 0 ? walker->directory_size * 2 : 64;
+            cat_fs_walk_directory_t *directories = (cat_fs_walk_directory_t *) cat_sys_realloc(walker->directories, sizeof(*walker->directories) * directory_size);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+            if (unlikely(directories == NULL)) {
+                return cat_fs_walker_out_of_memory(walker);
+            }
+#endif
+            walker->directories = directories;
+            walker->directory_size = directory_size;
+        }
+        child_path = cat_sys_strndup(walker->path_buffer, path_length);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+        if (unlikely(child_path == NULL)) {
+            return cat_fs_walker_out_of_memory(walker);
+        }
+#endif
+        child = &walker->directories[walker->directory_count++];
+        child->path = child_path;
+        child->name = child_path + path_length - name_length;
+        child->parent = dirfd;
+        dirfd->refcount++;
+        child->depth = entry.depth;
+    }
+
+    return cat_true;
+}
+
+static int cat_fs_walker_open_directory(const cat_fs_walker_t *walker, const cat_fs_walk_directory_t *directory)
+{
+    if (directory->parent == NULL) {
+        return open(walker->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    /* relative to the parent, so that kernel does not need to resolve the whole path again,
+     * and a directory on the way can not be swapped by a symlink */
+    return openat(directory->parent->fd, directory->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+}
+
+/* returns false if walker is closing or failed */
+static cat_bool_t cat_fs_walker_read_directory(cat_fs_walker_t *walker, cat_fs_walk_dirfd_t *dirfd, const cat_fs_walk_directory_t *directory)
+{
+#ifdef CAT_OS_LINUX
+    /* read entries in bulk by getdents64() directly */
+    struct cat_linux_dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+    char buffer[32 * 1024];
+    long nread;
+    long offset;
+
+    while ((nread = syscall(SYS_getdents64, dirfd->fd, buffer, sizeof(buffer))) > 0) {
+        for (offset = 0; offset < nread;) {
+            struct cat_linux_dirent64 *dirent = (struct cat_linux_dirent64 *) (buffer + offset);
+            if (!cat_fs_walker_add_entry(walker, dirfd, directory, dirent->d_name, dirent->d_type)) {
+                return cat_false;
+            }
+            offset += dirent->d_reclen;
+        }
+        if (cat_atomic_bool_load(&walker->closing)) {
+            break;
+        }
+    }
+    if (nread < 0) {
+        walker->local_stats.error_count++;
+    }
+#else
+    /* DIR owns the fd, but children still need the original one */
+    int fd = dup(dirfd->fd);
+    DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+    struct dirent *dirent;
+
+    if (dir == NULL) {
+        walker->local_stats.error_count++;
+        if (fd >= 0) {
+            (void) close(fd);
+        }
+        return cat_true;
+    }
+    while ((dirent = readdir(dir)) != NULL) {
+        if (!cat_fs_walker_add_entry(walker, dirfd, directory, dirent->d_name,
+#ifdef DT_UNKNOWN
+            dirent->d_type
+#else
+            0
+#endif
+        )) {
+            (void) closedir(dir);
+            return cat_false;
+        }
+    }
+    (void) closedir(dir);
+#endif
+
+    return !cat_atomic_bool_load(&walker->closing);
+}
+
+static void cat_fs_walker_thread_function(void *arg)
+{
+    cat_fs_walker_t *walker = (cat_fs_walker_t *) arg;
+    cat_fs_walk_directory_t directory;
+    int error = 0;
+
+    /* root is the only one at depth 0, its path is never freed */
+    directory.path = (char *) "";
+    directory.name = NULL;
+    directory.parent = NULL;
+    directory.depth = 0;
+    while (1) {
+        int fd = cat_fs_walker_open_directory(walker, &directory);
+        if (fd < 0 && directory.depth == 0) {
+            error = errno;
+        }
+        cat_fs_walk_dirfd_release(directory.parent);
+        if (fd < 0) {
+            if (directory.depth != 0 && walker->local_error == 0) {
+                walker->local_stats.error_count++;
+            }
+        } else {
+            cat_fs_walk_dirfd_t *dirfd = (cat_fs_walk_dirfd_t *) cat_sys_malloc(sizeof(*dirfd));
+            cat_bool_t ret;
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+            if (unlikely(dirfd == NULL)) {
+                (void) close(fd);
+                (void) cat_fs_walker_out_of_memory(walker);
+                if (directory.depth != 0) {
+                    cat_sys_free(directory.path);
+                }
+                break;
+            }
+#endif
+            dirfd->fd = fd;
+            dirfd->refcount = 1;
+            walker->local_stats.directory_count++;
+            ret = cat_fs_walker_read_directory(walker, dirfd, &directory);
+            cat_fs_walk_dirfd_release(dirfd);
+            if (!ret) {
+                if (directory.depth != 0) {
+                    cat_sys_free(directory.path);
+                }
+                break;
+            }
+        }
+        if (directory.depth != 0) {
+            cat_sys_free(directory.path);
+        }
+        if (walker->local_error != 0 || walker->directory_count == 0) {
+            break;
+        }
+        /* depth-first */
+        directory = walker->directories[--walker->directory_count];
+    }
+    if (walker->local_error != 0) {
+        error = walker->local_error;
+    }
+    if (walker->building != NULL) {
+        (void) cat_fs_walker_publish(walker);
+    }
+
+    uv_mutex_lock(&walker->mutex);
+    walker->done = cat_true;
+    walker->error = error;
+    walker->stats = walker->local_stats;
+    walker->end_time = cat_time_nsec();
+    uv_mutex_unlock(&walker->mutex);
+    (void) uv_async_send(&walker->notifier);
+}
+
+static void cat_fs_walker_notify_callback(uv_async_t *handle)
+{
+    cat_fs_walker_t *walker = cat_container_of(handle, cat_fs_walker_t, notifier);
+
+    if (walker->coroutine != NULL) {
+        cat_coroutine_schedule(walker->coroutine, FS, "File-System walker");
+    }
+}
+
+static void cat_fs_walker_close_callback(uv_handle_t *handle)
+{
+    cat_fs_walker_t *walker = cat_container_of(handle, cat_fs_walker_t, notifier);
+
+    cat_free(walker);
+}
+#endif /* CAT_OS_WIN */
+
+CAT_API void cat_fs_walk_options_init(cat_fs_walk_options_t *options)
+{
+    options->max_depth = 0;
+    options->stat = cat_false;
+    options->filter = NULL;
+    options->filter_data = NULL;
+    options->batch_size = 256;
+    options->max_batches = 8;
+}
+
+CAT_API cat_fs_walker_t *cat_fs_walker_create(const char *path, const cat_fs_walk_options_t *options)
+{
+#ifndef CAT_OS_WIN
+    cat_fs_walker_t *walker;
+    int error;
+
+    walker = (cat_fs_walker_t *) cat_malloc(sizeof(*walker));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(walker == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for file-system walker failed");
+        return NULL;
+    }
+#endif
+    memset(walker, 0, sizeof(*walker));
+    if (options != NULL) {
+        walker->options = *options;
+    } else {
+        cat_fs_walk_options_init(&walker->options);
+    }
+    if (walker->options.batch_size == 0) {
+        walker->options.batch_size = 1;
+    }
+    if (walker->options.max_batches == 0) {
+        walker->options.max_batches = 1;
+    }
+    walker->root = cat_sys_strdup(path);
+#if CAT_SYS_ALLOC_HANDLE_ERRORS
+    if (unlikely(walker->root == NULL)) {
+        cat_update_last_error_of_syscall("Strdup for file-system walker root failed");
+        cat_free(walker);
+        return NULL;
+    }
+#endif
+    cat_queue_init(&walker->batches);
+    cat_atomic_bool_init(&walker->closing, cat_false);
+    error = uv_mutex_init(&walker->mutex);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "File-System walker mutex init failed");
+        goto _mutex_init_error;
+    }
+    error = uv_cond_init(&walker->cond);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "File-System walker cond init failed");
+        goto _cond_init_error;
+    }
+    error = uv_async_init(&CAT_EVENT_G(loop), &walker->notifier, cat_fs_walker_notify_callback);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "File-System walker notifier init failed");
+        goto _async_init_error;
+    }
+    uv_unref((uv_handle_t *) &walker->notifier);
+    walker->start_time = cat_time_nsec();
+    error = uv_thread_create(&walker->tid, cat_fs_walker_thread_function, walker);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "File-System walker thread create failed");
+        goto _thread_create_error;
+    }
+
+    return walker;
+
+    _thread_create_error:
+    uv_close((uv_handle_t *) &walker->notifier, cat_fs_walker_close_callback);
+    uv_cond_destroy(&walker->cond);
+    uv_mutex_destroy(&walker->mutex);
+    cat_sys_free(walker->root);
+    return NULL;
+    _async_init_error:
+    uv_cond_destroy(&walker->cond);
+    _cond_init_error:
+    uv_mutex_destroy(&walker->mutex);
+    _mutex_init_error:
+    cat_sys_free(walker->root);
+    cat_free(walker);
+    return NULL;
+#else
+    (void) path;
+    (void) options;
+    cat_update_last_error(CAT_ENOTSUP, "File-System walker is not supported on this platform");
+    return NULL;
+#endif
+}
+
+CAT_API const cat_fs_walk_batch_t *cat_fs_walker_next(cat_fs_walker_t *walker, cat_timeout_t timeout)
+{
+#ifndef CAT_OS_WIN
+    cat_fs_walk_batch_internal_t *batch;
+    cat_bool_t ret;
+
+    if (walker->current != NULL) {
+        cat_fs_walk_batch_free(walker->current);
+        walker->current = NULL;
+    }
+    while (1) {
+        uv_mutex_lock(&walker->mutex);
+        batch = cat_queue_front_data(&walker->batches, cat_fs_walk_batch_internal_t, node);
+        if (batch != NULL) {
+            cat_queue_remove(&batch->node);
+            walker->batch_count--;
+            uv_cond_signal(&walker->cond);
+            uv_mutex_unlock(&walker->mutex);
+            walker->current = batch;
+            return &batch->batch;
+        }
+        if (walker->done) {
+            int error = walker->error;
+            uv_mutex_unlock(&walker->mutex);
+            if (unlikely(error != 0)) {
+                cat_update_last_error(cat_translate_sys_error(error), "File-System walker failed to walk \"%s\": %s", walker->root, cat_strerror(cat_translate_sys_error(error)));
+                return NULL;
+            }
+            return &walker->empty_batch;
+        }
+        uv_mutex_unlock(&walker->mutex);
+        CAT_TIME_WAIT_START() {
+            walker->coroutine = CAT_COROUTINE_G(current);
+            ret = cat_time_wait(timeout);
+            walker->coroutine = NULL;
+        } CAT_TIME_WAIT_END(timeout);
+        if (unlikely(!ret)) {
+            cat_update_last_error_with_previous("File-System walker wait failed");
+            return NULL;
+        }
+    }
+#else
+    (void) walker;
+    (void) timeout;
+    cat_update_last_error(CAT_ENOTSUP, "File-System walker is not supported on this platform");
+    return NULL;
+#endif
+}
+
+CAT_API void cat_fs_walker_get_stats(cat_fs_walker_t *walker, cat_fs_walk_stats_t *stats)
+{
+#ifndef CAT_OS_WIN
+    cat_nsec_t end_time;
+
+    uv_mutex_lock(&walker->mutex);
+    *stats = walker->stats;
+    end_time = walker->done ? walker->end_time : cat_time_nsec();
+    uv_mutex_unlock(&walker->mutex);
+    stats->duration = end_time - walker->start_time;
+    stats->entries_per_second = stats->duration != 0 ?
+        ((double) stats->entry_count) * 1000 * 1000 * 1000 / stats->duration : 0;
+#else
+    (void) walker;
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+CAT_API void cat_fs_walker_close(cat_fs_walker_t *walker)
+{
+#ifndef CAT_OS_WIN
+    cat_fs_walk_batch_internal_t *batch;
+
+    uv_mutex_lock(&walker->mutex);
+    cat_atomic_bool_store(&walker->closing, cat_true);
+    uv_cond_broadcast(&walker->cond);
+    uv_mutex_unlock(&walker->mutex);
+    (void) uv_thread_join(&walker->tid);
+
+    while ((batch = cat_queue_front_data(&walker->batches, cat_fs_walk_batch_internal_t, node)) != NULL) {
+        cat_queue_remove(&batch->node);
+        cat_fs_walk_batch_free(batch);
+    }
+    if (walker->current != NULL) {
+        cat_fs_walk_batch_free(walker->current);
+    }
+    if (walker->building != NULL) {
+        cat_fs_walk_batch_free(walker->building);
+    }
+    while (walker->directory_count > 0) {
+        cat_fs_walk_directory_t *directory = &walker->directories[--walker->directory_count];
+        cat_fs_walk_dirfd_release(directory->parent);
+        cat_sys_free(directory->path);
+    }
+    if (walker->directories != NULL) {
+        cat_sys_free(walker->directories);
+    }
+    if (walker->path_buffer != NULL) {
+        cat_sys_free(walker->path_buffer);
+    }
+    cat_sys_free(walker->root);
+    uv_cond_destroy(&walker->cond);
+    uv_mutex_destroy(&walker->mutex);
+    uv_close((uv_handle_t *) &walker->notifier, cat_fs_walker_close_callback);
+#else
+    (void) walker;
+#endif
+}
+
+/* buffered writer */
+
+#define CAT_FS_WRITER_MAX_VECTOR_COUNT 64
+
+typedef struct cat_fs_writer_buffer_s {
+    cat_queue_node_t node;
+    size_t length;
+    size_t size;
+    char value[1];
+} cat_fs_writer_buffer_t;
+
+typedef struct cat_fs_writer_waiter_s {
+    cat_queue_node_t node;
+    cat_coroutine_t *coroutine;
+    /* it is done once position reaches it */
+    uint64_t target;
+    cat_bool_t done;
+} cat_fs_writer_waiter_t;
+
+struct cat_fs_writer_s {
+    cat_file_t fd;
+    off_t offset;
+    cat_fs_writer_options_t options;
+    /* buffers which are waiting for flush */
+    cat_queue_t buffers;
+    size_t pending_length;
+    /* positions in the stream of data */
+    uint64_t written;
+    uint64_t flushed;
+    uint64_t synced;
+    uint64_t sync_request;
+    cat_queue_t flush_waiters;
+    cat_queue_t sync_waiters;
+    cat_coroutine_t *flusher;
+    cat_bool_t flusher_waiting;
+    cat_coroutine_t *closer;
+    cat_bool_t closing;
+    /* sticky, writer is broken once flush or sync has failed */
+    cat_errno_t error;
+    cat_fs_writer_stats_t stats;
+};
+
+CAT_API void cat_fs_writer_options_init(cat_fs_writer_options_t *options)
+{
+    options->buffer_size = CAT_FS_WRITER_DEFAULT_BUFFER_SIZE;
+    options->max_buffer_size = CAT_FS_WRITER_DEFAULT_MAX_BUFFER_SIZE;
+    options->flush_interval = CAT_FS_WRITER_DEFAULT_FLUSH_INTERVAL;
+}
+
+static void cat_fs_writer_notify(cat_queue_t *waiters, uint64_t position, cat_bool_t all)
+{
+    cat_fs_writer_waiter_t *waiter;
+
+    /* targets are in ascending order since they are taken from the written position */
+    while ((waiter = cat_queue_front_data(waiters, cat_fs_writer_waiter_t, node)) != NULL) {
+        if (!all && waiter->target > position) {
+            break;
+        }
+        cat_queue_remove(&waiter->node);
+        waiter->done = cat_true;
+        if (waiter->coroutine != NULL) {
+            cat_coroutine_schedule(waiter->coroutine, FS, "File-System writer");
+        }
+    }
+}
+
+static void cat_fs_writer_wakeup_flusher(cat_fs_writer_t *writer)
+{
+    if (writer->flusher_waiting) {
+        writer->flusher_waiting = cat_false;
+        cat_coroutine_schedule(writer->flusher, FS, "File-System writer flusher");
+    }
+}
+
+static cat_bool_t cat_fs_writer_is_urgent(const cat_fs_writer_t *writer)
+{
+    return writer->closing ||
+        writer->pending_length >= writer->options.buffer_size ||
+        !cat_queue_empty(&writer->flush_waiters) ||
+        writer->sync_request > writer->flushed;
+}
+
+static cat_bool_t cat_fs_writer_flush_buffers(cat_fs_writer_t *writer)
+{
+    cat_queue_t buffers;
+    cat_io_vector_t vector[CAT_FS_WRITER_MAX_VECTOR_COUNT];
+    cat_fs_writer_buffer_t *buffer;
+    size_t length = writer->pending_length;
+    cat_nsec_t start, duration;
+    cat_bool_t ret = cat_true;
+
+    /* buffers are detached, so writers can go on with new buffers during the flush */
+    cat_queue_init(&buffers);
+    while ((buffer = cat_queue_front_data(&writer->buffers, cat_fs_writer_buffer_t, node)) != NULL) {
+        cat_queue_remove(&buffer->node);
+        cat_queue_push_back(&buffers, &buffer->node);
+    }
+    writer->pending_length = 0;
+
+    start = cat_time_nsec();
+    buffer = cat_queue_front_data(&buffers, cat_fs_writer_buffer_t, node);
+    while (buffer != NULL) {
+        unsigned int count = 0;
+        size_t offset = 0;
+        ssize_t n;
+        cat_fs_writer_buffer_t *next = buffer;
+        do {
+            vector[count].base = next->value;
+            vector[count].length = (cat_io_vector_length_t) next->length;
+            count++;
+            next = cat_queue_next(&next->node) != &buffers ? cat_queue_data(cat_queue_next(&next->node), cat_fs_writer_buffer_t, node) : NULL;
+        } while (next != NULL && count < CAT_FS_WRITER_MAX_VECTOR_COUNT);
+        /* pwritev() may write less than requested */
+        while (count > 0) {
+            n = cat_fs_pwritev(writer->fd, vector, count, writer->offset);
+            if (unlikely(n <= 0)) {
+                if (n == 0) {
+                    cat_update_last_error(CAT_EIO, "File-System writer flush wrote nothing");
+                }
+                ret = cat_false;
+                break;
+            }
+            writer->offset += n;
+            offset += (size_t) n;
+            while (count > 0 && (size_t) n >= (size_t) vector[0].length) {
+                n -= vector[0].length;
+                memmove(&vector[0], &vector[1], sizeof(vector[0]) * --count);
+            }
+            if (count > 0) {
+                vector[0].base += n;
+                vector[0].length -= (cat_io_vector_length_t) n;
+            }
+        }
+        if (unlikely(!ret)) {
+            break;
+        }
+        buffer = next;
+    }
+    duration = cat_time_nsec() - start;
+
+    while ((buffer = cat_queue_front_data(&buffers, cat_fs_writer_buffer_t, node)) != NULL) {
+        cat_queue_remove(&buffer->node);
+        cat_free(buffer);
+    }
+    if (unlikely(!ret)) {
+        writer->error = cat_get_last_error_code();
+        return cat_false;
+    }
+    writer->flushed += length;
+    writer->stats.flush_count++;
+    writer->stats.flush_bytes += length;
+    writer->stats.flush_time += duration;
+    if (duration > writer->stats.max_flush_time) {
+        writer->stats.max_flush_time = duration;
+    }
+    cat_fs_writer_notify(&writer->flush_waiters, writer->flushed, cat_false);
+
+    return cat_true;
+}
+
+static cat_bool_t cat_fs_writer_sync_buffers(cat_fs_writer_t *writer)
+{
+    /* everything has been flushed so far would be durable after this sync */
+    uint64_t target = writer->flushed;
+    cat_nsec_t start, duration;
+
+    start = cat_time_nsec();
+    if (unlikely(cat_fs_fdatasync(writer->fd) != 0)) {
+        writer->error = cat_get_last_error_code();
+        return cat_false;
+    }
+    duration = cat_time_nsec() - start;
+    writer->synced = target;
+    writer->stats.sync_count++;
+    writer->stats.sync_time += duration;
+    if (duration > writer->stats.max_sync_time) {
+        writer->stats.max_sync_time = duration;
+    }
+    cat_fs_writer_notify(&writer->sync_waiters, target, cat_false);
+
+    return cat_true;
+}
+
+static cat_data_t *cat_fs_writer_flusher_function(cat_data_t *data)
+{
+    cat_fs_writer_t *writer = (cat_fs_writer_t *) data;
+
+    /* it lives as long as the writer, so it must not inherit the deadline of the creator */
+    (void) cat_time_set_deadline(0);
+
+    while (writer->error == 0) {
+        if (writer->pending_length == 0 && writer->sync_request <= writer->synced) {
+            if (writer->closing) {
+                break;
+            }
+            writer->flusher_waiting = cat_true;
+            (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+            writer->flusher_waiting = cat_false;
+            continue;
+        }
+        if (writer->pending_length > 0 && !cat_fs_writer_is_urgent(writer)) {
+            /* wait a moment to gather more data */
+            writer->flusher_waiting = cat_true;
+            (void) cat_time_wait(writer->options.flush_interval);
+            writer->flusher_waiting = cat_false;
+        }
+        if (writer->pending_length > 0 && !cat_fs_writer_flush_buffers(writer)) {
+            break;
+        }
+        /* do not wait for pending data which came after the request, or appenders would starve syncers */
+        if (writer->sync_request > writer->synced && writer->flushed >= writer->sync_request &&
+            !cat_fs_writer_sync_buffers(writer)) {
+            break;
+        }
+    }
+
+    if (unlikely(writer->error != 0)) {
+        CAT_LOG_DEBUG(FS, "Writer(" CAT_FS_FILE_FMT ") is broken (%s)", writer->fd, cat_strerror(writer->error));
+        /* nobody would be able to finish waiting */
+        cat_fs_writer_notify(&writer->flush_waiters, 0, cat_true);
+        cat_fs_writer_notify(&writer->sync_waiters, 0, cat_true);
+        while (!writer->closing) {
+            writer->flusher_waiting = cat_true;
+            (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+            writer->flusher_waiting = cat_false;
+        }
+    }
+    writer->flusher = NULL;
+    if (writer->closer != NULL) {
+        cat_coroutine_schedule(writer->closer, FS, "File-System writer closer");
+    }
+
+    return NULL;
+}
+
+CAT_API cat_fs_writer_t *cat_fs_writer_create(cat_file_t fd, const cat_fs_writer_options_t *options)
+{
+    cat_fs_writer_t *writer;
+    off_t offset;
+
+    offset = cat_fs_lseek(fd, 0, SEEK_END);
+    if (unlikely(offset < 0)) {
+        cat_update_last_error_with_previous("File-System writer get file size failed");
+        return NULL;
+    }
+    writer = (cat_fs_writer_t *) cat_malloc(sizeof(*writer));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(writer == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for fs writer failed");
+        return NULL;
+    }
+#endif
+    memset(writer, 0, sizeof(*writer));
+    if (options != NULL) {
+        writer->options = *options;
+    } else {
+        cat_fs_writer_options_init(&writer->options);
+    }
+    if (writer->options.buffer_size == 0) {
+        writer->options.buffer_size = CAT_FS_WRITER_DEFAULT_BUFFER_SIZE;
+    }
+    if (writer->options.max_buffer_size < writer->options.buffer_size) {
+        writer->options.max_buffer_size = writer->options.buffer_size;
+    }
+    writer->fd = fd;
+    writer->offset = offset;
+    cat_queue_init(&writer->buffers);
+    cat_queue_init(&writer->flush_waiters);
+    cat_queue_init(&writer->sync_waiters);
+    writer->error = 0;
+    writer->flusher = cat_coroutine_run(NULL, cat_fs_writer_flusher_function, writer);
+    if (unlikely(writer->flusher == NULL)) {
+        cat_update_last_error_with_previous("File-System writer create flusher failed");
+        cat_free(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+static cat_bool_t cat_fs_writer_check(const cat_fs_writer_t *writer, const char *operation)
+{
+    if (unlikely(writer->error != 0)) {
+        cat_update_last_error(writer->error, "File-System writer %s failed due to previous error (%s)", operation, cat_strerror(writer->error));
+        return cat_false;
+    }
+    if (unlikely(writer->closing)) {
+        cat_update_last_error(CAT_EBADF, "File-System writer %s failed due to writer is closing", operation);
+        return cat_false;
+    }
+
+    return cat_true;
+}
+
+static cat_bool_t cat_fs_writer_wait(cat_fs_writer_t *writer, cat_queue_t *waiters, uint64_t target, cat_timeout_t timeout, const char *operation)
+{
+    cat_fs_writer_waiter_t waiter;
+    cat_bool_t ret;
+
+    waiter.coroutine = NULL;
+    waiter.target = target;
+    waiter.done = cat_false;
+    cat_queue_push_back(waiters, &waiter.node);
+    /* flusher may be resumed and even be done immediately */
+    cat_fs_writer_wakeup_flusher(writer);
+    if (waiter.done) {
+        ret = cat_true;
+    } else {
+        waiter.coroutine = CAT_COROUTINE_G(current);
+        ret = cat_time_wait(timeout);
+        waiter.coroutine = NULL;
+    }
+    if (unlikely(!waiter.done)) {
+        cat_queue_remove(&waiter.node);
+        if (!ret) {
+            cat_update_last_error_with_previous("File-System writer %s wait failed", operation);
+        } else {
+            cat_update_last_error(CAT_ECANCELED, "File-System writer %s has been canceled", operation);
+        }
+        return cat_false;
+    }
+    if (unlikely(writer->error != 0)) {
+        cat_update_last_error(writer->error, "File-System writer %s failed (%s)", operation, cat_strerror(writer->error));
+        return cat_false;
+    }
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_fs_writer_write(cat_fs_writer_t *writer, const void *buffer, size_t length)
+{
+    cat_fs_writer_buffer_t *tail;
+    size_t size;
+
+    if (unlikely(!cat_fs_writer_check(writer, "write"))) {
+        return cat_false;
+    }
+    if (unlikely(length == 0)) {
+        return cat_true;
+    }
+    /* back pressure */
+    if (writer->pending_length > 0 && writer->pending_length + length > writer->options.max_buffer_size) {
+        if (unlikely(!cat_fs_writer_wait(writer, &writer->flush_waiters, writer->written, CAT_TIMEOUT_FOREVER, "write")) ||
+            unlikely(!cat_fs_writer_check(writer, "write"))) {
+            return cat_false;
+        }
+    }
+    tail = cat_queue_back_data(&writer->buffers, cat_fs_writer_buffer_t, node);
+    if (tail != NULL) {
+        size = CAT_MIN(tail->size - tail->length, length);
+        memcpy(tail->value + tail->length, buffer, size);
+        tail->length += size;
+        buffer = ((const char *) buffer) + size;
+    } else {
+        size = 0;
+    }
+    if (size < length) {
+        size_t rest = length - size;
+        size_t buffer_size = CAT_MAX(writer->options.buffer_size, rest);
+        tail = (cat_fs_writer_buffer_t *) cat_malloc(offsetof(cat_fs_writer_buffer_t, value) + buffer_size);
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(tail == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for fs writer buffer failed");
+            /* data is partially buffered, the stream is broken */
+            writer->error = CAT_ENOMEM;
+            return cat_false;
+        }
+#endif
+        memcpy(tail->value, buffer, rest);
+        tail->length = rest;
+        tail->size = buffer_size;
+        cat_queue_push_back(&writer->buffers, &tail->node);
+    }
+    writer->pending_length += length;
+    writer->written += length;
+    writer->stats.write_count++;
+    writer->stats.write_bytes += length;
+    /* flusher starts to count down the flush interval when data becomes pending */
+    if (writer->pending_length == length || writer->pending_length >= writer->options.buffer_size) {
+        cat_fs_writer_wakeup_flusher(writer);
+    }
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_fs_writer_flush(cat_fs_writer_t *writer, cat_timeout_t timeout)
+{
+    if (unlikely(!cat_fs_writer_check(writer, "flush"))) {
+        return cat_false;
+    }
+    if (writer->flushed >= writer->written) {
+        return cat_true;
+    }
+
+    return cat_fs_writer_wait(writer, &writer->flush_waiters, writer->written, timeout, "flush");
+}
+
+CAT_API cat_bool_t cat_fs_writer_sync(cat_fs_writer_t *writer, cat_timeout_t timeout)
+{
+    if (unlikely(!cat_fs_writer_check(writer, "sync"))) {
+        return cat_false;
+    }
+    writer->stats.sync_request_count++;
+    if (writer->synced >= writer->written) {
+        return cat_true;
+    }
+    /* requests which arrive during an in-flight sync are gathered, and served by the next one */
+    if (writer->written > writer->sync_request) {
+        writer->sync_request = writer->written;
+    }
+
+    return cat_fs_writer_wait(writer, &writer->sync_waiters, writer->written, timeout, "sync");
+}
+
+CAT_API void cat_fs_writer_get_stats(const cat_fs_writer_t *writer, cat_fs_writer_stats_t *stats)
+{
+    *stats = writer->stats;
+}
+
+CAT_API cat_bool_t cat_fs_writer_close(cat_fs_writer_t *writer)
+{
+    cat_fs_writer_buffer_t *buffer;
+    cat_bool_t ret;
+
+    writer->closing = cat_true;
+    cat_fs_writer_wakeup_flusher(writer);
+    if (writer->flusher != NULL) {
+        /* buffers must be flushed and released whatever the deadline is */
+        cat_msec_t deadline = cat_time_set_deadline(0);
+        writer->closer = CAT_COROUTINE_G(current);
+        while (writer->flusher != NULL) {
+            (void) cat_time_wait(CAT_TIMEOUT_FOREVER);
+        }
+        writer->closer = NULL;
+        (void) cat_time_set_deadline(deadline);
+    }
+    ret = writer->error == 0;
+    if (unlikely(!ret)) {
+        cat_update_last_error(writer->error, "File-System writer close failed (%s)", cat_strerror(writer->error));
+    }
+    /* pending data is dropped if writer is broken */
+    while ((buffer = cat_queue_front_data(&writer->buffers, cat_fs_writer_buffer_t, node)) != NULL) {
+        cat_queue_remove(&buffer->node);
+        cat_free(buffer);
+    }
+    cat_free(writer);
+
+    return ret;
+}
+
 CAT_API char *cat_fs_get_contents(const char *filename, size_t *length)
 {
     cat_file_t fd = cat_fs_open(filename, CAT_FS_OPEN_FLAG_RDONLY);
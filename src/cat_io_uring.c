@@ -0,0 +1,774 @@
+/*
+  +--------------------------------------------------------------------------+
+  | libcat                                                                   |
+  +--------------------------------------------------------------------------+
+  | Licensed under the Apache License, Version 2.0 (the "License");          |
+  | you may not use this file except in compliance with the License.         |
+  | You may obtain a copy of the License at                                  |
+  | http://www.apache.org/licenses/LICENSE-2.0                               |
+  | Unless required by applicable law or agreed to in writing, software      |
+  | distributed under the License is distributed on an "AS IS" BASIS,        |
+  | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. |
+  | See the License for the specific language governing permissions and      |
+  | limitations under the License. See accompanying LICENSE file.            |
+  +--------------------------------------------------------------------------+
+  | Author: Twosee <twosee@php.net>                                          |
+  +--------------------------------------------------------------------------+
+ */
+
+#include "cat_io_uring.h"
+
+#ifdef CAT_IO_URING
+
+#include "cat_coroutine.h"
+#include "cat_event.h"
+#include "cat_env.h"
+#include "cat_time.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* we do not depend on liburing, the ring is small enough to be managed by ourselves */
+
+typedef enum cat_io_uring_state_e {
+    CAT_IO_URING_STATE_NONE,
+    CAT_IO_URING_STATE_READY,
+    CAT_IO_URING_STATE_UNAVAILABLE,
+} cat_io_uring_state_t;
+
+typedef enum cat_io_uring_request_state_e {
+    /* waiting for being copied into SQ ring */
+    CAT_IO_URING_REQUEST_STATE_PENDING,
+    /* kernel owns it */
+    CAT_IO_URING_REQUEST_STATE_SUBMITTED,
+} cat_io_uring_request_state_t;
+
+typedef struct cat_io_uring_request_s {
+    cat_queue_node_t node;
+    /* it is NULL if request is done or nobody cares about it anymore */
+    cat_coroutine_t *coroutine;
+    cat_io_uring_request_state_t state;
+    int32_t result;
+    /* buffer which may be still referenced by kernel after request was canceled */
+    void *data;
+#ifdef CAT_IO_URING_RECV
+    /* destination of data in the selected provided buffer */
+    char *recv_buffer;
+#endif
+    struct io_uring_sqe sqe;
+} cat_io_uring_request_t;
+
+typedef struct cat_io_uring_ring_s {
+    int fd;
+    unsigned int features;
+    /* submission queue */
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    /* completion queue */
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+    /* mappings */
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    /* opcodes which are supported by kernel */
+    uint8_t supported[IORING_OP_LAST];
+} cat_io_uring_ring_t;
+
+#ifdef CAT_IO_URING_RECV
+/* provided buffer ring, kernel picks a buffer only when data has arrived,
+ * so that idle connections do not pin any memory and canceled recv never writes into user buffer */
+typedef struct cat_io_uring_buffer_ring_s {
+    cat_io_uring_state_t state;
+    struct io_uring_buf_ring *ring;
+    size_t ring_size;
+    char *buffers;
+    unsigned int mask;
+    uint16_t tail;
+} cat_io_uring_buffer_ring_t;
+#endif
+
+CAT_GLOBALS_STRUCT_BEGIN(cat_io_uring) {
+    cat_io_uring_state_t state;
+    cat_bool_t fs_enabled;
+#ifdef CAT_IO_URING_RECV
+    cat_bool_t socket_enabled;
+#endif
+    cat_io_uring_ring_t ring;
+#ifdef CAT_IO_URING_RECV
+    cat_io_uring_buffer_ring_t buffer_ring;
+#endif
+    uv_poll_t poller;
+    uv_prepare_t submitter;
+    cat_queue_t pending_requests;
+    size_t pending_count;
+    cat_queue_t free_requests;
+    size_t free_count;
+    cat_io_uring_stats_t stats;
+} CAT_GLOBALS_STRUCT_END(cat_io_uring);
+
+CAT_GLOBALS_DECLARE(cat_io_uring);
+
+#define CAT_IO_URING_G(x) CAT_GLOBALS_GET(cat_io_uring, x)
+
+#define CAT_IO_URING_MAX_FREE_REQUESTS 128
+
+#ifdef CAT_IO_URING_RECV
+#define CAT_IO_URING_BUFFER_GROUP_ID 0
+#endif
+
+static int cat_io_uring__setup(unsigned int entries, struct io_uring_params *params)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int cat_io_uring__enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int cat_io_uring__register(int fd, unsigned int opcode, void *arg, unsigned int nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void cat_io_uring_ring_close(cat_io_uring_ring_t *ring)
+{
+    if (ring->sqes != NULL) {
+        (void) munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) {
+        (void) munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL) {
+        (void) munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        (void) close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static void cat_io_uring_ring_probe(cat_io_uring_ring_t *ring)
+{
+    struct io_uring_probe *probe;
+    size_t size = sizeof(*probe) + sizeof(struct io_uring_probe_op) * 256;
+    unsigned int n;
+
+    memset(ring->supported, 0, sizeof(ring->supported));
+    probe = (struct io_uring_probe *) cat_malloc(size);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(probe == NULL)) {
+        return;
+    }
+#endif
+    memset(probe, 0, size);
+    if (cat_io_uring__register(ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        for (n = 0; n < probe->ops_len && n < IORING_OP_LAST; n++) {
+            if (probe->ops[n].flags & IO_URING_OP_SUPPORTED) {
+                ring->supported[n] = 1;
+            }
+        }
+    }
+    cat_free(probe);
+}
+
+static cat_bool_t cat_io_uring_ring_open(cat_io_uring_ring_t *ring, unsigned int entries)
+{
+    struct io_uring_params params;
+    int fd;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    memset(&params, 0, sizeof(params));
+    fd = cat_io_uring__setup(entries, &params);
+    if (unlikely(fd < 0)) {
+        cat_update_last_error_of_syscall("io_uring setup failed");
+        return cat_false;
+    }
+    ring->fd = fd;
+    ring->features = params.features;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (unlikely(ring->sq_ring == MAP_FAILED)) {
+        ring->sq_ring = NULL;
+        goto _mmap_error;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (unlikely(ring->cq_ring == MAP_FAILED)) {
+            ring->cq_ring = NULL;
+            goto _mmap_error;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (unlikely(ring->sqes == MAP_FAILED)) {
+        ring->sqes = NULL;
+        goto _mmap_error;
+    }
+    ring->sq_head = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = *(unsigned int *) ((char *) ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned int *) ((char *) ring->sq_ring + params.sq_off.ring_entries);
+    ring->sq_array = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned int *) ((char *) ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int *) ((char *) ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int *) ((char *) ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ring + params.cq_off.cqes);
+    cat_io_uring_ring_probe(ring);
+
+    return cat_true;
+
+    _mmap_error:
+    cat_update_last_error_of_syscall("io_uring mmap failed");
+    cat_io_uring_ring_close(ring);
+    return cat_false;
+}
+
+static cat_io_uring_request_t *cat_io_uring_request_alloc(void)
+{
+    cat_io_uring_request_t *request;
+
+    request = cat_queue_front_data(&CAT_IO_URING_G(free_requests), cat_io_uring_request_t, node);
+    if (request != NULL) {
+        cat_queue_remove(&request->node);
+        CAT_IO_URING_G(free_count)--;
+        return request;
+    }
+    request = (cat_io_uring_request_t *) cat_malloc(sizeof(*request));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(request == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for io_uring request failed");
+        return NULL;
+    }
+#endif
+
+    return request;
+}
+
+static void cat_io_uring_request_free(cat_io_uring_request_t *request)
+{
+    if (request->data != NULL) {
+        cat_free(request->data);
+        request->data = NULL;
+    }
+    if (CAT_IO_URING_G(free_count) < CAT_IO_URING_MAX_FREE_REQUESTS) {
+        cat_queue_push_back(&CAT_IO_URING_G(free_requests), &request->node);
+        CAT_IO_URING_G(free_count)++;
+    } else {
+        cat_free(request);
+    }
+}
+
+#ifdef CAT_IO_URING_RECV
+static cat_always_inline char *cat_io_uring_buffer_ring_get(uint16_t id)
+{
+    return CAT_IO_URING_G(buffer_ring).buffers + ((size_t) id * CAT_IO_URING_RECV_BUFFER_SIZE);
+}
+
+static void cat_io_uring_buffer_ring_recycle(uint16_t id)
+{
+    cat_io_uring_buffer_ring_t *buffer_ring = &CAT_IO_URING_G(buffer_ring);
+    struct io_uring_buf *buf = &buffer_ring->ring->bufs[buffer_ring->tail & buffer_ring->mask];
+
+    buf->addr = (uint64_t) (uintptr_t) cat_io_uring_buffer_ring_get(id);
+    buf->len = CAT_IO_URING_RECV_BUFFER_SIZE;
+    buf->bid = id;
+    buffer_ring->tail++;
+    __atomic_store_n(&buffer_ring->ring->tail, buffer_ring->tail, __ATOMIC_RELEASE);
+}
+
+static void cat_io_uring_buffer_ring_close(cat_io_uring_buffer_ring_t *buffer_ring)
+{
+    if (buffer_ring->ring != NULL) {
+        (void) munmap(buffer_ring->ring, buffer_ring->ring_size);
+    }
+    if (buffer_ring->buffers != NULL) {
+        (void) munmap(buffer_ring->buffers, (size_t) CAT_IO_URING_RECV_BUFFER_COUNT * CAT_IO_URING_RECV_BUFFER_SIZE);
+    }
+    memset(buffer_ring, 0, sizeof(*buffer_ring));
+}
+
+static cat_bool_t cat_io_uring_buffer_ring_setup(void)
+{
+    cat_io_uring_buffer_ring_t *buffer_ring = &CAT_IO_URING_G(buffer_ring);
+    struct io_uring_buf_reg reg;
+    uint16_t id;
+
+    buffer_ring->ring_size = CAT_IO_URING_RECV_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    buffer_ring->ring = (struct io_uring_buf_ring *) mmap(NULL, buffer_ring->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (unlikely(buffer_ring->ring == MAP_FAILED)) {
+        buffer_ring->ring = NULL;
+        goto _error;
+    }
+    buffer_ring->buffers = (char *) mmap(NULL, (size_t) CAT_IO_URING_RECV_BUFFER_COUNT * CAT_IO_URING_RECV_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (unlikely(buffer_ring->buffers == MAP_FAILED)) {
+        buffer_ring->buffers = NULL;
+        goto _error;
+    }
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) buffer_ring->ring;
+    reg.ring_entries = CAT_IO_URING_RECV_BUFFER_COUNT;
+    reg.bgid = CAT_IO_URING_BUFFER_GROUP_ID;
+    if (cat_io_uring__register(CAT_IO_URING_G(ring).fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        goto _error;
+    }
+    buffer_ring->mask = CAT_IO_URING_RECV_BUFFER_COUNT - 1;
+    buffer_ring->tail = 0;
+    for (id = 0; id < CAT_IO_URING_RECV_BUFFER_COUNT; id++) {
+        cat_io_uring_buffer_ring_recycle(id);
+    }
+    buffer_ring->state = CAT_IO_URING_STATE_READY;
+
+    return cat_true;
+
+    _error:
+    CAT_LOG_DEBUG(IO_URING, "io_uring provided buffer ring is unavailable, reason: %s", strerror(errno));
+    cat_io_uring_buffer_ring_close(buffer_ring);
+    buffer_ring->state = CAT_IO_URING_STATE_UNAVAILABLE;
+    return cat_false;
+}
+#endif
+
+static void cat_io_uring_reap(void)
+{
+    cat_io_uring_ring_t *ring = &CAT_IO_URING_G(ring);
+    unsigned int head = *ring->cq_head;
+
+    while (1) {
+        unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        cat_io_uring_request_t *request;
+        struct io_uring_cqe *cqe;
+        int32_t result;
+        if (head == tail) {
+            break;
+        }
+        cqe = &ring->cqes[head & ring->cq_mask];
+        request = (cat_io_uring_request_t *) (uintptr_t) cqe->user_data;
+        result = cqe->res;
+#ifdef CAT_IO_URING_RECV
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            uint16_t id = (uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (request->coroutine != NULL && result > 0) {
+                memcpy(request->recv_buffer, cat_io_uring_buffer_ring_get(id), (size_t) result);
+            }
+            cat_io_uring_buffer_ring_recycle(id);
+        }
+#endif
+        /* release the slot before we resume anyone */
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        CAT_IO_URING_G(stats.inflight_count)--;
+        CAT_IO_URING_G(stats.completed_count)++;
+        if (request->coroutine != NULL) {
+            cat_coroutine_t *coroutine = request->coroutine;
+            request->coroutine = NULL;
+            request->result = result;
+            cat_coroutine_wakeup(coroutine, IO_URING, "io_uring");
+            /* request is owned by coroutine now */
+        } else {
+            if (request->sqe.opcode == IORING_OP_OPENAT && result >= 0) {
+                /* nobody would take it */
+                (void) close(result);
+            }
+            cat_io_uring_request_free(request);
+        }
+        /* coroutine may have consumed some CQEs */
+        head = *ring->cq_head;
+    }
+    if (CAT_IO_URING_G(stats.inflight_count) == 0) {
+        (void) uv_poll_stop(&CAT_IO_URING_G(poller));
+    }
+}
+
+static void cat_io_uring_poll_callback(uv_poll_t *handle, int status, int events)
+{
+    (void) handle;
+    (void) status;
+    (void) events;
+    cat_io_uring_reap();
+}
+
+static void cat_io_uring_submitter_callback(uv_prepare_t *handle);
+
+/* copy pending requests into SQ ring and submit them all by one syscall */
+static void cat_io_uring_submit(void)
+{
+    cat_io_uring_ring_t *ring = &CAT_IO_URING_G(ring);
+    cat_io_uring_request_t *request;
+    unsigned int tail = *ring->sq_tail, count = 0;
+    int ret;
+
+    while ((request = cat_queue_front_data(&CAT_IO_URING_G(pending_requests), cat_io_uring_request_t, node)) != NULL) {
+        unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        unsigned int index;
+        if (tail - head >= ring->sq_entries) {
+            /* SQ ring is full, try again on the next iteration */
+            break;
+        }
+        index = tail & ring->sq_mask;
+        ring->sqes[index] = request->sqe;
+        ring->sq_array[index] = index;
+        tail++;
+        cat_queue_remove(&request->node);
+        CAT_IO_URING_G(pending_count)--;
+        request->state = CAT_IO_URING_REQUEST_STATE_SUBMITTED;
+        count++;
+    }
+    if (count == 0 && tail == __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    do {
+        /* SQEs left by the last failed enter (if any) are submitted together */
+        ret = cat_io_uring__enter(ring->fd, tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE), 0, 0);
+    } while (unlikely(ret < 0 && errno == EINTR));
+    CAT_IO_URING_G(stats.submit_call_count)++;
+    if (unlikely(ret < 0)) {
+        /* EAGAIN or EBUSY (CQ overflow), SQEs are still in the ring, we will try again on the next iteration */
+        CAT_LOG_DEBUG(IO_URING, "io_uring_enter() failed, reason: %s", strerror(errno));
+        (void) uv_prepare_start(&CAT_IO_URING_G(submitter), cat_io_uring_submitter_callback);
+    }
+    CAT_IO_URING_G(stats.submitted_count) += count;
+    CAT_IO_URING_G(stats.inflight_count) += count;
+    if (!uv_is_active((uv_handle_t *) &CAT_IO_URING_G(poller))) {
+        (void) uv_poll_start(&CAT_IO_URING_G(poller), UV_READABLE, cat_io_uring_poll_callback);
+    }
+}
+
+static void cat_io_uring_submitter_callback(uv_prepare_t *handle)
+{
+    cat_io_uring_ring_t *ring = &CAT_IO_URING_G(ring);
+
+    cat_io_uring_submit();
+    if (CAT_IO_URING_G(pending_count) == 0 &&
+        *ring->sq_tail == __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)) {
+        (void) uv_prepare_stop(handle);
+    }
+}
+
+static cat_bool_t cat_io_uring_setup(void)
+{
+    cat_io_uring_ring_t *ring = &CAT_IO_URING_G(ring);
+
+    if (!cat_env_is_true("CAT_IO_URING", cat_true)) {
+        CAT_IO_URING_G(state) = CAT_IO_URING_STATE_UNAVAILABLE;
+        return cat_false;
+    }
+    if (!cat_io_uring_ring_open(ring, CAT_IO_URING_DEFAULT_ENTRIES)) {
+        CAT_LOG_DEBUG(IO_URING, "io_uring is unavailable, reason: %s", cat_get_last_error_message());
+        CAT_IO_URING_G(state) = CAT_IO_URING_STATE_UNAVAILABLE;
+        return cat_false;
+    }
+    (void) uv_poll_init(&CAT_EVENT_G(loop), &CAT_IO_URING_G(poller), ring->fd);
+    (void) uv_prepare_init(&CAT_EVENT_G(loop), &CAT_IO_URING_G(submitter));
+    /* they should not keep loop alive by themselves when there is no request */
+    CAT_IO_URING_G(state) = CAT_IO_URING_STATE_READY;
+
+    return cat_true;
+}
+
+static cat_always_inline cat_bool_t cat_io_uring_ready(void)
+{
+    if (likely(CAT_IO_URING_G(state) == CAT_IO_URING_STATE_READY)) {
+        return cat_true;
+    }
+    if (CAT_IO_URING_G(state) == CAT_IO_URING_STATE_UNAVAILABLE) {
+        return cat_false;
+    }
+    CAT_PROTECT_LAST_ERROR_START() {
+        (void) cat_io_uring_setup();
+    } CAT_PROTECT_LAST_ERROR_END();
+
+    return CAT_IO_URING_G(state) == CAT_IO_URING_STATE_READY;
+}
+
+CAT_API cat_bool_t cat_io_uring_is_available(void)
+{
+    return cat_io_uring_ready();
+}
+
+CAT_API cat_bool_t cat_io_uring_is_supported(uint8_t opcode)
+{
+    if (!cat_io_uring_ready() || opcode >= IORING_OP_LAST) {
+        return cat_false;
+    }
+    if (opcode == IORING_OP_READ || opcode == IORING_OP_WRITE) {
+        /* offset -1 (current position) is required by read()/write() */
+        if (!(CAT_IO_URING_G(ring).features & IORING_FEAT_RW_CUR_POS)) {
+            return cat_false;
+        }
+    }
+
+    return CAT_IO_URING_G(ring).supported[opcode];
+}
+
+CAT_API cat_bool_t cat_io_uring_enable_fs(cat_bool_t enable)
+{
+    cat_bool_t previous = CAT_IO_URING_G(fs_enabled);
+
+    CAT_IO_URING_G(fs_enabled) = enable;
+
+    return previous;
+}
+
+CAT_API cat_bool_t cat_io_uring_is_fs_enabled(void)
+{
+    return CAT_IO_URING_G(fs_enabled);
+}
+
+#ifdef CAT_IO_URING_RECV
+CAT_API cat_bool_t cat_io_uring_enable_socket(cat_bool_t enable)
+{
+    cat_bool_t previous = CAT_IO_URING_G(socket_enabled);
+
+    CAT_IO_URING_G(socket_enabled) = enable;
+
+    return previous;
+}
+
+CAT_API cat_bool_t cat_io_uring_is_socket_enabled(void)
+{
+    return CAT_IO_URING_G(socket_enabled);
+}
+#endif
+
+static void cat_io_uring_queue(cat_io_uring_request_t *request)
+{
+    request->state = CAT_IO_URING_REQUEST_STATE_PENDING;
+    cat_queue_push_back(&CAT_IO_URING_G(pending_requests), &request->node);
+    if (CAT_IO_URING_G(pending_count)++ == 0) {
+        (void) uv_prepare_start(&CAT_IO_URING_G(submitter), cat_io_uring_submitter_callback);
+    }
+}
+
+static void cat_io_uring_cancel(cat_io_uring_request_t *request)
+{
+    cat_io_uring_request_t *cancel_request;
+
+    CAT_IO_URING_G(stats.canceled_count)++;
+    if (request->state == CAT_IO_URING_REQUEST_STATE_PENDING) {
+        /* kernel does not know it yet, just drop it */
+        cat_queue_remove(&request->node);
+        CAT_IO_URING_G(pending_count)--;
+        cat_io_uring_request_free(request);
+        return;
+    }
+    /* the request will be released after its completion,
+     * but we try to cancel it ASAP (some operations e.g. regular file read can not be canceled) */
+    request->coroutine = NULL;
+    cancel_request = cat_io_uring_request_alloc();
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(cancel_request == NULL)) {
+        return;
+    }
+#endif
+    memset(&cancel_request->sqe, 0, sizeof(cancel_request->sqe));
+    cancel_request->sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    cancel_request->sqe.fd = -1;
+    cancel_request->sqe.addr = (uint64_t) (uintptr_t) request;
+    cancel_request->sqe.user_data = (uint64_t) (uintptr_t) cancel_request;
+    cancel_request->coroutine = NULL;
+    cancel_request->data = NULL;
+#ifdef CAT_IO_URING_RECV
+    cancel_request->recv_buffer = NULL;
+#endif
+    cat_io_uring_queue(cancel_request);
+}
+
+static cat_ret_t cat_io_uring_wait(cat_io_uring_request_t *request, int32_t *result, void *data, cat_timeout_t timeout)
+{
+    cat_bool_t ret;
+
+    request->sqe.user_data = (uint64_t) (uintptr_t) request;
+    request->coroutine = CAT_COROUTINE_G(current);
+    request->result = 0;
+    request->data = NULL;
+    cat_io_uring_queue(request);
+
+    ret = cat_time_wait(timeout);
+
+    if (unlikely(request->coroutine != NULL)) {
+        /* it is not completed */
+        if (ret) {
+            cat_update_last_error(CAT_ECANCELED, "io_uring operation has been canceled");
+        } else {
+            cat_update_last_error_with_previous("io_uring operation wait failed");
+        }
+        request->data = data;
+        cat_io_uring_cancel(request);
+        return CAT_RET_ERROR;
+    }
+    *result = request->result;
+    cat_io_uring_request_free(request);
+
+    return CAT_RET_OK;
+}
+
+CAT_API cat_ret_t cat_io_uring_execute(const struct io_uring_sqe *sqe, int32_t *result)
+{
+    return cat_io_uring_execute_ex(sqe, result, NULL, CAT_TIMEOUT_FOREVER);
+}
+
+CAT_API cat_ret_t cat_io_uring_execute_ex(const struct io_uring_sqe *sqe, int32_t *result, void *data, cat_timeout_t timeout)
+{
+    cat_io_uring_request_t *request;
+
+    if (unlikely(!cat_io_uring_is_supported(sqe->opcode))) {
+        return CAT_RET_NONE;
+    }
+    request = cat_io_uring_request_alloc();
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(request == NULL)) {
+        return CAT_RET_ERROR;
+    }
+#endif
+    request->sqe = *sqe;
+#ifdef CAT_IO_URING_RECV
+    request->recv_buffer = NULL;
+#endif
+
+    return cat_io_uring_wait(request, result, data, timeout);
+}
+
+#ifdef CAT_IO_URING_RECV
+CAT_API cat_ret_t cat_io_uring_recv(int fd, char *buffer, size_t size, int32_t *result, cat_timeout_t timeout)
+{
+    cat_io_uring_request_t *request;
+    cat_ret_t ret;
+
+    if (unlikely(!cat_io_uring_is_supported(IORING_OP_RECV))) {
+        return CAT_RET_NONE;
+    }
+    if (unlikely(CAT_IO_URING_G(buffer_ring).state != CAT_IO_URING_STATE_READY)) {
+        if (CAT_IO_URING_G(buffer_ring).state == CAT_IO_URING_STATE_UNAVAILABLE ||
+            !cat_io_uring_buffer_ring_setup()) {
+            return CAT_RET_NONE;
+        }
+    }
+    request = cat_io_uring_request_alloc();
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(request == NULL)) {
+        return CAT_RET_ERROR;
+    }
+#endif
+    memset(&request->sqe, 0, sizeof(request->sqe));
+    request->sqe.opcode = IORING_OP_RECV;
+    request->sqe.fd = fd;
+    request->sqe.len = (uint32_t) CAT_MIN(size, CAT_IO_URING_RECV_BUFFER_SIZE);
+    request->sqe.flags = IOSQE_BUFFER_SELECT;
+    request->sqe.buf_group = CAT_IO_URING_BUFFER_GROUP_ID;
+    /* caller has already known that there is no data (EAGAIN) */
+    request->sqe.ioprio = IORING_RECVSEND_POLL_FIRST;
+    request->recv_buffer = buffer;
+
+    ret = cat_io_uring_wait(request, result, NULL, timeout);
+    if (ret == CAT_RET_OK && unlikely(*result == -ENOBUFS)) {
+        /* all buffers are in use, caller should fallback */
+        return CAT_RET_NONE;
+    }
+
+    return ret;
+}
+#endif
+
+CAT_API const cat_io_uring_stats_t *cat_io_uring_get_stats(void)
+{
+    return &CAT_IO_URING_G(stats);
+}
+
+CAT_API cat_bool_t cat_io_uring_module_init(void)
+{
+    CAT_GLOBALS_REGISTER(cat_io_uring);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_io_uring_module_shutdown(void)
+{
+    CAT_GLOBALS_UNREGISTER(cat_io_uring);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_io_uring_runtime_init(void)
+{
+    CAT_IO_URING_G(state) = CAT_IO_URING_STATE_NONE;
+    CAT_IO_URING_G(fs_enabled) = cat_env_is_true("CAT_FS_IO_URING", cat_false);
+#ifdef CAT_IO_URING_RECV
+    CAT_IO_URING_G(socket_enabled) = cat_env_is_true("CAT_SOCKET_IO_URING", cat_false);
+    memset(&CAT_IO_URING_G(buffer_ring), 0, sizeof(CAT_IO_URING_G(buffer_ring)));
+#endif
+    memset(&CAT_IO_URING_G(ring), 0, sizeof(CAT_IO_URING_G(ring)));
+    CAT_IO_URING_G(ring).fd = -1;
+    cat_queue_init(&CAT_IO_URING_G(pending_requests));
+    CAT_IO_URING_G(pending_count) = 0;
+    cat_queue_init(&CAT_IO_URING_G(free_requests));
+    CAT_IO_URING_G(free_count) = 0;
+    memset(&CAT_IO_URING_G(stats), 0, sizeof(CAT_IO_URING_G(stats)));
+
+    return cat_true;
+}
+
+/* canceled requests are orphans, kernel may still write into their data even after the ring was closed,
+ * so we wait for all of them to be completed and released */
+static void cat_io_uring_drain(void)
+{
+    cat_io_uring_ring_t *ring = &CAT_IO_URING_G(ring);
+    int ret;
+
+    cat_io_uring_submit();
+    while (CAT_IO_URING_G(stats.inflight_count) > 0) {
+        ret = cat_io_uring__enter(ring->fd, *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE), 1, IORING_ENTER_GETEVENTS);
+        if (unlikely(ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)) {
+            /* leak them rather than free the memory which kernel may write */
+            CAT_LOG_DEBUG(IO_URING, "io_uring_enter() failed on drain, reason: %s", strerror(errno));
+            break;
+        }
+        cat_io_uring_reap();
+    }
+}
+
+CAT_API cat_bool_t cat_io_uring_runtime_shutdown(void)
+{
+    cat_io_uring_request_t *request;
+
+    if (CAT_IO_URING_G(state) == CAT_IO_URING_STATE_READY) {
+        cat_io_uring_drain();
+        uv_close((uv_handle_t *) &CAT_IO_URING_G(poller), NULL);
+        uv_close((uv_handle_t *) &CAT_IO_URING_G(submitter), NULL);
+        cat_io_uring_ring_close(&CAT_IO_URING_G(ring));
+#ifdef CAT_IO_URING_RECV
+        cat_io_uring_buffer_ring_close(&CAT_IO_URING_G(buffer_ring));
+#endif
+    }
+    CAT_IO_URING_G(state) = CAT_IO_URING_STATE_NONE;
+    while ((request = cat_queue_front_data(&CAT_IO_URING_G(free_requests), cat_io_uring_request_t, node)) != NULL) {
+        cat_queue_remove(&request->node);
+        cat_free(request);
+    }
+    CAT_IO_URING_G(free_count) = 0;
+
+    return cat_true;
+}
+
+#endif /* CAT_IO_URING */
@@ -22,7 +22,7 @@
 #include "cat_event.h"
 #include "cat_time.h"
 
-#include "cat_ref.h"
+#include "uv/tree.h"
 
 #ifdef CAT_ENABLE_DEBUG_LOG
 #include "cat_buffer.h"
@@ -35,6 +35,7 @@
 #  else
 #    include "../deps/libuv/src/unix/internal.h"
 #  endif
+#  include <sys/stat.h>
 #endif
 
 #define UV_EVENT_MAP(XX) \
@@ -169,69 +170,297 @@ static CAT_BUFFER_STR_FREE char *cat_pollfd_events_str(cat_pollfd_events_t event
 }
 #endif
 
-/* TODO: Optimize dup() in poll() (can not find a better way temporarily) */
+/* watcher registry:
+ * one uv_poll_t per fd is shared by all of pollers of the fd,
+ * its interest mask is the union of events of waiters and it is
+ * only restarted when the mask changes.
+ * unwatched watchers are closed when the last waiter leaves,
+ * fd may be closed by user at any time after poll returns and its number may be reused,
+ * closing a handle of the stale fd would remove the new one from epoll (uv__platform_invalidate_fd()).
+ * watched watchers (see cat_poll_watch()) keep their epoll registrations
+ * alive across calls, because the owner guarantees that fd is alive. */
 
-typedef struct cat_poll_one_s {
+typedef struct cat_poll_context_s {
+    cat_coroutine_t *coroutine;
+    cat_event_io_defer_task_t *done_task;
+} cat_poll_context_t;
+
+typedef struct cat_poll_waiter_s {
+    cat_queue_node_t node;
+    cat_poll_context_t *context;
+    struct cat_poll_watcher_s *watcher;
+    uv_events_t events; // interested uv events
+    struct {
+        int status; // uv status
+        uv_events_t events; // uv events, e.g UV_EVENT_READABLE, UV_EVENT_WRITABLE...
+    } ret;
+} cat_poll_waiter_t;
+
+typedef struct cat_poll_watcher_s {
+    RB_ENTRY(cat_poll_watcher_s) tree_entry;
+    cat_os_socket_t fd;
+    /* current interest mask, NONE means handle is stopped */
+    uv_events_t events;
+    size_t watch_count;
+    size_t waiter_count;
+    cat_queue_t waiters;
+#ifdef CAT_OS_UNIX_LIKE
+    cat_os_fd_t fd_dup;
+#endif
     union {
-        cat_coroutine_t *coroutine;
         uv_handle_t handle;
         uv_poll_t poll;
     } u;
-#ifdef CAT_ENABLE_DEBUG_LOG
-    cat_os_socket_t fd;
+} cat_poll_watcher_t;
+
+RB_HEAD(cat_poll_watcher_tree_s, cat_poll_watcher_s);
+
+CAT_GLOBALS_STRUCT_BEGIN(cat_poll) {
+    struct cat_poll_watcher_tree_s watcher_tree;
+    cat_poll_stats_t stats;
+} CAT_GLOBALS_STRUCT_END(cat_poll);
+
+CAT_GLOBALS_DECLARE(cat_poll);
+
+#define CAT_POLL_G(x) CAT_GLOBALS_GET(cat_poll, x)
+
+static int cat_poll_watcher_compare(cat_poll_watcher_t *w1, cat_poll_watcher_t *w2)
+{
+    if (w1->fd < w2->fd) {
+        return -1;
+    }
+    if (w1->fd > w2->fd) {
+        return 1;
+    }
+    return 0;
+}
+
+RB_GENERATE_STATIC(cat_poll_watcher_tree_s,
+                   cat_poll_watcher_s, tree_entry,
+                   cat_poll_watcher_compare);
+
+static cat_always_inline cat_poll_watcher_t *cat_poll_watcher_find(cat_os_socket_t fd)
+{
+    cat_poll_watcher_t lookup;
+    lookup.fd = fd;
+    return RB_FIND(cat_poll_watcher_tree_s, &CAT_POLL_G(watcher_tree), &lookup);
+}
+
+static void cat_poll_watcher_close_callback(uv_handle_t *handle)
+{
+    cat_poll_watcher_t *watcher = cat_container_of(handle, cat_poll_watcher_t, u.handle);
+
+#ifdef CAT_OS_UNIX_LIKE
+    if (watcher->fd_dup != CAT_OS_INVALID_FD) {
+        uv__close(watcher->fd_dup);
+    }
 #endif
-    struct {
-        int status; // uv status
-        uv_events_t events; // uv events, e.g UV_EVENT_READABLE, UV_EVENT_WRITABLE...
-    } ret;
-    cat_event_io_defer_task_t *done_task;
-} cat_poll_one_t;
+    cat_free(watcher);
+}
+
+static void cat_poll_watcher_close(cat_poll_watcher_t *watcher)
+{
+    CAT_ASSERT(watcher->waiter_count == 0);
+    RB_REMOVE(cat_poll_watcher_tree_s, &CAT_POLL_G(watcher_tree), watcher);
+    CAT_POLL_G(stats).watcher_count--;
+    uv_close(&watcher->u.handle, cat_poll_watcher_close_callback);
+}
 
-static void cat_poll_one_close_callback(uv_handle_t *handle)
+static void cat_poll_watcher_callback(uv_poll_t *handle, int status, uv_events_t events);
+
+static int cat_poll_watcher_update(cat_poll_watcher_t *watcher, uv_events_t events)
 {
-    cat_poll_one_t *poll = cat_container_of(handle, cat_poll_one_t, u.handle);
-    /** @see poll_free_callback() comments.  */
-    cat_free(poll);
+    int error;
+
+    if (events == watcher->events) {
+        return 0;
+    }
+    CAT_POLL_G(stats).watcher_update_count++;
+    if (events == UV_EVENT_NONE) {
+        (void) uv_poll_stop(&watcher->u.poll);
+        watcher->events = UV_EVENT_NONE;
+        return 0;
+    }
+    error = uv_poll_start(&watcher->u.poll, events, cat_poll_watcher_callback);
+    if (unlikely(error != 0)) {
+        /* handle may have been stopped */
+        (void) uv_poll_stop(&watcher->u.poll);
+        watcher->events = UV_EVENT_NONE;
+        return error;
+    }
+    watcher->events = events;
+
+    return 0;
 }
 
-static void cat_poll_one_done_callback(cat_event_io_defer_task_t *task, cat_data_t *data)
+static cat_poll_watcher_t *cat_poll_watcher_create(cat_os_socket_t fd, int *error)
 {
-    cat_poll_one_t *poll = (cat_poll_one_t *) data;
+    cat_poll_watcher_t *watcher;
+    cat_os_socket_t fd_no = fd;
+
+    watcher = (cat_poll_watcher_t *) cat_malloc(sizeof(*watcher));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(watcher == NULL)) {
+        *error = cat_translate_sys_error(cat_sys_errno);
+        return NULL;
+    }
+#endif
+#ifdef CAT_OS_UNIX_LIKE
+    watcher->fd_dup = CAT_OS_INVALID_FD;
+    if (unlikely(uv__fd_exists(&CAT_EVENT_G(loop), fd))) {
+        /* uv_poll_init_socket() and uv_poll_start() will return error if fd exists */
+        watcher->fd_dup = dup(fd);
+        if (unlikely(watcher->fd_dup == CAT_OS_INVALID_FD)) {
+            *error = cat_translate_sys_error(cat_sys_errno);
+            cat_free(watcher);
+            return NULL;
+        }
+        fd_no = watcher->fd_dup;
+    }
+#endif
+    *error = uv_poll_init_socket(&CAT_EVENT_G(loop), &watcher->u.poll, fd_no);
+    if (unlikely(*error != 0)) {
+#ifdef CAT_OS_UNIX_LIKE
+        if (watcher->fd_dup != CAT_OS_INVALID_FD) {
+            uv__close(watcher->fd_dup);
+        }
+#endif
+        cat_free(watcher);
+        return NULL;
+    }
+    watcher->fd = fd;
+    watcher->events = UV_EVENT_NONE;
+    watcher->watch_count = 0;
+    watcher->waiter_count = 0;
+    cat_queue_init(&watcher->waiters);
+    RB_INSERT(cat_poll_watcher_tree_s, &CAT_POLL_G(watcher_tree), watcher);
+    CAT_POLL_G(stats).watcher_count++;
+    CAT_POLL_G(stats).watcher_create_count++;
+
+    return watcher;
+}
+
+/* find or create the watcher of fd */
+static cat_poll_watcher_t *cat_poll_watcher_get(cat_os_socket_t fd, int *error)
+{
+    cat_poll_watcher_t *watcher = cat_poll_watcher_find(fd);
+
+    if (watcher != NULL) {
+        return watcher;
+    }
+
+    return cat_poll_watcher_create(fd, error);
+}
+
+/* it should be called when a waiter or a watch reference has gone */
+static void cat_poll_watcher_release(cat_poll_watcher_t *watcher)
+{
+    if (watcher->waiter_count > 0 || watcher->watch_count > 0) {
+        return;
+    }
+    /* fd is still alive here, but nobody guarantees it after poll returns */
+    (void) cat_poll_watcher_update(watcher, UV_EVENT_NONE);
+    cat_poll_watcher_close(watcher);
+}
+
+static void cat_poll_done_callback(cat_event_io_defer_task_t *task, cat_data_t *data)
+{
+    cat_poll_context_t *context = (cat_poll_context_t *) data;
 
     /** @note: we can recognize cancel operation via
-     * close task and set task to NULL, but  it's not necessary. */
+     * event_io_defer_task_close(context->done_task) + context->done_task = NULL,
+     * but it is not necessary. */
     (void) task;
     /** @note coroutine maybe force resumed when poll_callback() was called
-     * but poll_done_callback() has not been called, before, we have to check
-     * whether it exists here, but now we are using event_defer_task_close()
+     * but poll_done_callback() has not been called, so we have to check
+     * if it is done here before, but now we are using event_io_defer_task_close()
      * to cancel this callback, so schedule is always safe. */
-    cat_coroutine_schedule(poll->u.coroutine, EVENT, "Poll one");
+    cat_coroutine_wakeup(context->coroutine, EVENT, "Poll");
 }
 
-static void cat_poll_one_callback(uv_poll_t* handle, int status, uv_events_t events)
+static void cat_poll_watcher_callback(uv_poll_t *handle, int status, uv_events_t events)
 {
-    cat_poll_one_t *poll = (cat_poll_one_t *) handle;
+    cat_poll_watcher_t *watcher = cat_container_of(handle, cat_poll_watcher_t, u.poll);
+    uv_events_t interest = UV_EVENT_NONE;
 
     CAT_LOG_DEBUG_VA_WITH_LEVEL(POLL, 2, {
         char *events_str = cat_poll_uv_events_str(events);
-        CAT_LOG_DEBUG_D(POLL, "poll_one_callback(fd: " CAT_OS_SOCKET_FMT ", status: %d" CAT_LOG_STRERRNO_FMT ", events: %s)",
-            poll->fd, status, CAT_LOG_STRERRNO_C(status == 0, status), events_str);
+        CAT_LOG_DEBUG_D(POLL, "poll_callback(fd: " CAT_OS_SOCKET_FMT ", status: %d" CAT_LOG_STRERRNO_FMT ", events: %s, waiters: %zu)",
+            watcher->fd, status, CAT_LOG_STRERRNO_C(status == 0, status), events_str, watcher->waiter_count);
         cat_buffer_str_free(events_str);
     });
 
-    poll->ret.status = status;
-    /* Note: uv may return multi events in multi callbacks */
-    poll->ret.events |= events;
+    if (unlikely(status < 0)) {
+        /* libuv has stopped the handle */
+        watcher->events = UV_EVENT_NONE;
+    }
+
+    CAT_QUEUE_FOREACH_DATA_START(&watcher->waiters, cat_poll_waiter_t, node, waiter) {
+        uv_events_t waiter_events = events & waiter->events;
+        interest |= waiter->events;
+        if (status < 0 || waiter_events != UV_EVENT_NONE) {
+            cat_poll_context_t *context = waiter->context;
+            waiter->ret.status = status;
+            /* Note: uv may return multi events in multi callbacks */
+            waiter->ret.events |= waiter_events;
+            /* Note: for get all revents of all pollfd at once,
+             * we should schedule coroutine in io defer callback,
+             * and callback may be called multiple times,
+             * so we must check whether defer task has been registered here. */
+            if (context->done_task == NULL) {
+                context->done_task = cat_event_io_defer_task_create(cat_poll_done_callback, context);
+            }
+        }
+    } CAT_QUEUE_FOREACH_DATA_END();
 
-    /* Note: for get all revents at once,
-     * we should schedule coroutine in io defer callback,
-     * and callback may be called multiple times,
-     * so we must check whether defer task has been registered here. */
-    if (poll->done_task == NULL) {
-        poll->done_task = cat_event_io_defer_task_create(cat_poll_one_done_callback, poll);
+    if (status == 0 && (events & ~interest) != UV_EVENT_NONE) {
+        /* nobody is waiting for them (e.g. watched fd without waiters),
+         * narrow down the mask, otherwise level-triggered events would keep firing */
+        (void) cat_poll_watcher_update(watcher, interest);
     }
 }
 
+static cat_always_inline void cat_poll_waiter_init(cat_poll_waiter_t *waiter, cat_poll_context_t *context, cat_pollfd_events_t events)
+{
+    waiter->context = context;
+    waiter->watcher = NULL;
+    waiter->events = cat_poll_translate_sys_events_to_uv_events(events);
+    waiter->ret.status = CAT_ECANCELED;
+    waiter->ret.events = UV_EVENT_NONE;
+}
+
+static int cat_poll_watcher_add_waiter(cat_poll_watcher_t *watcher, cat_poll_waiter_t *waiter)
+{
+    uv_events_t events = waiter->events;
+    int error;
+
+    /* mask of a watched watcher without waiters may be outdated */
+    if (watcher->waiter_count > 0) {
+        events |= watcher->events;
+    }
+    error = cat_poll_watcher_update(watcher, events);
+    if (unlikely(error != 0)) {
+        cat_poll_watcher_release(watcher);
+        return error;
+    }
+    cat_queue_push_back(&watcher->waiters, &waiter->node);
+    watcher->waiter_count++;
+    waiter->watcher = watcher;
+
+    return 0;
+}
+
+static void cat_poll_watcher_remove_waiter(cat_poll_waiter_t *waiter)
+{
+    cat_poll_watcher_t *watcher = waiter->watcher;
+
+    cat_queue_remove(&waiter->node);
+    watcher->waiter_count--;
+    waiter->watcher = NULL;
+    /* mask of remaining waiters will be narrowed down lazily in callback */
+    cat_poll_watcher_release(watcher);
+}
+
 #define CAT_POLL_ONE_EMULATE(fd, events, revents) do { \
     if (cat_poll_one_emulate != NULL) { \
         cat_ret_t ret = cat_poll_one_emulate(fd, events, revents); \
@@ -247,89 +476,60 @@ static cat_ret_t cat_poll_one_impl(cat_os_socket_t fd, cat_pollfd_events_t event
 {
     CAT_POLL_ONE_EMULATE(fd, events, revents);
     CAT_POLL_CHECK_TIMEOUT(timeout);
-    cat_poll_one_t *poll;
-    cat_os_socket_t _fd = fd;
+    cat_poll_context_t context;
+    cat_poll_waiter_t waiter;
+    cat_poll_watcher_t *watcher;
     cat_ret_t ret;
     int error;
 
     *revents = POLLNONE;
 
-    poll = (cat_poll_one_t *) cat_malloc(sizeof(*poll));
-#if CAT_ALLOC_HANDLE_ERRORS
-    if (unlikely(poll == NULL)) {
-        cat_update_last_error_of_syscall("Malloc for poll failed");
-        return CAT_RET_ERROR;
-    }
-#endif
-#ifdef CAT_OS_UNIX_LIKE
-    if (unlikely(uv__fd_exists(&CAT_EVENT_G(loop), fd))) {
-        _fd = dup(fd);
-        if (unlikely(_fd == CAT_OS_INVALID_SOCKET)) {
-            cat_update_last_error_of_syscall("Dup for poll_one() failed");
-            cat_free(poll);
-            return CAT_RET_ERROR;
-        }
-        /* uv_poll_init_socket() and uv_poll_start() must return success if fd exists */
-    }
-#endif
-    error = uv_poll_init_socket(&CAT_EVENT_G(loop), &poll->u.poll, _fd);
-    if (unlikely(error != 0)) {
+    watcher = cat_poll_watcher_get(fd, &error);
+    if (unlikely(watcher == NULL)) {
         cat_update_last_error_with_reason(error, "Poll init failed");
-        cat_free(poll);
         *revents = cat_poll_translate_error_to_sys_events(events, cat_poll_filter_init_error(error));
         return CAT_RET_ERROR;
     }
-    error = uv_poll_start(&poll->u.poll, cat_poll_translate_sys_events_to_uv_events(events), cat_poll_one_callback);
+    context.coroutine = CAT_COROUTINE_G(current);
+    context.done_task = NULL;
+    cat_poll_waiter_init(&waiter, &context, events);
+    error = cat_poll_watcher_add_waiter(watcher, &waiter);
     if (unlikely(error != 0)) {
         cat_update_last_error_with_reason(error, "Poll start failed");
-        uv_close(&poll->u.handle, cat_poll_one_close_callback);
         *revents = cat_poll_translate_error_to_sys_events(events, error);
         return CAT_RET_ERROR;
     }
-#ifdef CAT_ENABLE_DEBUG_LOG
-    poll->fd = fd;
-#endif
-    poll->ret.status = CAT_ECANCELED;
-    poll->ret.events = UV_EVENT_NONE;
-    poll->u.coroutine = CAT_COROUTINE_G(current);
-    poll->done_task = NULL;
 
     ret = cat_time_delay(timeout);
 
-    if (poll->done_task != NULL) {
-        cat_event_io_defer_task_close(poll->done_task);
+    if (context.done_task != NULL) {
+        cat_event_io_defer_task_close(context.done_task);
     }
-
-    uv_close(&poll->u.handle, cat_poll_one_close_callback);
-#ifdef CAT_OS_UNIX_LIKE
-    if (_fd != fd) {
-        uv__close(_fd);
-    }
-#endif
+    cat_poll_watcher_remove_waiter(&waiter);
 
     switch (ret) {
         /* delay canceled */
         case CAT_RET_NONE: {
-            if (unlikely(poll->ret.status < 0)) {
-                if (poll->ret.status == CAT_ECANCELED) {
+            if (unlikely(waiter.ret.status < 0)) {
+                if (waiter.ret.status == CAT_ECANCELED) {
                     cat_update_last_error(CAT_ECANCELED, "Poll has been canceled");
                     ret = CAT_RET_ERROR;
                 }
 #ifndef CAT_OS_WIN
-                else if (poll->ret.status == CAT_EBADF) {
+                else if (waiter.ret.status == CAT_EBADF) {
                     /* see: https://github.com/libuv/libuv/pull/1040#discussion_r80087447 */
                     *revents = POLLERR;
                     ret = CAT_RET_OK;
                 }
 #endif
                 else {
-                    cat_update_last_error_with_reason(poll->ret.status, "Poll failed");
-                    *revents = cat_poll_translate_error_to_sys_events(events, poll->ret.status);
+                    cat_update_last_error_with_reason(waiter.ret.status, "Poll failed");
+                    *revents = cat_poll_translate_error_to_sys_events(events, waiter.ret.status);
                     ret = CAT_RET_ERROR;
                 }
             } else {
                 ret = CAT_RET_OK;
-                *revents = cat_poll_translate_uv_events_to_sys_events(poll->ret.events);
+                *revents = cat_poll_translate_uv_events_to_sys_events(waiter.ret.events);
             }
             break;
         }
@@ -362,7 +562,13 @@ CAT_API cat_ret_t cat_poll_one(cat_os_socket_t fd, cat_pollfd_events_t events, c
         cat_buffer_str_free(events_str);
     });
 
-    cat_ret_t ret = cat_poll_one_impl(fd, events, revents, timeout);
+    cat_timeout_t clamped_timeout = cat_time_clamp_timeout(timeout);
+    cat_ret_t ret = cat_poll_one_impl(fd, events, revents, clamped_timeout);
+
+    if (unlikely(ret == CAT_RET_NONE && clamped_timeout != timeout)) {
+        cat_update_last_error(CAT_ETIMEDOUT, "Poll deadline exceeded");
+        ret = CAT_RET_ERROR;
+    }
 
     CAT_LOG_DEBUG_VA(POLL, {
         char *events_str = cat_pollfd_events_str(events);
@@ -376,86 +582,6 @@ CAT_API cat_ret_t cat_poll_one(cat_os_socket_t fd, cat_pollfd_events_t events, c
     return ret;
 }
 
-typedef struct cat_poll_context_s {
-    CAT_REF_FIELD;
-    cat_coroutine_t *coroutine;
-    cat_event_io_defer_task_t *done_task;
-} cat_poll_context_t;
-
-typedef struct {
-    union {
-        cat_poll_context_t *context;
-        uv_handle_t handle;
-        uv_poll_t poll;
-    } u;
-#ifdef CAT_ENABLE_DEBUG_LOG
-    cat_os_socket_t fd;
-#endif
-    struct {
-        int status; // uv status
-        uv_events_t events; // uv events, e.g UV_EVENT_READABLE, UV_EVENT_WRITABLE...
-    } ret;
-    cat_bool_t initialized;
-#ifdef CAT_OS_UNIX_LIKE
-    cat_os_fd_t fd_dup;
-#endif
-} cat_poll_t;
-
-static void cat_poll_close_callback(uv_handle_t *handle)
-{
-    cat_poll_t *poll = cat_container_of(handle, cat_poll_t, u.handle);
-    cat_poll_context_t *context = poll->u.context;
-
-#ifdef CAT_OS_UNIX_LIKE
-    if (poll->fd_dup != CAT_OS_INVALID_FD) {
-        uv__close(poll->fd_dup);
-    }
-#endif
-    /* multi polls uses the same context,
-     * we should free it when all polls are all closed. */
-    if (CAT_REF_DEL(context) == 0) {
-        cat_free(context);
-    }
-}
-
-static void cat_poll_done_callback(cat_event_io_defer_task_t *task, cat_data_t *data)
-{
-    cat_poll_context_t *context = (cat_poll_context_t *) data;
-
-    /** @note: we can recognize cancel operation via
-     * event_io_defer_task_close(context->done_task) + context->done_task = NULL,
-     * but it is not necessary. */
-    (void) task;
-    /** @note coroutine maybe force resumed when poll_callback() was called
-     * but poll_done_callback() has not been called, so we have to check
-     * if it is done here before, but now we are using event_io_defer_task_close()
-     * to cancel this callback, so schedule is always safe. */
-    cat_coroutine_schedule(context->coroutine, EVENT, "Poll");
-}
-
-static void cat_poll_callback(uv_poll_t* handle, int status, uv_events_t events)
-{
-    cat_poll_t *poll = (cat_poll_t *) handle;
-    cat_poll_context_t *context = poll->u.context;
-
-    CAT_LOG_DEBUG_VA_WITH_LEVEL(POLL, 2, {
-        char *events_str = cat_poll_uv_events_str(events);
-        CAT_LOG_DEBUG_D(POLL, "poll_callback(fd: " CAT_OS_SOCKET_FMT ", status: %d" CAT_LOG_STRERRNO_FMT ", events: %s)",
-            poll->fd, status, CAT_LOG_STRERRNO_C(status == 0, status), events_str);
-        cat_buffer_str_free(events_str);
-    });
-
-    poll->ret.status = status;
-    /* Note: uv may return multi events in multi callbacks */
-    poll->ret.events |= events;
-
-    /* Note: for get all revents of all pollfd at once,
-     * we should schedule coroutine in io defer callback */
-    if (context->done_task == NULL) {
-        context->done_task = cat_event_io_defer_task_create(cat_poll_done_callback, context);
-    }
-}
-
 #define CAT_POLL_EMULATE(fds, nfds) do { \
     if (cat_poll_emulate != NULL) { \
         int n; \
@@ -472,126 +598,104 @@ static int cat_poll_impl(cat_pollfd_t *fds, cat_nfds_t nfds, cat_timeout_t timeo
 {
     CAT_POLL_EMULATE(fds, nfds);
     CAT_POLL_CHECK_TIMEOUT(timeout);
-    cat_poll_context_t *context;
-    cat_poll_t *polls;
-    cat_nfds_t i = 0, e = 0;
+    cat_poll_context_t context;
+    cat_poll_waiter_t stacked_waiters[8];
+    cat_poll_waiter_t *waiters;
+    cat_nfds_t i, e = 0;
     cat_ret_t ret;
     int n = 0; // use int instead, because nfds_t maybe unsigned, can not be -1 (ERROR)
-    int error = 0;
+    int error;
 
-    /** @note: context memory includes poll objects. */
-    context = (cat_poll_context_t *) cat_malloc(sizeof(*context) + sizeof(*polls) * nfds);
+    if (nfds <= CAT_ARRAY_SIZE(stacked_waiters)) {
+        waiters = stacked_waiters;
+    } else {
+        waiters = (cat_poll_waiter_t *) cat_malloc(sizeof(*waiters) * nfds);
 #if CAT_ALLOC_HANDLE_ERRORS
-    if (unlikely(context == NULL)) {
-        cat_update_last_error_of_syscall("Malloc for poll failed");
-        return CAT_RET_ERROR;
-    }
+        if (unlikely(waiters == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for poll failed");
+            return CAT_RET_ERROR;
+        }
 #endif
-    polls = (cat_poll_t *) (((char *) context) + sizeof(*context));
+    }
 
-    CAT_REF_INIT(context);
-    context->coroutine = CAT_COROUTINE_G(current);
-    context->done_task = NULL;
-    for (; i < nfds; i++) {
+    context.coroutine = CAT_COROUTINE_G(current);
+    context.done_task = NULL;
+    for (i = 0; i < nfds; i++) {
         cat_pollfd_t *fd = &fds[i];
-        cat_poll_t *poll = &polls[i];
+        cat_poll_waiter_t *waiter = &waiters[i];
+        cat_poll_watcher_t *watcher;
         fd->revents = POLLNONE; // clear it
-#ifdef CAT_ENABLE_DEBUG_LOG
-        poll->fd = fd->fd;
-#endif
-        poll->initialized = cat_false;
-        poll->ret.events = UV_EVENT_NONE;
-        poll->u.context = context;
-        do {
-            cat_os_socket_t fd_no = fd->fd;
-#ifdef CAT_OS_UNIX_LIKE
-            poll->fd_dup = CAT_OS_INVALID_FD;
-            if (unlikely(uv__fd_exists(&CAT_EVENT_G(loop), fd->fd))) {
-                /* uv_poll_init_socket() and uv_poll_start() will return error if fd exists */
-                poll->fd_dup = dup(fd->fd);
-                if (unlikely(fd->fd == CAT_OS_INVALID_SOCKET)) {
-                    poll->ret.status = cat_translate_sys_error(cat_sys_errno);
-                    e++;
-                    break;
-                }
-                fd_no = poll->fd_dup;
-            }
-#endif
-            error = uv_poll_init_socket(&CAT_EVENT_G(loop), &poll->u.poll, fd_no);
-            if (unlikely(error != 0)) {
-                /* ENOTSOCK means it maybe a regular file */
-                poll->ret.status = cat_poll_filter_init_error(error);
-                e++;
-                break;
-            }
-            poll->initialized = cat_true;
-            CAT_REF_ADD(context);
-            if (e > 0) {
-                /* fast return without starting handle */
-                break;
-            }
-            error = uv_poll_start(&poll->u.poll, cat_poll_translate_sys_events_to_uv_events(fd->events), cat_poll_callback);
-            if (unlikely(error != 0)) {
-                poll->ret.status = error;
-                e++;
-                break;
-            }
-            poll->ret.status = CAT_ECANCELED;
-        } while (0);
+        cat_poll_waiter_init(waiter, &context, fd->events);
+        watcher = cat_poll_watcher_get(fd->fd, &error);
+        if (unlikely(watcher == NULL)) {
+            /* ENOTSOCK means it maybe a regular file */
+            waiter->ret.status = cat_poll_filter_init_error(error);
+            e++;
+            continue;
+        }
+        if (e > 0) {
+            /* fast return without starting watcher */
+            cat_poll_watcher_release(watcher);
+            continue;
+        }
+        error = cat_poll_watcher_add_waiter(watcher, waiter);
+        if (unlikely(error != 0)) {
+            waiter->ret.status = error;
+            e++;
+            continue;
+        }
     }
 
     if (e > 0) {
         /* fast return without waiting */
         ret = CAT_RET_NONE;
-        CAT_ASSERT(context->done_task == NULL);
+        CAT_ASSERT(context.done_task == NULL);
     } else {
         ret = cat_time_delay(timeout);
         if (unlikely(ret == CAT_RET_ERROR)) {
-            CAT_ASSERT(context->done_task == NULL);
+            CAT_ASSERT(context.done_task == NULL);
             cat_update_last_error_with_previous("Poll wait failed");
             n = CAT_RET_ERROR;
-        } else if (context->done_task != NULL) {
-            cat_event_io_defer_task_close(context->done_task);
+        } else if (context.done_task != NULL) {
+            cat_event_io_defer_task_close(context.done_task);
         }
     }
 
-    for (; i-- > 0;) {
+    for (i = 0; i < nfds; i++) {
         cat_pollfd_t *fd = &fds[i];
-        cat_poll_t *poll = &polls[i];
-        if (poll->initialized) {
-            uv_close(&poll->u.handle, cat_poll_close_callback);
+        cat_poll_waiter_t *waiter = &waiters[i];
+        if (waiter->watcher != NULL) {
+            cat_poll_watcher_remove_waiter(waiter);
         }
         if (unlikely(ret == CAT_RET_ERROR)) {
-            /* just close handle and go to the next one */
+            /* just remove waiter and go to the next one */
             continue;
         }
-        if (unlikely(ret == CAT_RET_NONE && poll->ret.status < 0)) {
-            if (poll->ret.status == CAT_ECANCELED) {
+        if (unlikely(ret == CAT_RET_NONE && waiter->ret.status < 0)) {
+            if (waiter->ret.status == CAT_ECANCELED) {
                 fd->revents = POLLNONE;
             }
 #ifndef CAT_OS_WIN
-            else if (poll->ret.status == CAT_EBADF) {
+            else if (waiter->ret.status == CAT_EBADF) {
                 /* see: https://github.com/libuv/libuv/pull/1040#discussion_r80087447 */
                 fd->revents = POLLERR;
                 n++;
             }
 #endif
             else {
-                fd->revents = cat_poll_translate_error_to_sys_events(fd->events, poll->ret.status);
+                fd->revents = cat_poll_translate_error_to_sys_events(fd->events, waiter->ret.status);
                 n++;
             }
         } else {
-            fd->revents = cat_poll_translate_uv_events_to_sys_events(poll->ret.events);
+            fd->revents = cat_poll_translate_uv_events_to_sys_events(waiter->ret.events);
             if (fd->revents != POLLNONE) {
                 n++;
             }
         }
     }
 
-    if (CAT_REF_DEL(context) == 0) {
-        /* no handle is initialized, close callback will never
-         * be called, so free context directly here. */
-        cat_free(context);
+    if (waiters != stacked_waiters) {
+        cat_free(waiters);
     }
 
     return n;
@@ -630,7 +734,13 @@ CAT_API int cat_poll(cat_pollfd_t *fds, cat_nfds_t nfds, cat_timeout_t timeout)
         cat_buffer_str_free(fds_str);
     });
 
-    int ret = cat_poll_impl(fds, nfds, timeout);
+    cat_timeout_t clamped_timeout = cat_time_clamp_timeout(timeout);
+    int ret = cat_poll_impl(fds, nfds, clamped_timeout);
+
+    if (unlikely(ret == 0 && clamped_timeout != timeout)) {
+        cat_update_last_error(CAT_ETIMEDOUT, "Poll deadline exceeded");
+        ret = CAT_RET_ERROR;
+    }
 
     CAT_LOG_DEBUG_VA(POLL, {
         char *fds_str = cat_pollfds_str(fds, nfds, cat_true);
@@ -744,3 +854,77 @@ CAT_API int cat_select(cat_os_socket_t max_fd, fd_set *readfds, fd_set *writefds
     cat_free(pfds);
     return ret;
 }
+
+CAT_API cat_bool_t cat_poll_watch(cat_os_socket_t fd)
+{
+    cat_poll_watcher_t *watcher;
+    int error;
+
+    watcher = cat_poll_watcher_get(fd, &error);
+    if (unlikely(watcher == NULL)) {
+        cat_update_last_error_with_reason(error, "Poll watch failed");
+        return cat_false;
+    }
+    watcher->watch_count++;
+
+    return cat_true;
+}
+
+CAT_API void cat_poll_unwatch(cat_os_socket_t fd)
+{
+    cat_poll_watcher_t *watcher = cat_poll_watcher_find(fd);
+
+    if (watcher == NULL || watcher->watch_count == 0) {
+        return;
+    }
+    if (--watcher->watch_count > 0 || watcher->waiter_count > 0) {
+        return;
+    }
+    /* fd is going to be closed, it is useless to keep it */
+    (void) cat_poll_watcher_update(watcher, UV_EVENT_NONE);
+    cat_poll_watcher_close(watcher);
+}
+
+CAT_API const cat_poll_stats_t *cat_poll_get_stats(void)
+{
+    return &CAT_POLL_G(stats);
+}
+
+CAT_API cat_bool_t cat_poll_module_init(void)
+{
+    CAT_GLOBALS_REGISTER(cat_poll);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_poll_module_shutdown(void)
+{
+    CAT_GLOBALS_UNREGISTER(cat_poll);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_poll_runtime_init(void)
+{
+    RB_INIT(&CAT_POLL_G(watcher_tree));
+    memset(&CAT_POLL_G(stats), 0, sizeof(CAT_POLL_G(stats)));
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_poll_runtime_shutdown(void)
+{
+    cat_poll_watcher_t *watcher;
+    cat_poll_watcher_t *tmp_watcher_iterator;
+
+    /* watched fds may have not been unwatched yet (e.g. curl multi handles which have not been cleaned up) */
+    RB_FOREACH_SAFE(watcher, cat_poll_watcher_tree_s, &CAT_POLL_G(watcher_tree), tmp_watcher_iterator) {
+        CAT_ASSERT(watcher->waiter_count == 0);
+        watcher->watch_count = 0;
+        (void) cat_poll_watcher_update(watcher, UV_EVENT_NONE);
+        cat_poll_watcher_close(watcher);
+    }
+    CAT_ASSERT(RB_MIN(cat_poll_watcher_tree_s, &CAT_POLL_G(watcher_tree)) == NULL);
+
+    return cat_true;
+}
@@ -20,7 +20,9 @@
 
 #ifdef CAT_PQ
 
+#include "cat_coroutine.h"
 #include "cat_poll.h"
+#include "cat_time.h"
 
 CAT_API cat_bool_t cat_pq_runtime_init(void)
 {
@@ -36,30 +38,67 @@ static int cat_pq_flush(PGconn *conn)
 {
     int flush_ret = -1;
 
-    do {
-        cat_ret_t poll_ret = cat_poll_one(PQsocket(conn), POLLOUT, NULL, -1);
+    CAT_LOG_DEBUG(PQ, "PQflush(conn=%p)", conn);
+    while ((flush_ret = PQflush(conn)) == 1) {
+        /* server may be blocked on sending results to us (e.g. in pipeline mode),
+         * so we must consume the input at the same time, otherwise we would deadlock */
+        cat_pollfd_events_t revents = POLLNONE;
+        cat_ret_t poll_ret = cat_poll_one(PQsocket(conn), POLLIN | POLLOUT, &revents, -1);
         if (unlikely(poll_ret == CAT_RET_ERROR)) {
             return -1;
         }
+        if ((revents & POLLIN) && PQconsumeInput(conn) == 0) {
+            return -1;
+        }
         CAT_LOG_DEBUG(PQ, "PQflush(conn=%p)", conn);
-        flush_ret = PQflush(conn);
-    } while (flush_ret == 1);
+    }
 
     return flush_ret;
 }
 
+static cat_always_inline cat_bool_t cat_pq_result_is_copy(const PGresult *result)
+{
+    ExecStatusType status = PQresultStatus(result);
+    return status == PGRES_COPY_IN || status == PGRES_COPY_OUT || status == PGRES_COPY_BOTH;
+}
+
+/* wait until PQgetResult() would not block */
+static cat_bool_t cat_pq_wait_result(PGconn *conn)
+{
+    while (PQisBusy(conn)) {
+        cat_ret_t poll_ret = cat_poll_one(PQsocket(conn), POLLIN, NULL, -1);
+        if (unlikely(poll_ret == CAT_RET_ERROR)) {
+            return cat_false;
+        }
+        CAT_LOG_DEBUG(PQ, "PQconsumeInput(conn=%p)", conn);
+        if (PQconsumeInput(conn) == 0) {
+            return cat_false;
+        }
+    }
+
+    return cat_true;
+}
+
 static PGresult *cat_pq_get_result(PGconn *conn)
 {
     PGresult *result, *last_result = NULL;
-    cat_ret_t poll_ret = cat_poll_one(PQsocket(conn), POLLIN, NULL, -1);
-    if (unlikely(poll_ret == CAT_RET_ERROR)) {
-        return NULL;
-    }
 
-    CAT_LOG_DEBUG(PQ, "PQgetResult(conn=%p)", conn);
-    while ((result = PQgetResult(conn))) {
+    while (1) {
+        if (unlikely(!cat_pq_wait_result(conn))) {
+            PQclear(last_result);
+            return NULL;
+        }
+        CAT_LOG_DEBUG(PQ, "PQgetResult(conn=%p)", conn);
+        result = PQgetResult(conn);
+        if (result == NULL) {
+            break;
+        }
         PQclear(last_result);
         last_result = result;
+        if (cat_pq_result_is_copy(result)) {
+            /* COPY state would never be terminated by NULL result */
+            break;
+        }
     }
 
     return last_result;
@@ -176,4 +215,696 @@ CAT_API PGresult *cat_pq_exec_params(PGconn *conn, const char *command, int n_pa
     return cat_pq_get_result(conn);
 }
 
+/* copy */
+
+static cat_bool_t cat_pq_copy_put_data_impl(PGconn *conn, const char *buffer, int length)
+{
+    int ret;
+
+    CAT_LOG_DEBUG(PQ, "PQputCopyData(conn=%p, length=%d)", conn, length);
+    while ((ret = PQputCopyData(conn, buffer, length)) == 0) {
+        /* no buffer space available (non-blocking), wait for the socket */
+        if (unlikely(cat_pq_flush(conn) == -1)) {
+            return cat_false;
+        }
+    }
+
+    return ret == 1;
+}
+
+CAT_API cat_bool_t cat_pq_copy_put_data(PGconn *conn, const char *buffer, size_t length)
+{
+    while (length > 0) {
+        int n = length > INT_MAX ? INT_MAX : (int) length;
+        if (unlikely(!cat_pq_copy_put_data_impl(conn, buffer, n))) {
+            return cat_false;
+        }
+        buffer += n;
+        length -= n;
+    }
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_pq_copy_put_vector(PGconn *conn, const cat_io_vector_t *vector, unsigned int vector_count)
+{
+    unsigned int n;
+
+    for (n = 0; n < vector_count; n++) {
+        if (unlikely(!cat_pq_copy_put_data(conn, vector[n].base, vector[n].length))) {
+            return cat_false;
+        }
+    }
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_pq_copy_put_buffer(PGconn *conn, const cat_buffer_t *buffer)
+{
+    return cat_pq_copy_put_data(conn, buffer->value, buffer->length);
+}
+
+CAT_API PGresult *cat_pq_copy_end(PGconn *conn, const char *error_message)
+{
+    int ret;
+
+    CAT_LOG_DEBUG(PQ, "PQputCopyEnd(conn=%p, error_message='%s')", conn, error_message != NULL ? error_message : "");
+    while ((ret = PQputCopyEnd(conn, error_message)) == 0) {
+        if (unlikely(cat_pq_flush(conn) == -1)) {
+            return NULL;
+        }
+    }
+    if (unlikely(ret == -1)) {
+        return NULL;
+    }
+    if (cat_pq_flush(conn) == -1) {
+        return NULL;
+    }
+
+    return cat_pq_get_result(conn);
+}
+
+CAT_API int cat_pq_copy_get_data(PGconn *conn, char **buffer)
+{
+    int ret;
+
+    while (1) {
+        CAT_LOG_DEBUG(PQ, "PQgetCopyData(conn=%p)", conn);
+        ret = PQgetCopyData(conn, buffer, 1);
+        if (ret != 0) {
+            break;
+        }
+        /* no row is available yet */
+        if (unlikely(cat_poll_one(PQsocket(conn), POLLIN, NULL, -1) == CAT_RET_ERROR)) {
+            return -2;
+        }
+        if (unlikely(PQconsumeInput(conn) == 0)) {
+            return -2;
+        }
+    }
+
+    return ret;
+}
+
+CAT_API PGresult *cat_pq_copy_to(PGconn *conn, cat_pq_copy_row_callback_t callback, cat_data_t *data)
+{
+    char *row;
+    int length;
+
+    while ((length = cat_pq_copy_get_data(conn, &row)) > 0) {
+        cat_bool_t ret = callback(row, (size_t) length, data);
+        PQfreemem(row);
+        if (unlikely(!ret)) {
+            /* there is no way to abort COPY TO in protocol, so we drain the rest of rows */
+            while ((length = cat_pq_copy_get_data(conn, &row)) > 0) {
+                PQfreemem(row);
+            }
+            break;
+        }
+    }
+    if (unlikely(length == -2)) {
+        return NULL;
+    }
+
+    /* COPY is done, fetch the final result */
+    return cat_pq_get_result(conn);
+}
+
+/* pool */
+
+typedef struct cat_pq_pool_waiter_s {
+    cat_queue_node_t node;
+    cat_coroutine_t *coroutine;
+    cat_pq_pool_connection_t *connection;
+    cat_bool_t notified;
+} cat_pq_pool_waiter_t;
+
+CAT_API void cat_pq_pool_options_init(cat_pq_pool_options_t *options)
+{
+    options->min_size = CAT_PQ_POOL_DEFAULT_MIN_SIZE;
+    options->max_size = CAT_PQ_POOL_DEFAULT_MAX_SIZE;
+    options->idle_timeout = CAT_PQ_POOL_DEFAULT_IDLE_TIMEOUT;
+    options->health_check_interval = CAT_PQ_POOL_DEFAULT_HEALTH_CHECK_INTERVAL;
+    options->wait_timeout = CAT_TIMEOUT_FOREVER;
+    options->statement_cache_size = CAT_PQ_POOL_DEFAULT_STATEMENT_CACHE_SIZE;
+}
+
+static void cat_pq_pool_free(cat_pq_pool_t *pool);
+static void cat_pq_pool_notify_waiter(cat_pq_pool_t *pool, cat_pq_pool_connection_t *connection);
+
+/* give up the reserved slot, Notice: pool may be released if it has been closed during connecting */
+static void cat_pq_pool_connection_abort(cat_pq_pool_t *pool)
+{
+    pool->stats.size--;
+    if (pool->flags & CAT_PQ_POOL_FLAG_CLOSED) {
+        if (pool->stats.size == 0) {
+            cat_pq_pool_free(pool);
+        }
+        return;
+    }
+    /* the reserved slot is available again */
+    if (!cat_queue_empty(&pool->waiters)) {
+        cat_pq_pool_notify_waiter(pool, NULL);
+    }
+}
+
+/* pool must not be accessed if it returns NULL */
+static cat_pq_pool_connection_t *cat_pq_pool_connection_create(cat_pq_pool_t *pool)
+{
+    cat_pq_pool_connection_t *connection;
+    PGconn *conn;
+
+    /* reserve the slot before connecting, it may yield */
+    pool->stats.size++;
+    conn = cat_pq_connectdb(pool->conninfo);
+    if (unlikely(conn == NULL || PQstatus(conn) != CONNECTION_OK)) {
+        cat_update_last_error(CAT_ECONNREFUSED, "Pool connect failed, reason: %s",
+            conn != NULL ? PQerrorMessage(conn) : "out of memory");
+        PQfinish(conn);
+        cat_pq_pool_connection_abort(pool);
+        return NULL;
+    }
+    connection = (cat_pq_pool_connection_t *) cat_malloc(sizeof(*connection));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(connection == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for pool connection failed");
+        PQfinish(conn);
+        cat_pq_pool_connection_abort(pool);
+        return NULL;
+    }
+#endif
+    connection->pool = pool;
+    connection->conn = conn;
+    connection->last_used_time = cat_time_msec();
+    connection->statement_id = 0;
+    connection->statement_count = 0;
+    connection->statements = NULL;
+    pool->stats.create_count++;
+    CAT_LOG_DEBUG(PQ, "Pool(%p) created connection(%p), size=%zu", pool, connection, pool->stats.size);
+
+    return connection;
+}
+
+static void cat_pq_pool_free(cat_pq_pool_t *pool)
+{
+    cat_free(pool->conninfo);
+    if (pool->flags & CAT_PQ_POOL_FLAG_ALLOCATED) {
+        cat_free(pool);
+    }
+}
+
+static void cat_pq_pool_connection_close(cat_pq_pool_connection_t *connection)
+{
+    cat_pq_pool_t *pool = connection->pool;
+    size_t n;
+
+    CAT_LOG_DEBUG(PQ, "Pool(%p) closed connection(%p), size=%zu", pool, connection, pool->stats.size - 1);
+    PQfinish(connection->conn);
+    for (n = 0; n < connection->statement_count; n++) {
+        cat_free(connection->statements[n].query);
+    }
+    cat_free(connection->statements);
+    cat_free(connection);
+    pool->stats.size--;
+    pool->stats.close_count++;
+    if ((pool->flags & CAT_PQ_POOL_FLAG_CLOSED) && pool->stats.size == 0) {
+        cat_pq_pool_free(pool);
+    }
+}
+
+/* close connections which have been idle for too long (the oldest are at the back) */
+static void cat_pq_pool_evict_idle_connections(cat_pq_pool_t *pool)
+{
+    cat_msec_t now = cat_time_msec();
+    cat_pq_pool_connection_t *connection;
+
+    while (pool->stats.size > pool->options.min_size &&
+           (connection = cat_queue_back_data(&pool->idle_connections, cat_pq_pool_connection_t, node)) != NULL &&
+           now - connection->last_used_time >= pool->options.idle_timeout) {
+        cat_queue_remove(&connection->node);
+        pool->stats.idle_count--;
+        cat_pq_pool_connection_close(connection);
+    }
+}
+
+static cat_bool_t cat_pq_pool_connection_check(cat_pq_pool_connection_t *connection)
+{
+    cat_pq_pool_t *pool = connection->pool;
+    PGresult *result;
+    cat_bool_t ret;
+
+    if (cat_time_msec() - connection->last_used_time < pool->options.health_check_interval) {
+        return PQstatus(connection->conn) == CONNECTION_OK;
+    }
+    pool->stats.health_check_count++;
+    result = cat_pq_exec(connection->conn, "");
+    ret = result != NULL && PQresultStatus(result) == PGRES_EMPTY_QUERY;
+    PQclear(result);
+    if (unlikely(!ret)) {
+        CAT_LOG_DEBUG(PQ, "Pool(%p) connection(%p) health check failed, reason: %s", pool, connection, PQerrorMessage(connection->conn));
+        pool->stats.health_check_failure_count++;
+    }
+
+    return ret;
+}
+
+static void cat_pq_pool_notify_waiter(cat_pq_pool_t *pool, cat_pq_pool_connection_t *connection)
+{
+    cat_pq_pool_waiter_t *waiter = cat_queue_front_data(&pool->waiters, cat_pq_pool_waiter_t, node);
+
+    CAT_ASSERT(waiter != NULL);
+    waiter->connection = connection;
+    waiter->notified = cat_true;
+    cat_coroutine_schedule(waiter->coroutine, PQ, "Pool waiter");
+}
+
+CAT_API cat_pq_pool_t *cat_pq_pool_create(cat_pq_pool_t *pool, const char *conninfo, const cat_pq_pool_options_t *options)
+{
+    cat_pq_pool_flags_t flags = CAT_PQ_POOL_FLAG_NONE;
+    size_t n;
+
+    if (options != NULL && unlikely(options->max_size == 0 || options->min_size > options->max_size)) {
+        cat_update_last_error(CAT_EINVAL, "Pool size is invalid (min=%zu, max=%zu)", options->min_size, options->max_size);
+        return NULL;
+    }
+    if (pool == NULL) {
+        pool = (cat_pq_pool_t *) cat_malloc(sizeof(*pool));
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(pool == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for pool failed");
+            return NULL;
+        }
+#endif
+        flags |= CAT_PQ_POOL_FLAG_ALLOCATED;
+    }
+    pool->flags = flags;
+    pool->conninfo = cat_strdup(conninfo);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(pool->conninfo == NULL)) {
+        cat_update_last_error_of_syscall("Dup for pool conninfo failed");
+        if (flags & CAT_PQ_POOL_FLAG_ALLOCATED) {
+            cat_free(pool);
+        }
+        return NULL;
+    }
+#endif
+    if (options != NULL) {
+        pool->options = *options;
+    } else {
+        cat_pq_pool_options_init(&pool->options);
+    }
+    cat_queue_init(&pool->idle_connections);
+    cat_queue_init(&pool->waiters);
+    memset(&pool->stats, 0, sizeof(pool->stats));
+
+    for (n = 0; n < pool->options.min_size; n++) {
+        cat_pq_pool_connection_t *connection = cat_pq_pool_connection_create(pool);
+        if (unlikely(connection == NULL)) {
+            cat_update_last_error_with_previous("Pool create failed");
+            CAT_PROTECT_LAST_ERROR_START() {
+                cat_pq_pool_close(pool);
+            } CAT_PROTECT_LAST_ERROR_END();
+            return NULL;
+        }
+        cat_queue_push_back(&pool->idle_connections, &connection->node);
+        pool->stats.idle_count++;
+    }
+
+    return pool;
+}
+
+CAT_API void cat_pq_pool_close(cat_pq_pool_t *pool)
+{
+    cat_pq_pool_connection_t *connection;
+
+    CAT_ASSERT(!(pool->flags & CAT_PQ_POOL_FLAG_CLOSED));
+    pool->flags |= CAT_PQ_POOL_FLAG_CLOSED;
+    /* let waiters know that pool has been closed */
+    while (!cat_queue_empty(&pool->waiters)) {
+        cat_pq_pool_notify_waiter(pool, NULL);
+    }
+    if (pool->stats.size == 0) {
+        cat_pq_pool_free(pool);
+        return;
+    }
+    while ((connection = cat_queue_front_data(&pool->idle_connections, cat_pq_pool_connection_t, node)) != NULL) {
+        cat_queue_remove(&connection->node);
+        pool->stats.idle_count--;
+        /* Notice: pool may be released after the last connection was closed */
+        cat_pq_pool_connection_close(connection);
+    }
+}
+
+CAT_API cat_pq_pool_connection_t *cat_pq_pool_acquire(cat_pq_pool_t *pool)
+{
+    return cat_pq_pool_acquire_ex(pool, pool->options.wait_timeout);
+}
+
+CAT_API cat_pq_pool_connection_t *cat_pq_pool_acquire_ex(cat_pq_pool_t *pool, cat_timeout_t timeout)
+{
+    cat_pq_pool_connection_t *connection;
+    cat_msec_t start_time = cat_time_msec(), checkout_time;
+
+    while (1) {
+        cat_pq_pool_waiter_t waiter;
+        cat_msec_t wait_start_time, wait_time;
+        cat_bool_t ret;
+
+        if (unlikely(pool->flags & CAT_PQ_POOL_FLAG_CLOSED)) {
+            cat_update_last_error(CAT_ECLOSED, "Pool has been closed");
+            return NULL;
+        }
+        cat_pq_pool_evict_idle_connections(pool);
+        connection = cat_queue_front_data(&pool->idle_connections, cat_pq_pool_connection_t, node);
+        if (connection != NULL) {
+            cat_queue_remove(&connection->node);
+            pool->stats.idle_count--;
+            /* mark it as in-use before check, it may yield */
+            pool->stats.in_use_count++;
+            if (likely(cat_pq_pool_connection_check(connection))) {
+                break;
+            }
+            pool->stats.in_use_count--;
+            cat_pq_pool_connection_close(connection);
+            continue;
+        }
+        if (pool->stats.size < pool->options.max_size) {
+            connection = cat_pq_pool_connection_create(pool);
+            if (unlikely(connection == NULL)) {
+                /* Notice: pool may have been released */
+                cat_update_last_error_with_previous("Pool acquire failed");
+                return NULL;
+            }
+            pool->stats.in_use_count++;
+            break;
+        }
+        /* wait for a connection to be released (FIFO) */
+        waiter.coroutine = CAT_COROUTINE_G(current);
+        waiter.connection = NULL;
+        waiter.notified = cat_false;
+        cat_queue_push_back(&pool->waiters, &waiter.node);
+        pool->stats.waiter_count++;
+        pool->stats.wait_count++;
+        wait_start_time = cat_time_msec();
+        CAT_TIME_WAIT_START() {
+            ret = cat_time_wait(timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        cat_queue_remove(&waiter.node);
+        pool->stats.waiter_count--;
+        wait_time = cat_time_msec() - wait_start_time;
+        pool->stats.wait_time_total += wait_time;
+        if (wait_time > pool->stats.wait_time_max) {
+            pool->stats.wait_time_max = wait_time;
+        }
+        if (waiter.connection != NULL) {
+            /* it was handed over and it has just been used */
+            connection = waiter.connection;
+            break;
+        }
+        if (unlikely(!ret)) {
+            if (cat_get_last_error_code() == CAT_ETIMEDOUT) {
+                pool->stats.timeout_count++;
+            }
+            cat_update_last_error_with_previous("Pool acquire failed");
+            return NULL;
+        }
+        if (unlikely(!waiter.notified)) {
+            cat_update_last_error(CAT_ECANCELED, "Pool acquire has been canceled");
+            return NULL;
+        }
+        /* a slot is available or pool has been closed, retry */
+    }
+
+    pool->stats.acquire_count++;
+    checkout_time = cat_time_msec() - start_time;
+    pool->stats.checkout_time_total += checkout_time;
+    if (checkout_time > pool->stats.checkout_time_max) {
+        pool->stats.checkout_time_max = checkout_time;
+    }
+
+    return connection;
+}
+
+CAT_API void cat_pq_pool_release(cat_pq_pool_connection_t *connection)
+{
+    cat_pq_pool_t *pool = connection->pool;
+
+    CAT_ASSERT(pool->stats.in_use_count > 0);
+    connection->last_used_time = cat_time_msec();
+    if (unlikely((pool->flags & CAT_PQ_POOL_FLAG_CLOSED) ||
+                 PQstatus(connection->conn) != CONNECTION_OK ||
+                 PQtransactionStatus(connection->conn) != PQTRANS_IDLE)) {
+        cat_bool_t closed = !!(pool->flags & CAT_PQ_POOL_FLAG_CLOSED);
+        pool->stats.in_use_count--;
+        cat_pq_pool_connection_close(connection);
+        /* Notice: pool may be released if it has been closed */
+        if (!closed && !cat_queue_empty(&pool->waiters)) {
+            /* the slot is available */
+            cat_pq_pool_notify_waiter(pool, NULL);
+        }
+        return;
+    }
+    if (!cat_queue_empty(&pool->waiters)) {
+        /* hand it over directly, so that the waiters are served fairly */
+        cat_pq_pool_notify_waiter(pool, connection);
+        return;
+    }
+    pool->stats.in_use_count--;
+    cat_queue_push_front(&pool->idle_connections, &connection->node);
+    pool->stats.idle_count++;
+    cat_pq_pool_evict_idle_connections(pool);
+}
+
+CAT_API PGconn *cat_pq_pool_connection_get_conn(const cat_pq_pool_connection_t *connection)
+{
+    return connection->conn;
+}
+
+static const cat_pq_pool_statement_t *cat_pq_pool_connection_get_statement(
+    cat_pq_pool_connection_t *connection, const char *query, int n_params, const Oid *param_types)
+{
+    cat_pq_pool_t *pool = connection->pool;
+    cat_pq_pool_statement_t *statement, *statements;
+    PGresult *result;
+    size_t n;
+    cat_bool_t ret;
+
+    for (n = 0; n < connection->statement_count; n++) {
+        statement = &connection->statements[n];
+        if (strcmp(statement->query, query) == 0) {
+            return statement;
+        }
+    }
+    if (connection->statement_count >= pool->options.statement_cache_size) {
+        return NULL;
+    }
+    statements = (cat_pq_pool_statement_t *) cat_realloc(connection->statements, sizeof(*statements) * (connection->statement_count + 1));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(statements == NULL)) {
+        return NULL;
+    }
+#endif
+    connection->statements = statements;
+    statement = &statements[connection->statement_count];
+    (void) snprintf(statement->name, sizeof(statement->name), "cat_pq_pool_stmt_%" PRIu64, ++connection->statement_id);
+    result = cat_pq_prepare(connection->conn, statement->name, query, n_params, param_types);
+    ret = result != NULL && PQresultStatus(result) == PGRES_COMMAND_OK;
+    PQclear(result);
+    if (unlikely(!ret)) {
+        return NULL;
+    }
+    statement->query = cat_strdup(query);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(statement->query == NULL)) {
+        return NULL;
+    }
+#endif
+    connection->statement_count++;
+    pool->stats.statement_prepare_count++;
+
+    return statement;
+}
+
+CAT_API PGresult *cat_pq_pool_connection_exec_cached(cat_pq_pool_connection_t *connection, const char *query, int n_params,
+    const Oid *param_types, const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format)
+{
+    const cat_pq_pool_statement_t *statement;
+
+    statement = cat_pq_pool_connection_get_statement(connection, query, n_params, param_types);
+    if (statement != NULL) {
+        return cat_pq_exec_prepared(connection->conn, statement->name, n_params, param_values, param_lengths, param_formats, result_format);
+    }
+    /* cache is full or prepare failed, fallback to unnamed statement,
+     * so that error will be reported by result as usual */
+    return cat_pq_exec_params(connection->conn, query, n_params, param_types, param_values, param_lengths, param_formats, result_format);
+}
+
+CAT_API const cat_pq_pool_stats_t *cat_pq_pool_get_stats(const cat_pq_pool_t *pool)
+{
+    return &pool->stats;
+}
+
+/* pipeline */
+
+#ifdef CAT_PQ_HAVE_PIPELINE
+
+CAT_API cat_bool_t cat_pq_enter_pipeline_mode(PGconn *conn)
+{
+    CAT_LOG_DEBUG(PQ, "PQenterPipelineMode(conn=%p)", conn);
+    return PQenterPipelineMode(conn) == 1;
+}
+
+CAT_API cat_bool_t cat_pq_exit_pipeline_mode(PGconn *conn)
+{
+    CAT_LOG_DEBUG(PQ, "PQexitPipelineMode(conn=%p)", conn);
+    return PQexitPipelineMode(conn) == 1;
+}
+
+CAT_API cat_bool_t cat_pq_pipeline_prepare(PGconn *conn, const char *stmt_name, const char *query, int n_params, const Oid *param_types)
+{
+    CAT_LOG_DEBUG(PQ, "PQsendPrepare(conn=%p, stmt_name='%s') in pipeline", conn, stmt_name);
+    return PQsendPrepare(conn, stmt_name, query, n_params, param_types) == 1;
+}
+
+CAT_API cat_bool_t cat_pq_pipeline_exec_prepared(PGconn *conn, const char *stmt_name, int n_params,
+    const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format)
+{
+    CAT_LOG_DEBUG(PQ, "PQsendQueryPrepared(conn=%p, stmt_name='%s') in pipeline", conn, stmt_name);
+    return PQsendQueryPrepared(conn, stmt_name, n_params, param_values, param_lengths, param_formats, result_format) == 1;
+}
+
+CAT_API cat_bool_t cat_pq_pipeline_exec_params(PGconn *conn, const char *command, int n_params,
+    const Oid *param_types, const char *const *param_values, const int *param_lengths, const int *param_formats, int result_format)
+{
+    CAT_LOG_DEBUG(PQ, "PQsendQueryParams(conn=%p, command='%s') in pipeline", conn, command);
+    return PQsendQueryParams(conn, command, n_params, param_types, param_values, param_lengths, param_formats, result_format) == 1;
+}
+
+CAT_API cat_bool_t cat_pq_pipeline_sync(PGconn *conn)
+{
+    CAT_LOG_DEBUG(PQ, "PQpipelineSync(conn=%p)", conn);
+    if (PQpipelineSync(conn) == 0) {
+        return cat_false;
+    }
+
+    return cat_pq_flush(conn) == 0;
+}
+
+CAT_API PGresult *cat_pq_pipeline_get_result(PGconn *conn)
+{
+    PGresult *result, *last_result = NULL;
+
+    while (1) {
+        if (unlikely(!cat_pq_wait_result(conn))) {
+            break;
+        }
+        CAT_LOG_DEBUG(PQ, "PQgetResult(conn=%p) in pipeline", conn);
+        result = PQgetResult(conn);
+        if (result == NULL) {
+            /* end of results of current query */
+            if (last_result == NULL && PQpipelineStatus(conn) != PQ_PIPELINE_OFF && PQisBusy(conn)) {
+                /* nothing is queued yet */
+                continue;
+            }
+            break;
+        }
+        if (PQresultStatus(result) == PGRES_PIPELINE_SYNC) {
+            /* sync point has no NULL terminator */
+            if (last_result != NULL) {
+                /* should never happen, but keep the result in order */
+                PQclear(result);
+                break;
+            }
+            return result;
+        }
+        PQclear(last_result);
+        last_result = result;
+    }
+
+    return last_result;
+}
+
+/* consume all results until sync point, so that pipeline mode can be exited */
+static cat_bool_t cat_pq_pipeline_drain(PGconn *conn)
+{
+    PGresult *result;
+
+    if (PQstatus(conn) != CONNECTION_OK) {
+        return cat_false;
+    }
+    while ((result = cat_pq_pipeline_get_result(conn)) != NULL) {
+        cat_bool_t is_sync = PQresultStatus(result) == PGRES_PIPELINE_SYNC;
+        PQclear(result);
+        if (is_sync) {
+            return cat_true;
+        }
+    }
+
+    return cat_false;
+}
+
+CAT_API int cat_pq_pipeline_exec_params_batch(PGconn *conn, const char *command, int n_params, int n_batches,
+    const Oid *param_types, const char *const *const *param_values, const int *const *param_lengths, const int *param_formats,
+    int result_format, cat_pq_pipeline_result_callback_t callback, cat_data_t *data)
+{
+    cat_bool_t was_in_pipeline = PQpipelineStatus(conn) != PQ_PIPELINE_OFF;
+    int n, n_done = 0;
+
+    if (!was_in_pipeline && !cat_pq_enter_pipeline_mode(conn)) {
+        return -1;
+    }
+    for (n = 0; n < n_batches; n++) {
+        if (!cat_pq_pipeline_exec_params(conn, command, n_params, param_types,
+            param_values[n], param_lengths != NULL ? param_lengths[n] : NULL, param_formats, result_format)) {
+            break;
+        }
+    }
+    if (!cat_pq_pipeline_sync(conn)) {
+        /* sync point may not be sent, results can never be drained */
+        goto _unusable;
+    }
+    while (1) {
+        PGresult *result = cat_pq_pipeline_get_result(conn);
+        ExecStatusType status;
+        if (unlikely(result == NULL)) {
+            /* results of the rest must be consumed before exit */
+            if (!cat_pq_pipeline_drain(conn)) {
+                goto _unusable;
+            }
+            n_done = -1;
+            goto _out;
+        }
+        status = PQresultStatus(result);
+        if (status == PGRES_PIPELINE_SYNC) {
+            PQclear(result);
+            break;
+        }
+        if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+            n_done++;
+        }
+        if (callback != NULL) {
+            /* result is owned by callback */
+            callback(conn, result, data);
+        } else {
+            PQclear(result);
+        }
+    }
+    if (n != n_batches) {
+        /* some of queries were not queued */
+        n_done = -1;
+    }
+
+    _out:
+    if (!was_in_pipeline) {
+        (void) cat_pq_exit_pipeline_mode(conn);
+    }
+    return n_done;
+
+    _unusable:
+    /* it is still in pipeline mode with results pending */
+    cat_update_last_error(CAT_EPROTO, "PQ pipeline is broken, connection is unusable: %s", PQerrorMessage(conn));
+    return -1;
+}
+#endif /* CAT_PQ_HAVE_PIPELINE */
+
 #endif /* CAT_PQ */
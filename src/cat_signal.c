@@ -49,7 +49,7 @@ static void cat_signal_callback(uv_signal_t* handle, int signum)
 
     signal->coroutine = NULL;
 
-    cat_coroutine_schedule(coroutine, SIGNAL, "Signal");
+    cat_coroutine_wakeup(coroutine, SIGNAL, "Signal");
 }
 
 static void cat_signal_close_callback(uv_handle_t *handle)
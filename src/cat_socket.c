@@ -25,6 +25,7 @@
 #include "cat_poll.h"
 
 #include "cat_fs.h" /* for sendfile */
+#include "cat_io_uring.h"
 
 #ifdef CAT_IDE_HELPER
 #include "uv-common.h"
@@ -485,6 +486,11 @@ CAT_API cat_bool_t cat_socket_runtime_init(void)
     CAT_SOCKET_G(last_id) = 0;
     CAT_SOCKET_G(options.timeout) = cat_socket_default_global_timeout_options;
     CAT_SOCKET_G(options.tcp_keepalive_delay) = 60;
+    CAT_SOCKET_G(options.connect_attempt_delay) = CAT_SOCKET_DEFAULT_CONNECT_ATTEMPT_DELAY;
+    memset(&CAT_SOCKET_G(connect_stats), 0, sizeof(CAT_SOCKET_G(connect_stats)));
+    CAT_SOCKET_G(dns_use_stub_resolver) = cat_env_is_true("CAT_DNS_STUB_RESOLVER", cat_false);
+    CAT_SOCKET_G(dns_resolver) = NULL;
+    cat_queue_init(&CAT_SOCKET_G(dns_stub_addrinfos));
 
     return cat_true;
 }
@@ -1414,6 +1420,26 @@ CAT_SOCKET_TIMEOUT_API_GEN(write)
 
 #undef CAT_SOCKET_TIMEOUT_API_GEN
 
+CAT_API cat_msec_t cat_socket_get_global_connect_attempt_delay(void)
+{
+    return CAT_SOCKET_G(options.connect_attempt_delay);
+}
+
+CAT_API void cat_socket_set_global_connect_attempt_delay(cat_msec_t delay)
+{
+    CAT_SOCKET_G(options.connect_attempt_delay) = delay;
+}
+
+CAT_API const cat_socket_connect_stats_t *cat_socket_get_connect_stats(void)
+{
+    return &CAT_SOCKET_G(connect_stats);
+}
+
+CAT_API void cat_socket_reset_connect_stats(void)
+{
+    memset(&CAT_SOCKET_G(connect_stats), 0, sizeof(CAT_SOCKET_G(connect_stats)));
+}
+
 #ifdef CAT_ENABLE_DEBUG_LOG
 static CAT_BUFFER_STR_FREE char *cat_socket_bind_flags_str(cat_socket_bind_flags_t flags)
 {
@@ -1602,7 +1628,7 @@ static void cat_socket_accept_connection_callback(uv_stream_t *stream, int statu
         cat_coroutine_t *coroutine = server_i->context.accept.coroutine;
         CAT_ASSERT(coroutine != NULL);
         server_i->context.accept.data.status = status;
-        cat_coroutine_schedule(coroutine, SOCKET, "Accept");
+        cat_coroutine_wakeup(coroutine, SOCKET, "Accept");
     }
     // else we can call uv_accept to get it later
 }
@@ -1780,7 +1806,7 @@ static void cat_socket_internal_connect_callback(uv_connect_t* request, int stat
         cat_coroutine_t *coroutine = socket_i->context.connect.coroutine;
         CAT_ASSERT(coroutine != NULL);
         socket_i->context.connect.data.status = status;
-        cat_coroutine_schedule(coroutine, SOCKET, "Connect");
+        cat_coroutine_wakeup(coroutine, SOCKET, "Connect");
     }
 
     cat_free(request);
@@ -1899,6 +1925,262 @@ static cat_bool_t cat_socket_connect_impl(cat_socket_t *socket, const cat_sockad
     return cat_socket_internal_connect(socket_i, address, address_length, timeout, is_try);
 }
 
+/* Happy Eyeballs (RFC 8305) */
+
+typedef struct cat_socket_connect_race_s cat_socket_connect_race_t;
+
+typedef struct cat_socket_connect_attempt_s {
+    cat_socket_connect_race_t *race;
+    /* it is NULL if attempt is not running */
+    cat_coroutine_t *coroutine;
+    cat_socket_t socket;
+    cat_sockaddr_info_t address;
+    cat_timeout_t timeout;
+} cat_socket_connect_attempt_t;
+
+struct cat_socket_connect_race_s {
+    /* it is not NULL only when it is waiting for attempts */
+    cat_coroutine_t *coroutine;
+    cat_bool_t notified;
+    size_t running;
+    cat_socket_connect_attempt_t *winner;
+    cat_errno_t error;
+};
+
+static cat_data_t *cat_socket_connect_attempt_function(cat_data_t *data)
+{
+    cat_socket_connect_attempt_t *attempt = (cat_socket_connect_attempt_t *) data;
+    cat_socket_connect_race_t *race = attempt->race;
+    cat_bool_t ret;
+
+    attempt->coroutine = CAT_COROUTINE_G(current);
+    race->running++;
+    ret = cat_socket_connect_ex(&attempt->socket, &attempt->address.address.common, attempt->address.length, attempt->timeout);
+    attempt->coroutine = NULL;
+    race->running--;
+    if (ret && race->winner == NULL) {
+        race->winner = attempt;
+    } else {
+        if (!ret) {
+            race->error = cat_get_last_error_code();
+        }
+        cat_socket_close(&attempt->socket);
+    }
+    if (race->coroutine != NULL) {
+        race->notified = cat_true;
+        /* Notice: race may be released after this, so we can not touch it anymore */
+        cat_coroutine_schedule(race->coroutine, SOCKET, "Connect race");
+    }
+
+    return NULL;
+}
+
+/* move all sockets bound on origin into the winner's connection, and then the lazy origin one can be closed */
+static void cat_socket_connect_race_adopt(cat_socket_internal_t *origin_i, cat_socket_t *winner)
+{
+    cat_socket_internal_t *winner_i = winner->internal;
+    cat_socket_t *socket_reference;
+    cat_ref_t ref;
+
+    cat_queue_remove(&winner->node);
+    while ((socket_reference = cat_queue_front_data(&origin_i->sockets, cat_socket_t, node))) {
+        cat_queue_remove(&socket_reference->node);
+        socket_reference->internal = winner_i;
+        cat_queue_push_back(&winner_i->sockets, &socket_reference->node);
+    }
+    winner->internal = origin_i;
+    cat_queue_push_back(&origin_i->sockets, &winner->node);
+    ref = origin_i->ref;
+    origin_i->ref = winner_i->ref;
+    winner_i->ref = ref;
+    cat_socket_close(winner);
+}
+
+static cat_sa_family_t cat_socket_connect_race(
+    cat_socket_internal_t *socket_i,
+    const cat_sockaddr_info_t *addresses, size_t count,
+    cat_timeout_t timeout, cat_msec_t delay
+)
+{
+    cat_socket_connect_race_t race;
+    cat_socket_connect_attempt_t *attempts, *attempt;
+    cat_sa_family_t af = AF_UNSPEC;
+    cat_errno_t error = CAT_ECONNREFUSED;
+    size_t started = 0, launched = 0, n;
+
+    attempts = (cat_socket_connect_attempt_t *) cat_malloc(sizeof(*attempts) * count);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(attempts == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for connect attempts failed");
+        return AF_UNSPEC;
+    }
+#endif
+    race.coroutine = NULL;
+    race.notified = cat_false;
+    race.running = 0;
+    race.winner = NULL;
+    race.error = CAT_ECONNREFUSED;
+
+    /* it can be canceled by socket close */
+    socket_i->context.connect.coroutine = CAT_COROUTINE_G(current);
+    socket_i->io_flags = CAT_SOCKET_IO_FLAG_CONNECT;
+    while (race.winner == NULL) {
+        cat_timeout_t wait_timeout;
+        cat_bool_t ret;
+        if (started < count) {
+            attempt = &attempts[started++];
+            attempt->race = &race;
+            attempt->coroutine = NULL;
+            attempt->address = addresses[started - 1];
+            attempt->timeout = timeout;
+            if (unlikely(cat_socket_create(&attempt->socket, socket_i->type) == NULL)) {
+                error = cat_get_last_error_code();
+                continue;
+            }
+            attempt->socket.internal->option_flags = socket_i->option_flags;
+            attempt->socket.internal->options = socket_i->options;
+            CAT_SOCKET_G(connect_stats.attempts)++;
+            if (unlikely(cat_coroutine_run(NULL, cat_socket_connect_attempt_function, attempt) == NULL)) {
+                error = cat_get_last_error_code();
+                cat_socket_close(&attempt->socket);
+                continue;
+            }
+            if (++launched == 2) {
+                /* it is a real race only if more than one attempt has been started */
+                CAT_SOCKET_G(connect_stats.races)++;
+            }
+            if (race.winner != NULL) {
+                break;
+            }
+            if (attempt->coroutine == NULL) {
+                /* failed immediately (e.g. network is unreachable), start the next one ASAP */
+                error = race.error;
+                continue;
+            }
+            wait_timeout = (cat_timeout_t) delay;
+            if (timeout != CAT_TIMEOUT_FOREVER && wait_timeout > timeout) {
+                wait_timeout = timeout;
+            }
+        } else if (race.running > 0) {
+            wait_timeout = timeout;
+        } else {
+            break;
+        }
+        race.notified = cat_false;
+        race.coroutine = CAT_COROUTINE_G(current);
+        CAT_TIME_WAIT_START() {
+            ret = cat_time_wait(wait_timeout);
+        } CAT_TIME_WAIT_END(timeout);
+        race.coroutine = NULL;
+        if (ret) {
+            if (!race.notified) {
+                error = CAT_ECANCELED;
+                break;
+            }
+            /* an attempt is done, go on */
+            error = race.error;
+        } else {
+            error = cat_get_last_error_code();
+            if (error != CAT_ETIMEDOUT || timeout == 0) {
+                break;
+            }
+            /* it is time to start the next attempt */
+        }
+        if (race.winner == NULL && cat_time_clamp_timeout(timeout) == 0) {
+            /* deadline may be exhausted even if timeout is forever, do not start the rest */
+            error = CAT_ETIMEDOUT;
+            break;
+        }
+    }
+    /* it may be resumed by others (e.g. coroutine group cancel) rather than socket close */
+    socket_i->io_flags = CAT_SOCKET_IO_FLAG_NONE;
+    socket_i->context.connect.coroutine = NULL;
+
+    /* cancel the losers */
+    for (n = 0; n < started; n++) {
+        attempt = &attempts[n];
+        if (attempt->coroutine != NULL) {
+            cat_coroutine_resume(attempt->coroutine, NULL, NULL);
+        }
+    }
+    CAT_ASSERT(race.running == 0);
+
+    if (race.winner != NULL) {
+        cat_socket_t *winner = &race.winner->socket;
+        if (likely(error != CAT_ECANCELED)) {
+            af = cat_socket_get_af(winner);
+            cat_socket_connect_race_adopt(socket_i, winner);
+        } else {
+            cat_socket_close(winner);
+        }
+    }
+    cat_free(attempts);
+    if (error == CAT_ECANCELED) {
+        cat_update_last_error(CAT_ECANCELED, "Socket connect has been canceled");
+        return AF_UNSPEC;
+    }
+    if (af == AF_UNSPEC) {
+        cat_update_last_error_with_reason(error, "Socket connect failed after %zu attempts", started);
+    }
+    CAT_LOG_DEBUG(SOCKET, "Connect race started %zu attempts, winner is %s", started, af != AF_UNSPEC ? cat_sockaddr_af_get_name(af) : "none");
+
+    return af;
+}
+
+/* interleave address families, starting with the family of the first address */
+static size_t cat_socket_connect_sort_addresses(const struct addrinfo *responses, cat_sockaddr_info_t *addresses, int port)
+{
+    const struct addrinfo *first = responses, *second = NULL, *response;
+    size_t count = 0;
+
+    for (response = responses; response != NULL; response = response->ai_next) {
+        if (response->ai_family != responses->ai_family) {
+            second = response;
+            break;
+        }
+    }
+    while (first != NULL || second != NULL) {
+        const struct addrinfo **cursor = first != NULL && (second == NULL || (count % 2) == 0) ? &first : &second;
+        cat_sockaddr_info_t *address = &addresses[count++];
+        const struct addrinfo *current = *cursor;
+        int af = current->ai_family;
+        memcpy(&address->address.common, current->ai_addr, current->ai_addrlen);
+        address->length = (cat_socklen_t) current->ai_addrlen;
+        if (af == AF_INET) {
+            address->address.in.sin_port = htons((uint16_t) port);
+        } else {
+            address->address.in6.sin6_port = htons((uint16_t) port);
+        }
+        do {
+            current = current->ai_next;
+        } while (current != NULL && current->ai_family != af);
+        *cursor = current;
+    }
+
+    return count;
+}
+
+static void cat_socket_connect_stats_update(cat_sa_family_t af, cat_msec_t start_time)
+{
+    cat_socket_connect_family_stats_t *stats;
+    cat_msec_t latency;
+
+    if (af == AF_INET) {
+        stats = &CAT_SOCKET_G(connect_stats.ipv4);
+    } else if (af == AF_INET6) {
+        stats = &CAT_SOCKET_G(connect_stats.ipv6);
+    } else {
+        CAT_SOCKET_G(connect_stats.failures)++;
+        return;
+    }
+    latency = cat_time_msec() - start_time;
+    stats->count++;
+    stats->latency_total += latency;
+    if (latency > stats->latency_max) {
+        stats->latency_max = latency;
+    }
+}
+
 static cat_bool_t cat_socket_connect_to_impl(cat_socket_t *socket, const char *name, size_t name_length, int port, cat_timeout_t timeout, cat_bool_t is_try)
 {
     CAT_SOCKET_INTERNAL_GETTER_WITH_IO(socket, socket_i, CAT_SOCKET_IO_FLAG_CONNECT, return cat_false);
@@ -1948,9 +2230,38 @@ static cat_bool_t cat_socket_connect_to_impl(cat_socket_t *socket, const char *n
         cat_update_last_error_with_previous("Socket connect failed");
         return cat_false;
     }
+    cat_bool_t is_initialized = cat_socket_internal_get_fd_fast(socket_i) != CAT_SOCKET_INVALID_FD;
+    cat_msec_t start_time = cat_time_msec();
+    if (!is_try && !is_initialized && af == AF_UNSPEC &&
+        ((socket_i->type & CAT_SOCKET_TYPE_TCP) == CAT_SOCKET_TYPE_TCP) &&
+        CAT_SOCKET_G(options.connect_attempt_delay) > 0 && responses->ai_next != NULL) {
+        /* race them */
+        cat_sockaddr_info_t *addresses;
+        size_t count = 0;
+        for (response = responses; response != NULL; response = response->ai_next) {
+            count++;
+        }
+        addresses = (cat_sockaddr_info_t *) cat_malloc(sizeof(*addresses) * count);
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(addresses == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for connect addresses failed");
+            cat_dns_freeaddrinfo(responses);
+            return cat_false;
+        }
+#endif
+        count = cat_socket_connect_sort_addresses(responses, addresses, port);
+        cat_dns_freeaddrinfo(responses);
+        af = cat_socket_connect_race(socket_i, addresses, count, timeout, CAT_SOCKET_G(options.connect_attempt_delay));
+        cat_free(addresses);
+        cat_socket_connect_stats_update(af, start_time);
+        ret = af != AF_UNSPEC;
+        if (ret) {
+            socket_i = socket->internal;
+        }
+        goto _out;
+    }
     /* Try to connect to all address results until successful */
     cat_sa_family_t last_af = responses->ai_addr->sa_family;
-    cat_bool_t is_initialized = cat_socket_internal_get_fd_fast(socket_i) != CAT_SOCKET_INVALID_FD;
     response = responses;
     do {
         CAT_ASSERT(((response->ai_addr->sa_family == AF_INET && response->ai_addrlen == sizeof(struct sockaddr_in)) ||
@@ -1977,6 +2288,9 @@ static cat_bool_t cat_socket_connect_to_impl(cat_socket_t *socket, const char *n
             }
             socket_i = socket->internal;
         }
+        if (!is_try) {
+            CAT_SOCKET_G(connect_stats.attempts)++;
+        }
         ret = cat_socket_internal_connect(
             socket_i,
             &address_info.address.common,
@@ -1989,7 +2303,11 @@ static cat_bool_t cat_socket_connect_to_impl(cat_socket_t *socket, const char *n
         }
     } while ((response = response->ai_next));
     cat_dns_freeaddrinfo(responses);
+    if (!is_try) {
+        cat_socket_connect_stats_update(ret ? cat_socket_internal_get_af(socket_i) : AF_UNSPEC, start_time);
+    }
 
+    _out:
 #ifdef CAT_SSL
     if (ret) {
         socket_i->ssl_peer_name = cat_strndup(name, name_length);
@@ -2625,7 +2943,9 @@ static void cat_socket_read_callback(uv_stream_t *stream, ssize_t nread, const u
     if (context->once || context->nread == context->size || context->error != 0) {
         cat_coroutine_t *coroutine = socket_i->context.io.read.coroutine;
         CAT_ASSERT(coroutine != NULL);
-        cat_coroutine_schedule(coroutine, SOCKET, "Stream read");
+        /* stop reading until coroutine handles the result, it may be resumed later */
+        uv_read_stop(stream);
+        cat_coroutine_wakeup(coroutine, SOCKET, "Stream read");
     }
 }
 
@@ -2675,7 +2995,9 @@ static void cat_socket_udp_recv_callback(uv_udp_t *udp, ssize_t nread, const uv_
     do {
         cat_coroutine_t *coroutine = socket_i->context.io.read.coroutine;
         CAT_ASSERT(coroutine != NULL);
-        cat_coroutine_schedule(coroutine, SOCKET, "UDP recv");
+        /* do not overwrite the result before coroutine handles it, it may be resumed later */
+        uv_udp_recv_stop(udp);
+        cat_coroutine_wakeup(coroutine, SOCKET, "UDP recv");
     } while (0);
 }
 
@@ -2800,6 +3122,56 @@ static ssize_t cat_socket_internal_read_raw(
     }
 #endif
 
+#ifdef CAT_IO_URING_RECV
+    /* completion-based read, it saves the additional recv() after readiness notification */
+    if (!is_dgram && cat_io_uring_is_socket_enabled() &&
+        cat_socket_internal_support_inline_read(socket_i) &&
+        !(socket_i->flags & CAT_SOCKET_INTERNAL_FLAG_NOT_SOCK)) {
+        cat_socket_fd_t fd = cat_socket_internal_get_fd_fast(socket_i);
+        cat_ret_t ret;
+        int32_t result;
+        error = 0;
+        socket_i->context.io.read.coroutine = CAT_COROUTINE_G(current);
+        socket_i->io_flags |= CAT_SOCKET_IO_FLAG_READ;
+        while (1) {
+            CAT_TIME_WAIT_START() {
+                ret = cat_io_uring_recv(fd, buffer + nread, size - nread, &result, timeout);
+            } CAT_TIME_WAIT_END(timeout);
+            if (ret != CAT_RET_OK) {
+                break;
+            }
+            if (unlikely(result < 0)) {
+                error = cat_translate_sys_error(-result);
+                break;
+            }
+            nread += result;
+            if (once || nread == size) {
+                break;
+            }
+            if (result == 0) {
+                error = CAT_ECONNRESET;
+                break;
+            }
+        }
+        socket_i->io_flags ^= CAT_SOCKET_IO_FLAG_READ;
+        socket_i->context.io.read.coroutine = NULL;
+        if (unlikely(ret == CAT_RET_ERROR)) {
+            if (cat_get_last_error_code() == CAT_ECANCELED) {
+                error = CAT_ECANCELED;
+                goto _error;
+            }
+            goto _wait_error;
+        }
+        if (unlikely(error != 0)) {
+            goto _error;
+        }
+        if (ret == CAT_RET_OK) {
+            return (ssize_t) nread;
+        }
+        /* fallback to the reactor way */
+    }
+#endif
+
     /* async read */
     {
         cat_socket_read_context_t context;
@@ -3586,6 +3958,13 @@ static cat_always_inline ssize_t cat_socket_internal_try_write(
             } \
         } while (0)
 
+#define CAT_SOCKET_WRITE_LOCKED_CHECK(_socket_i, _failure) do { \
+    if (unlikely(_socket_i->flags & CAT_SOCKET_INTERNAL_FLAG_WRITE_LOCKED)) { \
+        cat_update_last_error(CAT_ELOCKED, "Socket is sending mapped data now, unable to write"); \
+        _failure; \
+    } \
+} while (0)
+
 #define CAT_SOCKET_TRY_IO_CHECK(_socket, _socket_i, _io_flag, _failure) \
         CAT_SOCKET_INTERNAL_GETTER_WITH_IO_SILENT(_socket, _socket_i, _io_flag, _failure); \
         CAT_SOCKET_INTERNAL_IO_ESTABLISHED_CHECK_FOR_STREAM_SILENT(_socket_i, _failure) \
@@ -3605,6 +3984,7 @@ static cat_always_inline ssize_t cat_socket_try_recv_impl(cat_socket_t *socket,
 static cat_always_inline cat_bool_t cat_socket_write_impl(cat_socket_t *socket, const cat_socket_write_vector_t *vector, unsigned int vector_count, const cat_sockaddr_t *address, cat_socklen_t address_length, cat_timeout_t timeout)
 {
     CAT_SOCKET_IO_CHECK(socket, socket_i, CAT_SOCKET_IO_FLAG_NONE, return cat_false);
+    CAT_SOCKET_WRITE_LOCKED_CHECK(socket_i, return cat_false);
     return cat_socket_internal_write(socket_i, vector, vector_count, address, address_length, timeout);
 }
 
@@ -3709,6 +4089,7 @@ static cat_always_inline cat_ret_t cat_socket_internal_solve_write_to_address(
 static cat_bool_t cat_socket_write_to_impl(cat_socket_t *socket, const cat_socket_write_vector_t *vector, unsigned int vector_count, const char *name, size_t name_length, int port, cat_timeout_t timeout)
 {
     CAT_SOCKET_IO_CHECK(socket, socket_i, CAT_SOCKET_IO_FLAG_NONE, return cat_false);
+    CAT_SOCKET_WRITE_LOCKED_CHECK(socket_i, return cat_false);
     CAT_SOCKET_INTERNAL_SOLVE_WRITE_TO_ADDRESS(socket_i, name, name_length, port, address, address_length, return cat_false);
 
     return cat_socket_internal_write(socket_i, vector, vector_count, address, address_length, timeout);
@@ -4630,6 +5011,70 @@ CAT_API ssize_t cat_socket_send_file_ex(cat_socket_t *socket, const char *filena
     return written;
 }
 
+static cat_always_inline cat_bool_t cat_socket_send_mapped_impl(cat_socket_t *socket, const void *address, size_t length, cat_timeout_t timeout)
+{
+    CAT_SOCKET_IO_CHECK(socket, socket_i, CAT_SOCKET_IO_FLAG_WRITE, return cat_false);
+    const char *p = (const char *) address;
+    size_t remain = length;
+    cat_bool_t ret = cat_true;
+
+    /* hold the write lock for the whole send, otherwise others may write
+     * between chunks (e.g. during prefault) and interleave with us */
+    socket_i->flags |= CAT_SOCKET_INTERNAL_FLAG_WRITE_LOCKED;
+    socket_i->io_flags |= CAT_SOCKET_IO_FLAG_WRITE;
+    while (remain > 0) {
+        size_t n = CAT_MIN(CAT_SOCKET_SEND_MAPPED_CHUNK_SIZE, remain);
+        cat_socket_write_vector_t vector = cat_socket_write_vector_init(p, (cat_socket_vector_length_t) n);
+        int error;
+        CAT_TIME_WAIT_START() {
+            error = cat_fs_prefault_ex(p, n, timeout);
+            if (unlikely(socket->internal != socket_i)) {
+                /* it was closed during prefault, socket_i may be gone */
+                cat_update_last_error(CAT_ECANCELED, "Socket send mapped has been canceled");
+                return cat_false;
+            }
+            if (likely(error == 0)) {
+                ret = cat_socket_internal_write(socket_i, &vector, 1, NULL, 0, timeout);
+                /* write clears the flag once its queue is empty */
+                socket_i->io_flags |= CAT_SOCKET_IO_FLAG_WRITE;
+            }
+        } CAT_TIME_WAIT_END(timeout);
+        if (unlikely(error != 0)) {
+            cat_update_last_error_with_previous("Socket send mapped failed when prefault pages");
+            ret = cat_false;
+            break;
+        }
+        if (unlikely(!ret)) {
+            cat_update_last_error_with_previous("Socket send mapped failed when send data");
+            break;
+        }
+        p += n;
+        remain -= n;
+    }
+    socket_i->io_flags ^= CAT_SOCKET_IO_FLAG_WRITE;
+    socket_i->flags ^= CAT_SOCKET_INTERNAL_FLAG_WRITE_LOCKED;
+
+    return ret;
+}
+
+CAT_API cat_bool_t cat_socket_send_mapped(cat_socket_t *socket, const void *address, size_t length)
+{
+    return cat_socket_send_mapped_ex(socket, address, length, cat_socket_get_write_timeout_fast(socket));
+}
+
+CAT_API cat_bool_t cat_socket_send_mapped_ex(cat_socket_t *socket, const void *address, size_t length, cat_timeout_t timeout)
+{
+    CAT_LOG_DEBUG(SOCKET, "send_mapped(" CAT_SOCKET_ID_FMT ", %p, %zu, " CAT_TIMEOUT_FMT ") = " CAT_LOG_UNFINISHED_STR,
+        socket->id, address, length, timeout);
+
+    cat_bool_t ret = cat_socket_send_mapped_impl(socket, address, length, timeout);
+
+    CAT_LOG_DEBUG(SOCKET, "send_mapped(" CAT_SOCKET_ID_FMT ", %p, %zu, " CAT_TIMEOUT_FMT ") = " CAT_LOG_BOOL_RET_FMT,
+        socket->id, address, length, timeout, CAT_LOG_BOOL_RET_C(ret));
+
+    return ret;
+}
+
 static cat_always_inline void cat_socket_io_cancel(cat_coroutine_t *coroutine, const char *type_name)
 {
     if (coroutine != NULL) {
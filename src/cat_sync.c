@@ -86,3 +86,209 @@ CAT_API cat_bool_t cat_sync_wait_group_done(cat_sync_wait_group_t *wg)
 
     return cat_true;
 }
+
+/* coroutine group */
+
+typedef struct cat_sync_coroutine_group_child_s {
+    cat_queue_node_t node;
+    cat_sync_coroutine_group_t *group;
+    cat_coroutine_t *coroutine;
+    cat_sync_coroutine_group_function_t function;
+    cat_data_t *data;
+} cat_sync_coroutine_group_child_t;
+
+CAT_API cat_sync_coroutine_group_t *cat_sync_coroutine_group_create(cat_sync_coroutine_group_t *group)
+{
+    cat_queue_init(&group->children);
+    group->count = 0;
+    group->coroutine = NULL;
+    group->canceled = cat_false;
+    group->failed = cat_false;
+    group->error.code = 0;
+    group->error.message = NULL;
+
+    return group;
+}
+
+static void cat_sync_coroutine_group_cancel_children(cat_sync_coroutine_group_t *group)
+{
+    cat_coroutine_t *current_coroutine = CAT_COROUTINE_G(current);
+    cat_coroutine_t *waiter = group->coroutine;
+    cat_queue_t children;
+
+    /* joiner should not be notified before we are done, group may be released by it */
+    group->coroutine = NULL;
+
+    /* children may exit during resuming, so we move them out and put them back one by one */
+    cat_queue_init(&children);
+    while (!cat_queue_empty(&group->children)) {
+        cat_queue_node_t *node = cat_queue_front(&group->children);
+        cat_queue_remove(node);
+        cat_queue_push_back(&children, node);
+    }
+    while (!cat_queue_empty(&children)) {
+        cat_sync_coroutine_group_child_t *child = cat_queue_front_data(&children, cat_sync_coroutine_group_child_t, node);
+        cat_queue_remove(&child->node);
+        cat_queue_push_back(&group->children, &child->node);
+        if (child->coroutine != current_coroutine &&
+            child->coroutine->state == CAT_COROUTINE_STATE_WAITING) {
+            (void) cat_coroutine_resume(child->coroutine, NULL, NULL);
+        }
+    }
+    group->coroutine = waiter;
+}
+
+static void cat_sync_coroutine_group_notify(cat_sync_coroutine_group_t *group)
+{
+    if (group->count == 0 && group->coroutine != NULL) {
+        cat_coroutine_schedule(group->coroutine, SYNC, "Coroutine group");
+    }
+}
+
+static cat_data_t *cat_sync_coroutine_group_child_function(cat_data_t *data)
+{
+    cat_sync_coroutine_group_child_t *child = (cat_sync_coroutine_group_child_t *) data;
+    cat_sync_coroutine_group_t *group = child->group;
+    cat_bool_t ret;
+
+    ret = child->function(child->data);
+    cat_queue_remove(&child->node);
+    group->count--;
+    cat_free(child);
+
+    /* errors caused by cancellation are expected */
+    if (unlikely(!ret) && !group->failed && !group->canceled) {
+        group->failed = cat_true;
+        group->error.code = cat_get_last_error_code();
+        group->error.message = cat_strdup(cat_get_last_error_message());
+        group->canceled = cat_true;
+        cat_sync_coroutine_group_cancel_children(group);
+    }
+    cat_sync_coroutine_group_notify(group);
+
+    return NULL;
+}
+
+CAT_API cat_bool_t cat_sync_coroutine_group_spawn(cat_sync_coroutine_group_t *group, cat_sync_coroutine_group_function_t function, cat_data_t *data)
+{
+    cat_sync_coroutine_group_child_t *child;
+    cat_coroutine_t *coroutine;
+
+    if (unlikely(group->canceled)) {
+        cat_update_last_error(CAT_ECANCELED, "Coroutine group has been canceled");
+        return cat_false;
+    }
+    child = (cat_sync_coroutine_group_child_t *) cat_malloc(sizeof(*child));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(child == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for coroutine group child failed");
+        return cat_false;
+    }
+#endif
+    coroutine = cat_coroutine_create(NULL, cat_sync_coroutine_group_child_function);
+    if (unlikely(coroutine == NULL)) {
+        cat_free(child);
+        cat_update_last_error_with_previous("Coroutine group create child failed");
+        return cat_false;
+    }
+    child->group = group;
+    child->coroutine = coroutine;
+    child->function = function;
+    child->data = data;
+    cat_queue_push_back(&group->children, &child->node);
+    group->count++;
+    if (unlikely(!cat_coroutine_resume(coroutine, child, NULL))) {
+        cat_queue_remove(&child->node);
+        group->count--;
+        cat_free(child);
+        cat_coroutine_free(coroutine);
+        cat_update_last_error_with_previous("Coroutine group run child failed");
+        return cat_false;
+    }
+
+    return cat_true;
+}
+
+static void cat_sync_coroutine_group_wait(cat_sync_coroutine_group_t *group)
+{
+    /* children never outlive the group whatever the deadline is */
+    cat_msec_t deadline = cat_time_set_deadline(0);
+
+    while (group->count > 0) {
+        group->coroutine = CAT_COROUTINE_G(current);
+        (void) cat_time_wait(-1);
+        group->coroutine = NULL;
+    }
+    (void) cat_time_set_deadline(deadline);
+}
+
+CAT_API cat_bool_t cat_sync_coroutine_group_join(cat_sync_coroutine_group_t *group, cat_timeout_t timeout)
+{
+    if (unlikely(group->coroutine != NULL)) {
+        cat_update_last_error(CAT_EMISUSE, "Coroutine group can not be joined concurrently");
+        return cat_false;
+    }
+
+    if (group->count > 0) {
+        cat_bool_t ret;
+        group->coroutine = CAT_COROUTINE_G(current);
+        ret = cat_time_wait(timeout);
+        group->coroutine = NULL;
+        if (unlikely(group->count > 0)) {
+            cat_errno_t error = ret ? CAT_ECANCELED : cat_get_last_error_code();
+            cat_sync_coroutine_group_cancel(group);
+            cat_sync_coroutine_group_wait(group);
+            if (!group->failed) {
+                if (error == CAT_ETIMEDOUT) {
+                    cat_update_last_error(CAT_ETIMEDOUT, "Coroutine group join timedout");
+                } else if (error == CAT_ECANCELED) {
+                    cat_update_last_error(CAT_ECANCELED, "Coroutine group join has been canceled");
+                } else {
+                    cat_update_last_error_with_previous("Coroutine group join failed");
+                }
+                return cat_false;
+            }
+        }
+    }
+    if (unlikely(group->failed)) {
+        /* message may be lost (e.g. out of memory) */
+        cat_update_last_error(group->error.code, "%s", group->error.message != NULL ?
+            group->error.message : cat_strerror(group->error.code));
+        return cat_false;
+    }
+    if (unlikely(group->canceled)) {
+        cat_update_last_error(CAT_ECANCELED, "Coroutine group has been canceled");
+        return cat_false;
+    }
+
+    return cat_true;
+}
+
+CAT_API void cat_sync_coroutine_group_cancel(cat_sync_coroutine_group_t *group)
+{
+    group->canceled = cat_true;
+    cat_sync_coroutine_group_cancel_children(group);
+    cat_sync_coroutine_group_notify(group);
+}
+
+CAT_API cat_bool_t cat_sync_coroutine_group_is_canceled(const cat_sync_coroutine_group_t *group)
+{
+    return group->canceled;
+}
+
+CAT_API size_t cat_sync_coroutine_group_get_count(const cat_sync_coroutine_group_t *group)
+{
+    return group->count;
+}
+
+CAT_API void cat_sync_coroutine_group_close(cat_sync_coroutine_group_t *group)
+{
+    if (group->count > 0) {
+        cat_sync_coroutine_group_cancel(group);
+        cat_sync_coroutine_group_wait(group);
+    }
+    if (group->error.message != NULL) {
+        cat_free(group->error.message);
+        group->error.message = NULL;
+    }
+}
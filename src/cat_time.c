@@ -115,6 +115,10 @@ static void cat_timer_callback(uv_timer_t* handle)
     cat_timer_t *timer = (cat_timer_t *) handle;
     cat_coroutine_t *coroutine = timer->coroutine;
 
+    if (unlikely(cat_coroutine_is_ready(coroutine))) {
+        /* it has been woken up by I/O and it is waiting in the ready queue, so it is not timed out */
+        return;
+    }
     timer->coroutine = NULL;
     cat_coroutine_schedule(coroutine, TIME, "Timer");
 }
@@ -208,13 +212,70 @@ CAT_API cat_bool_t cat_time_wait(cat_timeout_t timeout)
 {
     CAT_LOG_DEBUG(TIME, "time_wait(" CAT_TIMEOUT_FMT ") = " CAT_LOG_UNFINISHED_STR, timeout);
 
-    cat_bool_t ret = cat_time_wait_impl(timeout);
+    cat_timeout_t clamped_timeout = cat_time_clamp_timeout(timeout);
+    cat_bool_t ret = cat_time_wait_impl(clamped_timeout);
+
+    if (unlikely(!ret && clamped_timeout != timeout && cat_get_last_error_code() == CAT_ETIMEDOUT)) {
+        cat_update_last_error(CAT_ETIMEDOUT, "Deadline exceeded");
+    }
 
     CAT_LOG_DEBUG(TIME, "time_wait(" CAT_TIMEOUT_FMT ") = " CAT_LOG_BOOL_RET_FMT, timeout, CAT_LOG_BOOL_RET_C(ret));
 
     return ret;
 }
 
+/* deadline */
+
+CAT_API cat_msec_t cat_time_set_deadline(cat_msec_t deadline)
+{
+    cat_coroutine_t *coroutine = CAT_COROUTINE_G(current);
+    cat_msec_t original_deadline = cat_coroutine_get_deadline(coroutine);
+
+    cat_coroutine_set_deadline(coroutine, deadline);
+
+    return original_deadline;
+}
+
+CAT_API cat_msec_t cat_time_get_deadline(void)
+{
+    return cat_coroutine_get_deadline(CAT_COROUTINE_G(current));
+}
+
+CAT_API cat_msec_t cat_time_narrow_deadline(cat_timeout_t timeout)
+{
+    cat_msec_t original_deadline = cat_time_get_deadline();
+    cat_msec_t deadline;
+
+    if (timeout < 0) {
+        return original_deadline;
+    }
+    deadline = cat_time_msec() + timeout;
+    if (original_deadline == 0 || deadline < original_deadline) {
+        (void) cat_time_set_deadline(deadline);
+    }
+
+    return original_deadline;
+}
+
+CAT_API cat_timeout_t cat_time_clamp_timeout(cat_timeout_t timeout)
+{
+    cat_msec_t deadline = cat_time_get_deadline();
+    cat_msec_t now;
+    cat_timeout_t remaining;
+
+    if (likely(deadline == 0)) {
+        return timeout;
+    }
+    /* timers are started from the loop time, so the timeout must be based on it, or they may expire before deadline */
+    now = cat_time_msec_cached();
+    remaining = deadline > now ? (cat_timeout_t) (deadline - now) : 0;
+    if (timeout < 0 || timeout > remaining) {
+        return remaining;
+    }
+
+    return timeout;
+}
+
 static cat_always_inline cat_ret_t cat_time_delay_impl(cat_timeout_t timeout)
 {
     if (timeout < 0) {
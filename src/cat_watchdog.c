@@ -17,9 +17,75 @@
  */
 
 #include "cat_watchdog.h"
+#include "cat_time.h"
+
+#if defined(CAT_OS_UNIX_LIKE) && defined(CAT_HAVE_BACKTRACE)
+#define CAT_WATCH_DOG_USE_BACKTRACE 1
+#include <execinfo.h>
+/* handler runs on the thread it interrupts, so only the compiler must not reorder around "reading" */
+#if defined(__ATOMIC_SEQ_CST)
+#define CAT_WATCH_DOG_SIGNAL_FENCE() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#else
+#define CAT_WATCH_DOG_SIGNAL_FENCE() __asm__ __volatile__("" ::: "memory")
+#endif
+#else
+#define CAT_WATCH_DOG_SIGNAL_FENCE()
+#endif
 
 CAT_API CAT_GLOBALS_DECLARE(cat_watchdog);
 
+typedef enum cat_watchdog_role_e {
+    CAT_WATCH_DOG_ROLE_MAIN,
+    CAT_WATCH_DOG_ROLE_SCHEDULER,
+    CAT_WATCH_DOG_ROLE_COROUTINE
+} cat_watchdog_role_t;
+
+static cat_watchdog_role_t cat_watchdog_get_role(CAT_GLOBALS_TYPE(cat_coroutine) *globals, const cat_coroutine_t *coroutine)
+{
+    if (coroutine == NULL || coroutine == globals->main) {
+        return CAT_WATCH_DOG_ROLE_MAIN;
+    } else if (coroutine == globals->scheduler) {
+        return CAT_WATCH_DOG_ROLE_SCHEDULER;
+    }
+    return CAT_WATCH_DOG_ROLE_COROUTINE;
+}
+
+static const char *cat_watchdog_role_name(uint32_t role)
+{
+    switch (role) {
+        case CAT_WATCH_DOG_ROLE_MAIN:
+            return "main";
+        case CAT_WATCH_DOG_ROLE_SCHEDULER:
+            return "scheduler";
+        default:
+            return "coroutine";
+    }
+}
+
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+/* the frames of signal handler and signal trampoline */
+#define CAT_WATCH_DOG_BACKTRACE_SKIP_DEPTH 2
+
+typedef struct cat_watchdog_sample_s {
+    uint32_t role;
+    uint32_t depth;
+    void *frames[CAT_WATCH_DOG_BACKTRACE_MAX_DEPTH];
+} cat_watchdog_sample_t;
+
+struct cat_watchdog_profiler_s {
+    /* samples are only written by signal handler on the watched thread,
+     * handler drops samples if the watched thread is reading */
+    volatile sig_atomic_t reading;
+    uint64_t sample_count;
+    uint64_t dropped_count;
+    size_t capacity;
+    cat_watchdog_sample_t samples[1];
+};
+
+static void cat_watchdog_profiler_sample(cat_watchdog_t *watchdog);
+static cat_bool_t cat_watchdog_install_signal_handler(void);
+#endif
+
 static cat_timeout_t cat_watchdog_align_quantum(cat_timeout_t quantum)
 {
     if (quantum <= 0) {
@@ -70,6 +136,37 @@ static void cat_improve_timer_resolution(void)
 }
 #endif
 
+static void cat_watchdog_snapshot(cat_watchdog_t *watchdog, cat_nsec_t blocked_time)
+{
+    cat_watchdog_snapshot_t *snapshot = &watchdog->snapshot;
+    CAT_GLOBALS_TYPE(cat_coroutine) *globals = watchdog->globals;
+    cat_watchdog_role_t role = cat_watchdog_get_role(globals, globals->current);
+
+    snapshot->blocked_time = blocked_time;
+    snapshot->role = cat_watchdog_role_name(role);
+    /* coroutine may be freed at any time, only the persistent ones are accessible here,
+     * others will be filled by signal handler on the watched thread */
+    snapshot->coroutine_id = role == CAT_WATCH_DOG_ROLE_COROUTINE ? 0 :
+        (role == CAT_WATCH_DOG_ROLE_MAIN ? CAT_COROUTINE_MAIN_ID : CAT_COROUTINE_SCHEDULER_ID);
+    snapshot->depth = 0;
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    if (cat_atomic_bool_load(&watchdog->snapshot_backtrace)) {
+        cat_nsec_t start = uv_hrtime();
+        cat_atomic_bool_store(&watchdog->snapshot_taken, cat_false);
+        cat_atomic_bool_store(&watchdog->snapshot_requested, cat_true);
+        (void) pthread_kill(watchdog->target, SIGPROF);
+        while (!cat_atomic_bool_load(&watchdog->snapshot_taken)) {
+            /* signal may be blocked, give up if handler has not started in time */
+            if (uv_hrtime() - start > (cat_nsec_t) watchdog->quantum &&
+                cat_atomic_bool_exchange(&watchdog->snapshot_requested, cat_false)) {
+                break;
+            }
+            (void) cat_sys_usleep(50);
+        }
+    }
+#endif
+}
+
 static void cat_watchdog_loop(void* arg)
 {
     cat_watchdog_t *watchdog = (cat_watchdog_t *) arg;
@@ -78,27 +175,45 @@ static void cat_watchdog_loop(void* arg)
     cat_improve_timer_resolution();
 #endif
 
+    watchdog->last_switch_time = uv_hrtime();
+
     uv_sem_post(watchdog->sem);
 
     while (1) {
+        cat_nsec_t now;
         watchdog->last_switches = watchdog->globals->switches;
         uv_mutex_lock(&watchdog->mutex);
         uv_cond_timedwait(&watchdog->cond, &watchdog->mutex, watchdog->quantum);
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+        if (watchdog->profiler != NULL && !cat_atomic_bool_load(&watchdog->stop)) {
+            cat_watchdog_profiler_sample(watchdog);
+        }
+#endif
         uv_mutex_unlock(&watchdog->mutex);
         if (cat_atomic_bool_load(&watchdog->stop)) {
             return;
         }
+        now = uv_hrtime();
         /* Notice: globals info maybe changed during check,
          * but it is usually acceptable to us.
          * In other words, there is a certain probability of false alert. */
         if (watchdog->globals->switches == watchdog->last_switches &&
-            watchdog->globals->current != watchdog->globals->scheduler &&
-            watchdog->globals->count > 1
+            watchdog->globals->current != watchdog->globals->scheduler
         ) {
-            watchdog->alert_count++;
-            watchdog->alerter(watchdog);
+            /* budget is checked on the watched thread */
+            cat_atomic_uint64_store(&watchdog->blocked_since, watchdog->last_switch_time);
+            cat_atomic_uint64_store(&watchdog->blocked_switches, watchdog->last_switches + 1);
+            if (watchdog->globals->count > 1) {
+                watchdog->alert_count++;
+                cat_watchdog_snapshot(watchdog, now - watchdog->last_switch_time);
+                watchdog->alerter(watchdog);
+            } else {
+                watchdog->alert_count = 0;
+            }
         } else {
+            /* the switch was made during the last quantum, so blocked time is a lower bound */
             watchdog->alert_count = 0;
+            watchdog->last_switch_time = now;
         }
     }
 }
@@ -151,9 +266,27 @@ CAT_API cat_bool_t cat_watchdog_runtime_shutdown(void)
 
 CAT_API void cat_watchdog_alert_standard(cat_watchdog_t *watchdog)
 {
-    fprintf(stderr, "Warning: <Watchdog> Syscall blocking or CPU starvation may occur in " CAT_WATCH_DOG_ROLE_NAME " %d, "
-                    "it has been blocked for more than " CAT_TIMEOUT_FMT  " ns\n",
-                    watchdog->pid, watchdog->quantum * watchdog->alert_count);
+    const cat_watchdog_snapshot_t *snapshot = &watchdog->snapshot;
+
+    if (snapshot->coroutine_id != 0 || strcmp(snapshot->role, cat_watchdog_role_name(CAT_WATCH_DOG_ROLE_COROUTINE)) != 0) {
+        fprintf(stderr, "Warning: <Watchdog> Syscall blocking or CPU starvation may occur in " CAT_WATCH_DOG_ROLE_NAME " %d, "
+                        "it has been blocked for more than " CAT_NSEC_FMT " ns by %s R" CAT_COROUTINE_ID_FMT "\n",
+                        watchdog->pid, snapshot->blocked_time, snapshot->role, snapshot->coroutine_id);
+    } else {
+        fprintf(stderr, "Warning: <Watchdog> Syscall blocking or CPU starvation may occur in " CAT_WATCH_DOG_ROLE_NAME " %d, "
+                        "it has been blocked for more than " CAT_NSEC_FMT " ns by %s\n",
+                        watchdog->pid, snapshot->blocked_time, snapshot->role);
+    }
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    if (snapshot->depth > 0) {
+        char **symbols = backtrace_symbols(snapshot->frames, (int) snapshot->depth);
+        uint32_t n;
+        for (n = 0; n < snapshot->depth; n++) {
+            fprintf(stderr, "    #%u %s\n", n, symbols != NULL ? symbols[n] : "?");
+        }
+        free(symbols);
+    }
+#endif
 }
 
 CAT_API cat_bool_t cat_watchdog_run(cat_watchdog_t *watchdog, cat_timeout_t quantum, cat_timeout_t threshold, cat_watchdog_alerter_t alerter)
@@ -188,6 +321,17 @@ CAT_API cat_bool_t cat_watchdog_run(cat_watchdog_t *watchdog, cat_timeout_t quan
     watchdog->pid = uv_os_getpid();
     watchdog->globals = CAT_GLOBALS_BULK(cat_coroutine);
     watchdog->last_switches = 0;
+    watchdog->last_switch_time = 0;
+    cat_atomic_uint64_init(&watchdog->blocked_switches, 0);
+    cat_atomic_uint64_init(&watchdog->blocked_since, 0);
+    watchdog->budget_handler = NULL;
+    memset(&watchdog->snapshot, 0, sizeof(watchdog->snapshot));
+    watchdog->snapshot.role = cat_watchdog_role_name(CAT_WATCH_DOG_ROLE_MAIN);
+    cat_atomic_bool_init(&watchdog->snapshot_backtrace, cat_false);
+    cat_atomic_bool_init(&watchdog->snapshot_requested, cat_false);
+    cat_atomic_bool_init(&watchdog->snapshot_taken, cat_false);
+    watchdog->profiler = NULL;
+    watchdog->target = uv_thread_self();
 
     error = uv_sem_init(&sem, 0);
     if (error != 0) {
@@ -247,6 +391,10 @@ CAT_API cat_bool_t cat_watchdog_stop(void)
         return cat_false;
     }
 
+    if (watchdog->profiler != NULL) {
+        (void) cat_watchdog_stop_profiler();
+    }
+
     cat_atomic_bool_store(&watchdog->stop, cat_true);
     uv_mutex_lock(&watchdog->mutex);
     uv_cond_signal(&watchdog->cond);
@@ -263,12 +411,14 @@ CAT_API cat_bool_t cat_watchdog_stop(void)
     uv_cond_destroy(&watchdog->cond);
     CAT_ASSERT(watchdog->sem == NULL);
 
+    /* a pending SIGPROF may still be delivered, handler must see NULL before it is freed */
+    CAT_WATCH_DOG_G(watchdog) = NULL;
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+
     if (watchdog->allocated) {
         cat_free(watchdog);
     }
 
-    CAT_WATCH_DOG_G(watchdog) = NULL;
-
     return cat_true;
 }
 
@@ -294,3 +444,403 @@ CAT_API cat_timeout_t cat_watchdog_get_threshold(void)
             watchdog->threshold :
             -1;
 }
+
+/* budget */
+
+CAT_API cat_bool_t cat_watchdog_check_budget(void)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+    cat_coroutine_t *coroutine;
+    cat_nsec_t elapsed;
+
+    if (likely(watchdog == NULL ||
+        cat_atomic_uint64_load(&watchdog->blocked_switches) != CAT_COROUTINE_G(switches) + 1)) {
+        return cat_false;
+    }
+    coroutine = CAT_COROUTINE_G(current);
+    if (coroutine->accounting.budget == 0) {
+        return cat_false;
+    }
+    elapsed = uv_hrtime() - cat_atomic_uint64_load(&watchdog->blocked_since);
+    if (elapsed <= coroutine->accounting.budget) {
+        return cat_false;
+    }
+    if (watchdog->budget_handler == NULL || watchdog->budget_handler(coroutine, elapsed)) {
+        (void) cat_time_delay(0);
+    }
+
+    return cat_true;
+}
+
+CAT_API cat_watchdog_budget_handler_t cat_watchdog_set_budget_handler(cat_watchdog_budget_handler_t handler)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+    cat_watchdog_budget_handler_t original_handler;
+
+    if (watchdog == NULL) {
+        return NULL;
+    }
+    original_handler = watchdog->budget_handler;
+    watchdog->budget_handler = handler;
+
+    return original_handler;
+}
+
+/* signal handler (for both of snapshot and profiler) */
+
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+static void cat_watchdog_profiler_record(cat_watchdog_profiler_t *profiler, cat_watchdog_role_t role, void **frames, int depth)
+{
+    cat_watchdog_sample_t *sample;
+
+    if (profiler->reading) {
+        profiler->dropped_count++;
+        return;
+    }
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    if (unlikely(depth <= 0)) {
+        profiler->dropped_count++;
+        return;
+    }
+    sample = &profiler->samples[profiler->sample_count % profiler->capacity];
+    sample->role = role;
+    sample->depth = (uint32_t) depth;
+    memcpy(sample->frames, frames, sizeof(*frames) * depth);
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    profiler->sample_count++;
+}
+
+static void cat_watchdog_signal_handler(int signum)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+    cat_watchdog_profiler_t *profiler;
+    cat_coroutine_t *coroutine;
+    cat_watchdog_role_t role;
+    void *frames[CAT_WATCH_DOG_BACKTRACE_SKIP_DEPTH + CAT_WATCH_DOG_BACKTRACE_MAX_DEPTH];
+    cat_bool_t snapshot_requested;
+    int saved_errno = errno;
+    int depth;
+
+    (void) signum;
+    /* it may be delivered after watchdog or profiler stopped */
+    if (watchdog == NULL) {
+        goto _out;
+    }
+    snapshot_requested = cat_atomic_bool_exchange(&watchdog->snapshot_requested, cat_false);
+    profiler = watchdog->profiler;
+    if (!snapshot_requested && profiler == NULL) {
+        goto _out;
+    }
+    depth = backtrace(frames, CAT_ARRAY_SIZE(frames)) - CAT_WATCH_DOG_BACKTRACE_SKIP_DEPTH;
+    coroutine = CAT_COROUTINE_G(current);
+    role = cat_watchdog_get_role(CAT_GLOBALS_BULK(cat_coroutine), coroutine);
+    if (snapshot_requested) {
+        /* watchdog thread is waiting for us, it is the only writer now */
+        cat_watchdog_snapshot_t *snapshot = &watchdog->snapshot;
+        snapshot->role = cat_watchdog_role_name(role);
+        snapshot->coroutine_id = coroutine != NULL ? coroutine->id : CAT_COROUTINE_MAIN_ID;
+        if (depth > 0) {
+            snapshot->depth = (uint32_t) depth;
+            memcpy(snapshot->frames, frames + CAT_WATCH_DOG_BACKTRACE_SKIP_DEPTH, sizeof(*frames) * depth);
+        }
+        cat_atomic_bool_store(&watchdog->snapshot_taken, cat_true);
+    }
+    if (profiler != NULL) {
+        cat_watchdog_profiler_record(profiler, role, frames + CAT_WATCH_DOG_BACKTRACE_SKIP_DEPTH, depth);
+    }
+
+    _out:
+    errno = saved_errno;
+}
+
+static cat_bool_t cat_watchdog_install_signal_handler(void)
+{
+    static cat_bool_t installed = cat_false;
+    struct sigaction action;
+    void *frames[1];
+
+    if (installed) {
+        return cat_true;
+    }
+    /* backtrace() may load libgcc lazily, which is not async-signal-safe */
+    (void) backtrace(frames, CAT_ARRAY_SIZE(frames));
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = cat_watchdog_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (unlikely(sigaction(SIGPROF, &action, NULL) != 0)) {
+        cat_update_last_error_of_syscall("Watchdog install signal handler failed");
+        return cat_false;
+    }
+    installed = cat_true;
+
+    return cat_true;
+}
+
+/* it is called on the watchdog thread with the mutex held */
+static void cat_watchdog_profiler_sample(cat_watchdog_t *watchdog)
+{
+    (void) pthread_kill(watchdog->target, SIGPROF);
+}
+#endif
+
+CAT_API cat_bool_t cat_watchdog_enable_snapshot_backtrace(cat_bool_t enable)
+{
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+
+    if (watchdog == NULL) {
+        cat_update_last_error(CAT_EMISUSE, "Watchdog is not running");
+        return cat_false;
+    }
+    if (enable && !cat_watchdog_install_signal_handler()) {
+        return cat_false;
+    }
+    cat_atomic_bool_store(&watchdog->snapshot_backtrace, enable);
+
+    return cat_true;
+#else
+    (void) enable;
+    cat_update_last_error(CAT_ENOTSUP, "Snapshot backtrace is not supported on this platform");
+    return cat_false;
+#endif
+}
+
+CAT_API cat_bool_t cat_watchdog_start_profiler(size_t capacity)
+{
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+    cat_watchdog_profiler_t *profiler;
+
+    if (watchdog == NULL) {
+        cat_update_last_error(CAT_EMISUSE, "Watchdog is not running");
+        return cat_false;
+    }
+    if (watchdog->profiler != NULL) {
+        cat_update_last_error(CAT_EMISUSE, "Profiler is already running");
+        return cat_false;
+    }
+    if (capacity == 0) {
+        capacity = CAT_WATCH_DOG_PROFILER_DEFAULT_CAPACITY;
+    }
+    if (unlikely(capacity > (SIZE_MAX - offsetof(cat_watchdog_profiler_t, samples)) / sizeof(cat_watchdog_sample_t))) {
+        cat_update_last_error(CAT_EINVAL, "Profiler capacity %zu is too large", capacity);
+        return cat_false;
+    }
+    if (!cat_watchdog_install_signal_handler()) {
+        return cat_false;
+    }
+    profiler = (cat_watchdog_profiler_t *) cat_malloc(
+        offsetof(cat_watchdog_profiler_t, samples) + sizeof(cat_watchdog_sample_t) * capacity);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(profiler == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for profiler failed");
+        return cat_false;
+    }
+#endif
+    profiler->reading = 0;
+    profiler->sample_count = 0;
+    profiler->dropped_count = 0;
+    profiler->capacity = capacity;
+
+    uv_mutex_lock(&watchdog->mutex);
+    watchdog->profiler = profiler;
+    uv_mutex_unlock(&watchdog->mutex);
+
+    return cat_true;
+#else
+    (void) capacity;
+    cat_update_last_error(CAT_ENOTSUP, "Profiler is not supported on this platform");
+    return cat_false;
+#endif
+}
+
+CAT_API cat_bool_t cat_watchdog_stop_profiler(void)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+    cat_watchdog_profiler_t *profiler;
+
+    if (watchdog == NULL || watchdog->profiler == NULL) {
+        cat_update_last_error(CAT_EMISUSE, "Profiler is not running");
+        return cat_false;
+    }
+
+    /* no more signals will be sent after unlocked,
+     * and signals in flight will see NULL in handler */
+    uv_mutex_lock(&watchdog->mutex);
+    profiler = watchdog->profiler;
+    watchdog->profiler = NULL;
+    uv_mutex_unlock(&watchdog->mutex);
+
+    cat_free(profiler);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_watchdog_is_profiling(void)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+
+    return watchdog != NULL && watchdog->profiler != NULL;
+}
+
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+static cat_watchdog_profiler_t *cat_watchdog_get_profiler(void)
+{
+    cat_watchdog_t *watchdog = CAT_WATCH_DOG_G(watchdog);
+
+    if (watchdog == NULL || watchdog->profiler == NULL) {
+        cat_update_last_error(CAT_EMISUSE, "Profiler is not running");
+        return NULL;
+    }
+
+    return watchdog->profiler;
+}
+
+static size_t cat_watchdog_profiler_get_stored_count(const cat_watchdog_profiler_t *profiler)
+{
+    return profiler->sample_count < profiler->capacity ? (size_t) profiler->sample_count : profiler->capacity;
+}
+#endif
+
+CAT_API cat_bool_t cat_watchdog_get_profiler_stats(cat_watchdog_profiler_stats_t *stats)
+{
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    cat_watchdog_profiler_t *profiler = cat_watchdog_get_profiler();
+
+    if (profiler == NULL) {
+        return cat_false;
+    }
+    profiler->reading = 1;
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    stats->sample_count = profiler->sample_count;
+    stats->dropped_count = profiler->dropped_count;
+    stats->stored_count = cat_watchdog_profiler_get_stored_count(profiler);
+    stats->capacity = profiler->capacity;
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    profiler->reading = 0;
+
+    return cat_true;
+#else
+    (void) stats;
+    cat_update_last_error(CAT_ENOTSUP, "Profiler is not supported on this platform");
+    return cat_false;
+#endif
+}
+
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+static int cat_watchdog_sample_compare(const void *p1, const void *p2)
+{
+    const cat_watchdog_sample_t *sample1 = (const cat_watchdog_sample_t *) p1;
+    const cat_watchdog_sample_t *sample2 = (const cat_watchdog_sample_t *) p2;
+
+    if (sample1->role != sample2->role) {
+        return sample1->role < sample2->role ? -1 : 1;
+    }
+    if (sample1->depth != sample2->depth) {
+        return sample1->depth < sample2->depth ? -1 : 1;
+    }
+    return memcmp(sample1->frames, sample2->frames, sizeof(*sample1->frames) * sample1->depth);
+}
+
+/* symbol is in form of "module(function+0x1f) [0x7f...]" (glibc) */
+static cat_bool_t cat_watchdog_append_frame(cat_buffer_t *buffer, const char *symbol, void *address)
+{
+    const char *start = strchr(symbol, '(');
+    const char *end = start != NULL ? strchr(start, ')') : NULL;
+
+    if (start != NULL && end != NULL && end > start + 1) {
+        const char *plus = memchr(start, '+', end - start);
+        if (plus == start + 1) {
+            /* no function name, use module+offset */
+            const char *module = start;
+            while (module > symbol && module[-1] != '/') {
+                module--;
+            }
+            return cat_buffer_append(buffer, module, start - module) &&
+                   cat_buffer_append(buffer, plus, end - plus);
+        }
+        return cat_buffer_append(buffer, start + 1, (plus != NULL ? plus : end) - (start + 1));
+    }
+
+    return cat_buffer_append_printf(buffer, "%p", address);
+}
+#endif
+
+CAT_API char *cat_watchdog_get_folded_stacks(void)
+{
+#ifdef CAT_WATCH_DOG_USE_BACKTRACE
+    cat_watchdog_profiler_t *profiler = cat_watchdog_get_profiler();
+    cat_watchdog_sample_t *samples;
+    cat_buffer_t buffer;
+    size_t count, i, n;
+
+    if (profiler == NULL) {
+        return NULL;
+    }
+    if (!cat_buffer_create(&buffer, 0)) {
+        cat_update_last_error_with_previous("Profiler create buffer failed");
+        return NULL;
+    }
+
+    /* copy samples out, so that sampling is only paused for a short while */
+    profiler->reading = 1;
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    count = cat_watchdog_profiler_get_stored_count(profiler);
+    samples = (cat_watchdog_sample_t *) cat_malloc(sizeof(*samples) * (count + 1));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(samples == NULL)) {
+        profiler->reading = 0;
+        cat_buffer_close(&buffer);
+        cat_update_last_error_of_syscall("Malloc for profiler samples failed");
+        return NULL;
+    }
+#endif
+    memcpy(samples, profiler->samples, sizeof(*samples) * count);
+    CAT_WATCH_DOG_SIGNAL_FENCE();
+    profiler->reading = 0;
+
+    qsort(samples, count, sizeof(*samples), cat_watchdog_sample_compare);
+
+    for (i = 0; i < count; i += n) {
+        const cat_watchdog_sample_t *sample = &samples[i];
+        char **symbols;
+        uint32_t depth;
+        for (n = 1; i + n < count && cat_watchdog_sample_compare(sample, &samples[i + n]) == 0; n++);
+        symbols = backtrace_symbols(sample->frames, (int) sample->depth);
+        if (unlikely(!cat_buffer_append_str(&buffer, cat_watchdog_role_name(sample->role)))) {
+            goto _error;
+        }
+        for (depth = sample->depth; depth-- > 0;) {
+            if (unlikely(!cat_buffer_append_char(&buffer, ';'))) {
+                goto _error;
+            }
+            if (symbols != NULL) {
+                if (unlikely(!cat_watchdog_append_frame(&buffer, symbols[depth], sample->frames[depth]))) {
+                    goto _error;
+                }
+            } else if (unlikely(!cat_buffer_append_printf(&buffer, "%p", sample->frames[depth]))) {
+                goto _error;
+            }
+        }
+        free(symbols);
+        if (unlikely(!cat_buffer_append_printf(&buffer, " %zu\n", n))) {
+            goto _error;
+        }
+        continue;
+        _error:
+        free(symbols);
+        cat_free(samples);
+        cat_buffer_close(&buffer);
+        cat_update_last_error_with_previous("Profiler fold stacks failed");
+        return NULL;
+    }
+    cat_free(samples);
+
+    return cat_buffer_export_str(&buffer);
+#else
+    cat_update_last_error(CAT_ENOTSUP, "Profiler is not supported on this platform");
+    return NULL;
+#endif
+}
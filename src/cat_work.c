@@ -20,6 +20,16 @@
 #include "cat_coroutine.h"
 #include "cat_event.h"
 #include "cat_time.h"
+#include "cat_env.h"
+#include "cat_atomic.h"
+
+typedef struct cat_work_batch_s {
+    cat_coroutine_t *coroutine;
+    /* contexts which are not done yet */
+    cat_queue_t contexts;
+    size_t count;
+    int status;
+} cat_work_batch_t;
 
 typedef struct cat_work_context_s {
     union {
@@ -27,23 +37,181 @@ typedef struct cat_work_context_s {
         uv_req_t req;
         uv_work_t work;
     } request;
+    /* node of cache or batch */
+    cat_queue_node_t node;
+    cat_work_batch_t *batch;
+    /* NULL if it is running on libuv thread-pool */
+    cat_work_pool_t *pool;
+    /* node of pool queues, protected by pool mutex */
+    cat_queue_node_t pool_node;
     cat_work_function_t function;
     cat_work_cleanup_callback_t cleanup;
     cat_data_t *data;
+    cat_nsec_t start_time;
+    cat_work_kind_t kind;
     int status;
+    /* state and result on pool, protected by pool mutex */
+    uint8_t pool_state;
+    int pool_status;
 } cat_work_context_t;
 
+enum cat_work_pool_context_state_e {
+    CAT_WORK_POOL_CONTEXT_STATE_WAITING,
+    CAT_WORK_POOL_CONTEXT_STATE_RUNNING,
+    CAT_WORK_POOL_CONTEXT_STATE_DONE,
+};
+
+typedef struct cat_work_pool_thread_s {
+    cat_queue_node_t node;
+    uv_thread_t tid;
+    cat_work_pool_t *pool;
+    cat_bool_t exited;
+} cat_work_pool_thread_t;
+
+struct cat_work_pool_s {
+    char *name;
+    uv_mutex_t mutex;
+    uv_cond_t cond;
+    cat_queue_t waiting_contexts;
+    cat_queue_t done_contexts;
+    cat_queue_t threads;
+    size_t thread_count;
+    size_t live_thread_count;
+    size_t max_queue_size;
+    /* NULL means no affinity */
+    char *cpumask;
+    size_t cpumask_size;
+    cat_bool_t closing;
+    uv_async_t notifier;
+    cat_event_shutdown_task_t *shutdown_task;
+    /* protected by mutex */
+    cat_work_pool_stats_t stats;
+};
+
+CAT_GLOBALS_STRUCT_BEGIN(cat_work) {
+    cat_queue_t cached_contexts;
+    cat_work_pool_t *pools[CAT_WORK_KIND_COUNT];
+    cat_work_stats_t stats;
+} CAT_GLOBALS_STRUCT_END(cat_work);
+
+CAT_GLOBALS_DECLARE(cat_work);
+
+#define CAT_WORK_G(x) CAT_GLOBALS_GET(cat_work, x)
+
+CAT_API cat_bool_t cat_work_module_init(void)
+{
+    CAT_GLOBALS_REGISTER(cat_work);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_work_module_shutdown(void)
+{
+    CAT_GLOBALS_UNREGISTER(cat_work);
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_work_runtime_init(void)
+{
+    cat_queue_init(&CAT_WORK_G(cached_contexts));
+    memset(CAT_WORK_G(pools), 0, sizeof(CAT_WORK_G(pools)));
+    memset(&CAT_WORK_G(stats), 0, sizeof(CAT_WORK_G(stats)));
+
+    return cat_true;
+}
+
+CAT_API cat_bool_t cat_work_runtime_shutdown(void)
+{
+    cat_work_context_t *context;
+
+    while ((context = cat_queue_front_data(&CAT_WORK_G(cached_contexts), cat_work_context_t, node)) != NULL) {
+        cat_queue_remove(&context->node);
+        cat_free(context);
+    }
+    CAT_WORK_G(stats.cached_context_count) = 0;
+
+    return cat_true;
+}
+
+static cat_work_context_t *cat_work_context_alloc(void)
+{
+    cat_work_context_t *context;
+
+    context = cat_queue_front_data(&CAT_WORK_G(cached_contexts), cat_work_context_t, node);
+    if (likely(context != NULL)) {
+        cat_queue_remove(&context->node);
+        CAT_WORK_G(stats.cached_context_count)--;
+        return context;
+    }
+    context = (cat_work_context_t *) cat_malloc(sizeof(*context));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(context == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for work context failed");
+        return NULL;
+    }
+#endif
+
+    return context;
+}
+
+static void cat_work_context_release(cat_work_context_t *context)
+{
+    if (CAT_WORK_G(stats.cached_context_count) < CAT_WORK_CONTEXT_CACHE_SIZE) {
+        cat_queue_push_back(&CAT_WORK_G(cached_contexts), &context->node);
+        CAT_WORK_G(stats.cached_context_count)++;
+    } else {
+        cat_free(context);
+    }
+}
+
+static cat_bool_t cat_work_submit(cat_work_context_t *context, cat_work_kind_t kind, cat_work_pool_t *pool, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data);
+static cat_bool_t cat_work_pool_submit(cat_work_pool_t *pool, cat_work_context_t *context);
+static void cat_work_pool_cancel(cat_work_pool_t *pool, cat_work_context_t *context);
+
 void cat_work_callback(uv_work_t *request)
 {
     cat_work_context_t *context = (cat_work_context_t *) request;
     context->function(context->data);
 }
 
+static void cat_work_update_stats(const cat_work_context_t *context, int status)
+{
+    cat_work_kind_stats_t *stats = &CAT_WORK_G(stats.kinds[context->kind]);
+    uint64_t latency = (cat_time_nsec() - context->start_time) / 1000;
+    size_t bucket = 0;
+
+    stats->queue_depth--;
+    if (unlikely(status != 0)) {
+        stats->canceled_count++;
+        return;
+    }
+    stats->completed_count++;
+    while ((latency >>= 1) != 0 && bucket < CAT_WORK_LATENCY_HISTOGRAM_SIZE - 1) {
+        bucket++;
+    }
+    stats->latency_histogram[bucket]++;
+}
+
 static void cat_work_after_done(uv_work_t *request, int status)
 {
     cat_work_context_t *context = (cat_work_context_t *) request;
 
-    if (likely(context->request.coroutine != NULL)) {
+    cat_work_update_stats(context, status);
+
+    if (context->batch != NULL) {
+        cat_work_batch_t *batch = context->batch;
+        cat_queue_remove(&context->node);
+        if (unlikely(status != 0) && batch->status == 0) {
+            batch->status = status;
+        }
+        /* wake up the waiter only once for the whole batch */
+        if (--batch->count == 0 && likely(batch->coroutine != NULL)) {
+            cat_coroutine_t *coroutine = batch->coroutine;
+            batch->coroutine = NULL;
+            cat_coroutine_schedule(coroutine, WORK, "Work");
+        }
+    } else if (likely(context->request.coroutine != NULL)) {
         context->status = status;
         cat_coroutine_schedule(context->request.coroutine, WORK, "Work");
     }
@@ -51,34 +219,78 @@ static void cat_work_after_done(uv_work_t *request, int status)
     if (context->cleanup != NULL) {
         context->cleanup(context->data);
     }
-    cat_free(context);
+    cat_work_context_release(context);
+}
+
+static cat_bool_t cat_work_submit(cat_work_context_t *context, cat_work_kind_t kind, cat_work_pool_t *pool, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data)
+{
+    cat_work_kind_stats_t *stats = &CAT_WORK_G(stats.kinds[kind]);
+
+    context->function = function;
+    context->cleanup = cleanup;
+    context->data = data;
+    context->kind = kind;
+    context->start_time = cat_time_nsec();
+    if (pool == NULL) {
+        pool = CAT_WORK_G(pools[kind]);
+    }
+    context->pool = pool;
+    if (pool != NULL) {
+        if (unlikely(!cat_work_pool_submit(pool, context))) {
+            return cat_false;
+        }
+    } else {
+        (void) uv_queue_work_ex(&CAT_EVENT_G(loop), &context->request.work, (uv_work_kind) kind, cat_work_callback, cat_work_after_done);
+    }
+    if (++stats->queue_depth > stats->max_queue_depth) {
+        stats->max_queue_depth = stats->queue_depth;
+    }
+
+    return cat_true;
+}
+
+static void cat_work_cancel(cat_work_context_t *context)
+{
+    if (context->pool != NULL) {
+        cat_work_pool_cancel(context->pool, context);
+    } else {
+        (void) uv_cancel(&context->request.req);
+    }
 }
 
 CAT_API cat_bool_t cat_work(cat_work_kind_t kind, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data, cat_timeout_t timeout)
 {
-    cat_work_context_t *context = (cat_work_context_t *) cat_malloc(sizeof(*context));
+    return cat_work_ex(kind, NULL, function, cleanup, data, timeout);
+}
+
+CAT_API cat_bool_t cat_work_ex(cat_work_kind_t kind, cat_work_pool_t *pool, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *data, cat_timeout_t timeout)
+{
+    cat_work_context_t *context = cat_work_context_alloc();
     cat_bool_t ret;
 
 #if CAT_ALLOC_HANDLE_ERRORS
     if (unlikely(context == NULL)) {
-        cat_update_last_error_of_syscall("Malloc for work context failed");
         if (cleanup != NULL) {
             cleanup(data);
         }
         return cat_false;
     }
 #endif
-    context->function = function;
-    context->cleanup = cleanup;
-    context->data = data;
-    (void) uv_queue_work_ex(&CAT_EVENT_G(loop), &context->request.work, (uv_work_kind) kind, cat_work_callback, cat_work_after_done);
+    context->batch = NULL;
+    if (unlikely(!cat_work_submit(context, kind, pool, function, cleanup, data))) {
+        cat_work_context_release(context);
+        if (cleanup != NULL) {
+            cleanup(data);
+        }
+        return cat_false;
+    }
     context->status = CAT_ECANCELED;
     context->request.coroutine = CAT_COROUTINE_G(current);
     ret = cat_time_wait(timeout);
     context->request.coroutine = NULL;
     if (unlikely(!ret)) {
         cat_update_last_error_with_previous("Work wait failed");
-        (void) uv_cancel(&context->request.req);
+        cat_work_cancel(context);
         return cat_false;
     }
     if (unlikely(context->status != 0)) {
@@ -88,3 +300,664 @@ CAT_API cat_bool_t cat_work(cat_work_kind_t kind, cat_work_function_t function,
 
     return cat_true;
 }
+
+CAT_API cat_bool_t cat_work_many(cat_work_kind_t kind, cat_work_function_t function, cat_work_cleanup_callback_t cleanup, cat_data_t *const *data, size_t count, cat_timeout_t timeout)
+{
+    cat_work_batch_t batch;
+    cat_work_context_t *context;
+    cat_queue_t pending;
+    size_t n;
+    cat_bool_t ret;
+
+    if (unlikely(count == 0)) {
+        return cat_true;
+    }
+    cat_queue_init(&pending);
+    /* allocate all at once, so that allocation failure never happens after submission,
+     * but pool may still reject one of them, then the submitted ones are canceled */
+    for (n = 0; n < count; n++) {
+        context = cat_work_context_alloc();
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(context == NULL)) {
+            while ((context = cat_queue_front_data(&pending, cat_work_context_t, node)) != NULL) {
+                cat_queue_remove(&context->node);
+                cat_work_context_release(context);
+            }
+            if (cleanup != NULL) {
+                for (n = 0; n < count; n++) {
+                    cleanup(data[n]);
+                }
+            }
+            return cat_false;
+        }
+#endif
+        context->batch = &batch;
+        cat_queue_push_back(&pending, &context->node);
+    }
+    cat_queue_init(&batch.contexts);
+    batch.coroutine = NULL;
+    batch.count = 0;
+    batch.status = 0;
+    for (n = 0; n < count; n++) {
+        context = cat_queue_front_data(&pending, cat_work_context_t, node);
+        cat_queue_remove(&context->node);
+        if (unlikely(!cat_work_submit(context, kind, NULL, function, cleanup, data[n]))) {
+            /* rejected by pool (queue is full), give up the rest */
+            cat_queue_push_back(&pending, &context->node);
+            while ((context = cat_queue_front_data(&pending, cat_work_context_t, node)) != NULL) {
+                cat_queue_remove(&context->node);
+                cat_work_context_release(context);
+            }
+            if (cleanup != NULL) {
+                for (; n < count; n++) {
+                    cleanup(data[n]);
+                }
+            }
+            break;
+        }
+        cat_queue_push_back(&batch.contexts, &context->node);
+        batch.count++;
+    }
+    if (likely(n == count)) {
+        batch.coroutine = CAT_COROUTINE_G(current);
+        ret = cat_time_wait(timeout);
+        batch.coroutine = NULL;
+    } else {
+        ret = cat_false;
+    }
+    if (unlikely(batch.count != 0)) {
+        /* detach and cancel all of the rest works, they will be released by themselves */
+        while ((context = cat_queue_front_data(&batch.contexts, cat_work_context_t, node)) != NULL) {
+            cat_queue_remove(&context->node);
+            context->batch = NULL;
+            context->request.coroutine = NULL;
+            cat_work_cancel(context);
+        }
+        if (unlikely(n != count)) {
+            /* last error has been set by the rejection */
+        } else if (!ret) {
+            cat_update_last_error_with_previous("Work wait failed");
+        } else {
+            cat_update_last_error(CAT_ECANCELED, "Work has been canceled");
+        }
+        return cat_false;
+    }
+    if (unlikely(n != count)) {
+        return cat_false;
+    }
+    if (unlikely(batch.status != 0)) {
+        cat_update_last_error_with_reason(batch.status, "Work failed");
+        return cat_false;
+    }
+
+    return cat_true;
+}
+
+/* parallel */
+
+typedef struct cat_work_parallel_s {
+    cat_work_parallel_function_t function;
+    cat_work_map_function_t map;
+    cat_data_t *data;
+    size_t grain;
+    /* it is set on timeout or cancellation, then the rest of slices would be skipped */
+    cat_atomic_bool_t canceled;
+    /* chunks and the waiter */
+    size_t refcount;
+} cat_work_parallel_t;
+
+typedef struct cat_work_parallel_chunk_s {
+    cat_work_parallel_t *parallel;
+    size_t begin;
+    size_t end;
+    void *partial;
+} cat_work_parallel_chunk_t;
+
+static size_t cat_work_get_thread_count(cat_work_kind_t kind)
+{
+    cat_work_pool_t *pool = CAT_WORK_G(pools[kind]);
+    size_t thread_count;
+
+    if (pool != NULL) {
+        uv_mutex_lock(&pool->mutex);
+        thread_count = pool->thread_count;
+        uv_mutex_unlock(&pool->mutex);
+    } else {
+        /* see init_threads() in libuv */
+        int size = cat_env_get_i("CAT_TPS", 0);
+        if (size <= 0) {
+            size = cat_env_get_i("UV_THREADPOOL_SIZE", 4);
+        }
+        thread_count = size > 0 ? (size_t) size : 1;
+        /* libuv runs at most half of threads for SLOW_IO */
+        if (kind == CAT_WORK_KIND_SLOW_IO) {
+            thread_count = (thread_count + 1) / 2;
+        }
+    }
+
+    return thread_count;
+}
+
+static void cat_work_parallel_chunk_function(cat_data_t *data)
+{
+    cat_work_parallel_chunk_t *chunk = (cat_work_parallel_chunk_t *) data;
+    cat_work_parallel_t *parallel = chunk->parallel;
+    size_t begin, end;
+
+    for (begin = chunk->begin; begin < chunk->end; begin = end) {
+        if (unlikely(cat_atomic_bool_load(&parallel->canceled))) {
+            return;
+        }
+        end = chunk->end - begin > parallel->grain ? begin + parallel->grain : chunk->end;
+        if (parallel->map != NULL) {
+            parallel->map(begin, end, chunk->partial, parallel->data);
+        } else {
+            parallel->function(begin, end, parallel->data);
+        }
+    }
+}
+
+static void cat_work_parallel_release(cat_data_t *data)
+{
+    cat_work_parallel_t *parallel = (cat_work_parallel_t *) data;
+
+    if (--parallel->refcount == 0) {
+        cat_free(parallel);
+    }
+}
+
+static void cat_work_parallel_chunk_cleanup(cat_data_t *data)
+{
+    cat_work_parallel_chunk_t *chunk = (cat_work_parallel_chunk_t *) data;
+
+    cat_work_parallel_release(chunk->parallel);
+}
+
+static cat_bool_t cat_work_parallel_run(
+    cat_work_kind_t kind, size_t begin, size_t end, size_t grain,
+    cat_work_parallel_function_t function, cat_work_map_function_t map, cat_work_reduce_function_t reduce,
+    void *result, size_t result_size, cat_data_t *data, cat_timeout_t timeout
+)
+{
+    cat_work_parallel_t *parallel;
+    cat_work_parallel_chunk_t *chunks;
+    cat_data_t **chunk_data;
+    char *partials;
+    size_t total, chunk_size, chunk_count, partial_size, max_chunk_count, n;
+    cat_bool_t ret;
+
+    if (unlikely(begin >= end)) {
+        return cat_true;
+    }
+    total = end - begin;
+    /* at most CHUNKS_PER_THREAD chunks for each thread, so that it would not be too fine-grained */
+    max_chunk_count = cat_work_get_thread_count(kind) * CAT_WORK_PARALLEL_CHUNKS_PER_THREAD;
+    chunk_size = (total + max_chunk_count - 1) / max_chunk_count;
+    if (chunk_size < grain) {
+        chunk_size = grain;
+    }
+    chunk_count = (total + chunk_size - 1) / chunk_size;
+    if (grain == 0) {
+        grain = chunk_size;
+    }
+    partial_size = map != NULL ? CAT_MEMORY_ALIGNED_SIZE(result_size) : 0;
+
+    /* allocate everything at once */
+    parallel = (cat_work_parallel_t *) cat_malloc(
+        CAT_MEMORY_ALIGNED_SIZE(sizeof(*parallel)) +
+        CAT_MEMORY_ALIGNED_SIZE(sizeof(*chunks) * chunk_count) +
+        CAT_MEMORY_ALIGNED_SIZE(sizeof(*chunk_data) * chunk_count) +
+        partial_size * chunk_count
+    );
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(parallel == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for parallel work failed");
+        return cat_false;
+    }
+#endif
+    chunks = (cat_work_parallel_chunk_t *) (((char *) parallel) + CAT_MEMORY_ALIGNED_SIZE(sizeof(*parallel)));
+    chunk_data = (cat_data_t **) (((char *) chunks) + CAT_MEMORY_ALIGNED_SIZE(sizeof(*chunks) * chunk_count));
+    partials = ((char *) chunk_data) + CAT_MEMORY_ALIGNED_SIZE(sizeof(*chunk_data) * chunk_count);
+    parallel->function = function;
+    parallel->map = map;
+    parallel->data = data;
+    parallel->grain = grain;
+    cat_atomic_bool_init(&parallel->canceled, cat_false);
+    parallel->refcount = chunk_count + 1;
+    for (n = 0; n < chunk_count; n++) {
+        cat_work_parallel_chunk_t *chunk = &chunks[n];
+        chunk->parallel = parallel;
+        chunk->begin = begin + n * chunk_size;
+        chunk->end = n == chunk_count - 1 ? end : chunk->begin + chunk_size;
+        if (map != NULL) {
+            chunk->partial = partials + partial_size * n;
+            memcpy(chunk->partial, result, result_size);
+        } else {
+            chunk->partial = NULL;
+        }
+        chunk_data[n] = chunk;
+    }
+
+    ret = cat_work_many(kind, cat_work_parallel_chunk_function, cat_work_parallel_chunk_cleanup, chunk_data, chunk_count, timeout);
+    if (unlikely(!ret)) {
+        /* let running chunks know that they should stop as soon as possible */
+        cat_atomic_bool_store(&parallel->canceled, cat_true);
+    } else if (map != NULL) {
+        for (n = 0; n < chunk_count; n++) {
+            reduce(result, chunks[n].partial, data);
+        }
+    }
+    cat_work_parallel_release(parallel);
+
+    return ret;
+}
+
+CAT_API cat_bool_t cat_work_parallel_for(cat_work_kind_t kind, size_t begin, size_t end, size_t grain, cat_work_parallel_function_t function, cat_data_t *data, cat_timeout_t timeout)
+{
+    return cat_work_parallel_run(kind, begin, end, grain, function, NULL, NULL, NULL, 0, data, timeout);
+}
+
+CAT_API cat_bool_t cat_work_map_reduce(cat_work_kind_t kind, size_t begin, size_t end, size_t grain, cat_work_map_function_t map, cat_work_reduce_function_t reduce, void *result, size_t result_size, cat_data_t *data, cat_timeout_t timeout)
+{
+    return cat_work_parallel_run(kind, begin, end, grain, NULL, map, reduce, result, result_size, data, timeout);
+}
+
+CAT_API const cat_work_stats_t *cat_work_get_stats(void)
+{
+    return &CAT_WORK_G(stats);
+}
+
+CAT_API void cat_work_reset_stats(void)
+{
+    size_t n;
+
+    for (n = 0; n < CAT_WORK_KIND_COUNT; n++) {
+        cat_work_kind_stats_t *stats = &CAT_WORK_G(stats.kinds[n]);
+        size_t queue_depth = stats->queue_depth;
+        memset(stats, 0, sizeof(*stats));
+        /* it is a gauge */
+        stats->queue_depth = queue_depth;
+        stats->max_queue_depth = queue_depth;
+    }
+}
+
+/* pool */
+
+static void cat_work_pool_thread_function(void *arg)
+{
+    cat_work_pool_thread_t *thread = (cat_work_pool_thread_t *) arg;
+    cat_work_pool_t *pool = thread->pool;
+    cat_work_context_t *context;
+    cat_nsec_t time;
+
+    uv_mutex_lock(&pool->mutex);
+    while (1) {
+        time = cat_time_nsec();
+        while (!pool->closing && pool->live_thread_count <= pool->thread_count && cat_queue_empty(&pool->waiting_contexts)) {
+            uv_cond_wait(&pool->cond, &pool->mutex);
+        }
+        pool->stats.idle_time += cat_time_nsec() - time;
+        if (pool->closing || pool->live_thread_count > pool->thread_count) {
+            break;
+        }
+        context = cat_queue_front_data(&pool->waiting_contexts, cat_work_context_t, pool_node);
+        cat_queue_remove(&context->pool_node);
+        context->pool_state = CAT_WORK_POOL_CONTEXT_STATE_RUNNING;
+        pool->stats.queue_depth--;
+        pool->stats.running_count++;
+        uv_mutex_unlock(&pool->mutex);
+
+        time = cat_time_nsec();
+        context->function(context->data);
+        time = cat_time_nsec() - time;
+
+        uv_mutex_lock(&pool->mutex);
+        pool->stats.busy_time += time;
+        pool->stats.running_count--;
+        pool->stats.completed_count++;
+        context->pool_state = CAT_WORK_POOL_CONTEXT_STATE_DONE;
+        context->pool_status = 0;
+        cat_queue_push_back(&pool->done_contexts, &context->pool_node);
+        (void) uv_async_send(&pool->notifier);
+    }
+    pool->live_thread_count--;
+    thread->exited = cat_true;
+    uv_mutex_unlock(&pool->mutex);
+}
+
+static void cat_work_pool_notify_callback(uv_async_t *handle)
+{
+    cat_work_pool_t *pool = cat_container_of(handle, cat_work_pool_t, notifier);
+    cat_work_context_t *context;
+    cat_queue_t done_contexts;
+
+    cat_queue_init(&done_contexts);
+    uv_mutex_lock(&pool->mutex);
+    while ((context = cat_queue_front_data(&pool->done_contexts, cat_work_context_t, pool_node)) != NULL) {
+        cat_queue_remove(&context->pool_node);
+        cat_queue_push_back(&done_contexts, &context->pool_node);
+    }
+    uv_mutex_unlock(&pool->mutex);
+
+    while ((context = cat_queue_front_data(&done_contexts, cat_work_context_t, pool_node)) != NULL) {
+        cat_queue_remove(&context->pool_node);
+        cat_work_after_done(&context->request.work, context->pool_status);
+    }
+}
+
+static void cat_work_pool_close_callback(uv_handle_t *handle)
+{
+    cat_work_pool_t *pool = cat_container_of(handle, cat_work_pool_t, notifier);
+
+    cat_free(pool);
+}
+
+static void cat_work_pool_shutdown_function(cat_data_t *data)
+{
+    cat_work_pool_t *pool = (cat_work_pool_t *) data;
+
+    /* task will be released by event module */
+    pool->shutdown_task = NULL;
+    cat_work_pool_close(pool);
+}
+
+/* join threads which have exited, it must be called without lock */
+static void cat_work_pool_join_threads(cat_work_pool_t *pool, cat_bool_t all)
+{
+    cat_work_pool_thread_t *thread;
+    cat_queue_t threads;
+
+    cat_queue_node_t *node, *next;
+
+    cat_queue_init(&threads);
+    uv_mutex_lock(&pool->mutex);
+    for (node = cat_queue_next(&pool->threads); node != &pool->threads; node = next) {
+        next = cat_queue_next(node);
+        thread = cat_queue_data(node, cat_work_pool_thread_t, node);
+        if (all || thread->exited) {
+            cat_queue_remove(node);
+            cat_queue_push_back(&threads, node);
+        }
+    }
+    uv_mutex_unlock(&pool->mutex);
+
+    while ((thread = cat_queue_front_data(&threads, cat_work_pool_thread_t, node)) != NULL) {
+        cat_queue_remove(&thread->node);
+        (void) uv_thread_join(&thread->tid);
+        cat_free(thread);
+    }
+}
+
+CAT_API void cat_work_pool_options_init(cat_work_pool_options_t *options)
+{
+    options->name = NULL;
+    options->thread_count = 4;
+    options->max_queue_size = 0;
+    options->cpus = NULL;
+    options->cpu_count = 0;
+}
+
+CAT_API cat_work_pool_t *cat_work_pool_create(const cat_work_pool_options_t *options)
+{
+    cat_work_pool_options_t default_options;
+    cat_work_pool_t *pool;
+    int error;
+
+    if (options == NULL) {
+        cat_work_pool_options_init(&default_options);
+        options = &default_options;
+    }
+    if (unlikely(options->thread_count == 0)) {
+        cat_update_last_error(CAT_EINVAL, "Work pool thread count can not be 0");
+        return NULL;
+    }
+    pool = (cat_work_pool_t *) cat_malloc(sizeof(*pool));
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(pool == NULL)) {
+        cat_update_last_error_of_syscall("Malloc for work pool failed");
+        return NULL;
+    }
+#endif
+    memset(pool, 0, sizeof(*pool));
+    if (options->cpu_count > 0) {
+        int size = uv_cpumask_size();
+        size_t n;
+        if (unlikely(size < 0)) {
+            cat_update_last_error_with_reason(size, "Work pool CPU affinity is not supported");
+            goto _cpumask_error;
+        }
+        pool->cpumask_size = (size_t) size;
+        pool->cpumask = (char *) cat_malloc(pool->cpumask_size);
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(pool->cpumask == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for work pool CPU mask failed");
+            goto _cpumask_error;
+        }
+#endif
+        memset(pool->cpumask, 0, pool->cpumask_size);
+        for (n = 0; n < options->cpu_count; n++) {
+            int cpu = options->cpus[n];
+            if (unlikely(cpu < 0 || (size_t) cpu >= pool->cpumask_size)) {
+                cat_update_last_error(CAT_EINVAL, "Work pool CPU %d is out of range [0, %zu)", cpu, pool->cpumask_size);
+                goto _cpumask_error;
+            }
+            pool->cpumask[cpu] = 1;
+        }
+    }
+    pool->name = cat_strdup(options->name != NULL ? options->name : "unnamed");
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(pool->name == NULL)) {
+        cat_update_last_error_of_syscall("Strdup for work pool name failed");
+        goto _name_error;
+    }
+#endif
+    error = uv_mutex_init(&pool->mutex);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "Work pool mutex init failed");
+        goto _mutex_init_error;
+    }
+    error = uv_cond_init(&pool->cond);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "Work pool cond init failed");
+        goto _cond_init_error;
+    }
+    error = uv_async_init(&CAT_EVENT_G(loop), &pool->notifier, cat_work_pool_notify_callback);
+    if (unlikely(error != 0)) {
+        cat_update_last_error_with_reason(error, "Work pool notifier init failed");
+        goto _async_init_error;
+    }
+    /* pool should not keep the loop alive */
+    uv_unref((uv_handle_t *) &pool->notifier);
+    cat_queue_init(&pool->waiting_contexts);
+    cat_queue_init(&pool->done_contexts);
+    cat_queue_init(&pool->threads);
+    pool->max_queue_size = options->max_queue_size;
+    pool->shutdown_task = cat_event_register_runtime_shutdown_task(cat_work_pool_shutdown_function, pool);
+#if CAT_ALLOC_HANDLE_ERRORS
+    if (unlikely(pool->shutdown_task == NULL)) {
+        cat_work_pool_close(pool);
+        return NULL;
+    }
+#endif
+    if (unlikely(!cat_work_pool_set_thread_count(pool, options->thread_count))) {
+        cat_work_pool_close(pool);
+        return NULL;
+    }
+
+    return pool;
+
+    _async_init_error:
+    uv_cond_destroy(&pool->cond);
+    _cond_init_error:
+    uv_mutex_destroy(&pool->mutex);
+    _mutex_init_error:
+    cat_free(pool->name);
+#if CAT_ALLOC_HANDLE_ERRORS
+    _name_error:
+#endif
+    _cpumask_error:
+    if (pool->cpumask != NULL) {
+        cat_free(pool->cpumask);
+    }
+    cat_free(pool);
+    return NULL;
+}
+
+CAT_API void cat_work_pool_close(cat_work_pool_t *pool)
+{
+    cat_work_context_t *context;
+    size_t n;
+
+    uv_mutex_lock(&pool->mutex);
+    while ((context = cat_queue_front_data(&pool->waiting_contexts, cat_work_context_t, pool_node)) != NULL) {
+        cat_queue_remove(&context->pool_node);
+        context->pool_state = CAT_WORK_POOL_CONTEXT_STATE_DONE;
+        context->pool_status = CAT_ECANCELED;
+        cat_queue_push_back(&pool->done_contexts, &context->pool_node);
+        pool->stats.queue_depth--;
+        pool->stats.canceled_count++;
+    }
+    pool->closing = cat_true;
+    uv_cond_broadcast(&pool->cond);
+    uv_mutex_unlock(&pool->mutex);
+
+    cat_work_pool_join_threads(pool, cat_true);
+    /* notifier will never be called after close, so we must deliver all of results here */
+    cat_work_pool_notify_callback(&pool->notifier);
+
+    for (n = 0; n < CAT_WORK_KIND_COUNT; n++) {
+        if (CAT_WORK_G(pools[n]) == pool) {
+            CAT_WORK_G(pools[n]) = NULL;
+        }
+    }
+    if (pool->shutdown_task != NULL) {
+        cat_event_unregister_runtime_shutdown_task(pool->shutdown_task);
+    }
+    uv_cond_destroy(&pool->cond);
+    uv_mutex_destroy(&pool->mutex);
+    cat_free(pool->name);
+    if (pool->cpumask != NULL) {
+        cat_free(pool->cpumask);
+    }
+    uv_close((uv_handle_t *) &pool->notifier, cat_work_pool_close_callback);
+}
+
+CAT_API const char *cat_work_pool_get_name(const cat_work_pool_t *pool)
+{
+    return pool->name;
+}
+
+CAT_API cat_bool_t cat_work_pool_set_thread_count(cat_work_pool_t *pool, size_t thread_count)
+{
+    cat_bool_t ret = cat_true;
+
+    if (unlikely(thread_count == 0)) {
+        cat_update_last_error(CAT_EINVAL, "Work pool thread count can not be 0");
+        return cat_false;
+    }
+
+    uv_mutex_lock(&pool->mutex);
+    pool->thread_count = thread_count;
+    while (pool->live_thread_count < pool->thread_count) {
+        cat_work_pool_thread_t *thread;
+        int error;
+        thread = (cat_work_pool_thread_t *) cat_malloc(sizeof(*thread));
+#if CAT_ALLOC_HANDLE_ERRORS
+        if (unlikely(thread == NULL)) {
+            cat_update_last_error_of_syscall("Malloc for work pool thread failed");
+            pool->thread_count = pool->live_thread_count;
+            ret = cat_false;
+            break;
+        }
+#endif
+        thread->pool = pool;
+        thread->exited = cat_false;
+        error = uv_thread_create(&thread->tid, cat_work_pool_thread_function, thread);
+        if (unlikely(error != 0)) {
+            cat_update_last_error_with_reason(error, "Work pool thread create failed");
+            cat_free(thread);
+            pool->thread_count = pool->live_thread_count;
+            ret = cat_false;
+            break;
+        }
+        if (pool->cpumask != NULL) {
+            error = uv_thread_setaffinity(&thread->tid, pool->cpumask, NULL, pool->cpumask_size);
+            if (unlikely(error != 0)) {
+                CAT_WARN_WITH_REASON(WORK, error, "Work pool thread set affinity failed");
+            }
+        }
+        cat_queue_push_back(&pool->threads, &thread->node);
+        pool->live_thread_count++;
+    }
+    /* let the redundant threads exit */
+    if (pool->live_thread_count > pool->thread_count) {
+        uv_cond_broadcast(&pool->cond);
+    }
+    uv_mutex_unlock(&pool->mutex);
+
+    cat_work_pool_join_threads(pool, cat_false);
+
+    return ret;
+}
+
+CAT_API void cat_work_pool_get_stats(cat_work_pool_t *pool, cat_work_pool_stats_t *stats)
+{
+    uint64_t total_time;
+
+    uv_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    stats->thread_count = pool->live_thread_count;
+    uv_mutex_unlock(&pool->mutex);
+    total_time = stats->busy_time + stats->idle_time;
+    stats->utilization = total_time != 0 ? ((double) stats->busy_time) / total_time : 0;
+}
+
+static cat_bool_t cat_work_pool_submit(cat_work_pool_t *pool, cat_work_context_t *context)
+{
+    uv_mutex_lock(&pool->mutex);
+    if (unlikely(pool->max_queue_size != 0 && pool->stats.queue_depth >= pool->max_queue_size)) {
+        pool->stats.rejected_count++;
+        uv_mutex_unlock(&pool->mutex);
+        cat_update_last_error(CAT_EAGAIN, "Work pool (%s) queue is full", pool->name);
+        return cat_false;
+    }
+    context->pool_state = CAT_WORK_POOL_CONTEXT_STATE_WAITING;
+    cat_queue_push_back(&pool->waiting_contexts, &context->pool_node);
+    if (++pool->stats.queue_depth > pool->stats.max_queue_depth) {
+        pool->stats.max_queue_depth = pool->stats.queue_depth;
+    }
+    uv_cond_signal(&pool->cond);
+    uv_mutex_unlock(&pool->mutex);
+
+    return cat_true;
+}
+
+static void cat_work_pool_cancel(cat_work_pool_t *pool, cat_work_context_t *context)
+{
+    uv_mutex_lock(&pool->mutex);
+    if (context->pool_state != CAT_WORK_POOL_CONTEXT_STATE_WAITING) {
+        /* it is running, we can only wait for it */
+        uv_mutex_unlock(&pool->mutex);
+        return;
+    }
+    cat_queue_remove(&context->pool_node);
+    context->pool_state = CAT_WORK_POOL_CONTEXT_STATE_DONE;
+    context->pool_status = CAT_ECANCELED;
+    cat_queue_push_back(&pool->done_contexts, &context->pool_node);
+    pool->stats.queue_depth--;
+    pool->stats.canceled_count++;
+    uv_mutex_unlock(&pool->mutex);
+    (void) uv_async_send(&pool->notifier);
+}
+
+CAT_API void cat_work_set_pool(cat_work_kind_t kind, cat_work_pool_t *pool)
+{
+    CAT_ASSERT(kind >= 0 && kind < CAT_WORK_KIND_COUNT);
+    CAT_WORK_G(pools[kind]) = pool;
+}
+
+CAT_API cat_work_pool_t *cat_work_get_pool(cat_work_kind_t kind)
+{
+    CAT_ASSERT(kind >= 0 && kind < CAT_WORK_KIND_COUNT);
+    return CAT_WORK_G(pools[kind]);
+}
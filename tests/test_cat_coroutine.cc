@@ -19,6 +19,8 @@
 
 #include "test.h"
 
+#include <vector>
+
 #if 0
 TEST(cat_coroutine, stackoverflow)
 {
@@ -592,6 +594,239 @@ TEST(cat_coroutine, set_mesc_time_function)
     ASSERT_TRUE(cat_coroutine_resume(coroutine, nullptr, nullptr));
 }
 
+TEST(cat_coroutine, accounting)
+{
+    cat_coroutine_t *busy, *victim;
+    cat_nsec_t victim_wait_time = 0;
+    bool done = false;
+
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    ASSERT_FALSE(cat_coroutine_is_accounting_enabled());
+    cat_coroutine_enable_accounting();
+    DEFER(cat_coroutine_disable_accounting());
+    ASSERT_TRUE(cat_coroutine_is_accounting_enabled());
+    /* let event start tracking the ready time */
+    ASSERT_TRUE(cat_time_delay(0));
+
+    busy = co([&] {
+        ASSERT_TRUE(cat_time_delay(0));
+        cat_sys_usleep(20 * 1000);
+        ASSERT_TRUE(cat_time_delay(0));
+        while (!done) {
+            ASSERT_TRUE(cat_time_delay(0));
+        }
+    });
+    victim = co([&] {
+        ASSERT_TRUE(cat_time_delay(0));
+        /* busy one ran before us in the same round */
+        victim_wait_time = cat_coroutine_get_wait_time(cat_coroutine_get_current());
+        while (!done) {
+            ASSERT_TRUE(cat_time_delay(0));
+        }
+    });
+    DEFER({
+        done = true;
+        cat_coroutine_wait_all();
+    });
+    ASSERT_TRUE(cat_time_delay(0));
+
+    ASSERT_GE(cat_coroutine_get_cpu_time(busy), 20 * 1000 * 1000);
+    ASSERT_GE(cat_coroutine_get_max_slice(busy), 20 * 1000 * 1000);
+    ASSERT_LT(cat_coroutine_get_max_slice(victim), cat_coroutine_get_max_slice(busy));
+    ASSERT_GE(victim_wait_time, 20 * 1000 * 1000);
+    ASSERT_LT(cat_coroutine_get_wait_time(busy), victim_wait_time);
+
+    cat_coroutine_t *top[2];
+    ASSERT_EQ(cat_coroutine_get_top(top, 1, CAT_COROUTINE_ACCOUNTING_KEY_MAX_SLICE), 1);
+    ASSERT_EQ(top[0], busy);
+    ASSERT_EQ(cat_coroutine_get_top(top, CAT_ARRAY_SIZE(top), CAT_COROUTINE_ACCOUNTING_KEY_CPU_TIME), 2);
+    ASSERT_EQ(top[0], busy);
+    ASSERT_GE(cat_coroutine_get_cpu_time(top[0]), cat_coroutine_get_cpu_time(top[1]));
+    ASSERT_EQ(cat_coroutine_get_top(top, 0, CAT_COROUTINE_ACCOUNTING_KEY_WAIT_TIME), 0);
+
+    testing::internal::CaptureStdout();
+    cat_coroutine_dump_top(2, CAT_COROUTINE_ACCOUNTING_KEY_CPU_TIME);
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_NE(output.find("#1   R" + std::to_string(busy->id)), std::string::npos);
+    ASSERT_NE(output.find("max_slice: "), std::string::npos);
+}
+
+TEST(cat_coroutine, local)
+{
+    static size_t destructed;
+    cat_coroutine_local_key_t key, key2;
+
+    destructed = 0;
+    ASSERT_TRUE(cat_coroutine_local_key_create(&key, [](cat_data_t *value) {
+        destructed += (size_t) (uintptr_t) value;
+    }));
+    DEFER(cat_coroutine_local_key_delete(key));
+    ASSERT_TRUE(cat_coroutine_local_key_create(&key2, nullptr));
+    DEFER(cat_coroutine_local_key_delete(key2));
+    ASSERT_NE(key, key2);
+
+    cat_coroutine_t *coroutine = co([=] {
+        ASSERT_EQ(cat_coroutine_local_get(key), nullptr);
+        ASSERT_TRUE(cat_coroutine_local_set(key, (cat_data_t *) (uintptr_t) 1));
+        ASSERT_TRUE(cat_coroutine_local_set(key2, (cat_data_t *) (uintptr_t) 2));
+        ASSERT_TRUE(cat_time_delay(0));
+        ASSERT_EQ(cat_coroutine_local_get(key), (cat_data_t *) (uintptr_t) 1);
+        ASSERT_EQ(cat_coroutine_local_get(key2), (cat_data_t *) (uintptr_t) 2);
+        ASSERT_TRUE(cat_coroutine_local_set(key, (cat_data_t *) (uintptr_t) 3));
+    });
+    /* values are isolated */
+    ASSERT_EQ(cat_coroutine_get_local(coroutine, key), (cat_data_t *) (uintptr_t) 1);
+    ASSERT_EQ(cat_coroutine_local_get(key), nullptr);
+    co([=] {
+        /* no allocation if it is never set */
+        ASSERT_TRUE(cat_coroutine_local_set(key, nullptr));
+        ASSERT_EQ(cat_coroutine_get_current()->locals, nullptr);
+        ASSERT_EQ(cat_coroutine_local_get(key), nullptr);
+    });
+    ASSERT_EQ(destructed, 0);
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    /* destructor is called with the last value on exit */
+    ASSERT_EQ(destructed, 3);
+
+    /* invalid keys */
+    ASSERT_FALSE(cat_coroutine_local_set(CAT_COROUTINE_LOCAL_MAX_KEYS, nullptr));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+    ASSERT_EQ(cat_coroutine_local_get(CAT_COROUTINE_LOCAL_MAX_KEYS), nullptr);
+    ASSERT_FALSE(cat_coroutine_local_key_delete(CAT_COROUTINE_LOCAL_MAX_KEYS));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+TEST(cat_coroutine, local_key_reuse)
+{
+    static size_t destructed;
+    cat_coroutine_local_key_t key, key2;
+
+    destructed = 0;
+    ASSERT_TRUE(cat_coroutine_local_key_create(&key, nullptr));
+    cat_coroutine_t *coroutine = co([=] {
+        ASSERT_TRUE(cat_coroutine_local_set(key, (cat_data_t *) (uintptr_t) 1));
+        ASSERT_TRUE(cat_time_delay(0));
+    });
+    ASSERT_TRUE(cat_coroutine_local_set(key, (cat_data_t *) (uintptr_t) 1));
+    ASSERT_TRUE(cat_coroutine_local_key_delete(key));
+
+    /* the slot may be reused, but values of the deleted key are not inherited */
+    ASSERT_TRUE(cat_coroutine_local_key_create(&key2, [](cat_data_t *value) {
+        destructed++;
+    }));
+    DEFER(cat_coroutine_local_key_delete(key2));
+    ASSERT_EQ(cat_coroutine_local_get(key2), nullptr);
+    ASSERT_EQ(cat_coroutine_get_local(coroutine, key2), nullptr);
+    ASSERT_TRUE(cat_coroutine_local_set(key2, (cat_data_t *) (uintptr_t) 2));
+    ASSERT_EQ(cat_coroutine_local_get(key2), (cat_data_t *) (uintptr_t) 2);
+    ASSERT_TRUE(cat_coroutine_local_set(key2, nullptr));
+    /* stale value is not destructed by the new key */
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    ASSERT_EQ(destructed, 0);
+}
+
+TEST(cat_coroutine, local_key_exhausted)
+{
+    std::vector<cat_coroutine_local_key_t> keys;
+    cat_coroutine_local_key_t key;
+
+    while (cat_coroutine_local_key_create(&key, nullptr)) {
+        keys.push_back(key);
+    }
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAGAIN);
+    ASSERT_LE(keys.size(), CAT_COROUTINE_LOCAL_MAX_KEYS);
+    for (auto key : keys) {
+        ASSERT_TRUE(cat_coroutine_local_key_delete(key));
+    }
+    ASSERT_FALSE(cat_coroutine_local_key_delete(keys[0]));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+TEST(cat_coroutine, priority)
+{
+    cat_coroutine_t *current = cat_coroutine_get_current();
+    cat_coroutine_priority_t original_priority = cat_coroutine_get_priority(current);
+
+    ASSERT_EQ(original_priority, CAT_COROUTINE_PRIORITY_NORMAL);
+    ASSERT_STREQ(cat_coroutine_priority_name(CAT_COROUTINE_PRIORITY_HIGH), "high");
+    ASSERT_STREQ(cat_coroutine_priority_name(CAT_COROUTINE_PRIORITY_LOW), "low");
+    cat_coroutine_set_priority(current, CAT_COROUTINE_PRIORITY_LOW);
+    DEFER(cat_coroutine_set_priority(current, original_priority));
+    co([] {
+        /* it is inherited from creator */
+        ASSERT_EQ(cat_coroutine_get_priority(cat_coroutine_get_current()), CAT_COROUTINE_PRIORITY_LOW);
+    });
+}
+
+TEST(cat_coroutine, ready_queue)
+{
+    typedef std::vector<std::pair<char, cat_coroutine_priority_t>> receivers_t;
+    cat_socket_t sender;
+    std::string order;
+
+    ASSERT_NE(cat_socket_create(&sender, CAT_SOCKET_TYPE_UDP4), nullptr);
+    DEFER(cat_socket_close(&sender));
+    ASSERT_FALSE(cat_coroutine_is_ready_queue_enabled());
+    cat_coroutine_enable_ready_queue();
+    DEFER(cat_coroutine_disable_ready_queue());
+    cat_coroutine_reset_ready_stats();
+
+    /* all of them become readable in the same round */
+    auto run = [&](const receivers_t &receivers) {
+        std::vector<cat_socket_t> sockets(receivers.size());
+        order.clear();
+        for (size_t n = 0; n < receivers.size(); n++) {
+            cat_socket_t *socket = &sockets[n];
+            char id = receivers[n].first;
+            ASSERT_NE(cat_socket_create(socket, CAT_SOCKET_TYPE_UDP4), nullptr);
+            ASSERT_TRUE(cat_socket_bind_to(socket, CAT_STRL(TEST_LISTEN_IPV4), 0));
+            cat_coroutine_t *coroutine = co([&order, socket, id] {
+                char buffer[1];
+                ASSERT_EQ(cat_socket_recv(socket, buffer, sizeof(buffer)), 1);
+                order += id;
+            });
+            cat_coroutine_set_priority(coroutine, receivers[n].second);
+        }
+        for (auto &socket : sockets) {
+            ASSERT_EQ(cat_socket_try_send_to(&sender, CAT_STRL("x"), CAT_STRL(TEST_LISTEN_IPV4), cat_socket_get_sock_port(&socket)), 1);
+        }
+        ASSERT_TRUE(cat_coroutine_wait_all());
+        ASSERT_EQ(cat_coroutine_get_ready_count(), 0);
+        for (auto &socket : sockets) {
+            cat_socket_close(&socket);
+        }
+    };
+
+    run({ { 'l', CAT_COROUTINE_PRIORITY_LOW }, { 'n', CAT_COROUTINE_PRIORITY_NORMAL }, { 'h', CAT_COROUTINE_PRIORITY_HIGH } });
+    ASSERT_EQ(order, "hnl");
+
+    cat_coroutine_ready_stats_t stats;
+    ASSERT_TRUE(cat_coroutine_get_ready_stats(CAT_COROUTINE_PRIORITY_HIGH, &stats));
+    ASSERT_EQ(stats.length, 0);
+    ASSERT_EQ(stats.queued_count, 1);
+    ASSERT_EQ(stats.resumed_count, 1);
+    ASSERT_TRUE(cat_coroutine_get_ready_stats(CAT_COROUTINE_PRIORITY_LOW, &stats));
+    ASSERT_EQ(stats.resumed_count, 1);
+    ASSERT_GE(stats.total_latency, stats.max_latency);
+    ASSERT_FALSE(cat_coroutine_get_ready_stats((cat_coroutine_priority_t) CAT_COROUTINE_PRIORITY_COUNT, &stats));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+
+    /* strict priority */
+    uint32_t original_limit = cat_coroutine_set_ready_starvation_limit(0);
+    DEFER(cat_coroutine_set_ready_starvation_limit(original_limit));
+    run({ { 'l', CAT_COROUTINE_PRIORITY_LOW }, { 'h', CAT_COROUTINE_PRIORITY_HIGH }, { 'h', CAT_COROUTINE_PRIORITY_HIGH } });
+    ASSERT_EQ(order, "hhl");
+
+    /* the low one is served after every higher one */
+    ASSERT_EQ(cat_coroutine_set_ready_starvation_limit(1), 0);
+    run({ { 'l', CAT_COROUTINE_PRIORITY_LOW }, { 'h', CAT_COROUTINE_PRIORITY_HIGH }, { 'h', CAT_COROUTINE_PRIORITY_HIGH } });
+    ASSERT_EQ(order, "hlh");
+
+    cat_coroutine_reset_ready_stats();
+    ASSERT_TRUE(cat_coroutine_get_ready_stats(CAT_COROUTINE_PRIORITY_HIGH, &stats));
+    ASSERT_EQ(stats.resumed_count, 0);
+}
+
 TEST(cat_coroutine, get_role_name)
 {
     defer([] {
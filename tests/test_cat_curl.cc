@@ -114,6 +114,278 @@ TEST(cat_curl, timeout)
     ASSERT_EQ(response.find(TEST_REMOTE_HTTP_SERVER_KEYWORD), std::string::npos);
 }
 
+/* local HTTP/1.1 server which keeps connections alive */
+class test_curl_keepalive_server
+{
+public:
+    int port = 0;
+    size_t connection_count = 0;
+    size_t request_count = 0;
+
+    test_curl_keepalive_server()
+    {
+        co([this] {
+            wg++;
+            DEFER(wg--);
+            cat_socket_t server;
+            ASSERT_NE(cat_socket_create(&server, CAT_SOCKET_TYPE_TCP), nullptr);
+            DEFER(cat_socket_close(&server));
+            ASSERT_TRUE(cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+            ASSERT_TRUE(cat_socket_listen(&server, TEST_SERVER_BACKLOG));
+            ASSERT_GT(port = cat_socket_get_sock_port(&server), 0);
+            coroutines.insert(cat_coroutine_get_current());
+            DEFER(coroutines.erase(cat_coroutine_get_current()));
+            while (true) {
+                cat_socket_t *connection = cat_socket_create(nullptr, CAT_SOCKET_TYPE_TCP);
+                if (!cat_socket_accept(&server, connection)) {
+                    cat_socket_close(connection);
+                    break;
+                }
+                connection_count++;
+                co([this, connection] {
+                    wg++;
+                    DEFER(wg--);
+                    DEFER(cat_socket_close(connection));
+                    coroutines.insert(cat_coroutine_get_current());
+                    DEFER(coroutines.erase(cat_coroutine_get_current()));
+                    std::string request;
+                    while (true) {
+                        char buffer[TEST_BUFFER_SIZE_STD];
+                        ssize_t n = cat_socket_recv(connection, CAT_STRS(buffer));
+                        if (n <= 0) {
+                            break;
+                        }
+                        request.append(buffer, n);
+                        size_t end;
+                        while ((end = request.find("\r\n\r\n")) != std::string::npos) {
+                            request.erase(0, end + 4);
+                            request_count++;
+                            const char *response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+                            if (!cat_socket_send(connection, response, strlen(response))) {
+                                return;
+                            }
+                        }
+                    }
+                });
+            }
+        });
+    }
+
+    ~test_curl_keepalive_server()
+    {
+        while (!coroutines.empty()) {
+            cat_coroutine_resume(*coroutines.begin(), nullptr, nullptr);
+        }
+        wg();
+    }
+
+    std::string url()
+    {
+        return "http://" TEST_LISTEN_IPV4 ":" + std::to_string(port) + "/";
+    }
+
+private:
+    wait_group wg;
+    std::set<cat_coroutine_t *> coroutines;
+};
+
+static CURLcode cat_curl_query_local(const std::string &url, std::string &response)
+{
+    CURL *ch;
+    CURLcode code;
+    cat_buffer_t buffer;
+
+    if (!cat_buffer_create(&buffer, 0)) {
+        return CURLE_OUT_OF_MEMORY;
+    }
+    ch = curl_easy_init();
+    if (ch == nullptr) {
+        return CURLE_FAILED_INIT;
+    }
+    curl_easy_setopt(ch, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(ch, CURLOPT_NOPROXY, "*");
+    curl_easy_setopt(ch, CURLOPT_WRITEFUNCTION, cat_curl_write_function);
+    curl_easy_setopt(ch, CURLOPT_WRITEDATA, &buffer);
+    curl_easy_setopt(ch, CURLOPT_TIMEOUT_MS, (long) TEST_IO_TIMEOUT);
+    code = cat_curl_easy_perform(ch);
+    response = std::string(buffer.value, buffer.length);
+    cat_buffer_close(&buffer);
+    curl_easy_cleanup(ch);
+
+    return code;
+}
+
+TEST(cat_curl, shared_connection_reuse)
+{
+    ASSERT_TRUE(cat_coroutine_wait_all()); // for accurate stats
+    test_curl_keepalive_server server;
+    cat_curl_stats_t stats = *cat_curl_get_stats();
+    const size_t count = 8;
+
+    ASSERT_TRUE(cat_curl_is_shared_enabled());
+    ASSERT_NE(cat_curl_get_share(), nullptr);
+    for (size_t n = 0; n < count; n++) {
+        std::string response;
+        ASSERT_EQ(cat_curl_query_local(server.url(), response), CURLE_OK);
+        ASSERT_EQ(response, "hello");
+    }
+    /* connection is reused across easy handles */
+    ASSERT_EQ(server.connection_count, 1);
+    ASSERT_EQ(server.request_count, count);
+    ASSERT_EQ(cat_curl_get_stats()->transfer_count - stats.transfer_count, count);
+    ASSERT_EQ(cat_curl_get_stats()->new_connection_count - stats.new_connection_count, 1);
+    ASSERT_EQ(cat_curl_get_stats()->reused_connection_count - stats.reused_connection_count, count - 1);
+}
+
+TEST(cat_curl, shared_concurrency)
+{
+    test_curl_keepalive_server server;
+    const size_t concurrency = 8, count = 4;
+    wait_group wg;
+
+    for (size_t c = 0; c < concurrency; c++) {
+        co([&] {
+            wg++;
+            DEFER(wg--);
+            for (size_t n = 0; n < count; n++) {
+                std::string response;
+                ASSERT_EQ(cat_curl_query_local(server.url(), response), CURLE_OK);
+                ASSERT_EQ(response, "hello");
+            }
+        });
+    }
+    ASSERT_TRUE(wg());
+    ASSERT_EQ(server.request_count, concurrency * count);
+    /* HTTP/1.1 can not be multiplexed, but connections are still reused */
+    ASSERT_LE(server.connection_count, concurrency);
+}
+
+TEST(cat_curl, shared_reactor)
+{
+    test_curl_keepalive_server server;
+    const size_t concurrency = 128;
+    cat_curl_stats_t stats = *cat_curl_get_stats();
+    wait_group wg;
+
+    for (size_t c = 0; c < concurrency; c++) {
+        co([&] {
+            wg++;
+            DEFER(wg--);
+            std::string response;
+            ASSERT_EQ(cat_curl_query_local(server.url(), response), CURLE_OK);
+            ASSERT_EQ(response, "hello");
+        });
+    }
+    ASSERT_TRUE(wg());
+    ASSERT_EQ(server.request_count, concurrency);
+    ASSERT_EQ(cat_curl_get_stats()->transfer_count - stats.transfer_count, concurrency);
+    /* sockets are only acted on when they are ready, and events of the same round are handled at once */
+    ASSERT_GT(cat_curl_get_stats()->socket_action_count - stats.socket_action_count, 0);
+    ASSERT_LT(cat_curl_get_stats()->socket_action_count - stats.socket_action_count, concurrency * 8);
+    ASSERT_LT(cat_curl_get_stats()->reactor_wakeup_count - stats.reactor_wakeup_count, concurrency * 8);
+}
+
+TEST(cat_curl, shared_cancel)
+{
+    /* server never responds */
+    cat_socket_t server;
+    ASSERT_NE(cat_socket_create(&server, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&server));
+    ASSERT_TRUE(cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(&server, TEST_SERVER_BACKLOG));
+    std::string url = "http://" TEST_LISTEN_IPV4 ":" + std::to_string(cat_socket_get_sock_port(&server)) + "/";
+
+    wait_group wg;
+    cat_coroutine_t *coroutine = co([&] {
+        wg++;
+        DEFER(wg--);
+        std::string response;
+        ASSERT_NE(cat_curl_query_local(url, response), CURLE_OK);
+    });
+    ASSERT_EQ(cat_time_usleep(10 * 1000), 0);
+    cat_coroutine_resume(coroutine, nullptr, nullptr);
+    ASSERT_TRUE(wg());
+
+    /* reactor can be restarted */
+    test_curl_keepalive_server keepalive_server;
+    std::string response;
+    ASSERT_EQ(cat_curl_query_local(keepalive_server.url(), response), CURLE_OK);
+    ASSERT_EQ(response, "hello");
+}
+
+struct test_curl_yield_context {
+    cat_coroutine_t *waiter;
+    size_t count;
+};
+
+static size_t test_curl_yield_write_function(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    test_curl_yield_context *context = (test_curl_yield_context *) userdata;
+    (void) ptr;
+
+    /* callbacks must not yield, but a mistaken one must not break the reactor */
+    if (context->count++ == 0) {
+        cat_coroutine_resume(context->waiter, nullptr, nullptr);
+        (void) cat_time_msleep(10);
+    }
+
+    return size * nmemb;
+}
+
+TEST(cat_curl, shared_cancel_in_callback)
+{
+    test_curl_keepalive_server server;
+    test_curl_yield_context context;
+    std::string url = server.url();
+    CURLcode code = CURLE_OK;
+    wait_group wg;
+
+    context.waiter = cat_coroutine_get_current();
+    context.count = 0;
+    cat_coroutine_t *coroutine = co([&] {
+        wg++;
+        DEFER(wg--);
+        CURL *ch = curl_easy_init();
+        ASSERT_NE(ch, nullptr);
+        DEFER(curl_easy_cleanup(ch));
+        curl_easy_setopt(ch, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(ch, CURLOPT_NOPROXY, "*");
+        curl_easy_setopt(ch, CURLOPT_WRITEFUNCTION, test_curl_yield_write_function);
+        curl_easy_setopt(ch, CURLOPT_WRITEDATA, &context);
+        curl_easy_setopt(ch, CURLOPT_TIMEOUT_MS, (long) TEST_IO_TIMEOUT);
+        code = cat_curl_easy_perform(ch);
+    });
+    /* reactor is sleeping in the write callback of transfer now */
+    ASSERT_TRUE(cat_time_wait(TEST_IO_TIMEOUT));
+    ASSERT_EQ(context.count, 1);
+    /* owner is cancelled, it must wait for reactor to leave curl before removing handle */
+    cat_coroutine_resume(coroutine, nullptr, nullptr);
+    ASSERT_TRUE(wg());
+    ASSERT_NE(code, CURLE_OK);
+
+    /* reactor still works */
+    std::string response;
+    ASSERT_EQ(cat_curl_query_local(url, response), CURLE_OK);
+    ASSERT_EQ(response, "hello");
+}
+
+TEST(cat_curl, shared_disabled)
+{
+    test_curl_keepalive_server server;
+    const size_t count = 4;
+
+    ASSERT_TRUE(cat_curl_enable_shared(cat_false));
+    DEFER(cat_curl_enable_shared(cat_true));
+    ASSERT_FALSE(cat_curl_is_shared_enabled());
+    for (size_t n = 0; n < count; n++) {
+        std::string response;
+        ASSERT_EQ(cat_curl_query_local(server.url(), response), CURLE_OK);
+        ASSERT_EQ(response, "hello");
+    }
+    /* every private multi has its own connection cache */
+    ASSERT_EQ(server.connection_count, count);
+}
+
 TEST(cat_curl, busy)
 {
     CURL *ch;
@@ -115,3 +115,401 @@ TEST(cat_dns, nospc)
     }
 #endif
 }
+
+/* stub resolver */
+
+namespace testing
+{
+    class fake_dns_server
+    {
+    protected:
+        cat_socket_t udp_server;
+        cat_socket_t tcp_server;
+        wait_group wg;
+
+        static std::string build_response(const char *query, size_t length, bool over_tcp)
+        {
+            size_t offset = 12;
+            std::string name;
+            while (offset < length && query[offset] != 0) {
+                size_t label_length = (unsigned char) query[offset];
+                if (!name.empty()) {
+                    name += '.';
+                }
+                name.append(query + offset + 1, label_length);
+                offset += 1 + label_length;
+            }
+            offset += 1;
+            uint16_t type = (uint16_t) ((((unsigned char) query[offset]) << 8) | ((unsigned char) query[offset + 1]));
+            offset += 4;
+
+            std::vector<std::string> answers;
+            int rcode = 0;
+            bool truncated = false;
+            auto rdata = [&](uint16_t answer_type, const std::string &data) {
+                std::string answer;
+                answer += (char) 0xc0; answer += (char) 0x0c; /* pointer to question name */
+                answer += (char) (answer_type >> 8); answer += (char) answer_type;
+                answer += (char) 0; answer += (char) 1; /* IN */
+                answer += std::string("\0\0\0\x3c", 4); /* ttl */
+                answer += (char) (data.length() >> 8); answer += (char) data.length();
+                answers.push_back(answer + data);
+            };
+            auto address = [&](int af, const char *ip) {
+                char buffer[16];
+                ASSERT_EQ(uv_inet_pton(af, ip, buffer), 0);
+                rdata(af == AF_INET ? CAT_DNS_RECORD_TYPE_A : CAT_DNS_RECORD_TYPE_AAAA, std::string(buffer, af == AF_INET ? 4 : 16));
+            };
+
+            if (name == "stub.test") {
+                if (type == CAT_DNS_RECORD_TYPE_A) {
+                    address(AF_INET, "10.0.0.1");
+                    address(AF_INET, "10.0.0.2");
+                } else if (type == CAT_DNS_RECORD_TYPE_AAAA) {
+                    address(AF_INET6, "2001:db8::1");
+                }
+            } else if (name == "v4only.test" || name == "v4only.search.test") {
+                if (type == CAT_DNS_RECORD_TYPE_A) {
+                    address(AF_INET, name == "v4only.test" ? "10.0.1.1" : "10.0.1.2");
+                }
+            } else if (name == "srv.test" && type == CAT_DNS_RECORD_TYPE_SRV) {
+                rdata(CAT_DNS_RECORD_TYPE_SRV, std::string("\0\x0a\0\x05\x1f\x90\x04node\x04stub\x04test\0", 22));
+            } else if (name == "big.test" && type == CAT_DNS_RECORD_TYPE_A) {
+                if (!over_tcp) {
+                    truncated = true;
+                } else {
+                    address(AF_INET, "10.0.2.1");
+                }
+            } else if (name == "slow.test") {
+                return std::string();
+            } else if (name == "forged.test") {
+                address(AF_INET, "10.0.3.1");
+            } else {
+                rcode = 3; /* NXDOMAIN */
+            }
+
+            std::string response(query, offset);
+            response[2] = (char) (0x81 | (truncated ? 0x02 : 0x00));
+            response[3] = (char) (0x80 | rcode);
+            response[6] = 0; response[7] = (char) (truncated ? 0 : answers.size());
+            response[8] = 0; response[9] = 0;
+            response[10] = 0; response[11] = 0; /* drop OPT */
+            if (!truncated) {
+                for (auto &answer : answers) {
+                    response += answer;
+                }
+            }
+            if (name == "forged.test") {
+                /* question is not echoed */
+                response[13] = 'x';
+            }
+            return response;
+        }
+
+    public:
+        int port = 0;
+
+        fake_dns_server()
+        {
+            EXPECT_NE(cat_socket_create(&udp_server, CAT_SOCKET_TYPE_UDP4), nullptr);
+            EXPECT_TRUE(cat_socket_bind_to(&udp_server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+            port = cat_socket_get_sock_port(&udp_server);
+            EXPECT_GT(port, 0);
+            EXPECT_NE(cat_socket_create(&tcp_server, CAT_SOCKET_TYPE_TCP4), nullptr);
+            EXPECT_TRUE(cat_socket_bind_to(&tcp_server, CAT_STRL(TEST_LISTEN_IPV4), port));
+            EXPECT_TRUE(cat_socket_listen(&tcp_server, TEST_MAX_CONCURRENCY));
+            co([this] {
+                wg++;
+                DEFER(wg--);
+                while (true) {
+                    char buffer[TEST_BUFFER_SIZE_STD];
+                    cat_sockaddr_union_t address;
+                    cat_socklen_t address_length = sizeof(address);
+                    ssize_t n = cat_socket_recvfrom(&udp_server, CAT_STRS(buffer), &address.common, &address_length);
+                    if (n <= 0) {
+                        break;
+                    }
+                    std::string response = build_response(buffer, n, false);
+                    if (!response.empty()) {
+                        ASSERT_TRUE(cat_socket_sendto(&udp_server, response.data(), response.length(), &address.common, address_length));
+                    }
+                }
+            });
+            co([this] {
+                wg++;
+                DEFER(wg--);
+                while (true) {
+                    cat_socket_t connection;
+                    ASSERT_NE(cat_socket_create(&connection, CAT_SOCKET_TYPE_TCP), nullptr);
+                    DEFER(cat_socket_close(&connection));
+                    if (!cat_socket_accept(&tcp_server, &connection)) {
+                        break;
+                    }
+                    unsigned char header[2];
+                    char buffer[TEST_BUFFER_SIZE_STD];
+                    ASSERT_EQ(cat_socket_read(&connection, (char *) header, sizeof(header)), (ssize_t) sizeof(header));
+                    size_t length = (header[0] << 8) | header[1];
+                    ASSERT_EQ(cat_socket_read(&connection, buffer, length), (ssize_t) length);
+                    std::string response = build_response(buffer, length, true);
+                    header[0] = (unsigned char) (response.length() >> 8);
+                    header[1] = (unsigned char) response.length();
+                    ASSERT_TRUE(cat_socket_send(&connection, (const char *) header, sizeof(header)));
+                    ASSERT_TRUE(cat_socket_send(&connection, response.data(), response.length()));
+                }
+            });
+        }
+
+        ~fake_dns_server()
+        {
+            cat_socket_close(&udp_server);
+            cat_socket_close(&tcp_server);
+            wg();
+        }
+
+        void configure(cat_dns_resolver_options_t *options, cat_timeout_t timeout = TEST_IO_TIMEOUT)
+        {
+            cat_dns_resolver_options_init(options);
+            ASSERT_TRUE(cat_dns_resolver_options_add_nameserver(options, CAT_STRL(TEST_LISTEN_IPV4), port));
+            options->timeout = timeout;
+            options->attempts = 1;
+            ASSERT_TRUE(cat_dns_resolver_configure(options));
+        }
+    };
+}
+
+#define TEST_DNS_STUB_RESOLVER_SAVE_OPTIONS() \
+    cat_dns_resolver_options_t saved_options = *cat_dns_resolver_get_options(); \
+    DEFER(ASSERT_TRUE(cat_dns_resolver_configure(&saved_options)))
+
+TEST(cat_dns, stub_resolver_options_parse)
+{
+    cat_dns_resolver_options_t options;
+    const char conf[] =
+        "# comment\n"
+        "nameserver 127.0.0.53\n"
+        "nameserver ::1 ; comment\n"
+        "nameserver bad-ip\n"
+        "domain example.com\n"
+        "search a.example.com b.example.com.\n"
+        "options ndots:2 timeout:1 attempts:3 rotate\n"
+        "nameserver 10.0.0.1\n"
+        "nameserver 10.0.0.2\n";
+
+    cat_dns_resolver_options_init(&options);
+    cat_dns_resolver_options_parse(&options, CAT_STRL(conf));
+    ASSERT_EQ(options.nameserver_count, 3);
+    ASSERT_EQ(options.nameservers[0].address.common.sa_family, AF_INET);
+    ASSERT_EQ(cat_sockaddr_get_port(&options.nameservers[0].address.common), CAT_DNS_PORT);
+    ASSERT_EQ(options.nameservers[1].address.common.sa_family, AF_INET6);
+    ASSERT_EQ(options.nameservers[2].address.common.sa_family, AF_INET);
+    ASSERT_EQ(options.search_count, 2);
+    ASSERT_STREQ(options.search[0], "a.example.com");
+    ASSERT_STREQ(options.search[1], "b.example.com");
+    ASSERT_EQ(options.ndots, 2);
+    ASSERT_EQ(options.timeout, 1000);
+    ASSERT_EQ(options.attempts, 3);
+    ASSERT_TRUE(options.rotate);
+
+    ASSERT_FALSE(cat_dns_resolver_options_add_nameserver(&options, CAT_STRL("10.0.0.3"), CAT_DNS_PORT));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ENOSPC);
+}
+
+TEST(cat_dns, stub_resolver_query)
+{
+    TEST_DNS_STUB_RESOLVER_SAVE_OPTIONS();
+    testing::fake_dns_server server;
+    cat_dns_resolver_options_t options;
+    cat_dns_record_t records[4];
+    char ip[CAT_SOCKET_IP_BUFFER_SIZE];
+    size_t count;
+
+    server.configure(&options);
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_TRUE(cat_dns_query("stub.test", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(count, 2);
+    ASSERT_EQ(records[0].type, CAT_DNS_RECORD_TYPE_A);
+    ASSERT_EQ(records[0].ttl, 60);
+    ASSERT_EQ(uv_inet_ntop(AF_INET, &records[1].data.a, CAT_STRS(ip)), 0);
+    ASSERT_STREQ(ip, "10.0.0.2");
+
+    count = 1;
+    ASSERT_TRUE(cat_dns_query("stub.test.", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(count, 1);
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_TRUE(cat_dns_query("stub.test", CAT_DNS_RECORD_TYPE_AAAA, records, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(uv_inet_ntop(AF_INET6, &records[0].data.aaaa, CAT_STRS(ip)), 0);
+    ASSERT_STREQ(ip, "2001:db8::1");
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_TRUE(cat_dns_query("srv.test", CAT_DNS_RECORD_TYPE_SRV, records, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(records[0].data.srv.priority, 10);
+    ASSERT_EQ(records[0].data.srv.weight, 5);
+    ASSERT_EQ(records[0].data.srv.port, 8080);
+    ASSERT_STREQ(records[0].data.srv.target, "node.stub.test");
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_FALSE(cat_dns_query("nx.test", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAI_NONAME);
+    ASSERT_EQ(count, 0);
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_FALSE(cat_dns_query("srv.test", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAI_NONAME);
+
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_FALSE(cat_dns_query("bad..name", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+TEST(cat_dns, stub_resolver_truncated)
+{
+    TEST_DNS_STUB_RESOLVER_SAVE_OPTIONS();
+    testing::fake_dns_server server;
+    cat_dns_resolver_options_t options;
+    cat_dns_record_t records[4];
+    char ip[CAT_SOCKET_IP_BUFFER_SIZE];
+    size_t count = CAT_ARRAY_SIZE(records);
+
+    server.configure(&options);
+    ASSERT_TRUE(cat_dns_query("big.test", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(uv_inet_ntop(AF_INET, &records[0].data.a, CAT_STRS(ip)), 0);
+    ASSERT_STREQ(ip, "10.0.2.1");
+}
+
+TEST(cat_dns, stub_resolver_timeout)
+{
+    TEST_DNS_STUB_RESOLVER_SAVE_OPTIONS();
+    testing::fake_dns_server server;
+    cat_dns_resolver_options_t options;
+    cat_dns_record_t records[4];
+    size_t count = CAT_ARRAY_SIZE(records);
+    cat_msec_t start;
+
+    /* timeout of each try */
+    server.configure(&options, 10);
+    options.attempts = 3;
+    ASSERT_TRUE(cat_dns_resolver_configure(&options));
+    start = cat_time_msec();
+    ASSERT_FALSE(cat_dns_query_ex("slow.test", CAT_DNS_RECORD_TYPE_A, records, &count, CAT_TIMEOUT_FOREVER));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    ASSERT_GE(cat_time_msec() - start, 30);
+
+    /* total timeout */
+    server.configure(&options, CAT_TIMEOUT_FOREVER);
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_FALSE(cat_dns_query_ex("slow.test", CAT_DNS_RECORD_TYPE_A, records, &count, 10));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+
+    /* answer of other question is ignored */
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_FALSE(cat_dns_query_ex("forged.test", CAT_DNS_RECORD_TYPE_A, records, &count, 10));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+}
+
+TEST(cat_dns, stub_resolver_getaddrinfo)
+{
+    TEST_DNS_STUB_RESOLVER_SAVE_OPTIONS();
+    testing::fake_dns_server server;
+    cat_dns_resolver_options_t options;
+    struct addrinfo hints = { 0 };
+    struct addrinfo *response, *presponse;
+    char ip[CAT_SOCKET_IP_BUFFER_SIZE];
+    size_t ip_length;
+    std::vector<std::string> ips;
+
+    server.configure(&options);
+    cat_bool_t enabled = cat_dns_enable_stub_resolver(cat_true);
+    DEFER(cat_dns_enable_stub_resolver(enabled));
+    ASSERT_TRUE(cat_dns_is_stub_resolver_enabled());
+
+    hints.ai_socktype = SOCK_STREAM;
+    response = cat_dns_getaddrinfo("stub.test", "80", &hints);
+    ASSERT_NE(response, nullptr);
+    for (presponse = response; presponse != nullptr; presponse = presponse->ai_next) {
+        ASSERT_EQ(presponse->ai_socktype, SOCK_STREAM);
+        ASSERT_EQ(cat_sockaddr_get_port(presponse->ai_addr), 80);
+        ip_length = sizeof(ip);
+        ASSERT_TRUE(cat_sockaddr_get_address(presponse->ai_addr, presponse->ai_addrlen, ip, &ip_length));
+        ips.push_back(ip);
+    }
+    cat_dns_freeaddrinfo(response);
+    /* IPv6 first, then interleave */
+    ASSERT_EQ(ips, std::vector<std::string>({ "2001:db8::1", "10.0.0.1", "10.0.0.2" }));
+
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "stub.test", AF_INET));
+    ASSERT_STREQ(ip, "10.0.0.1");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "stub.test", AF_INET6));
+    ASSERT_STREQ(ip, "2001:db8::1");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "v4only.test", AF_UNSPEC));
+    ASSERT_STREQ(ip, "10.0.1.1");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "127.0.0.1", AF_UNSPEC));
+    ASSERT_STREQ(ip, "127.0.0.1");
+
+    ASSERT_FALSE(cat_dns_get_ip(CAT_STRS(ip), "nx.test", AF_UNSPEC));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAI_NONAME);
+
+    /* search list */
+    cat_dns_resolver_options_parse(&options, CAT_STRL("search search.test\noptions ndots:2\n"));
+    ASSERT_TRUE(cat_dns_resolver_configure(&options));
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "v4only", AF_UNSPEC));
+    ASSERT_STREQ(ip, "10.0.1.2");
+    /* v4only.test.search.test does not exist, fallback to v4only.test */
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "v4only.test", AF_UNSPEC));
+    ASSERT_STREQ(ip, "10.0.1.1");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "v4only.test.", AF_UNSPEC));
+    ASSERT_STREQ(ip, "10.0.1.1");
+}
+
+TEST(cat_dns, stub_resolver_hosts)
+{
+    std::string hosts_path = get_random_path();
+    const char hosts[] =
+        "127.0.0.1 localhost\n"
+        "10.1.2.3 myhost.test myalias.test # comment\n"
+        "fd00::3  MyHost.test\n";
+    char ip[CAT_SOCKET_IP_BUFFER_SIZE];
+
+    ASSERT_TRUE(file_put_contents(hosts_path.c_str(), CAT_STRL(hosts)));
+    DEFER(remove_file(hosts_path.c_str()));
+    ASSERT_TRUE(cat_dns_resolver_load_hosts(hosts_path.c_str()));
+    DEFER(cat_dns_resolver_load_hosts(nullptr));
+    cat_bool_t enabled = cat_dns_enable_stub_resolver(cat_true);
+    DEFER(cat_dns_enable_stub_resolver(enabled));
+
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "myhost.test", AF_UNSPEC));
+    ASSERT_STREQ(ip, "fd00::3");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "MYHOST.test.", AF_INET));
+    ASSERT_STREQ(ip, "10.1.2.3");
+    ASSERT_TRUE(cat_dns_get_ip(CAT_STRS(ip), "myalias.test", AF_UNSPEC));
+    ASSERT_STREQ(ip, "10.1.2.3");
+
+    /* flags are as same as hints */
+    struct addrinfo hints = {};
+    hints.ai_flags = AI_ADDRCONFIG;
+    struct addrinfo *response = cat_dns_getaddrinfo("myhost.test", nullptr, &hints);
+    ASSERT_NE(response, nullptr);
+    for (struct addrinfo *presponse = response; presponse != nullptr; presponse = presponse->ai_next) {
+        ASSERT_EQ(presponse->ai_flags, AI_ADDRCONFIG);
+    }
+    cat_dns_freeaddrinfo(response);
+
+    /* query also consults hosts */
+    cat_dns_record_t records[4];
+    size_t count = CAT_ARRAY_SIZE(records);
+    ASSERT_TRUE(cat_dns_query("myhost.test", CAT_DNS_RECORD_TYPE_A, records, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(uv_inet_ntop(AF_INET, &records[0].data.a, CAT_STRS(ip)), 0);
+    ASSERT_STREQ(ip, "10.1.2.3");
+    count = CAT_ARRAY_SIZE(records);
+    ASSERT_TRUE(cat_dns_query("myhost.test", CAT_DNS_RECORD_TYPE_AAAA, records, &count));
+    ASSERT_EQ(count, 1);
+    ASSERT_EQ(uv_inet_ntop(AF_INET6, &records[0].data.aaaa, CAT_STRS(ip)), 0);
+    ASSERT_STREQ(ip, "fd00::3");
+
+    ASSERT_FALSE(cat_dns_resolver_load_hosts("/path/to/nowhere"));
+}
@@ -40,6 +40,43 @@ TEST(cat_event, defer)
     ASSERT_TRUE(done);
 }
 
+TEST(cat_event, defer_cancel)
+{
+    bool done = false;
+    cat_event_loop_defer_task_t *task =
+        cat_event_loop_defer_task_create([](cat_event_loop_defer_task_t *task, cat_data_t *data) {
+            *((bool *) data) = true;
+        }, &done);
+    ASSERT_NE(task, nullptr);
+    ASSERT_FALSE(cat_event_loop_defer_task_close(task));
+    ASSERT_TRUE(cat_coroutine_wait_all()); // not blocking
+    ASSERT_FALSE(done);
+}
+
+TEST(cat_event, defer_yield_heavy)
+{
+    constexpr int n = 64;
+    constexpr int rounds = 100;
+    int count = 0;
+
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    uint64_t round = cat_event_get_round();
+    for (int i = 0; i < n; i++) {
+        co([&] {
+            for (int r = 0; r < rounds; r++) {
+                ASSERT_TRUE(cat_time_delay(0));
+                count++;
+            }
+        });
+    }
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    ASSERT_EQ(count, n * rounds);
+    /* all coroutines are resumed in the same loop iteration */
+    ASSERT_LE(cat_event_get_round() - round, (uint64_t) rounds + 2);
+    ASSERT_TRUE(cat_queue_empty(&CAT_EVENT_G(loop_defer_tasks)));
+    ASSERT_FALSE(uv_is_active((uv_handle_t *) &CAT_EVENT_G(loop_defer_idle)));
+}
+
 TEST(cat_event, defer_in_defer)
 {
     uint64_t round = cat_event_get_round();
@@ -285,6 +285,92 @@ TEST(cat_fs, pwrite_pread)
 
 }
 
+TEST(cat_fs, writev_readv)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string fnstr = path_join(TEST_TMP_PATH, "cat_tests_rwv");
+    const char *fn = fnstr.c_str();
+    char header[16], payload[4096], red_header[16], red_payload[4096];
+    cat_file_t fd;
+
+    cat_srand(header, sizeof(header));
+    cat_srand(payload, sizeof(payload));
+    ASSERT_GE(fd = cat_fs_open(fn, CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600), 0);
+    DEFER({
+        cat_fs_close(fd);
+        cat_fs_unlink(fn);
+    });
+
+    cat_io_vector_t out[2] = {
+        { header, sizeof(header) },
+        { payload, sizeof(payload) },
+    };
+    cat_io_vector_t in[2] = {
+        { red_header, sizeof(red_header) },
+        { red_payload, sizeof(red_payload) },
+    };
+    /* record = header + payload, twice */
+    ASSERT_EQ(cat_fs_writev(fd, out, 2), (ssize_t) (sizeof(header) + sizeof(payload)));
+    ASSERT_EQ(cat_fs_pwritev(fd, out, 2, sizeof(header) + sizeof(payload)), (ssize_t) (sizeof(header) + sizeof(payload)));
+    ASSERT_EQ(cat_fs_lseek(fd, 0, SEEK_SET), 0);
+    for (int n = 0; n < 2; n++) {
+        memset(red_header, 0, sizeof(red_header));
+        memset(red_payload, 0, sizeof(red_payload));
+        ASSERT_EQ(cat_fs_readv(fd, in, 2), (ssize_t) (sizeof(header) + sizeof(payload)));
+        ASSERT_EQ(memcmp(red_header, header, sizeof(header)), 0);
+        ASSERT_EQ(memcmp(red_payload, payload, sizeof(payload)), 0);
+    }
+    ASSERT_EQ(cat_fs_readv(fd, in, 2), 0);
+    memset(red_payload, 0, sizeof(red_payload));
+    ASSERT_EQ(cat_fs_preadv(fd, &in[1], 1, sizeof(header)), (ssize_t) sizeof(payload));
+    ASSERT_EQ(memcmp(red_payload, payload, sizeof(payload)), 0);
+
+    /* data has just been written, so it is in page cache and would be read inline */
+    memset(red_header, 0, sizeof(red_header));
+    memset(red_payload, 0, sizeof(red_payload));
+    ASSERT_EQ(cat_fs_preadv2(fd, in, 2, 0, CAT_FS_RW_FLAG_NOWAIT), (ssize_t) (sizeof(header) + sizeof(payload)));
+    ASSERT_EQ(memcmp(red_header, header, sizeof(header)), 0);
+    ASSERT_EQ(memcmp(red_payload, payload, sizeof(payload)), 0);
+
+    ASSERT_LT(cat_fs_preadv2(-1, in, 2, 0, CAT_FS_RW_FLAG_NOWAIT), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+}
+
+#ifdef CAT_OS_LINUX
+TEST(cat_fs, pwritev2_flags)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string fnstr = path_join(TEST_TMP_PATH, "cat_tests_rwv2");
+    const char *fn = fnstr.c_str();
+    char buffer[64];
+    cat_file_t fd;
+    cat_stat_t statbuf;
+
+    cat_srand(buffer, sizeof(buffer));
+    ASSERT_GE(fd = cat_fs_open(fn, CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600), 0);
+    DEFER({
+        cat_fs_close(fd);
+        cat_fs_unlink(fn);
+    });
+    cat_io_vector_t vector = { buffer, sizeof(buffer) };
+
+    ASSERT_EQ(cat_fs_pwritev2(fd, &vector, 1, 0, CAT_FS_RW_FLAG_DSYNC), (ssize_t) sizeof(buffer));
+    /* offset is ignored, it is always appended */
+    ASSERT_EQ(cat_fs_pwritev2(fd, &vector, 1, 0, CAT_FS_RW_FLAG_APPEND), (ssize_t) sizeof(buffer));
+    ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, (off_t) sizeof(buffer) * 2);
+    /* falls back to the thread-pool if NOWAIT write is not supported */
+    ASSERT_EQ(cat_fs_pwritev2(fd, &vector, 1, sizeof(buffer) * 2, CAT_FS_RW_FLAG_NOWAIT | CAT_FS_RW_FLAG_DSYNC), (ssize_t) sizeof(buffer));
+    ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, (off_t) sizeof(buffer) * 3);
+    char red[sizeof(buffer) * 3];
+    ASSERT_EQ(cat_fs_pread(fd, red, sizeof(red), 0), (ssize_t) sizeof(red));
+    for (int n = 0; n < 3; n++) {
+        ASSERT_EQ(memcmp(&red[sizeof(buffer) * n], buffer, sizeof(buffer)), 0);
+    }
+}
+#endif
+
 // fsync and fdatasync cannot be tested here
 
 TEST(cat_fs, ftruncate)
@@ -1571,3 +1657,450 @@ TEST(cat_fs, get_or_put_content)
     ASSERT_EQ(length, content_str.length());
     ASSERT_STREQ(content, content_str.c_str());
 }
+
+#ifndef CAT_OS_WIN
+TEST(cat_fs, mmap_munmap)
+{
+    std::string random_bytes = get_random_bytes(TEST_BUFFER_SIZE_STD * 4);
+    std::string filename = get_random_path();
+    cat_file_t fd;
+    char *address;
+
+    ASSERT_TRUE(cat_fs_put_contents(filename.c_str(), random_bytes.c_str(), random_bytes.length()));
+    DEFER(cat_fs_unlink(filename.c_str()));
+
+    fd = cat_fs_open(filename.c_str(), CAT_FS_OPEN_FLAG_RDWR);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_close(fd));
+
+    /* read-only with prefault */
+    address = (char *) cat_fs_mmap(fd, 0, random_bytes.length(), CAT_FS_MMAP_FLAG_PREFAULT);
+    ASSERT_NE(address, nullptr);
+    ASSERT_EQ(std::string(address, random_bytes.length()), random_bytes);
+    ASSERT_EQ(cat_fs_madvise(address, random_bytes.length(), CAT_FS_MADVISE_SEQUENTIAL), 0);
+    ASSERT_EQ(cat_fs_madvise(address, random_bytes.length(), CAT_FS_MADVISE_WILLNEED), 0);
+    ASSERT_EQ(cat_fs_prefault(address + 1, random_bytes.length() - 1), 0);
+    ASSERT_EQ(cat_fs_munmap(address, random_bytes.length()), 0);
+
+    /* writable and shared with the file */
+    address = (char *) cat_fs_mmap(fd, 0, random_bytes.length(), CAT_FS_MMAP_FLAG_WRITE);
+    ASSERT_NE(address, nullptr);
+    memset(address, 'x', 3);
+    ASSERT_EQ(cat_fs_munmap(address, random_bytes.length()), 0);
+    char buffer[3];
+    ASSERT_EQ(cat_fs_pread(fd, buffer, sizeof(buffer), 0), (ssize_t) sizeof(buffer));
+    ASSERT_EQ(std::string(buffer, sizeof(buffer)), "xxx");
+
+    /* offset must be aligned to page */
+    ASSERT_EQ(cat_fs_mmap(fd, 1, random_bytes.length() - 1, CAT_FS_MMAP_FLAG_NONE), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+    ASSERT_EQ(cat_fs_mmap(-1, 0, random_bytes.length(), CAT_FS_MMAP_FLAG_NONE), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+    ASSERT_LT(cat_fs_madvise(nullptr, 1, (cat_fs_madvise_t) -1), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+#include <sys/mman.h>
+
+TEST(cat_fs, prefault_timeout)
+{
+    size_t length = 256 * 1024 * 1024;
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ASSERT_NE(address, MAP_FAILED);
+
+    cat_msec_t deadline = cat_time_set_deadline(cat_time_msec() + 1);
+    int ret = cat_fs_prefault(address, length);
+    (void) cat_time_set_deadline(deadline);
+    ASSERT_TRUE(ret == 0 || cat_get_last_error_code() == CAT_ETIMEDOUT);
+    /* the worker must have stopped touching the pages */
+    ASSERT_EQ(munmap(address, length), 0);
+}
+
+TEST(cat_fs, prefault_ex_timeout)
+{
+    size_t length = 256 * 1024 * 1024;
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ASSERT_NE(address, MAP_FAILED);
+
+    cat_msec_t start = cat_time_msec();
+    int ret = cat_fs_prefault_ex(address, length, 1);
+    ASSERT_TRUE(ret == 0 || cat_get_last_error_code() == CAT_ETIMEDOUT);
+    /* the worker stops at the next page rather than finishing the range */
+    ASSERT_LT(cat_time_msec() - start, TEST_IO_TIMEOUT);
+    ASSERT_EQ(munmap(address, length), 0);
+}
+#endif
+
+#ifndef CAT_OS_WIN
+class test_fs_tree
+{
+public:
+    std::string root;
+    std::vector<std::string> paths;
+    size_t count = 0;
+
+    test_fs_tree(size_t directories, size_t files)
+    {
+        root = get_random_path();
+        EXPECT_EQ(cat_fs_mkdir(root.c_str(), 0777), 0);
+        for (size_t d = 0; d < directories; d++) {
+            std::string directory = "d" + std::to_string(d);
+            mkdir(directory);
+            for (size_t f = 0; f < files; f++) {
+                touch(directory + "/f" + std::to_string(f));
+            }
+        }
+    }
+
+    ~test_fs_tree()
+    {
+        for (auto it = paths.rbegin(); it != paths.rend(); it++) {
+            std::string path = path_join(root, *it);
+            if (cat_fs_unlink(path.c_str()) != 0) {
+                (void) cat_fs_rmdir(path.c_str());
+            }
+        }
+        (void) cat_fs_rmdir(root.c_str());
+    }
+
+    void mkdir(const std::string &path)
+    {
+        EXPECT_EQ(cat_fs_mkdir(path_join(root, path).c_str(), 0777), 0);
+        paths.push_back(path);
+        count++;
+    }
+
+    void touch(const std::string &path)
+    {
+        EXPECT_EQ(cat_fs_put_contents(path_join(root, path).c_str(), "x", 1), 1);
+        paths.push_back(path);
+        count++;
+    }
+};
+
+static size_t test_fs_walk(cat_fs_walker_t *walker, std::function<void(const cat_fs_walk_entry_t *entry)> callback = nullptr)
+{
+    const cat_fs_walk_batch_t *batch;
+    size_t count = 0;
+
+    while ((batch = cat_fs_walker_next(walker, TEST_IO_TIMEOUT)) != nullptr && batch->count != 0) {
+        for (size_t n = 0; n < batch->count; n++) {
+            if (callback) {
+                callback(&batch->entries[n]);
+            }
+        }
+        count += batch->count;
+    }
+    EXPECT_NE(batch, nullptr);
+
+    return count;
+}
+
+TEST(cat_fs, walker)
+{
+    test_fs_tree tree(8, 16);
+    tree.mkdir("d0/sub");
+    tree.touch("d0/sub/deep");
+    cat_fs_walk_options_t options;
+    cat_fs_walker_t *walker;
+    cat_fs_walk_stats_t stats;
+
+    /* all of entries with stat */
+    cat_fs_walk_options_init(&options);
+    options.stat = cat_true;
+    options.batch_size = 7;
+    options.max_batches = 2;
+    walker = cat_fs_walker_create(tree.root.c_str(), &options);
+    ASSERT_NE(walker, nullptr);
+    bool deep_found = false;
+    ASSERT_EQ(test_fs_walk(walker, [&](const cat_fs_walk_entry_t *entry) {
+        if (entry->type == CAT_DIRENT_TYPE_DIR) {
+            ASSERT_TRUE(S_ISDIR(entry->stat.st_mode));
+        } else {
+            ASSERT_EQ(entry->type, CAT_DIRENT_TYPE_FILE);
+            ASSERT_TRUE(S_ISREG(entry->stat.st_mode));
+            ASSERT_EQ(entry->stat.st_size, 1);
+        }
+        if (std::string(entry->path) == "d0/sub/deep") {
+            ASSERT_STREQ(entry->name, "deep");
+            ASSERT_EQ(entry->depth, 3);
+            deep_found = true;
+        }
+    }), tree.count);
+    ASSERT_TRUE(deep_found);
+    cat_fs_walker_get_stats(walker, &stats);
+    ASSERT_EQ(stats.entry_count, tree.count);
+    ASSERT_EQ(stats.scanned_count, tree.count);
+    ASSERT_EQ(stats.directory_count, 1 + 8 + 1);
+    ASSERT_EQ(stats.error_count, 0);
+    ASSERT_EQ(stats.batch_count, (tree.count + options.batch_size - 1) / options.batch_size);
+    ASSERT_GT(stats.entries_per_second, 0);
+    /* it is still done */
+    ASSERT_EQ(cat_fs_walker_next(walker, TEST_IO_TIMEOUT)->count, 0);
+    cat_fs_walker_close(walker);
+
+    /* depth limit */
+    cat_fs_walk_options_init(&options);
+    options.max_depth = 1;
+    walker = cat_fs_walker_create(tree.root.c_str(), &options);
+    ASSERT_NE(walker, nullptr);
+    ASSERT_EQ(test_fs_walk(walker), 8);
+    cat_fs_walker_close(walker);
+
+    /* filter */
+    cat_fs_walk_options_init(&options);
+    options.filter = [](const cat_fs_walk_entry_t *entry, cat_data_t *data) {
+        if (strcmp(entry->path, "d0") == 0) {
+            return CAT_FS_WALK_ACTION_PRUNE;
+        }
+        if (entry->type == CAT_DIRENT_TYPE_DIR) {
+            return CAT_FS_WALK_ACTION_SKIP;
+        }
+        return CAT_FS_WALK_ACTION_INCLUDE;
+    };
+    walker = cat_fs_walker_create(tree.root.c_str(), &options);
+    ASSERT_NE(walker, nullptr);
+    ASSERT_EQ(test_fs_walk(walker), 7 * 16);
+    cat_fs_walker_close(walker);
+}
+
+TEST(cat_fs, walker_error)
+{
+    cat_fs_walker_t *walker = cat_fs_walker_create(get_random_path().c_str(), nullptr);
+    ASSERT_NE(walker, nullptr);
+    DEFER(cat_fs_walker_close(walker));
+    ASSERT_EQ(cat_fs_walker_next(walker, TEST_IO_TIMEOUT), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ENOENT);
+}
+
+TEST(cat_fs, walker_root_moved)
+{
+    test_fs_tree tree(2, 2);
+    tree.mkdir("d0/sub");
+    tree.touch("d0/sub/deep");
+    std::string moved = tree.root + ".moved";
+    cat_fs_walk_options_t options;
+    cat_fs_walker_t *walker;
+    cat_fs_walk_stats_t stats;
+
+    /* move the root away once its entries are read, children are still reachable by the parent fd */
+    cat_fs_walk_options_init(&options);
+    options.filter = [](const cat_fs_walk_entry_t *entry, cat_data_t *data) {
+        std::pair<std::string, std::string> *paths = (std::pair<std::string, std::string> *) data;
+        if (entry->depth == 1 && !paths->first.empty()) {
+            EXPECT_EQ(rename(paths->first.c_str(), paths->second.c_str()), 0);
+            paths->first.clear();
+        }
+        return CAT_FS_WALK_ACTION_INCLUDE;
+    };
+    std::pair<std::string, std::string> paths(tree.root, moved);
+    options.filter_data = &paths;
+    walker = cat_fs_walker_create(tree.root.c_str(), &options);
+    ASSERT_NE(walker, nullptr);
+    DEFER((void) rename(moved.c_str(), tree.root.c_str()));
+    ASSERT_EQ(test_fs_walk(walker), tree.count);
+    cat_fs_walker_get_stats(walker, &stats);
+    ASSERT_EQ(stats.error_count, 0);
+    cat_fs_walker_close(walker);
+}
+
+TEST(cat_fs, walker_close_early)
+{
+    test_fs_tree tree(4, 16);
+    cat_fs_walk_options_t options;
+    cat_fs_walker_t *walker;
+    const cat_fs_walk_batch_t *batch;
+
+    /* worker would be blocked by the bounded queue */
+    cat_fs_walk_options_init(&options);
+    options.batch_size = 1;
+    options.max_batches = 1;
+    walker = cat_fs_walker_create(tree.root.c_str(), &options);
+    ASSERT_NE(walker, nullptr);
+    batch = cat_fs_walker_next(walker, TEST_IO_TIMEOUT);
+    ASSERT_NE(batch, nullptr);
+    ASSERT_EQ(batch->count, 1);
+    cat_fs_walker_close(walker);
+}
+#endif
+
+TEST(cat_fs, writer)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string path = get_random_path();
+    cat_fs_writer_options_t options;
+    cat_fs_writer_t *writer;
+    cat_fs_writer_stats_t stats;
+    cat_file_t fd;
+    size_t sync_call_count = 0;
+    const size_t concurrency = 64, count = 16;
+
+    ASSERT_GE(fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600), 0);
+    DEFER({
+        cat_fs_close(fd);
+        cat_fs_unlink(path.c_str());
+    });
+    ASSERT_EQ(cat_fs_write(fd, "head\n", 5), 5);
+
+    cat_fs_writer_options_init(&options);
+    options.buffer_size = 4096;
+    writer = cat_fs_writer_create(fd, &options);
+    ASSERT_NE(writer, nullptr);
+    {
+        wait_group wg;
+        for (size_t c = 0; c < concurrency; c++) {
+            co([&, c] {
+                wg++;
+                DEFER(wg--);
+                for (size_t n = 0; n < count; n++) {
+                    std::string record = "record-" + std::to_string(c) + "-" + std::to_string(n) + "\n";
+                    ASSERT_TRUE(cat_fs_writer_write(writer, record.c_str(), record.length()));
+                    ASSERT_TRUE(cat_fs_writer_sync(writer, TEST_IO_TIMEOUT));
+                    sync_call_count++;
+                }
+            });
+        }
+        wg();
+    }
+    cat_fs_writer_get_stats(writer, &stats);
+    ASSERT_TRUE(cat_fs_writer_close(writer));
+
+    /* group commit */
+    ASSERT_EQ(stats.write_count, concurrency * count);
+    ASSERT_EQ(stats.sync_request_count, sync_call_count);
+    ASSERT_GT(stats.sync_count, 0);
+    ASSERT_LT(stats.sync_count, sync_call_count / 4);
+    ASSERT_LE(stats.flush_count, stats.sync_count + 1);
+    ASSERT_EQ(stats.flush_bytes, stats.write_bytes);
+    ASSERT_GT(stats.sync_time, 0);
+    ASSERT_GE(stats.max_sync_time, stats.sync_time / stats.sync_count);
+
+    size_t length;
+    char *contents = cat_fs_get_contents(path.c_str(), &length);
+    ASSERT_NE(contents, nullptr);
+    DEFER(cat_free(contents));
+    ASSERT_EQ(length, 5 + stats.write_bytes);
+    ASSERT_EQ(std::string(contents, 5), "head\n");
+    std::set<std::string> records;
+    std::string s(contents + 5, length - 5);
+    size_t start = 0, end;
+    while ((end = s.find('\n', start)) != std::string::npos) {
+        records.insert(s.substr(start, end - start));
+        start = end + 1;
+    }
+    ASSERT_EQ(records.size(), concurrency * count);
+    ASSERT_EQ(records.count("record-0-0"), 1);
+    ASSERT_EQ(records.count("record-" + std::to_string(concurrency - 1) + "-" + std::to_string(count - 1)), 1);
+}
+
+TEST(cat_fs, writer_flush_interval)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string path = get_random_path();
+    cat_fs_writer_options_t options;
+    cat_fs_writer_t *writer;
+    cat_stat_t statbuf;
+    cat_file_t fd;
+
+    ASSERT_GE(fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600), 0);
+    DEFER({
+        cat_fs_close(fd);
+        cat_fs_unlink(path.c_str());
+    });
+    cat_fs_writer_options_init(&options);
+    options.flush_interval = 5;
+    writer = cat_fs_writer_create(fd, &options);
+    ASSERT_NE(writer, nullptr);
+    DEFER(ASSERT_TRUE(cat_fs_writer_close(writer)));
+
+    ASSERT_TRUE(cat_fs_writer_write(writer, "hello", 5));
+    ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, 0);
+    /* it is flushed without being asked to */
+    for (int n = 0; n < 100 && statbuf.st_size == 0; n++) {
+        ASSERT_EQ(cat_time_msleep(options.flush_interval), 0);
+        ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    }
+    ASSERT_EQ(statbuf.st_size, 5);
+
+    /* writers would be blocked if too much data is pending */
+    std::string data = get_random_bytes(options.max_buffer_size * 3);
+    for (size_t offset = 0; offset < data.length(); offset += 1000) {
+        ASSERT_TRUE(cat_fs_writer_write(writer, data.c_str() + offset, CAT_MIN(1000, data.length() - offset)));
+    }
+    ASSERT_TRUE(cat_fs_writer_flush(writer, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    ASSERT_EQ((size_t) statbuf.st_size, 5 + data.length());
+    char *buffer = (char *) cat_malloc(data.length());
+    ASSERT_NE(buffer, nullptr);
+    DEFER(cat_free(buffer));
+    ASSERT_EQ(cat_fs_pread(fd, buffer, data.length(), 5), (ssize_t) data.length());
+    ASSERT_EQ(memcmp(buffer, data.c_str(), data.length()), 0);
+}
+
+TEST(cat_fs, writer_sync_under_appends)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string path = get_random_path();
+    cat_fs_writer_t *writer;
+    cat_fs_writer_stats_t stats;
+    cat_file_t fd;
+    const size_t concurrency = 4;
+    bool done = false, starved = false;
+
+    ASSERT_GE(fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600), 0);
+    DEFER({
+        cat_fs_close(fd);
+        cat_fs_unlink(path.c_str());
+    });
+    writer = cat_fs_writer_create(fd, nullptr);
+    ASSERT_NE(writer, nullptr);
+    DEFER(ASSERT_TRUE(cat_fs_writer_close(writer)));
+
+    wait_group wg;
+    for (size_t c = 0; c < concurrency; c++) {
+        co([&] {
+            wg++;
+            DEFER(wg--);
+            cat_msec_t deadline = cat_time_msec() + TEST_IO_TIMEOUT;
+            /* appenders are woken up by I/O as well, so there is always new data when a flush is done */
+            while (!done && cat_time_msec() < deadline) {
+                cat_stat_t statbuf;
+                ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+                ASSERT_TRUE(cat_fs_writer_write(writer, "record\n", 7));
+            }
+            starved = starved || !done;
+        });
+    }
+    ASSERT_TRUE(cat_fs_writer_write(writer, "hello\n", 6));
+    ASSERT_TRUE(cat_fs_writer_sync(writer, TEST_IO_TIMEOUT));
+    done = true;
+    wg();
+    ASSERT_FALSE(starved);
+    cat_fs_writer_get_stats(writer, &stats);
+    ASSERT_GT(stats.sync_count, 0);
+}
+
+TEST(cat_fs, writer_error)
+{
+    SKIP_IF_(no_tmp(), "Temp dir not writable");
+    std::string path = get_random_path();
+    cat_fs_writer_t *writer;
+    cat_file_t fd;
+
+    ASSERT_EQ(cat_fs_put_contents(path.c_str(), "", 0), 0);
+    DEFER(cat_fs_unlink(path.c_str()));
+    ASSERT_GE(fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDONLY), 0);
+    DEFER(cat_fs_close(fd));
+
+    writer = cat_fs_writer_create(fd, nullptr);
+    ASSERT_NE(writer, nullptr);
+    /* it is only buffered */
+    ASSERT_TRUE(cat_fs_writer_write(writer, "hello", 5));
+    ASSERT_FALSE(cat_fs_writer_sync(writer, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+    /* writer is broken */
+    ASSERT_FALSE(cat_fs_writer_write(writer, "hello", 5));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+    ASSERT_FALSE(cat_fs_writer_close(writer));
+}
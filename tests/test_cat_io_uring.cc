@@ -0,0 +1,297 @@
+/*
+  +--------------------------------------------------------------------------+
+  | libcat                                                                   |
+  +--------------------------------------------------------------------------+
+  | Licensed under the Apache License, Version 2.0 (the "License");          |
+  | you may not use this file except in compliance with the License.         |
+  | You may obtain a copy of the License at                                  |
+  | http://www.apache.org/licenses/LICENSE-2.0                               |
+  | Unless required by applicable law or agreed to in writing, software      |
+  | distributed under the License is distributed on an "AS IS" BASIS,        |
+  | WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. |
+  | See the License for the specific language governing permissions and      |
+  | limitations under the License. See accompanying LICENSE file.            |
+  +--------------------------------------------------------------------------+
+  | Author: Twosee <twosee@php.net>                                          |
+  +--------------------------------------------------------------------------+
+ */
+
+#include "test.h"
+
+#ifdef CAT_IO_URING
+
+namespace testing
+{
+    class io_uring_fs_context
+    {
+    public:
+        cat_bool_t previous;
+
+        io_uring_fs_context(cat_bool_t enable)
+        {
+            previous = cat_io_uring_enable_fs(enable);
+        }
+
+        ~io_uring_fs_context()
+        {
+            (void) cat_io_uring_enable_fs(previous);
+        }
+    };
+
+#ifdef CAT_IO_URING_RECV
+    class io_uring_socket_context
+    {
+    public:
+        cat_bool_t previous;
+
+        io_uring_socket_context(cat_bool_t enable)
+        {
+            previous = cat_io_uring_enable_socket(enable);
+        }
+
+        ~io_uring_socket_context()
+        {
+            (void) cat_io_uring_enable_socket(previous);
+        }
+    };
+
+    /* connect a pair of TCP sockets over loopback */
+    static bool io_uring_socket_pair(cat_socket_t *client, cat_socket_t *connection)
+    {
+        cat_socket_t server;
+        bool ret = false;
+
+        if (cat_socket_create(&server, CAT_SOCKET_TYPE_TCP) == nullptr) {
+            return false;
+        }
+        if (cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0) &&
+            cat_socket_listen(&server, TEST_SERVER_BACKLOG) &&
+            cat_socket_create(client, CAT_SOCKET_TYPE_TCP) != nullptr) {
+            if (cat_socket_connect_to(client, CAT_STRL(TEST_LISTEN_IPV4), cat_socket_get_sock_port(&server)) &&
+                cat_socket_create(connection, CAT_SOCKET_TYPE_TCP) != nullptr) {
+                if (cat_socket_accept(&server, connection)) {
+                    ret = true;
+                } else {
+                    cat_socket_close(connection);
+                }
+            }
+            if (!ret) {
+                cat_socket_close(client);
+            }
+        }
+        cat_socket_close(&server);
+
+        return ret;
+    }
+#endif
+}
+
+#define SKIP_IF_IO_URING_UNAVAILABLE() SKIP_IF_(!cat_io_uring_is_available(), "io_uring is unavailable")
+
+TEST(cat_io_uring, fs)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_fs_context context(cat_true);
+    std::string path = get_random_path();
+    const char *data = "Hello io_uring";
+    char buffer[64];
+    cat_stat_t statbuf;
+    cat_file_t fd;
+    uint64_t submitted_count = cat_io_uring_get_stats()->submitted_count;
+
+    fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_unlink(path.c_str()));
+    ASSERT_EQ(cat_fs_write(fd, data, strlen(data)), (ssize_t) strlen(data));
+    ASSERT_EQ(cat_fs_fsync(fd), 0);
+    ASSERT_EQ(cat_fs_fdatasync(fd), 0);
+    ASSERT_EQ(cat_fs_pread(fd, buffer, sizeof(buffer), 6), (ssize_t) strlen(data) - 6);
+    ASSERT_EQ(std::string(buffer, strlen(data) - 6), std::string("io_uring"));
+    ASSERT_EQ(cat_fs_pwrite(fd, "IO", 2, 6), 2);
+    ASSERT_EQ(cat_fs_fstat(fd, &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, strlen(data));
+    ASSERT_TRUE(S_ISREG(statbuf.st_mode));
+    ASSERT_EQ(cat_fs_close(fd), 0);
+
+    ASSERT_EQ(cat_fs_stat(path.c_str(), &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, strlen(data));
+    ASSERT_EQ(cat_fs_lstat(path.c_str(), &statbuf), 0);
+    ASSERT_EQ(statbuf.st_size, strlen(data));
+
+    fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDONLY);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(cat_fs_read(fd, buffer, sizeof(buffer)), (ssize_t) strlen(data));
+    ASSERT_EQ(std::string(buffer, strlen(data)), std::string("Hello IO_uring"));
+    ASSERT_EQ(cat_fs_read(fd, buffer, sizeof(buffer)), 0);
+    ASSERT_EQ(cat_fs_close(fd), 0);
+
+    ASSERT_GT(cat_io_uring_get_stats()->submitted_count, submitted_count);
+}
+
+TEST(cat_io_uring, fs_error)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_fs_context context(cat_true);
+    std::string path = get_random_path();
+    cat_stat_t statbuf;
+    char buffer[8];
+
+    ASSERT_LT(cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDONLY), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ENOENT);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_LT(cat_fs_stat(path.c_str(), &statbuf), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ENOENT);
+    ASSERT_LT(cat_fs_read(-1, buffer, sizeof(buffer)), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+    ASSERT_EQ(errno, EBADF);
+    ASSERT_LT(cat_fs_close(-1), 0);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EBADF);
+}
+
+TEST(cat_io_uring, batch_submission)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_fs_context context(cat_true);
+    std::string path = get_random_path();
+    const size_t n = 64;
+    char buffer[4096] = { 0 };
+    cat_file_t fd;
+
+    fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT | CAT_FS_OPEN_FLAG_TRUNC, 0600);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_close(fd); cat_fs_unlink(path.c_str()));
+    ASSERT_EQ(cat_fs_write(fd, buffer, sizeof(buffer)), (ssize_t) sizeof(buffer));
+
+    const cat_io_uring_stats_t *stats = cat_io_uring_get_stats();
+    uint64_t submitted_count = stats->submitted_count;
+    uint64_t submit_call_count = stats->submit_call_count;
+    {
+        wait_group wg;
+        for (size_t i = 0; i < n; i++) {
+            co([&] {
+                wg++;
+                DEFER(wg--);
+                char buf[512];
+                ASSERT_EQ(cat_fs_pread(fd, buf, sizeof(buf), 0), (ssize_t) sizeof(buf));
+            });
+        }
+    }
+    ASSERT_EQ(stats->submitted_count - submitted_count, n);
+    /* all SQEs were queued in the same loop iteration */
+    ASSERT_LT(stats->submit_call_count - submit_call_count, n);
+    ASSERT_EQ(stats->inflight_count, 0);
+}
+
+#ifdef CAT_IO_URING_RECV
+TEST(cat_io_uring, socket)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_socket_context context(cat_true);
+    cat_socket_t client, connection;
+    const cat_io_uring_stats_t *stats = cat_io_uring_get_stats();
+    uint64_t completed_count;
+    char buffer[64];
+
+    ASSERT_TRUE(io_uring_socket_pair(&client, &connection));
+    DEFER(cat_socket_close(&client); cat_socket_close(&connection));
+
+    completed_count = stats->completed_count;
+    co([&] {
+        ASSERT_TRUE(cat_socket_send(&client, CAT_STRL("Hello ")));
+        cat_time_msleep(1);
+        ASSERT_TRUE(cat_socket_send(&client, CAT_STRL("io_uring")));
+    });
+    /* read() waits for the whole buffer */
+    ASSERT_EQ(cat_socket_read(&connection, buffer, 14), 14);
+    ASSERT_EQ(std::string(buffer, 14), std::string("Hello io_uring"));
+    ASSERT_GT(stats->completed_count, completed_count);
+
+    /* recv() returns once there is data */
+    co([&] {
+        ASSERT_TRUE(cat_socket_send(&client, CAT_STRL("once")));
+    });
+    ASSERT_EQ(cat_socket_recv(&connection, buffer, sizeof(buffer)), 4);
+    ASSERT_EQ(std::string(buffer, 4), std::string("once"));
+
+    /* timeout */
+    ASSERT_EQ(cat_socket_recv_ex(&connection, buffer, sizeof(buffer), 1), -1);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+
+    /* peer closed */
+    co([&] {
+        cat_socket_close(&client);
+    });
+    ASSERT_EQ(cat_socket_recv(&connection, buffer, sizeof(buffer)), 0);
+}
+
+TEST(cat_io_uring, socket_cancel)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_socket_context context(cat_true);
+    cat_socket_t client, connection;
+    uint64_t canceled_count = cat_io_uring_get_stats()->canceled_count;
+    char buffer[64];
+
+    ASSERT_TRUE(io_uring_socket_pair(&client, &connection));
+    DEFER(cat_socket_close(&client));
+
+    co([&] {
+        cat_time_msleep(1);
+        cat_socket_close(&connection);
+    });
+    ASSERT_EQ(cat_socket_recv(&connection, buffer, sizeof(buffer)), -1);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+    ASSERT_GT(cat_io_uring_get_stats()->canceled_count, canceled_count);
+    /* wait for ASYNC_CANCEL */
+    cat_time_msleep(1);
+    ASSERT_EQ(cat_io_uring_get_stats()->inflight_count, 0);
+}
+
+TEST(cat_io_uring, socket_concurrency)
+{
+    SKIP_IF_IO_URING_UNAVAILABLE();
+    io_uring_socket_context context(cat_true);
+    const size_t concurrency = 32, requests = 100;
+    size_t n = 0;
+
+    {
+        wait_group wg;
+        for (size_t c = 0; c < concurrency; c++) {
+            co([&] {
+                wg++;
+                DEFER(wg--);
+                cat_socket_t client, connection;
+                wait_group echo_wg;
+                ASSERT_TRUE(io_uring_socket_pair(&client, &connection));
+                /* echo */
+                co([&] {
+                    echo_wg++;
+                    DEFER(echo_wg--);
+                    DEFER(cat_socket_close(&connection));
+                    char buffer[64];
+                    ssize_t nread;
+                    while ((nread = cat_socket_recv(&connection, buffer, sizeof(buffer))) > 0) {
+                        if (!cat_socket_send(&connection, buffer, nread)) {
+                            break;
+                        }
+                    }
+                });
+                char buffer[64];
+                for (size_t i = 0; i < requests; i++) {
+                    memset(buffer, (int) ('a' + i % 26), sizeof(buffer));
+                    ASSERT_TRUE(cat_socket_send(&client, buffer, sizeof(buffer)));
+                    memset(buffer, 0, sizeof(buffer));
+                    ASSERT_EQ(cat_socket_read(&client, buffer, sizeof(buffer)), (ssize_t) sizeof(buffer));
+                    ASSERT_EQ(buffer[sizeof(buffer) - 1], (char) ('a' + i % 26));
+                    n++;
+                }
+                cat_socket_close(&client);
+            });
+        }
+    }
+    ASSERT_EQ(n, requests * concurrency);
+    ASSERT_EQ(cat_io_uring_get_stats()->inflight_count, 0);
+}
+#endif /* CAT_IO_URING_RECV */
+
+#endif /* CAT_IO_URING */
@@ -154,6 +154,119 @@ TEST(cat_poll, defer_bug)
     ASSERT_EQ(cat_socket_read(&socket, buffer, sizeof(buffer)), sizeof(buffer));
 }
 
+#ifdef CAT_OS_UNIX_LIKE
+#define PREPARE_SOCKET_PAIR(fds) \
+    int fds[2]; \
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0); \
+    DEFER(close(fds[0]); close(fds[1]))
+
+TEST(cat_poll, watcher_close)
+{
+    const cat_poll_stats_t *stats = cat_poll_get_stats();
+    size_t watcher_count = stats->watcher_count;
+    uint64_t create_count = stats->watcher_create_count;
+
+    PREPARE_SOCKET_PAIR(fds);
+    for (int n = 0; n < 3; n++) {
+        cat_pollfd_events_t revents;
+        ASSERT_EQ(cat_poll_one(fds[0], POLLOUT, &revents, TEST_IO_TIMEOUT), CAT_RET_OK);
+        ASSERT_EQ(revents, POLLOUT);
+        /* watcher of unwatched fd is closed when poll returns */
+        ASSERT_EQ(stats->watcher_count, watcher_count);
+    }
+    ASSERT_EQ(stats->watcher_create_count - create_count, 3);
+}
+
+TEST(cat_poll, fd_reused_by_socket)
+{
+    cat_socket_t server, client, connection;
+    int fd;
+
+    /* find out which fd number the server would take */
+    ASSERT_NE(cat_socket_create(&server, CAT_SOCKET_TYPE_TCP), nullptr);
+    ASSERT_TRUE(cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(&server, TEST_SERVER_BACKLOG));
+    fd = cat_socket_get_fd(&server);
+    ASSERT_TRUE(cat_socket_close(&server));
+    ASSERT_TRUE(cat_time_delay(0));
+
+    /* poll on that fd number and then close it, it would be reused by the server */
+    do {
+        PREPARE_SOCKET_PAIR(fds);
+        ASSERT_EQ(dup2(fds[0], fd), fd);
+        DEFER(close(fd));
+        ASSERT_EQ(cat_poll_one(fd, POLLOUT, nullptr, TEST_IO_TIMEOUT), CAT_RET_OK);
+    } while (0);
+    ASSERT_NE(cat_socket_create(&server, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&server));
+    ASSERT_TRUE(cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(&server, TEST_SERVER_BACKLOG));
+    SKIP_IF_(cat_socket_get_fd(&server) != fd, "fd number was not reused");
+    /* let server be registered in the loop */
+    ASSERT_TRUE(cat_time_delay(0));
+    /* poll on the same fd number again */
+    ASSERT_EQ(cat_poll_one(fd, POLLIN, nullptr, 0), CAT_RET_NONE);
+
+    /* server still gets readiness events */
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    ASSERT_TRUE(cat_socket_connect_to(&client, CAT_STRL(TEST_LISTEN_IPV4), cat_socket_get_sock_port(&server)));
+    ASSERT_NE(cat_socket_create(&connection, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&connection));
+    ASSERT_TRUE(cat_socket_accept_ex(&server, &connection, TEST_IO_TIMEOUT));
+}
+
+TEST(cat_poll, watch)
+{
+    const cat_poll_stats_t *stats = cat_poll_get_stats();
+    PREPARE_SOCKET_PAIR(fds);
+    size_t watcher_count = stats->watcher_count;
+
+    ASSERT_TRUE(cat_poll_watch(fds[0]));
+    uint64_t update_count = stats->watcher_update_count;
+    for (int n = 0; n < 10; n++) {
+        char c;
+        ASSERT_EQ(write(fds[1], "x", 1), 1);
+        ASSERT_EQ(cat_poll_one(fds[0], POLLIN, nullptr, TEST_IO_TIMEOUT), CAT_RET_OK);
+        ASSERT_EQ(read(fds[0], &c, 1), 1);
+    }
+    /* registration has been kept alive across calls */
+    ASSERT_EQ(stats->watcher_update_count - update_count, 1);
+    ASSERT_EQ(cat_poll_one(fds[0], POLLIN, nullptr, 1), CAT_RET_NONE);
+    cat_poll_unwatch(fds[0]);
+    ASSERT_EQ(stats->watcher_count, watcher_count);
+}
+
+TEST(cat_poll, shared_watcher)
+{
+    const cat_poll_stats_t *stats = cat_poll_get_stats();
+    PREPARE_SOCKET_PAIR(fds);
+    uint64_t create_count = stats->watcher_create_count;
+    wait_group wg;
+
+    for (size_t n = 10; n--;) {
+        co([&] {
+            wg++;
+            DEFER(wg--);
+            cat_pollfd_events_t revents;
+            ASSERT_EQ(cat_poll_one(fds[0], POLLIN, &revents, TEST_IO_TIMEOUT), CAT_RET_OK);
+            ASSERT_EQ(revents, POLLIN);
+        });
+    }
+    /* one of pollers only cares about writable event */
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        cat_pollfd_events_t revents;
+        ASSERT_EQ(cat_poll_one(fds[0], POLLOUT, &revents, TEST_IO_TIMEOUT), CAT_RET_OK);
+        ASSERT_EQ(revents, POLLOUT);
+    });
+    ASSERT_EQ(write(fds[1], "x", 1), 1);
+    ASSERT_TRUE(wg());
+    ASSERT_EQ(stats->watcher_create_count - create_count, 1);
+}
+#endif
+
 typedef int (*test_select_function_t)(cat_os_socket_t nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
 
 static cat_ret_t select_is_xxx_able(test_select_function_t select_function, cat_socket_fd_t fd, int type)
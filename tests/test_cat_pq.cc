@@ -19,6 +19,8 @@
 #include "test.h"
 #ifdef CAT_PQ
 
+#include <vector>
+
 static cat_always_inline cat_bool_t skip()
 {
     return (! cat_env_is_true("TEST_CAT_POSTGRESQL", cat_false));
@@ -111,4 +113,315 @@ TEST(cat_pq, concurrency)
     }
 }
 
+static void cat_pq_exec_ok(PGconn *conn, const char *query)
+{
+    PGresult *result = cat_pq_exec(conn, query);
+    ASSERT_TRUE(PQresultStatus(result) == PGRES_COMMAND_OK || PQresultStatus(result) == PGRES_TUPLES_OK)
+        << PQerrorMessage(conn);
+    PQclear(result);
+}
+
+TEST(cat_pq, copy)
+{
+    SKIP_IF(skip());
+
+    PGconn *conn = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+    DEFER(PQfinish(conn));
+
+    cat_pq_exec_ok(conn, "CREATE TEMP TABLE cat_pq_copy_test (id int, name text)");
+
+    /* COPY FROM */
+    PGresult *result = cat_pq_exec(conn, "COPY cat_pq_copy_test FROM STDIN");
+    ASSERT_EQ(PQresultStatus(result), PGRES_COPY_IN);
+    PQclear(result);
+    ASSERT_TRUE(cat_pq_copy_put_data(conn, CAT_STRL("1\tfoo\n")));
+    char row2[] = "2\tbar\n", row3[] = "3\tbaz\n";
+    cat_io_vector_t vector[2];
+    vector[0].base = row2;
+    vector[0].length = CAT_STRLEN(row2);
+    vector[1].base = row3;
+    vector[1].length = CAT_STRLEN(row3);
+    ASSERT_TRUE(cat_pq_copy_put_vector(conn, vector, CAT_ARRAY_SIZE(vector)));
+    cat_buffer_t buffer;
+    ASSERT_TRUE(cat_buffer_create(&buffer, 0));
+    DEFER(cat_buffer_close(&buffer));
+    ASSERT_TRUE(cat_buffer_append_str(&buffer, "4\tqux\n"));
+    ASSERT_TRUE(cat_pq_copy_put_buffer(conn, &buffer));
+    result = cat_pq_copy_end(conn, nullptr);
+    ASSERT_EQ(PQresultStatus(result), PGRES_COMMAND_OK);
+    ASSERT_STREQ(PQcmdTuples(result), "4");
+    PQclear(result);
+
+    /* COPY TO */
+    result = cat_pq_exec(conn, "COPY (SELECT * FROM cat_pq_copy_test ORDER BY id) TO STDOUT");
+    ASSERT_EQ(PQresultStatus(result), PGRES_COPY_OUT);
+    PQclear(result);
+    std::string output;
+    result = cat_pq_copy_to(conn, [](const char *row, size_t length, cat_data_t *data) -> cat_bool_t {
+        ((std::string *) data)->append(row, length);
+        return cat_true;
+    }, &output);
+    ASSERT_EQ(PQresultStatus(result), PGRES_COMMAND_OK);
+    PQclear(result);
+    ASSERT_EQ(output, "1\tfoo\n2\tbar\n3\tbaz\n4\tqux\n");
+
+    /* COPY FROM can be aborted */
+    result = cat_pq_exec(conn, "COPY cat_pq_copy_test FROM STDIN");
+    ASSERT_EQ(PQresultStatus(result), PGRES_COPY_IN);
+    PQclear(result);
+    ASSERT_TRUE(cat_pq_copy_put_data(conn, CAT_STRL("5\tquux\n")));
+    result = cat_pq_copy_end(conn, "canceled");
+    ASSERT_EQ(PQresultStatus(result), PGRES_FATAL_ERROR);
+    PQclear(result);
+}
+
+TEST(cat_pq, copy_bulk)
+{
+    SKIP_IF(skip());
+
+    PGconn *conn = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+    DEFER(PQfinish(conn));
+    const int rows = 100000;
+
+    cat_pq_exec_ok(conn, "CREATE TEMP TABLE cat_pq_copy_bulk_test (id int, name text)");
+
+    /* rows are streamed in many chunks */
+    PGresult *result = cat_pq_exec(conn, "COPY cat_pq_copy_bulk_test FROM STDIN");
+    ASSERT_EQ(PQresultStatus(result), PGRES_COPY_IN);
+    PQclear(result);
+    cat_buffer_t buffer;
+    ASSERT_TRUE(cat_buffer_create(&buffer, 8192));
+    DEFER(cat_buffer_close(&buffer));
+    for (int n = 0; n < rows; n++) {
+        std::string row = string_format("%d\tname_%d\n", n, n);
+        ASSERT_TRUE(cat_buffer_append(&buffer, row.c_str(), row.length()));
+        if (buffer.length >= 8000) {
+            ASSERT_TRUE(cat_pq_copy_put_buffer(conn, &buffer));
+            cat_buffer_clear(&buffer);
+        }
+    }
+    ASSERT_TRUE(cat_pq_copy_put_buffer(conn, &buffer));
+    result = cat_pq_copy_end(conn, nullptr);
+    ASSERT_EQ(PQresultStatus(result), PGRES_COMMAND_OK);
+    ASSERT_EQ(std::stoi(PQcmdTuples(result)), rows);
+    PQclear(result);
+}
+
+TEST(cat_pq, pool_invalid_options)
+{
+    cat_pq_pool_options_t options;
+
+    cat_pq_pool_options_init(&options);
+    options.max_size = 0;
+    ASSERT_EQ(cat_pq_pool_create(nullptr, TEST_PQ_CONNINFO, &options), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+    options.max_size = 1;
+    options.min_size = 2;
+    ASSERT_EQ(cat_pq_pool_create(nullptr, TEST_PQ_CONNINFO, &options), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+TEST(cat_pq, pool)
+{
+    SKIP_IF(skip());
+
+    cat_pq_pool_options_t options;
+    cat_pq_pool_t pool;
+
+    cat_pq_pool_options_init(&options);
+    options.min_size = 1;
+    options.max_size = 2;
+    ASSERT_NE(cat_pq_pool_create(&pool, TEST_PQ_CONNINFO, &options), nullptr);
+    DEFER(cat_pq_pool_close(&pool));
+    const cat_pq_pool_stats_t *stats = cat_pq_pool_get_stats(&pool);
+    ASSERT_EQ(stats->size, 1u);
+    ASSERT_EQ(stats->idle_count, 1u);
+
+    cat_pq_pool_connection_t *connection1 = cat_pq_pool_acquire(&pool);
+    ASSERT_NE(connection1, nullptr);
+    PGconn *conn1 = cat_pq_pool_connection_get_conn(connection1);
+    cat_pq_pool_connection_t *connection2 = cat_pq_pool_acquire(&pool);
+    ASSERT_NE(connection2, nullptr);
+    ASSERT_EQ(stats->size, 2u);
+    ASSERT_EQ(stats->in_use_count, 2u);
+
+    /* statement is prepared only once */
+    for (int n = 0; n < 3; n++) {
+        std::string value = std::to_string(n);
+        const char *values[] = { value.c_str() };
+        PGresult *result = cat_pq_pool_connection_exec_cached(connection1, "SELECT $1::int + 1", 1, nullptr, values, nullptr, nullptr, 0);
+        ASSERT_EQ(PQresultStatus(result), PGRES_TUPLES_OK);
+        ASSERT_EQ(std::stoi(PQgetvalue(result, 0, 0)), n + 1);
+        PQclear(result);
+    }
+    ASSERT_EQ(stats->statement_prepare_count, 1u);
+
+    /* pool is exhausted */
+    ASSERT_EQ(cat_pq_pool_acquire_ex(&pool, 10), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    ASSERT_EQ(stats->timeout_count, 1u);
+
+    /* connection is handed over to the waiter */
+    cat_pq_pool_connection_t *connection3 = nullptr;
+    co([&] {
+        connection3 = cat_pq_pool_acquire(&pool);
+    });
+    ASSERT_EQ(stats->waiter_count, 1u);
+    cat_pq_pool_release(connection1);
+    ASSERT_NE(connection3, nullptr);
+    ASSERT_EQ(cat_pq_pool_connection_get_conn(connection3), conn1);
+    ASSERT_EQ(stats->waiter_count, 0u);
+    ASSERT_EQ(stats->in_use_count, 2u);
+
+    /* connection in transaction would not be reused */
+    PQclear(cat_pq_exec(cat_pq_pool_connection_get_conn(connection3), "BEGIN"));
+    cat_pq_pool_release(connection3);
+    ASSERT_EQ(stats->size, 1u);
+    cat_pq_pool_release(connection2);
+    ASSERT_EQ(stats->idle_count, 1u);
+    ASSERT_EQ(stats->in_use_count, 0u);
+}
+
+TEST(cat_pq, pool_close_while_connecting)
+{
+    cat_socket_t server;
+    ASSERT_NE(cat_socket_create(&server, CAT_SOCKET_TYPE_TCP4), nullptr);
+    DEFER(cat_socket_close(&server));
+    ASSERT_TRUE(cat_socket_bind_to(&server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(&server, TEST_SERVER_BACKLOG));
+    std::string conninfo = string_format("host=%s port=%d dbname=postgres user=postgres connect_timeout=5",
+        TEST_LISTEN_IPV4, cat_socket_get_sock_port(&server));
+
+    cat_pq_pool_options_t options;
+    cat_pq_pool_options_init(&options);
+    options.min_size = 0;
+    options.max_size = 1;
+    cat_pq_pool_t *pool = cat_pq_pool_create(nullptr, conninfo.c_str(), &options);
+    ASSERT_NE(pool, nullptr);
+
+    wait_group wg;
+    cat_pq_pool_connection_t *connection = (cat_pq_pool_connection_t *) -1;
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        connection = cat_pq_pool_acquire(pool);
+    });
+    ASSERT_EQ(cat_pq_pool_get_stats(pool)->size, 1u);
+
+    /* connect fails after pool was closed, the last slot releases the pool */
+    cat_socket_t connection_socket;
+    ASSERT_NE(cat_socket_create(&connection_socket, CAT_SOCKET_TYPE_TCP), nullptr);
+    ASSERT_TRUE(cat_socket_accept(&server, &connection_socket));
+    cat_pq_pool_close(pool);
+    cat_socket_close(&connection_socket);
+    wg();
+    ASSERT_EQ(connection, nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ECONNREFUSED);
+}
+
+#ifdef CAT_PQ_HAVE_PIPELINE
+TEST(cat_pq, pipeline)
+{
+    SKIP_IF(skip());
+
+    PGconn *conn = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+    DEFER(PQfinish(conn));
+
+    ASSERT_TRUE(cat_pq_enter_pipeline_mode(conn));
+    ASSERT_TRUE(cat_pq_pipeline_prepare(conn, "pipeline_stmt", "SELECT $1::int * 2", 1, nullptr));
+    for (int n = 0; n < 10; n++) {
+        std::string value = std::to_string(n);
+        const char *values[] = { value.c_str() };
+        ASSERT_TRUE(cat_pq_pipeline_exec_prepared(conn, "pipeline_stmt", 1, values, nullptr, nullptr, 0));
+    }
+    ASSERT_TRUE(cat_pq_pipeline_sync(conn));
+
+    PGresult *result = cat_pq_pipeline_get_result(conn);
+    ASSERT_EQ(PQresultStatus(result), PGRES_COMMAND_OK);
+    PQclear(result);
+    for (int n = 0; n < 10; n++) {
+        result = cat_pq_pipeline_get_result(conn);
+        ASSERT_EQ(PQresultStatus(result), PGRES_TUPLES_OK);
+        ASSERT_EQ(std::stoi(PQgetvalue(result, 0, 0)), n * 2);
+        PQclear(result);
+    }
+    result = cat_pq_pipeline_get_result(conn);
+    ASSERT_EQ(PQresultStatus(result), PGRES_PIPELINE_SYNC);
+    PQclear(result);
+    ASSERT_TRUE(cat_pq_exit_pipeline_mode(conn));
+}
+
+TEST(cat_pq, pipeline_exec_params_batch)
+{
+    SKIP_IF(skip());
+
+    PGconn *conn = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+    DEFER(PQfinish(conn));
+
+    std::vector<std::string> values;
+    std::vector<const char *> params;
+    std::vector<const char *const *> batches;
+    for (int n = 0; n < 100; n++) {
+        values.push_back(std::to_string(n));
+    }
+    for (auto &value : values) {
+        params.push_back(value.c_str());
+    }
+    for (auto &param : params) {
+        batches.push_back(&param);
+    }
+    std::vector<int> sums;
+    int n_done = cat_pq_pipeline_exec_params_batch(conn, "SELECT $1::int + 1", 1, (int) batches.size(),
+        nullptr, batches.data(), nullptr, nullptr, 0, [](PGconn *conn, PGresult *result, cat_data_t *data) {
+            (void) conn;
+            auto sums = (std::vector<int> *) data;
+            sums->push_back(std::stoi(PQgetvalue(result, 0, 0)));
+            PQclear(result);
+        }, &sums);
+    ASSERT_EQ(n_done, 100);
+    ASSERT_EQ(sums.size(), 100u);
+    for (int n = 0; n < 100; n++) {
+        ASSERT_EQ(sums[n], n + 1);
+    }
+    ASSERT_EQ(PQpipelineStatus(conn), PQ_PIPELINE_OFF);
+
+    /* it still works in normal mode */
+    PGresult *result = cat_pq_exec(conn, "SELECT 1");
+    ASSERT_EQ(PQresultStatus(result), PGRES_TUPLES_OK);
+    PQclear(result);
+}
+
+TEST(cat_pq, pipeline_exec_params_batch_broken)
+{
+    SKIP_IF(skip());
+
+    PGconn *conn = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+    DEFER(PQfinish(conn));
+    PGconn *killer = cat_pq_connectdb(TEST_PQ_CONNINFO);
+    ASSERT_EQ(PQstatus(killer), CONNECTION_OK);
+    DEFER(PQfinish(killer));
+
+    std::string pid = std::to_string(PQbackendPID(conn));
+    const char *pid_param = pid.c_str();
+    PGresult *result = cat_pq_exec_params(killer, "SELECT pg_terminate_backend($1::int)", 1, nullptr, &pid_param, nullptr, nullptr, 0);
+    ASSERT_EQ(PQresultStatus(result), PGRES_TUPLES_OK);
+    PQclear(result);
+    /* termination is asynchronous */
+    cat_time_msleep(100);
+
+    const char *value = "1";
+    const char *const params[] = { value };
+    const char *const *batches[] = { params, params };
+    ASSERT_EQ(cat_pq_pipeline_exec_params_batch(conn, "SELECT $1::int + 1", 1, 2,
+        nullptr, batches, nullptr, nullptr, 0, nullptr, nullptr), -1);
+    /* results can not be drained, it must not pretend to be reusable */
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EPROTO);
+}
+#endif
+
 #endif
@@ -1770,6 +1770,82 @@ TEST(cat_socket, send_file)
     }
 }
 
+#ifndef CAT_OS_WIN
+TEST(cat_socket, send_mapped)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    /* it spans multiple chunks */
+    const size_t length = CAT_SOCKET_SEND_MAPPED_CHUNK_SIZE * 2 + 1234;
+    std::string random_bytes = get_random_bytes(length);
+    std::string filename = get_random_path();
+    cat_socket_t client;
+    cat_file_t fd;
+    void *address;
+    wait_group wg;
+
+    ASSERT_TRUE(cat_fs_put_contents(filename.c_str(), random_bytes.c_str(), random_bytes.length()));
+    DEFER(cat_fs_unlink(filename.c_str()));
+    fd = cat_fs_open(filename.c_str(), CAT_FS_OPEN_FLAG_RDONLY);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_close(fd));
+    address = cat_fs_mmap(fd, 0, length, CAT_FS_MMAP_FLAG_NONE);
+    ASSERT_NE(address, nullptr);
+    DEFER(cat_fs_munmap(address, length));
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    ASSERT_TRUE(cat_socket_connect_to(&client, echo_tcp_server_ip, echo_tcp_server_ip_length, echo_tcp_server_port));
+
+    std::string read_buffer(length, '\0');
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        ASSERT_EQ(cat_socket_read(&client, &read_buffer[0], length), (ssize_t) length);
+    });
+    ASSERT_TRUE(cat_socket_send_mapped(&client, address, length));
+    ASSERT_TRUE(wg());
+    ASSERT_EQ(read_buffer, random_bytes);
+}
+
+TEST(cat_socket, send_mapped_exclusive)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    const size_t length = CAT_SOCKET_SEND_MAPPED_CHUNK_SIZE * 2 + 1234;
+    std::string random_bytes = get_random_bytes(length);
+    std::string filename = get_random_path();
+    cat_socket_t client;
+    cat_file_t fd;
+    void *address;
+    wait_group wg;
+
+    ASSERT_TRUE(cat_fs_put_contents(filename.c_str(), random_bytes.c_str(), random_bytes.length()));
+    DEFER(cat_fs_unlink(filename.c_str()));
+    fd = cat_fs_open(filename.c_str(), CAT_FS_OPEN_FLAG_RDONLY);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_close(fd));
+    address = cat_fs_mmap(fd, 0, length, CAT_FS_MMAP_FLAG_NONE);
+    ASSERT_NE(address, nullptr);
+    DEFER(cat_fs_munmap(address, length));
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    ASSERT_TRUE(cat_socket_connect_to(&client, echo_tcp_server_ip, echo_tcp_server_ip_length, echo_tcp_server_port));
+
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        ASSERT_TRUE(cat_socket_send_mapped(&client, address, length));
+    });
+    /* it is prefaulting now, others must not write in between */
+    ASSERT_FALSE(cat_socket_send(&client, CAT_STRL("x")));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ELOCKED);
+    std::string read_buffer(length, '\0');
+    ASSERT_EQ(cat_socket_read(&client, &read_buffer[0], length), (ssize_t) length);
+    ASSERT_TRUE(wg());
+    ASSERT_EQ(read_buffer, random_bytes);
+}
+#endif
+
 TEST(cat_socket, send_big_file)
 {
     TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
@@ -1915,6 +1991,221 @@ TEST(cat_socket, cancel_connect_local)
     ASSERT_TRUE(exited);
 }
 
+namespace testing
+{
+    class connect_race_context
+    {
+    public:
+        std::string hosts_path;
+        cat_bool_t stub_resolver_enabled;
+        cat_msec_t connect_attempt_delay;
+
+        connect_race_context(const char *hosts)
+        {
+            hosts_path = get_random_path();
+            EXPECT_TRUE(file_put_contents(hosts_path.c_str(), hosts, strlen(hosts)));
+            EXPECT_TRUE(cat_dns_resolver_load_hosts(hosts_path.c_str()));
+            stub_resolver_enabled = cat_dns_enable_stub_resolver(cat_true);
+            connect_attempt_delay = cat_socket_get_global_connect_attempt_delay();
+            cat_socket_set_global_connect_attempt_delay(50);
+        }
+
+        ~connect_race_context()
+        {
+            cat_socket_set_global_connect_attempt_delay(connect_attempt_delay);
+            cat_dns_enable_stub_resolver(stub_resolver_enabled);
+            cat_dns_resolver_load_hosts(nullptr);
+            remove_file(hosts_path.c_str());
+        }
+    };
+
+#ifdef CAT_OS_LINUX
+    /* connecting to it hangs, because its accept queue is full and SYNs are dropped */
+    class blackhole_server
+    {
+    public:
+        int fd;
+        int port;
+        std::vector<int> fillers;
+
+        blackhole_server()
+        {
+            struct sockaddr_in address;
+            socklen_t address_length = sizeof(address);
+
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            EXPECT_GE(fd, 0);
+            memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            EXPECT_EQ(bind(fd, (struct sockaddr *) &address, sizeof(address)), 0);
+            EXPECT_EQ(listen(fd, 0), 0);
+            EXPECT_EQ(getsockname(fd, (struct sockaddr *) &address, &address_length), 0);
+            port = ntohs(address.sin_port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            for (int n = 0; n < 3; n++) {
+                int filler = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+                (void) connect(filler, (struct sockaddr *) &address, sizeof(address));
+                fillers.push_back(filler);
+            }
+            /* wait for handshakes of fillers */
+            (void) cat_time_msleep(10);
+        }
+
+        ~blackhole_server()
+        {
+            for (auto filler : fillers) {
+                (void) close(filler);
+            }
+            (void) close(fd);
+        }
+    };
+#endif
+}
+
+TEST(cat_socket, connect_race)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    testing::connect_race_context context(
+        /* TEST-NET-1, it never responds or fails immediately */
+        "192.0.2.1 race.test\n"
+        "127.0.0.1 race.test\n"
+    );
+    const cat_socket_connect_stats_t *stats = cat_socket_get_connect_stats();
+    uint64_t attempts = stats->attempts, races = stats->races, ipv4_count = stats->ipv4.count;
+    cat_socket_t client;
+    char buffer[CAT_STRLEN("hello")];
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    cat_msec_t s = cat_time_msec();
+    ASSERT_TRUE(cat_socket_connect_to_ex(&client, CAT_STRL("race.test"), echo_tcp_server_port, 3000));
+    ASSERT_LT(cat_time_msec() - s, 1000);
+    ASSERT_TRUE(cat_socket_is_established(&client));
+    ASSERT_EQ(cat_socket_get_af(&client), AF_INET);
+    ASSERT_EQ(cat_socket_get_peer_port(&client), echo_tcp_server_port);
+    ASSERT_EQ(stats->attempts, attempts + 2);
+    ASSERT_EQ(stats->races, races + 1);
+    ASSERT_EQ(stats->ipv4.count, ipv4_count + 1);
+    /* the winner socket is fully usable */
+    ASSERT_TRUE(cat_socket_send(&client, CAT_STRL("hello")));
+    ASSERT_EQ(cat_socket_recv(&client, CAT_STRS(buffer)), (ssize_t) sizeof(buffer));
+    ASSERT_EQ(std::string(buffer, sizeof(buffer)), std::string("hello"));
+}
+
+TEST(cat_socket, connect_race_first_wins)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    testing::connect_race_context context(
+        "127.0.0.1 race.test\n"
+        "192.0.2.1 race.test\n"
+    );
+    const cat_socket_connect_stats_t *stats = cat_socket_get_connect_stats();
+    uint64_t attempts = stats->attempts, races = stats->races;
+    cat_socket_t client;
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    ASSERT_TRUE(cat_socket_connect_to_ex(&client, CAT_STRL("race.test"), echo_tcp_server_port, 3000));
+    ASSERT_EQ(cat_socket_get_af(&client), AF_INET);
+    /* the second one has never been started */
+    ASSERT_EQ(stats->attempts, attempts + 1);
+    ASSERT_EQ(stats->races, races);
+}
+
+TEST(cat_socket, connect_race_fallback_to_ipv4)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    /* echo server only listens on IPv4, so IPv6 attempt would be refused or timed out */
+    testing::connect_race_context context(
+        "::1 race.test\n"
+        "127.0.0.1 race.test\n"
+    );
+    cat_socket_t client;
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    ASSERT_TRUE(cat_socket_connect_to_ex(&client, CAT_STRL("race.test"), echo_tcp_server_port, 3000));
+    ASSERT_EQ(cat_socket_get_af(&client), AF_INET);
+}
+
+#ifdef CAT_OS_LINUX
+TEST(cat_socket, connect_race_canceled_by_resume)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    testing::blackhole_server blackhole;
+    testing::connect_race_context context(
+        "127.0.0.1 race.test\n"
+        "127.0.0.2 race.test\n"
+    );
+    cat_socket_t client;
+    char buffer[CAT_STRLEN("hello")];
+    bool done = false;
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    cat_coroutine_t *coroutine = co([&] {
+        ASSERT_FALSE(cat_socket_connect_to_ex(&client, CAT_STRL("race.test"), blackhole.port, TEST_IO_TIMEOUT));
+        ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+        done = true;
+    });
+    ASSERT_FALSE(done);
+    /* e.g. coroutine group cancel, it is not caused by socket close */
+    ASSERT_TRUE(cat_coroutine_resume(coroutine, nullptr, nullptr));
+    ASSERT_TRUE(done);
+    /* socket is not busy anymore, it can be reused */
+    ASSERT_TRUE(cat_socket_connect_to_ex(&client, CAT_STRL(TEST_LISTEN_IPV4), echo_tcp_server_port, TEST_IO_TIMEOUT));
+    ASSERT_TRUE(cat_socket_send(&client, CAT_STRL("hello")));
+    ASSERT_EQ(cat_socket_recv(&client, CAT_STRS(buffer)), (ssize_t) sizeof(buffer));
+    ASSERT_EQ(std::string(buffer, sizeof(buffer)), std::string("hello"));
+}
+
+TEST(cat_socket, connect_race_deadline)
+{
+    testing::blackhole_server blackhole;
+    testing::connect_race_context context(
+        "127.0.0.1 race.test\n"
+        "127.0.0.2 race.test\n"
+        "127.0.0.3 race.test\n"
+        "127.0.0.4 race.test\n"
+    );
+    const cat_socket_connect_stats_t *stats = cat_socket_get_connect_stats();
+    uint64_t attempts = stats->attempts;
+    cat_socket_t client;
+
+    ASSERT_NE(cat_socket_create(&client, CAT_SOCKET_TYPE_TCP), nullptr);
+    DEFER(cat_socket_close(&client));
+    /* it is shorter than the attempt delay */
+    cat_msec_t deadline = cat_time_narrow_deadline(10);
+    cat_msec_t s = cat_time_msec();
+    ASSERT_FALSE(cat_socket_connect_to_ex(&client, CAT_STRL("race.test"), blackhole.port, CAT_TIMEOUT_FOREVER));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    (void) cat_time_set_deadline(deadline);
+    ASSERT_LT(cat_time_msec() - s, 1000);
+    /* the rest are not started once deadline is exceeded */
+    ASSERT_EQ(stats->attempts, attempts + 1);
+}
+#endif
+
+TEST(cat_socket, cross_close_when_connect_racing)
+{
+    TEST_REQUIRE(echo_tcp_server != nullptr, cat_socket, echo_tcp_server);
+    testing::connect_race_context context(
+        "192.0.2.1 race.test\n"
+        "192.0.2.2 race.test\n"
+    );
+    cat_socket_t _socket, *socket = cat_socket_create(&_socket, CAT_SOCKET_TYPE_TCP);
+    bool exited = false;
+    co([&] {
+        DEFER(exited = true);
+        ASSERT_FALSE(cat_socket_connect_to_ex(socket, CAT_STRL("race.test"), echo_tcp_server_port, 3000));
+    });
+    ASSERT_TRUE(cat_socket_close(socket));
+    while (!exited) {
+        (void) cat_time_delay(1);
+    }
+}
+
 TEST(cat_socket, query_remote_http_server)
 {
     SKIP_IF_OFFLINE();
@@ -96,3 +96,180 @@ TEST(cat_sync_wait_group, error)
     ASSERT_FALSE(cat_sync_wait_group_wait(wg, TEST_IO_TIMEOUT));
     ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
 }
+
+static cat_bool_t group_spawn(cat_sync_coroutine_group_t *group, std::function<cat_bool_t(void)> function)
+{
+    auto *callable = new std::function<cat_bool_t(void)>(std::move(function));
+    cat_bool_t ret = cat_sync_coroutine_group_spawn(group, [](cat_data_t *data) -> cat_bool_t {
+        auto *callable = (std::function<cat_bool_t(void)> *) data;
+        cat_bool_t ret = (*callable)();
+        delete callable;
+        return ret;
+    }, callable);
+    if (!ret) {
+        delete callable;
+    }
+    return ret;
+}
+
+TEST(cat_sync_coroutine_group, base)
+{
+    cat_sync_coroutine_group_t *group, _group;
+    size_t done = 0;
+
+    group = cat_sync_coroutine_group_create(&_group);
+    ASSERT_NE(group, nullptr);
+    DEFER(cat_sync_coroutine_group_close(group));
+
+    for (size_t n = 4; n--;) {
+        ASSERT_TRUE(group_spawn(group, [group, &done]() -> cat_bool_t {
+            if (cat_time_delay(0) != CAT_RET_OK) {
+                return cat_false;
+            }
+            done++;
+            /* spawn into the same group */
+            return group_spawn(group, [&done]() -> cat_bool_t {
+                if (cat_time_delay(0) != CAT_RET_OK) {
+                    return cat_false;
+                }
+                done++;
+                return cat_true;
+            });
+        }));
+    }
+    ASSERT_EQ(cat_sync_coroutine_group_get_count(group), 4);
+
+    ASSERT_TRUE(cat_sync_coroutine_group_join(group, TEST_IO_TIMEOUT));
+    ASSERT_EQ(done, 8);
+    ASSERT_EQ(cat_sync_coroutine_group_get_count(group), 0);
+    ASSERT_FALSE(cat_sync_coroutine_group_is_canceled(group));
+    /* nothing to join */
+    ASSERT_TRUE(cat_sync_coroutine_group_join(group, 0));
+}
+
+TEST(cat_sync_coroutine_group, error)
+{
+    cat_sync_coroutine_group_t *group, _group;
+    cat_channel_t *channel, _channel;
+    cat_socket_t *server, _server;
+    size_t canceled = 0;
+
+    channel = cat_channel_create(&_channel, 0, sizeof(int), nullptr);
+    ASSERT_NE(channel, nullptr);
+    DEFER(cat_channel_cleanup(channel));
+    server = cat_socket_create(&_server, CAT_SOCKET_TYPE_TCP);
+    ASSERT_NE(server, nullptr);
+    DEFER(cat_socket_close(server));
+    ASSERT_TRUE(cat_socket_bind_to(server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(server, TEST_SERVER_BACKLOG));
+
+    group = cat_sync_coroutine_group_create(&_group);
+    DEFER(cat_sync_coroutine_group_close(group));
+
+    ASSERT_TRUE(group_spawn(group, [channel, &canceled]() -> cat_bool_t {
+        int data;
+        if (!cat_channel_pop(channel, &data, -1) && cat_get_last_error_code() == CAT_ECANCELED) {
+            canceled++;
+        }
+        return cat_false;
+    }));
+    ASSERT_TRUE(group_spawn(group, [server, &canceled]() -> cat_bool_t {
+        cat_socket_t *connection = cat_socket_create(nullptr, CAT_SOCKET_TYPE_TCP);
+        DEFER(cat_socket_close(connection));
+        if (!cat_socket_accept(server, connection) && cat_get_last_error_code() == CAT_ECANCELED) {
+            canceled++;
+        }
+        return cat_false;
+    }));
+    ASSERT_TRUE(group_spawn(group, [&canceled]() -> cat_bool_t {
+        /* it returns true if it was canceled */
+        if (cat_time_wait(-1)) {
+            canceled++;
+        }
+        return cat_true;
+    }));
+    ASSERT_TRUE(group_spawn(group, []() -> cat_bool_t {
+        (void) cat_time_delay(1);
+        cat_update_last_error(CAT_EINVAL, "Something went wrong");
+        return cat_false;
+    }));
+
+    ASSERT_FALSE(cat_sync_coroutine_group_join(group, TEST_IO_TIMEOUT));
+    /* the first error is propagated, errors caused by cancellation are ignored */
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+    ASSERT_STREQ(cat_get_last_error_message(), "Something went wrong");
+    ASSERT_EQ(canceled, 3);
+    ASSERT_EQ(cat_sync_coroutine_group_get_count(group), 0);
+    ASSERT_TRUE(cat_sync_coroutine_group_is_canceled(group));
+
+    ASSERT_FALSE(group_spawn(group, []() -> cat_bool_t { return cat_true; }));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+}
+
+TEST(cat_sync_coroutine_group, timeout)
+{
+    cat_sync_coroutine_group_t *group, _group;
+    size_t canceled = 0;
+
+    group = cat_sync_coroutine_group_create(&_group);
+    DEFER(cat_sync_coroutine_group_close(group));
+
+    for (size_t n = 4; n--;) {
+        ASSERT_TRUE(group_spawn(group, [&canceled]() -> cat_bool_t {
+            if (cat_time_wait(-1)) {
+                canceled++;
+            }
+            cat_update_last_error(CAT_ECANCELED, "Canceled");
+            return cat_false;
+        }));
+    }
+
+    ASSERT_FALSE(cat_sync_coroutine_group_join(group, 1));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    /* children never outlive join */
+    ASSERT_EQ(canceled, 4);
+    ASSERT_EQ(cat_sync_coroutine_group_get_count(group), 0);
+}
+
+TEST(cat_sync_coroutine_group, cancel)
+{
+    cat_sync_coroutine_group_t *group, _group;
+    size_t canceled = 0;
+
+    group = cat_sync_coroutine_group_create(&_group);
+    DEFER(cat_sync_coroutine_group_close(group));
+
+    ASSERT_TRUE(group_spawn(group, [&canceled]() -> cat_bool_t {
+        if (cat_time_wait(-1)) {
+            canceled++;
+        }
+        return cat_true;
+    }));
+    co([group] {
+        ASSERT_EQ(cat_time_delay(0), CAT_RET_OK);
+        ASSERT_FALSE(cat_sync_coroutine_group_join(group, 0));
+        ASSERT_EQ(cat_get_last_error_code(), CAT_EMISUSE);
+        cat_sync_coroutine_group_cancel(group);
+    });
+
+    ASSERT_FALSE(cat_sync_coroutine_group_join(group, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+    ASSERT_EQ(canceled, 1);
+}
+
+TEST(cat_sync_coroutine_group, close)
+{
+    cat_sync_coroutine_group_t *group, _group;
+    size_t canceled = 0;
+
+    group = cat_sync_coroutine_group_create(&_group);
+    ASSERT_TRUE(group_spawn(group, [&canceled]() -> cat_bool_t {
+        if (cat_time_wait(-1)) {
+            canceled++;
+        }
+        return cat_true;
+    }));
+    cat_sync_coroutine_group_close(group);
+    ASSERT_EQ(canceled, 1);
+    ASSERT_EQ(cat_sync_coroutine_group_get_count(group), 0);
+}
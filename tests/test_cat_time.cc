@@ -233,3 +233,106 @@ TEST(cat_time, blocking)
     ASSERT_TRUE(cat_time_delay(0));
     ASSERT_TRUE(cat_coroutine_resume(coroutine, nullptr, nullptr));
 }
+
+TEST(cat_time, deadline)
+{
+    ASSERT_EQ(cat_time_get_deadline(), 0);
+    ASSERT_EQ(cat_time_clamp_timeout(-1), -1);
+    ASSERT_EQ(cat_time_clamp_timeout(10), 10);
+
+    cat_msec_t original_deadline = cat_time_narrow_deadline(10);
+    DEFER(cat_time_set_deadline(original_deadline));
+    ASSERT_EQ(original_deadline, 0);
+    cat_msec_t deadline = cat_time_get_deadline();
+    ASSERT_GT(deadline, 0);
+    /* it can only be narrowed */
+    ASSERT_EQ(cat_time_narrow_deadline(1000), deadline);
+    ASSERT_EQ(cat_time_get_deadline(), deadline);
+    ASSERT_EQ(cat_time_clamp_timeout(-1), (cat_timeout_t) (deadline - cat_time_msec_cached()));
+    ASSERT_EQ(cat_time_clamp_timeout(0), 0);
+
+    cat_msec_t start = cat_time_msec();
+    ASSERT_FALSE(cat_time_wait(-1));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    ASSERT_STREQ(cat_get_last_error_message(), "Deadline exceeded");
+    ASSERT_GE(cat_time_msec(), deadline);
+    ASSERT_LT(cat_time_msec() - start, 1000);
+
+    /* exceeded, it fails immediately */
+    ASSERT_EQ(cat_time_clamp_timeout(-1), 0);
+    ASSERT_FALSE(cat_time_wait(1000));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+}
+
+TEST(cat_time, deadline_inherited)
+{
+    cat_channel_t *channel, _channel;
+    cat_socket_t *server, _server;
+    size_t exceeded = 0;
+
+    channel = cat_channel_create(&_channel, 0, sizeof(int), nullptr);
+    ASSERT_NE(channel, nullptr);
+    DEFER(cat_channel_cleanup(channel));
+    server = cat_socket_create(&_server, CAT_SOCKET_TYPE_TCP);
+    ASSERT_NE(server, nullptr);
+    DEFER(cat_socket_close(server));
+    ASSERT_TRUE(cat_socket_bind_to(server, CAT_STRL(TEST_LISTEN_IPV4), 0));
+    ASSERT_TRUE(cat_socket_listen(server, TEST_SERVER_BACKLOG));
+
+    cat_msec_t original_deadline = cat_time_narrow_deadline(10);
+    co([&] {
+        ASSERT_EQ(cat_time_get_deadline(), cat_coroutine_get_deadline(cat_coroutine_get_main()));
+        int data;
+        if (!cat_channel_pop(channel, &data, -1) && cat_get_last_error_code() == CAT_ETIMEDOUT) {
+            exceeded++;
+        }
+    });
+    co([&] {
+        cat_socket_t *connection = cat_socket_create(nullptr, CAT_SOCKET_TYPE_TCP);
+        DEFER(cat_socket_close(connection));
+        if (!cat_socket_accept(server, connection) && cat_get_last_error_code() == CAT_ETIMEDOUT) {
+            exceeded++;
+        }
+    });
+    co([&] {
+        cat_os_socket_t fd = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_NE(fd, CAT_OS_INVALID_SOCKET);
+#ifndef CAT_OS_WIN
+        DEFER(close(fd));
+#else
+        DEFER(closesocket(fd));
+#endif
+        if (cat_poll_one(fd, POLLIN, nullptr, -1) == CAT_RET_ERROR &&
+            cat_get_last_error_code() == CAT_ETIMEDOUT) {
+            exceeded++;
+        }
+    });
+    (void) cat_time_set_deadline(original_deadline);
+    co([&] {
+        /* it is not inherited after restored */
+        ASSERT_EQ(cat_time_get_deadline(), 0);
+    });
+
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    ASSERT_EQ(exceeded, 3);
+}
+
+TEST(cat_time, deadline_exempt)
+{
+    std::string path = get_random_path();
+    cat_file_t fd;
+    cat_dir_t *dir;
+
+    fd = cat_fs_open(path.c_str(), CAT_FS_OPEN_FLAG_RDWR | CAT_FS_OPEN_FLAG_CREAT, 0600);
+    ASSERT_GE(fd, 0);
+    DEFER(cat_fs_unlink(path.c_str()));
+    dir = cat_fs_opendir(TEST_TMP_PATH);
+    ASSERT_NE(dir, nullptr);
+
+    /* resources are released whatever the deadline is */
+    cat_msec_t original_deadline = cat_time_set_deadline(1);
+    ASSERT_FALSE(cat_time_wait(-1));
+    ASSERT_EQ(cat_fs_close(fd), 0);
+    ASSERT_EQ(cat_fs_closedir(dir), 0);
+    (void) cat_time_set_deadline(original_deadline);
+}
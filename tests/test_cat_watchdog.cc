@@ -18,6 +18,8 @@
 
 #include "test.h"
 
+#include <sstream>
+
 const std::string keyword = "Watchdog";
 
 static void test_sys_nanosleep_nocancel(cat_nsec_t ns_total)
@@ -141,4 +143,163 @@ TEST(cat_watchdog, duplicated)
 TEST(cat_watchdog, not_running)
 {
     ASSERT_EQ(cat_watchdog_get_quantum(), -1);
+    ASSERT_FALSE(cat_watchdog_enable_snapshot_backtrace(cat_true));
+}
+
+TEST(cat_watchdog, profiler)
+{
+    ASSERT_FALSE(cat_watchdog_start_profiler(0));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EMISUSE);
+
+    ASSERT_TRUE(cat_watchdog_run(nullptr, 1000 * 1000, CAT_WATCH_DOG_THRESHOLD_DISABLED, [](cat_watchdog_t *watchdog) { }));
+    DEFER(cat_watchdog_stop());
+
+    if (!cat_watchdog_start_profiler(0)) {
+        ASSERT_EQ(cat_get_last_error_code(), CAT_ENOTSUP);
+        SKIP_IF_(true, "Profiler is not supported");
+    }
+    ASSERT_TRUE(cat_watchdog_stop_profiler());
+    ASSERT_FALSE(cat_watchdog_start_profiler(SIZE_MAX));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+    ASSERT_FALSE(cat_watchdog_is_profiling());
+    ASSERT_TRUE(cat_watchdog_start_profiler(0));
+    ASSERT_TRUE(cat_watchdog_is_profiling());
+    ASSERT_FALSE(cat_watchdog_start_profiler(0));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EMISUSE);
+
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    co([] {
+        cat_nsec_t end = cat_time_nsec() + 50 * 1000 * 1000;
+        while (cat_time_nsec() < end);
+    });
+
+    cat_watchdog_profiler_stats_t stats;
+    ASSERT_TRUE(cat_watchdog_get_profiler_stats(&stats));
+    ASSERT_GT(stats.sample_count, 0);
+    ASSERT_EQ(stats.capacity, CAT_WATCH_DOG_PROFILER_DEFAULT_CAPACITY);
+    ASSERT_EQ(stats.stored_count, stats.sample_count);
+
+    char *folded = cat_watchdog_get_folded_stacks();
+    ASSERT_NE(folded, nullptr);
+    DEFER(cat_buffer_str_free(folded));
+    std::string output(folded);
+    ASSERT_NE(output.find("coroutine;"), std::string::npos);
+    ASSERT_EQ(output.back(), '\n');
+
+    ASSERT_TRUE(cat_watchdog_stop_profiler());
+    ASSERT_FALSE(cat_watchdog_is_profiling());
+    ASSERT_FALSE(cat_watchdog_stop_profiler());
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EMISUSE);
+}
+
+TEST(cat_watchdog, profiler_ring_buffer)
+{
+    constexpr size_t capacity = 4;
+
+    ASSERT_TRUE(cat_watchdog_run(nullptr, 1000 * 1000, CAT_WATCH_DOG_THRESHOLD_DISABLED, [](cat_watchdog_t *watchdog) { }));
+    DEFER(cat_watchdog_stop());
+    SKIP_IF_(!cat_watchdog_start_profiler(capacity), "Profiler is not supported");
+
+    cat_nsec_t end = cat_time_nsec() + 30 * 1000 * 1000;
+    while (cat_time_nsec() < end);
+
+    cat_watchdog_profiler_stats_t stats;
+    ASSERT_TRUE(cat_watchdog_get_profiler_stats(&stats));
+    ASSERT_GT(stats.sample_count, capacity);
+    ASSERT_EQ(stats.stored_count, capacity);
+
+    char *folded = cat_watchdog_get_folded_stacks();
+    ASSERT_NE(folded, nullptr);
+    DEFER(cat_buffer_str_free(folded));
+    std::istringstream lines(folded);
+    std::string line;
+    size_t total = 0;
+    while (std::getline(lines, line)) {
+        ASSERT_EQ(line.rfind("main;", 0), 0);
+        total += std::stoul(line.substr(line.rfind(' ') + 1));
+    }
+    ASSERT_EQ(total, capacity);
+    /* it is stopped by watchdog stop */
+}
+
+TEST(cat_watchdog, snapshot)
+{
+    static cat_watchdog_snapshot_t snapshot;
+    static cat_alert_count_t alert_count;
+    cat_coroutine_id_t id = 0;
+
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    snapshot.role = nullptr;
+    alert_count = 0;
+    ASSERT_TRUE(cat_watchdog_run(nullptr, 1000 * 1000, CAT_WATCH_DOG_THRESHOLD_DISABLED, [](cat_watchdog_t *watchdog) {
+        if (watchdog->alert_count == 2) {
+            snapshot = watchdog->snapshot;
+        }
+        alert_count = watchdog->alert_count;
+    }));
+    DEFER(cat_watchdog_stop());
+    bool backtrace = cat_watchdog_enable_snapshot_backtrace(cat_true);
+
+    co([&] {
+        id = cat_coroutine_get_current_id();
+        test_sys_nanosleep_nocancel(cat_watchdog_get_quantum() * 10);
+    });
+    ASSERT_TRUE(cat_watchdog_stop());
+
+    ASSERT_GE(alert_count, 2);
+    ASSERT_NE(snapshot.role, nullptr);
+    ASSERT_STREQ(snapshot.role, "coroutine");
+    ASSERT_GE(snapshot.blocked_time, 1000 * 1000);
+    if (snapshot.depth > 0 || snapshot.coroutine_id != 0) {
+        ASSERT_TRUE(backtrace);
+        ASSERT_EQ(snapshot.coroutine_id, id);
+    }
+}
+
+TEST(cat_watchdog, budget)
+{
+    static cat_coroutine_id_t exceeded_id;
+    static cat_nsec_t exceeded_elapsed;
+    constexpr cat_nsec_t budget = 5 * 1000 * 1000;
+    size_t exceeded = 0;
+
+    ASSERT_FALSE(cat_watchdog_check_budget());
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    exceeded_id = 0;
+    exceeded_elapsed = 0;
+    ASSERT_TRUE(cat_watchdog_run(nullptr, 1000 * 1000, CAT_WATCH_DOG_THRESHOLD_DISABLED, [](cat_watchdog_t *watchdog) { }));
+    DEFER(cat_watchdog_stop());
+    ASSERT_EQ(cat_watchdog_set_budget_handler([](cat_coroutine_t *coroutine, cat_nsec_t elapsed) -> cat_bool_t {
+        exceeded_id = cat_coroutine_get_id(coroutine);
+        exceeded_elapsed = elapsed;
+        return cat_true;
+    }), nullptr);
+
+    /* unlimited */
+    cat_nsec_t end = cat_time_nsec() + budget * 2;
+    while (cat_time_nsec() < end) {
+        ASSERT_FALSE(cat_watchdog_check_budget());
+    }
+
+    cat_coroutine_id_t id = 0;
+    co([&] {
+        id = cat_coroutine_get_current_id();
+        cat_coroutine_set_budget(cat_coroutine_get_current(), budget);
+        ASSERT_EQ(cat_coroutine_get_budget(cat_coroutine_get_current()), budget);
+        cat_nsec_t end = cat_time_nsec() + 1000 * 1000 * 1000;
+        while (cat_time_nsec() < end) {
+            if (cat_watchdog_check_budget()) {
+                exceeded++;
+                break;
+            }
+        }
+    });
+    /* it yielded in check */
+    ASSERT_EQ(exceeded, 0);
+    ASSERT_TRUE(cat_coroutine_wait_all());
+    ASSERT_EQ(exceeded, 1);
+
+    ASSERT_EQ(exceeded_id, id);
+    ASSERT_GT(exceeded_elapsed, budget);
+    ASSERT_LT(exceeded_elapsed, 1000 * 1000 * 1000);
 }
@@ -59,3 +59,483 @@ TEST(cat_work, cancel)
     });
     cat_coroutine_resume(coroutine, nullptr, nullptr);
 }
+
+TEST(cat_work, many)
+{
+    std::array<int, 64> values;
+    std::array<cat_data_t *, 64> data;
+    size_t cleanup_count = 0;
+    static size_t *cleanup_count_ptr;
+
+    for (size_t n = 0; n < values.size(); n++) {
+        values[n] = (int) n;
+        data[n] = &values[n];
+    }
+    cleanup_count_ptr = &cleanup_count;
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) {
+        int *value = (int *) data;
+        *value *= 2;
+    }, [](cat_data_t *data) {
+        (*cleanup_count_ptr)++;
+    }, data.data(), data.size(), TEST_IO_TIMEOUT));
+    for (size_t n = 0; n < values.size(); n++) {
+        ASSERT_EQ(values[n], (int) n * 2);
+    }
+    /* cleanup of the last one is called after we were resumed */
+    ASSERT_TRUE(work(CAT_WORK_KIND_CPU, [] { }, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cleanup_count, values.size());
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) { }, nullptr, nullptr, 0, TEST_IO_TIMEOUT));
+}
+
+TEST(cat_work, many_timeout)
+{
+    std::array<cat_data_t *, 8> data = { };
+    ASSERT_FALSE(cat_work_many(CAT_WORK_KIND_SLOW_IO, [](cat_data_t *data) {
+        cat_sys_usleep(50 * 1000);
+    }, nullptr, data.data(), data.size(), 1));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+}
+
+TEST(cat_work, many_cancel)
+{
+    cat_coroutine_t *coroutine = co([] {
+        std::array<cat_data_t *, 8> data = { };
+        ASSERT_FALSE(cat_work_many(CAT_WORK_KIND_SLOW_IO, [](cat_data_t *data) {
+            cat_sys_usleep(1000);
+        }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+        ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+    });
+    cat_coroutine_resume(coroutine, nullptr, nullptr);
+}
+
+TEST(cat_work, stats)
+{
+    const cat_work_stats_t *stats = cat_work_get_stats();
+    const cat_work_kind_stats_t *cpu_stats = &stats->kinds[CAT_WORK_KIND_CPU];
+    std::array<cat_data_t *, 16> data = { };
+    uint64_t histogram_count = 0;
+
+    cat_work_reset_stats();
+    ASSERT_EQ(cpu_stats->completed_count, 0);
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) { }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+    ASSERT_TRUE(work(CAT_WORK_KIND_CPU, [] { }, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cpu_stats->completed_count, data.size() + 1);
+    ASSERT_EQ(cpu_stats->queue_depth, 0);
+    ASSERT_GE(cpu_stats->max_queue_depth, data.size());
+    for (auto count : cpu_stats->latency_histogram) {
+        histogram_count += count;
+    }
+    ASSERT_EQ(histogram_count, cpu_stats->completed_count);
+    /* contexts are reused */
+    ASSERT_GE(stats->cached_context_count, data.size());
+}
+
+TEST(cat_work, parallel_for)
+{
+    std::vector<uint8_t> values(100000, 0);
+    const cat_work_kind_stats_t *stats = &cat_work_get_stats()->kinds[CAT_WORK_KIND_CPU];
+
+    cat_work_reset_stats();
+    ASSERT_TRUE(cat_work_parallel_for(CAT_WORK_KIND_CPU, 0, values.size(), 0, [](size_t begin, size_t end, cat_data_t *data) {
+        std::vector<uint8_t> *values = (std::vector<uint8_t> *) data;
+        for (size_t n = begin; n < end; n++) {
+            (*values)[n]++;
+        }
+    }, &values, TEST_IO_TIMEOUT));
+    for (auto value : values) {
+        ASSERT_EQ(value, 1);
+    }
+    /* it is chunked adaptively, rather than one work per item */
+    ASSERT_GT(stats->completed_count, 1);
+    ASSERT_LT(stats->completed_count, 1024);
+
+    /* grain is respected */
+    cat_work_reset_stats();
+    ASSERT_TRUE(cat_work_parallel_for(CAT_WORK_KIND_CPU, 10, 20, 6, [](size_t begin, size_t end, cat_data_t *data) {
+        ASSERT_LE(end - begin, 6);
+    }, nullptr, TEST_IO_TIMEOUT));
+    ASSERT_EQ(stats->completed_count, 2);
+
+    /* empty range */
+    ASSERT_TRUE(cat_work_parallel_for(CAT_WORK_KIND_CPU, 1, 1, 0, [](size_t begin, size_t end, cat_data_t *data) {
+        abort();
+    }, nullptr, TEST_IO_TIMEOUT));
+}
+
+TEST(cat_work, map_reduce)
+{
+    const uint64_t count = 1000000;
+    uint64_t sum = 0;
+
+    ASSERT_TRUE(cat_work_map_reduce(CAT_WORK_KIND_CPU, 1, count + 1, 1000, [](size_t begin, size_t end, void *partial, cat_data_t *data) {
+        uint64_t *sum = (uint64_t *) partial;
+        for (size_t n = begin; n < end; n++) {
+            *sum += n;
+        }
+    }, [](void *result, const void *partial, cat_data_t *data) {
+        *((uint64_t *) result) += *((const uint64_t *) partial);
+    }, &sum, sizeof(sum), nullptr, TEST_IO_TIMEOUT));
+    ASSERT_EQ(sum, count * (count + 1) / 2);
+
+    /* partial is initialized with the initial value of result */
+    uint64_t max = 7;
+    ASSERT_TRUE(cat_work_map_reduce(CAT_WORK_KIND_CPU, 0, 5, 0, [](size_t begin, size_t end, void *partial, cat_data_t *data) {
+        uint64_t *max = (uint64_t *) partial;
+        for (size_t n = begin; n < end; n++) {
+            *max = std::max(*max, (uint64_t) n);
+        }
+    }, [](void *result, const void *partial, cat_data_t *data) {
+        *((uint64_t *) result) = std::max(*((uint64_t *) result), *((const uint64_t *) partial));
+    }, &max, sizeof(max), nullptr, TEST_IO_TIMEOUT));
+    ASSERT_EQ(max, 7);
+}
+
+TEST(cat_work, parallel_timeout)
+{
+    static cat_atomic_uint64_t slices;
+    const size_t count = 1000;
+
+    cat_atomic_uint64_init(&slices, 0);
+    ASSERT_FALSE(cat_work_parallel_for(CAT_WORK_KIND_CPU, 0, count, 1, [](size_t begin, size_t end, cat_data_t *data) {
+        (void) cat_atomic_uint64_fetch_add(&slices, 1);
+        cat_sys_usleep(1000);
+    }, nullptr, 10));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    /* running chunks stop at the next slice */
+    cat_time_msleep(50);
+    uint64_t executed = cat_atomic_uint64_load(&slices);
+    ASSERT_LT(executed, count);
+    cat_time_msleep(50);
+    ASSERT_EQ(cat_atomic_uint64_load(&slices), executed);
+}
+
+static bool test_work_pool_wait_running(cat_work_pool_t *pool, size_t running_count)
+{
+    cat_work_pool_stats_t stats;
+
+    for (int n = 0; n < 1000; n++) {
+        cat_work_pool_get_stats(pool, &stats);
+        if (stats.running_count == running_count) {
+            return true;
+        }
+        cat_time_msleep(1);
+    }
+
+    return false;
+}
+
+TEST(cat_work_pool, base)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_stats_t stats;
+    cat_work_pool_t *pool;
+    std::array<int, 32> values;
+    std::array<cat_data_t *, 32> data;
+
+    cat_work_pool_options_init(&options);
+    options.name = "test";
+    options.thread_count = 2;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+    ASSERT_STREQ(cat_work_pool_get_name(pool), "test");
+
+    ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+        *((int *) data) = 1;
+    }, nullptr, &values[0], TEST_IO_TIMEOUT));
+    ASSERT_EQ(values[0], 1);
+
+    /* route all of works of the kind to the pool */
+    cat_work_set_pool(CAT_WORK_KIND_CPU, pool);
+    ASSERT_EQ(cat_work_get_pool(CAT_WORK_KIND_CPU), pool);
+    for (size_t n = 0; n < values.size(); n++) {
+        values[n] = (int) n;
+        data[n] = &values[n];
+    }
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) {
+        *((int *) data) *= 2;
+    }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+    for (size_t n = 0; n < values.size(); n++) {
+        ASSERT_EQ(values[n], (int) n * 2);
+    }
+    ASSERT_TRUE(work(CAT_WORK_KIND_CPU, [] { }, TEST_IO_TIMEOUT));
+
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.thread_count, 2);
+    ASSERT_EQ(stats.completed_count, values.size() + 2);
+    ASSERT_EQ(stats.queue_depth, 0);
+    ASSERT_EQ(stats.running_count, 0);
+    ASSERT_EQ(stats.rejected_count, 0);
+    ASSERT_GT(stats.max_queue_depth, 0);
+    ASSERT_GE(stats.utilization, 0);
+    ASSERT_LE(stats.utilization, 1);
+
+    cat_work_set_pool(CAT_WORK_KIND_CPU, nullptr);
+    ASSERT_EQ(cat_work_get_pool(CAT_WORK_KIND_CPU), nullptr);
+}
+
+TEST(cat_work_pool, close_unroutes)
+{
+    cat_work_pool_t *pool = cat_work_pool_create(nullptr);
+    ASSERT_NE(pool, nullptr);
+    cat_work_set_pool(CAT_WORK_KIND_SLOW_IO, pool);
+    cat_work_pool_close(pool);
+    ASSERT_EQ(cat_work_get_pool(CAT_WORK_KIND_SLOW_IO), nullptr);
+}
+
+TEST(cat_work_pool, invalid_options)
+{
+    cat_work_pool_options_t options;
+    int cpu = INT_MAX;
+
+    cat_work_pool_options_init(&options);
+    options.thread_count = 0;
+    ASSERT_EQ(cat_work_pool_create(&options), nullptr);
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+
+    cat_work_pool_options_init(&options);
+    options.cpus = &cpu;
+    options.cpu_count = 1;
+    ASSERT_EQ(cat_work_pool_create(&options), nullptr);
+}
+
+TEST(cat_work_pool, reject)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_stats_t stats;
+    cat_work_pool_t *pool;
+    uv_sem_t sem;
+    wait_group wg;
+
+    ASSERT_EQ(uv_sem_init(&sem, 0), 0);
+    DEFER(uv_sem_destroy(&sem));
+    cat_work_pool_options_init(&options);
+    options.thread_count = 1;
+    options.max_queue_size = 1;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+
+    /* make sure that threads can exit even if assertion failed */
+    DEFER(uv_sem_post(&sem); uv_sem_post(&sem));
+    /* the first one occupies the thread and the second one occupies the queue */
+    for (int n = 0; n < 2; n++) {
+        co([&] {
+            wg++;
+            DEFER(wg--);
+            ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+                uv_sem_wait((uv_sem_t *) data);
+            }, nullptr, &sem, TEST_IO_TIMEOUT));
+        });
+        if (n == 0) {
+            ASSERT_TRUE(test_work_pool_wait_running(pool, 1));
+        }
+    }
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.running_count, 1);
+    ASSERT_EQ(stats.queue_depth, 1);
+
+    bool cleaned = false;
+    ASSERT_FALSE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) { }, [](cat_data_t *data) {
+        *((bool *) data) = true;
+    }, &cleaned, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAGAIN);
+    ASSERT_TRUE(cleaned);
+
+    cat_work_set_pool(CAT_WORK_KIND_CPU, pool);
+    std::array<cat_data_t *, 4> data = { };
+    ASSERT_FALSE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) { }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EAGAIN);
+    cat_work_set_pool(CAT_WORK_KIND_CPU, nullptr);
+
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.rejected_count, 2);
+}
+
+TEST(cat_work_pool, timeout)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_stats_t stats;
+    cat_work_pool_t *pool;
+    uv_sem_t sem;
+    bool executed = false;
+
+    ASSERT_EQ(uv_sem_init(&sem, 0), 0);
+    DEFER(uv_sem_destroy(&sem));
+    cat_work_pool_options_init(&options);
+    options.thread_count = 1;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+
+    co([&] {
+        ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+            uv_sem_wait((uv_sem_t *) data);
+        }, nullptr, &sem, TEST_IO_TIMEOUT));
+    });
+    /* it is still waiting in the queue, so it should be canceled and never be executed */
+    ASSERT_FALSE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+        *((bool *) data) = true;
+    }, nullptr, &executed, 1));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_ETIMEDOUT);
+    uv_sem_post(&sem);
+    /* wait for the cancellation to be delivered */
+    ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) { }, nullptr, nullptr, TEST_IO_TIMEOUT));
+    ASSERT_FALSE(executed);
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.canceled_count, 1);
+}
+
+TEST(cat_work_pool, close_with_waiting)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_t *pool;
+    wait_group wg;
+
+    cat_work_pool_options_init(&options);
+    options.thread_count = 1;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+            cat_sys_usleep(50 * 1000);
+        }, nullptr, nullptr, TEST_IO_TIMEOUT));
+    });
+    ASSERT_TRUE(test_work_pool_wait_running(pool, 1));
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        ASSERT_FALSE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) { }, nullptr, nullptr, TEST_IO_TIMEOUT));
+        ASSERT_EQ(cat_get_last_error_code(), CAT_ECANCELED);
+    });
+    /* waiting one is canceled and running one is waited */
+    cat_work_pool_close(pool);
+    ASSERT_TRUE(wg());
+}
+
+TEST(cat_work_pool, resize)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_stats_t stats;
+    cat_work_pool_t *pool;
+    std::array<cat_data_t *, 64> data = { };
+
+    cat_work_pool_options_init(&options);
+    options.thread_count = 1;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+
+    ASSERT_TRUE(cat_work_pool_set_thread_count(pool, 8));
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.thread_count, 8);
+    cat_work_set_pool(CAT_WORK_KIND_FAST_IO, pool);
+    DEFER(cat_work_set_pool(CAT_WORK_KIND_FAST_IO, nullptr));
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_FAST_IO, [](cat_data_t *data) {
+        cat_sys_usleep(100);
+    }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+
+    ASSERT_TRUE(cat_work_pool_set_thread_count(pool, 2));
+    for (int n = 0; n < 100; n++) {
+        cat_work_pool_get_stats(pool, &stats);
+        if (stats.thread_count == 2) {
+            break;
+        }
+        cat_time_msleep(1);
+    }
+    ASSERT_EQ(stats.thread_count, 2);
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_FAST_IO, [](cat_data_t *data) { }, nullptr, data.data(), data.size(), TEST_IO_TIMEOUT));
+
+    ASSERT_FALSE(cat_work_pool_set_thread_count(pool, 0));
+    ASSERT_EQ(cat_get_last_error_code(), CAT_EINVAL);
+}
+
+TEST(cat_work_pool, affinity)
+{
+    SKIP_IF_(uv_cpumask_size() <= 0, "CPU affinity is not supported");
+    cat_work_pool_options_t options;
+    cat_work_pool_t *pool;
+    int cpu = 0;
+
+    cat_work_pool_options_init(&options);
+    options.thread_count = 1;
+    options.cpus = &cpu;
+    options.cpu_count = 1;
+    pool = cat_work_pool_create(&options);
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+
+    std::vector<char> cpumask(uv_cpumask_size(), 0);
+    ASSERT_TRUE(cat_work_ex(CAT_WORK_KIND_CPU, pool, [](cat_data_t *data) {
+        std::vector<char> *cpumask = (std::vector<char> *) data;
+        uv_thread_t tid = uv_thread_self();
+        (void) uv_thread_getaffinity(&tid, cpumask->data(), cpumask->size());
+    }, nullptr, &cpumask, TEST_IO_TIMEOUT));
+    ASSERT_EQ(cpumask[0], 1);
+    for (size_t n = 1; n < cpumask.size(); n++) {
+        ASSERT_EQ(cpumask[n], 0);
+    }
+}
+
+TEST(cat_work_pool, dns)
+{
+    cat_work_pool_t *pool = cat_work_pool_create(nullptr);
+    struct addrinfo *response;
+
+    ASSERT_NE(pool, nullptr);
+    DEFER(cat_work_pool_close(pool));
+    cat_work_set_pool(CAT_WORK_KIND_SLOW_IO, pool);
+    DEFER(cat_work_set_pool(CAT_WORK_KIND_SLOW_IO, nullptr));
+
+    response = cat_dns_getaddrinfo("127.0.0.1", "80", nullptr);
+    ASSERT_NE(response, nullptr);
+    cat_dns_freeaddrinfo(response);
+
+    cat_work_pool_stats_t stats;
+    cat_work_pool_get_stats(pool, &stats);
+    ASSERT_EQ(stats.completed_count, 1);
+}
+
+TEST(cat_work_pool, isolation)
+{
+    cat_work_pool_options_t options;
+    cat_work_pool_t *slow_pool, *cpu_pool;
+    const size_t slow_count = 64, cpu_count = 256;
+    std::vector<cat_data_t *> slow_data(slow_count, nullptr), cpu_data(cpu_count, nullptr);
+    cat_work_pool_stats_t stats;
+    wait_group wg;
+
+    cat_work_pool_options_init(&options);
+    options.name = "slow";
+    options.thread_count = 2;
+    slow_pool = cat_work_pool_create(&options);
+    ASSERT_NE(slow_pool, nullptr);
+    DEFER(cat_work_pool_close(slow_pool));
+    options.name = "cpu";
+    cpu_pool = cat_work_pool_create(&options);
+    ASSERT_NE(cpu_pool, nullptr);
+    DEFER(cat_work_pool_close(cpu_pool));
+    cat_work_set_pool(CAT_WORK_KIND_FAST_IO, slow_pool);
+    DEFER(cat_work_set_pool(CAT_WORK_KIND_FAST_IO, nullptr));
+    cat_work_set_pool(CAT_WORK_KIND_CPU, cpu_pool);
+    DEFER(cat_work_set_pool(CAT_WORK_KIND_CPU, nullptr));
+
+    /* e.g. fsync() on a slow disk, they take at least 64ms on 2 threads */
+    co([&] {
+        wg++;
+        DEFER(wg--);
+        ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_FAST_IO, [](cat_data_t *data) {
+            cat_sys_usleep(2000);
+        }, nullptr, slow_data.data(), slow_data.size(), TEST_IO_TIMEOUT));
+    });
+    /* CPU works are not queued behind slow ones */
+    ASSERT_TRUE(cat_work_many(CAT_WORK_KIND_CPU, [](cat_data_t *data) { }, nullptr, cpu_data.data(), cpu_data.size(), TEST_IO_TIMEOUT));
+    cat_work_pool_get_stats(slow_pool, &stats);
+    ASSERT_LT(stats.completed_count, slow_count);
+    cat_work_pool_get_stats(cpu_pool, &stats);
+    ASSERT_EQ(stats.completed_count, cpu_count);
+    ASSERT_TRUE(wg());
+}